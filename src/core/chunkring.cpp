@@ -0,0 +1,184 @@
+module;
+#include <QMutexLocker>
+#include <cstring>
+#include <utility>
+
+module raad.core.chunkring;
+
+BufferSlice BufferSlice::fromBytes(const QByteArray& bytes)
+{
+    auto block = std::make_shared<BufferBlock>();
+    block->bytes = bytes;
+    BufferSlice slice;
+    slice.block = std::move(block);
+    slice.length = bytes.size();
+    return slice;
+}
+
+BlockPool& BlockPool::instance()
+{
+    static BlockPool pool;
+    return pool;
+}
+
+std::shared_ptr<BufferBlock> BlockPool::acquire()
+{
+    BufferBlock* block = nullptr;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_idle.empty()) {
+            block = m_idle.back();
+            m_idle.pop_back();
+        }
+    }
+    if (!block) {
+        block = new BufferBlock;
+        block->bytes = QByteArray(static_cast<qsizetype>(kBlockSize), Qt::Uninitialized);
+        block->pooled = true;
+    }
+    m_inUse += kBlockSize;
+    return std::shared_ptr<BufferBlock>(block, [this](BufferBlock* released) { release(released); });
+}
+
+void BlockPool::release(BufferBlock* block)
+{
+    m_inUse -= kBlockSize;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (static_cast<qint64>(m_idle.size() + 1) * kBlockSize <= m_idleLimit) {
+            m_idle.push_back(block);
+            return;
+        }
+    }
+    delete block;
+}
+
+qint64 BlockPool::idleBytes() const
+{
+    QMutexLocker lock(&m_mutex);
+    return static_cast<qint64>(m_idle.size()) * kBlockSize;
+}
+
+qint64 BlockPool::idleLimit() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_idleLimit;
+}
+
+void BlockPool::setIdleLimit(qint64 bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_idleLimit = qMax<qint64>(0, bytes);
+    while (!m_idle.empty() && static_cast<qint64>(m_idle.size()) * kBlockSize > m_idleLimit) {
+        delete m_idle.back();
+        m_idle.pop_back();
+    }
+}
+
+char* ChunkRing::tailSpace(qint64* space)
+{
+    if (m_blocks.empty() || m_tail >= m_blocks.back()->bytes.size()) {
+        m_blocks.push_back(BlockPool::instance().acquire());
+        m_tail = 0;
+    }
+    BufferBlock* block = m_blocks.back().get();
+    *space = block->bytes.size() - m_tail;
+    return block->bytes.data() + m_tail;
+}
+
+qint64 ChunkRing::readFrom(QIODevice* device, qint64 maxBytes)
+{
+    if (!device) return 0;
+    qint64 total = 0;
+    while (maxBytes < 0 || total < maxBytes) {
+        const qint64 available = device->bytesAvailable();
+        if (available <= 0) break;
+        qint64 space = 0;
+        char* dst = tailSpace(&space);
+        qint64 want = qMin(space, available);
+        if (maxBytes >= 0) want = qMin(want, maxBytes - total);
+        const qint64 got = device->read(dst, want);
+        if (got <= 0) break;
+        m_tail += got;
+        m_size += got;
+        total += got;
+    }
+    return total;
+}
+
+void ChunkRing::append(const char* data, qint64 size)
+{
+    while (size > 0) {
+        qint64 space = 0;
+        char* dst = tailSpace(&space);
+        const qint64 n = qMin(space, size);
+        std::memcpy(dst, data, static_cast<size_t>(n));
+        m_tail += n;
+        m_size += n;
+        data += n;
+        size -= n;
+    }
+}
+
+QVector<BufferSlice> ChunkRing::peek(qint64 maxBytes) const
+{
+    QVector<BufferSlice> slices;
+    qint64 left = (maxBytes < 0) ? m_size : qMin(maxBytes, m_size);
+    const size_t count = m_blocks.size();
+    for (size_t i = 0; i < count && left > 0; ++i) {
+        const qint64 begin = (i == 0) ? m_head : 0;
+        const qint64 end = (i + 1 == count) ? m_tail : m_blocks[i]->bytes.size();
+        const qint64 length = qMin(left, end - begin);
+        if (length <= 0) continue;
+        slices.append(BufferSlice { m_blocks[i], begin, length });
+        left -= length;
+    }
+    return slices;
+}
+
+void ChunkRing::consume(qint64 bytes)
+{
+    bytes = qMin(bytes, m_size);
+    m_size -= bytes;
+    while (bytes > 0 && !m_blocks.empty()) {
+        const bool last = m_blocks.size() == 1;
+        const qint64 end = last ? m_tail : m_blocks.front()->bytes.size();
+        const qint64 n = qMin(bytes, end - m_head);
+        m_head += n;
+        bytes -= n;
+        if (m_head >= end && !last) {
+            m_blocks.pop_front();
+            m_head = 0;
+        }
+    }
+    if (m_size == 0) {
+        // Keep no partially used block around; a fresh one is taken on the next read.
+        m_blocks.clear();
+        m_head = 0;
+        m_tail = 0;
+    }
+}
+
+QVector<BufferSlice> ChunkRing::takeAll()
+{
+    QVector<BufferSlice> slices = peek();
+    clear();
+    return slices;
+}
+
+void ChunkRing::clear()
+{
+    m_blocks.clear();
+    m_head = 0;
+    m_tail = 0;
+    m_size = 0;
+}
+
+qint64 ChunkRing::memoryBytes() const
+{
+    qint64 total = 0;
+    for (const std::shared_ptr<BufferBlock>& block : m_blocks) {
+        total += block->bytes.size();
+    }
+    return total;
+}
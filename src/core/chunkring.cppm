@@ -0,0 +1,167 @@
+/*!
+ * @file        chunkring.cppm
+ * @brief       Pooled block buffers for downloaded data awaiting disk writes.
+ * @details     Network reads land directly in fixed-size blocks taken from a
+ *              process-wide pool. A ring of blocks per segment (or single
+ *              stream) hands out read-only slices that the disk writer
+ *              consumes with scatter-gather writes. Consuming data never moves
+ *              bytes, and blocks go back to the pool once the ring and every
+ *              in-flight write have released them.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QByteArray>
+#include <QIODevice>
+#include <QMutex>
+#include <QVector>
+#include <atomic>
+#include <deque>
+#include <memory>
+
+#ifndef Q_MOC_RUN
+export module raad.core.chunkring;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+/**
+ * @brief Fixed-capacity storage unit shared between a ring and the disk writer.
+ */
+RAAD_MODULE_EXPORT struct BufferBlock {
+    QByteArray bytes;                       //!< Backing storage (capacity == size).
+    bool pooled = false;                    //!< Return to the pool on release.
+};
+
+/**
+ * @brief Read-only view of a byte range inside a block.
+ *
+ * Holding a slice keeps its block alive, so slices may outlive the ring that
+ * produced them (e.g. while queued in the disk writer).
+ */
+RAAD_MODULE_EXPORT struct BufferSlice {
+    std::shared_ptr<const BufferBlock> block;   //!< Owning block.
+    qint64 offset = 0;                          //!< Start within the block.
+    qint64 length = 0;                          //!< Slice length in bytes.
+
+    //!< @brief Return a pointer to the first byte of the slice.
+    const char* data() const { return block->bytes.constData() + offset; }
+
+    //!< @brief Wrap an existing byte array without copying (not pooled).
+    static BufferSlice fromBytes(const QByteArray& bytes);
+};
+
+/**
+ * @brief Process-wide pool of fixed-size blocks.
+ *
+ * Thread-safe: blocks are acquired on the network thread and typically
+ * released on a disk writer thread.
+ */
+RAAD_MODULE_EXPORT class BlockPool {
+public:
+    static constexpr qint64 kBlockSize = 256 * 1024;            //!< Block capacity in bytes.
+
+    //!< @brief Return the shared pool.
+    static BlockPool& instance();
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    //!< @brief Take a block, reusing an idle one when possible.
+    std::shared_ptr<BufferBlock> acquire();
+
+    //!< @brief Return bytes held by blocks currently handed out.
+    qint64 inUseBytes() const { return m_inUse.load(); }
+
+    //!< @brief Return bytes held by idle blocks kept for reuse.
+    qint64 idleBytes() const;
+
+    //!< @brief Return the idle-block retention limit in bytes.
+    qint64 idleLimit() const;
+
+    /**
+     * @brief Set how many idle bytes the pool keeps instead of freeing.
+     * @param bytes Retention limit in bytes.
+     */
+    void setIdleLimit(qint64 bytes);
+
+private:
+    BlockPool() = default;
+
+    //!< @brief Take back a block whose last reference was dropped.
+    void release(BufferBlock* block);
+
+    mutable QMutex m_mutex;                                     //!< Guards the idle list.
+    std::deque<BufferBlock*> m_idle;                            //!< Blocks ready for reuse.
+    qint64 m_idleLimit = 64ll * 1024 * 1024;                    //!< Idle retention limit.
+    std::atomic<qint64> m_inUse { 0 };                          //!< Bytes handed out.
+};
+
+/**
+ * @brief FIFO byte queue built from pooled blocks.
+ *
+ * Data is appended at the tail (usually straight from a QIODevice) and
+ * consumed from the head as slices. Copies of a ring share blocks; rings are
+ * meant to be copied only while empty.
+ */
+RAAD_MODULE_EXPORT class ChunkRing {
+public:
+    /**
+     * @brief Read everything currently available from a device into the ring.
+     * @param device Source device (e.g. a QNetworkReply).
+     * @param maxBytes Upper bound on bytes to read (-1 = unbounded).
+     * @return Bytes read.
+     */
+    qint64 readFrom(QIODevice* device, qint64 maxBytes = -1);
+
+    /**
+     * @brief Append bytes to the ring.
+     * @param data Source pointer.
+     * @param size Byte count.
+     */
+    void append(const char* data, qint64 size);
+
+    /**
+     * @brief Return slices covering up to @p maxBytes from the head without consuming them.
+     * @param maxBytes Upper bound (-1 = everything).
+     */
+    QVector<BufferSlice> peek(qint64 maxBytes = -1) const;
+
+    /**
+     * @brief Drop bytes from the head.
+     * @param bytes Byte count (clamped to size()).
+     */
+    void consume(qint64 bytes);
+
+    //!< @brief Remove and return slices covering the whole ring.
+    QVector<BufferSlice> takeAll();
+
+    //!< @brief Drop all data and release the blocks.
+    void clear();
+
+    //!< @brief Return buffered payload bytes.
+    qint64 size() const { return m_size; }
+
+    //!< @brief Return whether the ring holds no data.
+    bool isEmpty() const { return m_size == 0; }
+
+    //!< @brief Return block memory held by the ring.
+    qint64 memoryBytes() const;
+
+private:
+    //!< @brief Return writable space at the tail, adding a block when full.
+    char* tailSpace(qint64* space);
+
+    std::deque<std::shared_ptr<BufferBlock>> m_blocks;          //!< Blocks in FIFO order.
+    qint64 m_head = 0;                                          //!< Read offset in the first block.
+    qint64 m_tail = 0;                                          //!< Fill level of the last block.
+    qint64 m_size = 0;                                          //!< Buffered payload bytes.
+};
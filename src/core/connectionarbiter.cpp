@@ -0,0 +1,97 @@
+module;
+#include <QHash>
+#include <QString>
+#include <QtGlobal>
+
+module raad.core.connectionarbiter;
+
+namespace {
+
+//!< Weight of a claimant; the default task priority (100) weighs 101.
+qint64 weightOf(int priority)
+{
+    return 1 + qMax(0, priority);
+}
+
+} // namespace
+
+ConnectionArbiter& ConnectionArbiter::instance()
+{
+    static ConnectionArbiter arbiter;
+    return arbiter;
+}
+
+void ConnectionArbiter::setBudget(int connections)
+{
+    m_budget = qMax(1, connections);
+}
+
+ConnectionArbiter::Claim& ConnectionArbiter::claimFor(const void* owner, const QString& host, int priority, int held)
+{
+    Claim& claim = m_claims[owner];
+    claim.host = host;
+    claim.priority = priority;
+    claim.held = qMax(0, held);
+    return claim;
+}
+
+void ConnectionArbiter::report(const void* owner, const QString& host, int priority, int held)
+{
+    if (!owner || host.isEmpty()) return;
+    Claim& claim = claimFor(owner, host, priority, held);
+    if (claim.held == 0) claim.waiting = false;
+}
+
+int ConnectionArbiter::request(const void* owner, const QString& host, int priority, int held, int wanted)
+{
+    if (!owner || host.isEmpty() || wanted <= 0) return qMax(0, wanted);
+    Claim& claim = claimFor(owner, host, priority, held);
+
+    const int free = m_budget - hostConnections(host);
+    if (free <= 0) {
+        claim.waiting = true;
+        return 0;
+    }
+
+    const int share = fairShare(owner);
+    if (claim.held >= share) {
+        // Free slots go to waiting claimants below their share first.
+        for (auto it = m_claims.cbegin(); it != m_claims.cend(); ++it) {
+            if (it.key() == owner || it->host != host || !it->waiting) continue;
+            if (it->held < fairShare(it.key())) {
+                claim.waiting = true;
+                return 0;
+            }
+        }
+    }
+
+    const int granted = qMin(wanted, free);
+    claim.held += granted;
+    claim.waiting = false;
+    return granted;
+}
+
+void ConnectionArbiter::leave(const void* owner)
+{
+    m_claims.remove(owner);
+}
+
+int ConnectionArbiter::hostConnections(const QString& host) const
+{
+    int total = 0;
+    for (const Claim& claim : m_claims) {
+        if (claim.host == host) total += claim.held;
+    }
+    return total;
+}
+
+int ConnectionArbiter::fairShare(const void* owner) const
+{
+    const auto found = m_claims.constFind(owner);
+    if (found == m_claims.cend()) return 0;
+    qint64 totalWeight = 0;
+    for (const Claim& claim : m_claims) {
+        if (claim.host == found->host) totalWeight += weightOf(claim.priority);
+    }
+    return qMax<int>(1, static_cast<int>(m_budget * weightOf(found->priority) / qMax<qint64>(1, totalWeight)));
+}
@@ -0,0 +1,107 @@
+/*!
+ * @file        connectionarbiter.cppm
+ * @brief       Per-host connection budget shared by all download tasks.
+ * @details     The task limit per host says nothing about sockets: every
+ *              task may split into many segments, each with its own
+ *              connection. The arbiter owns one connection budget per host.
+ *              Tasks report the connections they hold and ask before opening
+ *              more, so a host sees at most the budget however many tasks
+ *              target it.
+ *
+ *              Slots are shared by priority. A task below its weighted share
+ *              gets free slots first. A task at or above its share only gets
+ *              slots nobody below their share is waiting for. Connections are
+ *              never taken away; slots move to waiting tasks as segments
+ *              finish.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QHash>
+#include <QString>
+
+#ifndef Q_MOC_RUN
+export module raad.core.connectionarbiter;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+/**
+ * @brief Process-wide per-host connection budget.
+ *
+ * Claimants are identified by an opaque pointer (the task). Not thread-safe:
+ * use it from the thread that runs the download engine.
+ */
+RAAD_MODULE_EXPORT class ConnectionArbiter {
+public:
+    static constexpr int kDefaultBudget = 16;           //!< Connections per host unless configured.
+
+    //!< @brief Return the shared arbiter.
+    static ConnectionArbiter& instance();
+
+    ConnectionArbiter(const ConnectionArbiter&) = delete;
+    ConnectionArbiter& operator=(const ConnectionArbiter&) = delete;
+
+    //!< @brief Set the connection budget of every host (at least 1).
+    void setBudget(int connections);
+
+    //!< @brief Return the per-host connection budget.
+    int budget() const { return m_budget; }
+
+    /**
+     * @brief Record the connections a claimant holds without asking for more.
+     * @param owner Claimant.
+     * @param host Normalized host the connections go to.
+     * @param priority Claimant priority (higher gets a larger share).
+     * @param held Connections currently open.
+     */
+    void report(const void* owner, const QString& host, int priority, int held);
+
+    /**
+     * @brief Ask for more connections to a host.
+     *
+     * The grant is counted as held right away; the next report() or
+     * request() replaces it with the real count.
+     *
+     * @param owner Claimant.
+     * @param host Normalized host.
+     * @param priority Claimant priority.
+     * @param held Connections currently open.
+     * @param wanted Additional connections wanted.
+     * @return Connections granted, 0..@p wanted.
+     */
+    int request(const void* owner, const QString& host, int priority, int held, int wanted);
+
+    //!< @brief Forget a claimant, freeing everything it held.
+    void leave(const void* owner);
+
+    //!< @brief Return the connections held to a host across all claimants.
+    int hostConnections(const QString& host) const;
+
+    //!< @brief Return a claimant's share of its host's budget (0 if unknown).
+    int fairShare(const void* owner) const;
+
+private:
+    ConnectionArbiter() = default;
+
+    struct Claim {
+        QString host;                       //!< Host the connections go to.
+        int priority = 0;                   //!< Claimant priority.
+        int held = 0;                       //!< Connections open (or just granted).
+        bool waiting = false;               //!< Last request was refused.
+    };
+
+    //!< @brief Insert or update a claim.
+    Claim& claimFor(const void* owner, const QString& host, int priority, int held);
+
+    QHash<const void*, Claim> m_claims;     //!< Claims by owner.
+    int m_budget = kDefaultBudget;          //!< Connections per host.
+};
@@ -0,0 +1,714 @@
+module;
+#include <QtGlobal>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QStorageInfo>
+#include <QThread>
+#include <QWaitCondition>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#if defined(Q_OS_UNIX)
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#if defined(RAAD_HAVE_IO_URING)
+#include <liburing.h>
+#endif
+
+module raad.core.diskwriter;
+
+import raad.core.chunkring;
+
+namespace {
+
+constexpr int kMaxWorkers = 4;
+constexpr int kMaxBatch = 64;               //!< Jobs taken per wake-up; also the ring depth.
+constexpr int kMaxIov = 64;                 //!< Slices per gathered call (well below IOV_MAX).
+
+} // namespace
+
+struct DiskWriterPool::Channel {
+    int id = 0;
+    Worker* worker = nullptr;
+    QObject* receiver = nullptr;
+    Completion done;
+    std::atomic<qint64> queuedBytes { 0 };
+
+    QMutex deliverMutex;                    // held while posting so close() cannot race a delivery
+    bool closed = false;
+
+    QMutex releaseMutex;
+    QWaitCondition releaseCond;
+    bool released = false;
+
+    QHash<int, QFile*> files;               // touched by the writer thread only
+};
+
+struct DiskWriterPool::Worker {
+    struct Entry {
+        std::shared_ptr<Channel> channel;
+        Job job;
+        bool release = false;
+    };
+
+    QThread* thread = nullptr;
+    QMutex mutex;
+    QWaitCondition cond;
+    std::deque<Entry> queue;
+    bool stopping = false;
+
+#if defined(RAAD_HAVE_IO_URING)
+    io_uring ring {};                       // touched by the writer thread only
+    bool ringReady = false;
+    bool ringFailed = false;
+#endif
+};
+
+namespace {
+
+QFile* fileForJob(QHash<int, QFile*>& files, const DiskWriterPool::Job& job, DiskWriterPool::Result& result)
+{
+    QFile* file = files.value(job.fileId, nullptr);
+    if (file || job.op == DiskWriterPool::Op::Close) return file;
+
+    file = new QFile(job.path);
+    // A sync flushes a file written earlier; it never creates one that has been moved away since.
+    QIODevice::OpenMode mode = QIODevice::ReadWrite | QIODevice::Unbuffered;
+    if (job.op == DiskWriterPool::Op::Sync) mode |= QIODevice::ExistingOnly;
+    if (!file->open(mode)) {
+        result.ok = false;
+        result.errorCode = QStringLiteral("open_failed");
+        result.errorMessage = QStringLiteral("Cannot open output file: %1").arg(job.path);
+        delete file;
+        return nullptr;
+    }
+    files.insert(job.fileId, file);
+    return file;
+}
+
+#if defined(Q_OS_UNIX)
+//!< Fill @p iov with the job's slices starting @p done bytes into the payload.
+void gatherSlices(const DiskWriterPool::Job& job, qint64 done, std::vector<iovec>& iov)
+{
+    iov.clear();
+    for (const BufferSlice& slice : job.data) {
+        if (done >= slice.length) {
+            done -= slice.length;
+            continue;
+        }
+        iov.push_back(iovec { const_cast<char*>(slice.data()) + done, static_cast<size_t>(slice.length - done) });
+        done = 0;
+        if (iov.size() == static_cast<size_t>(kMaxIov)) break;
+    }
+}
+#endif
+
+//!< Write the payload from @p done bytes on with blocking calls; returns the number of calls made.
+qint64 writeRemainder(QFile* file, const DiskWriterPool::Job& job, qint64 done, DiskWriterPool::Result& result)
+{
+    qint64 calls = 0;
+    const qint64 total = job.size();
+#if defined(Q_OS_UNIX)
+    std::vector<iovec> iov;
+    iov.reserve(kMaxIov);
+    while (done < total) {
+        gatherSlices(job, done, iov);
+        const ssize_t written = ::pwritev(file->handle(), iov.data(), static_cast<int>(iov.size()),
+                                          static_cast<off_t>(job.offset + done));
+        ++calls;
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            result.ok = false;
+            result.errorCode = QStringLiteral("write_failed");
+            result.errorMessage = written < 0 ? qt_error_string(errno) : QStringLiteral("No space left on device");
+            break;
+        }
+        done += written;
+        result.bytes += written;
+    }
+#else
+    qint64 skip = done;
+    for (const BufferSlice& slice : job.data) {
+        if (skip >= slice.length) {
+            skip -= slice.length;
+            continue;
+        }
+        if (!file->seek(job.offset + done)) {
+            result.ok = false;
+            break;
+        }
+        const char* data = slice.data() + skip;
+        qint64 left = slice.length - skip;
+        skip = 0;
+        while (left > 0) {
+            const qint64 written = file->write(data, left);
+            ++calls;
+            if (written <= 0) {
+                result.ok = false;
+                break;
+            }
+            data += written;
+            left -= written;
+            done += written;
+            result.bytes += written;
+        }
+        if (!result.ok) break;
+    }
+    if (!result.ok) {
+        result.errorCode = QStringLiteral("write_failed");
+        result.errorMessage = file->errorString();
+    }
+#endif
+    return calls;
+}
+
+//!< reserveBlocks() result when the platform or filesystem has no way to reserve.
+constexpr int kNoReservation = -1;
+
+#if defined(Q_OS_UNIX)
+//!< Whether an fallocate error means "not supported here" rather than a real failure.
+bool reservationUnsupported(int error)
+{
+    return error == EOPNOTSUPP || error == ENOSYS || error == EINVAL;
+}
+#endif
+
+//!< Reserve blocks for [offset, offset + length); returns 0, an errno value or kNoReservation.
+int reserveBlocks(QFile* file, qint64 offset, qint64 length, bool keepSize)
+{
+#if defined(Q_OS_LINUX)
+    int error = 0;
+    do {
+        error = ::fallocate(file->handle(), keepSize ? FALLOC_FL_KEEP_SIZE : 0,
+                            static_cast<off_t>(offset), static_cast<off_t>(length)) == 0 ? 0 : errno;
+    } while (error == EINTR);
+    return reservationUnsupported(error) ? kNoReservation : error;
+#elif defined(Q_OS_MACOS)
+    // Contiguous first, then any extents; both stay past EOF until the file grows over them.
+    fstore_t store { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(offset + length), 0 };
+    if (::fcntl(file->handle(), F_PREALLOCATE, &store) != 0) {
+        store.fst_flags = F_ALLOCATEALL;
+        if (::fcntl(file->handle(), F_PREALLOCATE, &store) != 0) {
+            return reservationUnsupported(errno) ? kNoReservation : errno;
+        }
+    }
+    return 0;
+#elif defined(Q_OS_UNIX)
+    if (keepSize) return kNoReservation;
+    const int error = ::posix_fallocate(file->handle(), static_cast<off_t>(offset), static_cast<off_t>(length));
+    return reservationUnsupported(error) ? kNoReservation : error;
+#else
+    // Growing a file on NTFS allocates it, which the caller's resize fallback does.
+    Q_UNUSED(file);
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+    Q_UNUSED(keepSize);
+    return kNoReservation;
+#endif
+}
+
+bool syncFile(QFile* file)
+{
+    if (!file->flush()) return false;
+#if defined(Q_OS_LINUX)
+    return ::fdatasync(file->handle()) == 0;
+#elif defined(Q_OS_UNIX)
+    return ::fsync(file->handle()) == 0;
+#else
+    return true;
+#endif
+}
+
+} // namespace
+
+
+DiskWriterPool& DiskWriterPool::instance()
+{
+    static DiskWriterPool pool;
+    return pool;
+}
+
+DiskWriterPool::DiskWriterPool() = default;
+
+DiskWriterPool::~DiskWriterPool()
+{
+    for (Worker* worker : std::as_const(m_workers)) {
+        {
+            QMutexLocker lock(&worker->mutex);
+            worker->stopping = true;
+        }
+        worker->cond.wakeAll();
+    }
+    for (Worker* worker : std::as_const(m_workers)) {
+        worker->thread->wait();
+        delete worker->thread;
+        delete worker;
+    }
+}
+
+DiskWriterPool::Worker* DiskWriterPool::workerForPath(const QString& targetPath)
+{
+    // Caller holds m_mutex.
+    const QStorageInfo storage(QFileInfo(targetPath).absolutePath());
+    QString device = storage.isValid() ? QString::fromUtf8(storage.device()) : QString();
+    if (device.isEmpty()) device = storage.rootPath();
+
+    if (Worker* existing = m_workersByDevice.value(device, nullptr)) {
+        return existing;
+    }
+    if (m_workers.size() >= kMaxWorkers) {
+        Worker* shared = m_workers.at(static_cast<int>(qHash(device) % m_workers.size()));
+        m_workersByDevice.insert(device, shared);
+        return shared;
+    }
+
+    auto* worker = new Worker;
+    worker->thread = QThread::create([this, worker] { runWorker(worker); });
+    worker->thread->setObjectName(QStringLiteral("raad-disk-writer-%1").arg(m_workers.size()));
+    worker->thread->start();
+    m_workers.append(worker);
+    m_workersByDevice.insert(device, worker);
+    return worker;
+}
+
+int DiskWriterPool::openChannel(const QString& targetPath, QObject* receiver, Completion done)
+{
+    auto channel = std::make_shared<Channel>();
+    channel->receiver = receiver;
+    channel->done = std::move(done);
+
+    QMutexLocker lock(&m_mutex);
+    channel->id = m_nextChannelId++;
+    channel->worker = workerForPath(targetPath);
+    m_channels.insert(channel->id, channel);
+    return channel->id;
+}
+
+void DiskWriterPool::closeChannel(int channelId, bool waitForRelease)
+{
+    std::shared_ptr<Channel> channel;
+    {
+        QMutexLocker lock(&m_mutex);
+        channel = m_channels.take(channelId);
+    }
+    if (!channel) return;
+
+    {
+        QMutexLocker lock(&channel->deliverMutex);
+        channel->closed = true;
+    }
+
+    Worker* worker = channel->worker;
+    {
+        QMutexLocker lock(&worker->mutex);
+        for (auto it = worker->queue.begin(); it != worker->queue.end();) {
+            if (it->channel == channel) {
+                channel->queuedBytes -= it->job.size();
+                it = worker->queue.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        Worker::Entry release;
+        release.channel = channel;
+        release.release = true;
+        worker->queue.push_front(std::move(release));
+    }
+    worker->cond.wakeOne();
+
+    if (waitForRelease) {
+        QMutexLocker lock(&channel->releaseMutex);
+        while (!channel->released) {
+            channel->releaseCond.wait(&channel->releaseMutex);
+        }
+    }
+}
+
+bool DiskWriterPool::submit(int channelId, Job job, bool force)
+{
+    std::shared_ptr<Channel> channel;
+    qint64 capacity = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        channel = m_channels.value(channelId);
+        capacity = m_channelCapacity;
+    }
+    if (!channel) return false;
+
+    const qint64 size = job.size();
+    if (!force && size > 0 && channel->queuedBytes.load() + size > capacity) {
+        return false;
+    }
+
+    Worker* worker = channel->worker;
+    {
+        QMutexLocker lock(&worker->mutex);
+        channel->queuedBytes += size;
+        Worker::Entry entry;
+        entry.channel = std::move(channel);
+        entry.job = std::move(job);
+        worker->queue.push_back(std::move(entry));
+    }
+    worker->cond.wakeOne();
+    return true;
+}
+
+qint64 DiskWriterPool::queuedBytes(int channelId) const
+{
+    QMutexLocker lock(&m_mutex);
+    const std::shared_ptr<Channel> channel = m_channels.value(channelId);
+    return channel ? channel->queuedBytes.load() : 0;
+}
+
+qint64 DiskWriterPool::totalQueuedBytes() const
+{
+    QMutexLocker lock(&m_mutex);
+    qint64 total = 0;
+    for (const std::shared_ptr<Channel>& channel : m_channels) {
+        total += channel->queuedBytes.load();
+    }
+    return total;
+}
+
+int DiskWriterPool::workerCount() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_workers.size();
+}
+
+qint64 DiskWriterPool::channelCapacity() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_channelCapacity;
+}
+
+void DiskWriterPool::setChannelCapacity(qint64 bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_channelCapacity = qMax<qint64>(256 * 1024, bytes);
+}
+
+void DiskWriterPool::setBackend(Backend backend)
+{
+    m_backend.store(static_cast<int>(backend));
+}
+
+DiskWriterPool::Backend DiskWriterPool::backend() const
+{
+    return static_cast<Backend>(m_backend.load());
+}
+
+DiskWriterPool::Backend DiskWriterPool::activeBackend() const
+{
+    return (backend() == Backend::IoUring && ioUringAvailable()) ? Backend::IoUring : Backend::Portable;
+}
+
+bool DiskWriterPool::ioUringAvailable()
+{
+#if defined(RAAD_HAVE_IO_URING)
+    // Kernels may lack io_uring entirely or have it disabled (io_uring_disabled sysctl, seccomp).
+    static const bool available = [] {
+        io_uring ring {};
+        if (io_uring_queue_init(2, &ring, 0) != 0) return false;
+        bool ok = false;
+        if (io_uring_probe* probe = io_uring_get_probe_ring(&ring)) {
+            ok = io_uring_opcode_supported(probe, IORING_OP_WRITE)
+                 && io_uring_opcode_supported(probe, IORING_OP_FSYNC);
+            io_uring_free_probe(probe);
+        }
+        io_uring_queue_exit(&ring);
+        return ok;
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+QString DiskWriterPool::backendName(Backend backend)
+{
+    return backend == Backend::IoUring ? QStringLiteral("io_uring") : QStringLiteral("qfile");
+}
+
+DiskWriterPool::Backend DiskWriterPool::backendFromName(const QString& name)
+{
+    return name.trimmed().compare(QStringLiteral("io_uring"), Qt::CaseInsensitive) == 0
+               ? Backend::IoUring
+               : Backend::Portable;
+}
+
+qint64 DiskWriterPool::bytesWritten() const
+{
+    return m_bytesWritten.load();
+}
+
+qint64 DiskWriterPool::submissionCount() const
+{
+    return m_submissions.load();
+}
+
+void DiskWriterPool::runWorker(Worker* worker)
+{
+    std::vector<Worker::Entry> batch;
+    std::vector<Result> results;
+    batch.reserve(kMaxBatch);
+    results.reserve(kMaxBatch);
+
+    for (;;) {
+        batch.clear();
+        {
+            QMutexLocker lock(&worker->mutex);
+            while (worker->queue.empty() && !worker->stopping) {
+                worker->cond.wait(&worker->mutex);
+            }
+            if (worker->queue.empty()) break;
+            while (!worker->queue.empty() && batch.size() < static_cast<size_t>(kMaxBatch)) {
+                batch.push_back(std::move(worker->queue.front()));
+                worker->queue.pop_front();
+            }
+        }
+
+        bool useRing = false;
+#if defined(RAAD_HAVE_IO_URING)
+        if (activeBackend() == Backend::IoUring) {
+            if (!worker->ringReady && !worker->ringFailed) {
+                worker->ringReady = io_uring_queue_init(kMaxBatch, &worker->ring, 0) == 0;
+                worker->ringFailed = !worker->ringReady;
+                if (worker->ringFailed) qWarning() << "io_uring setup failed; using QFile writes";
+            }
+            useRing = worker->ringReady;
+        } else if (worker->ringReady) {
+            io_uring_queue_exit(&worker->ring);
+            worker->ringReady = false;
+        }
+#endif
+
+        results.assign(batch.size(), Result {});
+        for (size_t i = 0; i < batch.size();) {
+            Worker::Entry& entry = batch[i];
+            Channel* channel = entry.channel.get();
+            if (entry.release) {
+                for (QFile* file : std::as_const(channel->files)) {
+                    file->close();
+                    delete file;
+                }
+                channel->files.clear();
+                QMutexLocker lock(&channel->releaseMutex);
+                channel->released = true;
+                channel->releaseCond.wakeAll();
+                ++i;
+                continue;
+            }
+
+#if defined(RAAD_HAVE_IO_URING)
+            // Consecutive writes cover disjoint ranges, so one submission can carry them all.
+            if (useRing && entry.job.op == Op::Write) {
+                size_t end = i;
+                while (end < batch.size() && !batch[end].release && batch[end].job.op == Op::Write) ++end;
+
+                QElapsedTimer timer;
+                timer.start();
+                std::vector<QFile*> files(end - i, nullptr);
+                std::vector<std::vector<iovec>> iovs(end - i);
+                std::vector<char> inFlight(end - i, 0);
+                unsigned pending = 0;
+                for (size_t k = i; k < end; ++k) {
+                    const Job& job = batch[k].job;
+                    Result& result = results[k];
+                    result.op = job.op;
+                    result.fileId = job.fileId;
+                    result.tag = job.tag;
+                    QFile* file = fileForJob(batch[k].channel->files, job, result);
+                    files[k - i] = file;
+                    if (!file || job.data.isEmpty()) continue;
+                    std::vector<iovec>& iov = iovs[k - i];
+                    gatherSlices(job, 0, iov);
+                    io_uring_sqe* sqe = io_uring_get_sqe(&worker->ring);
+                    io_uring_prep_writev(sqe, file->handle(), iov.data(), static_cast<unsigned>(iov.size()),
+                                         static_cast<__u64>(job.offset));
+                    io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<std::uintptr_t>(k)));
+                    inFlight[k - i] = 1;
+                    ++pending;
+                }
+                if (pending > 0) {
+                    io_uring_submit_and_wait(&worker->ring, pending);
+                    m_submissions += 1;
+                }
+                for (unsigned n = 0; n < pending; ++n) {
+                    io_uring_cqe* cqe = nullptr;
+                    if (io_uring_wait_cqe(&worker->ring, &cqe) != 0 || !cqe) break;
+                    const size_t k = static_cast<size_t>(reinterpret_cast<std::uintptr_t>(io_uring_cqe_get_data(cqe)));
+                    const int res = cqe->res;
+                    io_uring_cqe_seen(&worker->ring, cqe);
+                    inFlight[k - i] = 0;
+
+                    Result& result = results[k];
+                    if (res < 0) {
+                        result.ok = false;
+                        result.errorCode = QStringLiteral("write_failed");
+                        result.errorMessage = qt_error_string(-res);
+                        continue;
+                    }
+                    result.bytes = res;
+                    if (res < batch[k].job.size()) {
+                        // Short write (disk nearly full, or more slices than one call takes):
+                        // finish or surface the error synchronously.
+                        m_submissions += writeRemainder(files[k - i], batch[k].job, res, result);
+                    }
+                }
+                const qint64 elapsedMs = timer.elapsed();
+                bool lost = false;
+                for (size_t k = i; k < end; ++k) {
+                    if (inFlight[k - i]) {
+                        lost = true;
+                        results[k].ok = false;
+                        results[k].errorCode = QStringLiteral("write_failed");
+                        results[k].errorMessage = QStringLiteral("Lost io_uring completion");
+                    }
+                    results[k].elapsedMs = elapsedMs;
+                    m_bytesWritten += results[k].bytes;
+                }
+                if (lost) {
+                    // A ring that dropped completions cannot be trusted with later batches.
+                    qWarning() << "io_uring completion lost; using QFile writes";
+                    io_uring_queue_exit(&worker->ring);
+                    worker->ringReady = false;
+                    worker->ringFailed = true;
+                    useRing = false;
+                }
+                i = end;
+                continue;
+            }
+#endif
+
+            const Job& job = entry.job;
+            Result& result = results[i];
+            result.op = job.op;
+            result.fileId = job.fileId;
+            result.tag = job.tag;
+
+            QElapsedTimer timer;
+            timer.start();
+
+            QFile* file = fileForJob(channel->files, job, result);
+            if (file) {
+                switch (job.op) {
+                case Op::Write:
+                    m_submissions += writeRemainder(file, job, 0, result);
+                    m_bytesWritten += result.bytes;
+                    break;
+                case Op::Resize:
+                    ++m_submissions;
+                    if (!file->resize(job.offset)) {
+                        result.ok = false;
+                        result.errorCode = QStringLiteral("resize_failed");
+                        result.errorMessage = file->errorString();
+                    }
+                    break;
+                case Op::Allocate: {
+                    ++m_submissions;
+                    int error = kNoReservation;
+                    bool tried = false;
+#if defined(RAAD_HAVE_IO_URING)
+                    if (useRing) {
+                        io_uring_sqe* sqe = io_uring_get_sqe(&worker->ring);
+                        io_uring_prep_fallocate(sqe, file->handle(), job.keepSize ? FALLOC_FL_KEEP_SIZE : 0,
+                                                static_cast<__u64>(job.offset),
+                                                static_cast<__u64>(job.length));
+                        io_uring_cqe* cqe = nullptr;
+                        if (io_uring_submit_and_wait(&worker->ring, 1) >= 0
+                            && io_uring_wait_cqe(&worker->ring, &cqe) == 0 && cqe) {
+                            tried = true;
+                            error = cqe->res == 0 ? 0 : (reservationUnsupported(-cqe->res) ? kNoReservation : -cqe->res);
+                            io_uring_cqe_seen(&worker->ring, cqe);
+                        }
+                    }
+#endif
+                    if (!tried) error = reserveBlocks(file, job.offset, job.length, job.keepSize);
+                    if (error == 0) {
+                        result.bytes = job.length;
+                    } else if (error != kNoReservation) {
+                        // Out of space now rather than halfway through the download.
+                        result.ok = false;
+                        result.errorCode = QStringLiteral("allocate_failed");
+                        result.errorMessage = qt_error_string(error);
+                        break;
+                    }
+                    // Filesystems that cannot reserve still get a file of the right size.
+                    const qint64 wanted = job.offset + job.length;
+                    if (!job.keepSize && file->size() < wanted && !file->resize(wanted)) {
+                        result.ok = false;
+                        result.errorCode = QStringLiteral("allocate_failed");
+                        result.errorMessage = file->errorString();
+                    }
+                    break;
+                }
+                case Op::Sync: {
+                    ++m_submissions;
+                    bool synced = false;
+#if defined(RAAD_HAVE_IO_URING)
+                    if (useRing) {
+                        io_uring_sqe* sqe = io_uring_get_sqe(&worker->ring);
+                        io_uring_prep_fsync(sqe, file->handle(), IORING_FSYNC_DATASYNC);
+                        io_uring_cqe* cqe = nullptr;
+                        if (io_uring_submit_and_wait(&worker->ring, 1) >= 0
+                            && io_uring_wait_cqe(&worker->ring, &cqe) == 0 && cqe) {
+                            synced = cqe->res == 0;
+                            io_uring_cqe_seen(&worker->ring, cqe);
+                        }
+                    }
+#endif
+                    if (!synced && !syncFile(file)) {
+                        result.ok = false;
+                        result.errorCode = QStringLiteral("sync_failed");
+                        result.errorMessage = file->errorString();
+                    }
+                    break;
+                }
+                case Op::Close:
+                    file->close();
+                    delete file;
+                    channel->files.remove(job.fileId);
+                    break;
+                }
+            }
+            result.elapsedMs = timer.elapsed();
+            ++i;
+        }
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            Worker::Entry& entry = batch[i];
+            if (entry.release) continue;
+            Channel* channel = entry.channel.get();
+            channel->queuedBytes -= entry.job.size();
+            if (entry.job.op == Op::Write && results[i].ok && entry.job.onWritten) {
+                // The data is on disk even if the channel was closed meanwhile.
+                entry.job.onWritten(entry.job);
+            }
+
+            QMutexLocker lock(&channel->deliverMutex);
+            if (channel->closed || !channel->receiver) continue;
+            QMetaObject::invokeMethod(channel->receiver,
+                                      [done = channel->done, result = results[i]]() { done(result); },
+                                      Qt::QueuedConnection);
+        }
+    }
+
+#if defined(RAAD_HAVE_IO_URING)
+    if (worker->ringReady) {
+        io_uring_queue_exit(&worker->ring);
+        worker->ringReady = false;
+    }
+#endif
+}
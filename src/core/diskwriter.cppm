@@ -0,0 +1,212 @@
+/*!
+ * @file        diskwriter.cppm
+ * @brief       Asynchronous disk writer pool for download tasks.
+ * @details     Moves file I/O for downloads off the thread that runs the
+ *              download engine (which is also the QML GUI thread). Tasks
+ *              submit positional writes into bounded per-task channels; a small
+ *              set of writer threads, one per storage device by default,
+ *              performs them and posts completions back to the owning task.
+ *
+ *              Network reads therefore never block on slow storage such as
+ *              spinning disks or network shares. Payloads are pooled block
+ *              slices written with one gathered call per job.
+ *
+ *              On Linux builds with liburing the writers can submit batches
+ *              of writes, syncs and allocations through io_uring instead of
+ *              one syscall per job; the QFile path remains the fallback.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#ifndef Q_MOC_RUN
+export module raad.core.diskwriter;
+import raad.core.chunkring;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+/**
+ * @brief Process-wide pool of disk writer threads.
+ *
+ * Each caller opens a channel bound to the writer thread serving the storage
+ * device of its target path. Jobs on one channel execute in submission order,
+ * so a later Close always observes every earlier Write. Completions are
+ * delivered on the receiver's thread through a queued call and stop as soon
+ * as the channel is closed.
+ */
+RAAD_MODULE_EXPORT class DiskWriterPool {
+public:
+    /**
+     * @brief Operation performed by a writer job.
+     */
+    enum class Op {
+        Write,      //!< Write data at an absolute offset.
+        Resize,     //!< Create the file if needed and resize it to the offset.
+        Allocate,   //!< Reserve disk blocks for [offset, offset + length), growing the file unless keepSize.
+        Sync,       //!< Flush written data of the file to stable storage (fails if the file is gone).
+        Close       //!< Release the writer's handle for the file.
+    };
+
+    /**
+     * @brief System call path used by the writer threads.
+     */
+    enum class Backend {
+        Portable,   //!< Blocking QFile calls, one per job (all platforms).
+        IoUring     //!< Batched submission through io_uring (Linux with liburing).
+    };
+
+    /**
+     * @brief Unit of work submitted to a channel.
+     */
+    struct Job {
+        Op op = Op::Write;          //!< Operation kind.
+        int fileId = 0;             //!< Caller-chosen handle id (per channel).
+        QString path;               //!< File path, used when opening the handle.
+        qint64 offset = 0;          //!< Write/Allocate offset, or new size for Resize.
+        qint64 length = 0;          //!< Range length for Allocate.
+        bool keepSize = false;      //!< Allocate only: reserve blocks without changing the file size.
+        QVector<BufferSlice> data;  //!< Payload for Write, gathered in order.
+        int tag = 0;                //!< Caller tag echoed back in the result.
+        std::function<void(const Job&)> onWritten;  //!< Runs on the writer thread after a successful Write.
+
+        //!< @brief Return the payload size in bytes.
+        qint64 size() const
+        {
+            qint64 total = 0;
+            for (const BufferSlice& slice : data) total += slice.length;
+            return total;
+        }
+    };
+
+    /**
+     * @brief Outcome of a job, delivered on the receiver's thread.
+     */
+    struct Result {
+        Op op = Op::Write;          //!< Operation kind.
+        int fileId = 0;             //!< Handle id of the job.
+        int tag = 0;                //!< Caller tag of the job.
+        qint64 bytes = 0;           //!< Bytes written (Write), or reserved (Allocate; 0 = filesystem cannot reserve).
+        qint64 elapsedMs = 0;       //!< Time spent in the syscall path.
+        bool ok = true;             //!< Whether the job succeeded.
+        QString errorCode;          //!< Structured error code on failure.
+        QString errorMessage;       //!< Human-readable error on failure.
+    };
+
+    using Completion = std::function<void(const Result&)>;
+
+    //!< @brief Return the shared writer pool.
+    static DiskWriterPool& instance();
+
+    DiskWriterPool(const DiskWriterPool&) = delete;
+    DiskWriterPool& operator=(const DiskWriterPool&) = delete;
+
+    /**
+     * @brief Open a submission channel for a task.
+     * @param targetPath Path used to pick the writer serving its storage device.
+     * @param receiver Object whose thread receives completions.
+     * @param done Completion callback.
+     * @return Channel id (> 0).
+     */
+    int openChannel(const QString& targetPath, QObject* receiver, Completion done);
+
+    /**
+     * @brief Close a channel, dropping queued jobs and releasing its handles.
+     * @param channelId Channel id.
+     * @param waitForRelease Block until the writer has closed the handles.
+     */
+    void closeChannel(int channelId, bool waitForRelease = false);
+
+    /**
+     * @brief Queue a job on a channel.
+     * @param channelId Channel id.
+     * @param job Job to run.
+     * @param force Queue even if the channel is over capacity.
+     * @return false if the channel is unknown or full.
+     */
+    bool submit(int channelId, Job job, bool force = false);
+
+    //!< @brief Return bytes queued but not yet written on a channel.
+    qint64 queuedBytes(int channelId) const;
+
+    //!< @brief Return bytes queued across all channels.
+    qint64 totalQueuedBytes() const;
+
+    //!< @brief Return the number of writer threads started so far.
+    int workerCount() const;
+
+    /**
+     * @brief Select the writer backend; takes effect at the next batch.
+     * @param backend Requested backend. IoUring falls back to Portable when unavailable.
+     */
+    void setBackend(Backend backend);
+
+    //!< @brief Return the requested writer backend.
+    Backend backend() const;
+
+    //!< @brief Return the backend the writers actually use.
+    Backend activeBackend() const;
+
+    //!< @brief Whether this build and kernel support the io_uring backend.
+    static bool ioUringAvailable();
+
+    //!< @brief Return the settings/telemetry name of a backend ("qfile" or "io_uring").
+    static QString backendName(Backend backend);
+
+    //!< @brief Parse a backend name; unknown names map to Portable.
+    static Backend backendFromName(const QString& name);
+
+    //!< @brief Return bytes written by all writers since start.
+    qint64 bytesWritten() const;
+
+    //!< @brief Return kernel entries (write calls or ring submissions) issued since start.
+    qint64 submissionCount() const;
+
+    //!< @brief Return the per-channel queue bound in bytes.
+    qint64 channelCapacity() const;
+
+    /**
+     * @brief Set the per-channel queue bound.
+     * @param bytes Capacity in bytes.
+     */
+    void setChannelCapacity(qint64 bytes);
+
+private:
+    struct Worker;
+    struct Channel;
+
+    DiskWriterPool();
+    ~DiskWriterPool();
+
+    //!< @brief Return (starting on demand) the writer for a storage device.
+    Worker* workerForPath(const QString& targetPath);
+
+    //!< @brief Writer thread main loop.
+    void runWorker(Worker* worker);
+
+    mutable QMutex m_mutex;                                     //!< Guards channels and workers.
+    QHash<int, std::shared_ptr<Channel>> m_channels;            //!< Open channels by id.
+    QHash<QString, Worker*> m_workersByDevice;                  //!< Writers by storage device.
+    QVector<Worker*> m_workers;                                 //!< All writers.
+    int m_nextChannelId = 1;                                    //!< Next channel id.
+    qint64 m_channelCapacity = 16ll * 1024 * 1024;              //!< Per-channel queue bound.
+    std::atomic<int> m_backend { static_cast<int>(Backend::Portable) }; //!< Requested backend.
+    std::atomic<qint64> m_bytesWritten { 0 };                   //!< Bytes written since start.
+    std::atomic<qint64> m_submissions { 0 };                    //!< Kernel entries since start.
+};
@@ -9,20 +9,79 @@ module;
 #include <QThread>
 #include <QDateTime>
 #include <QFileInfo>
+#include <QHostInfo>
 #include <QPointer>
 #include <QSslError>
 #include <QNetworkProxy>
 #include <QRegularExpression>
 #include <QStorageInfo>
 #include <QElapsedTimer>
+#include <QCryptographicHash>
 #include <ctime>
+#include <limits>
+#include <utility>
 
 module raad.core.downloadertask;
 
+import raad.core.chunkring;
+import raad.core.connectionarbiter;
+import raad.core.diskwriter;
+import raad.core.hostprofile;
+import raad.core.networksession;
+import raad.core.partmerger;
+import raad.core.rangeengine;
+import raad.core.ratelimiter;
+import raad.core.segmentcontroller;
+import raad.core.streamhash;
 import raad.utils.download_utils;
 
 namespace utils = raad::utils;
 
+namespace {
+
+//!< Writer tag for single-stream jobs; segment jobs are tagged with their index.
+constexpr int kSingleStreamTag = -1;
+//!< Writer tag for preallocating the direct placement file.
+constexpr int kPlacementTag = -2;
+//!< Ranges a task may hold, races included; the progress map and journal store at most 32,
+//!< and the segment list reserves this many so segment addresses stay put while replies run.
+constexpr int kMaxSegments = 32;
+//!< Per-reply socket buffer; once full, Qt stops reading and TCP flow control slows the sender.
+constexpr qint64 kReplyReadBufferSize = 512 * 1024;
+//!< Journal records appended before it is rewritten as a single layout record.
+constexpr int kJournalCompactRecords = 256;
+//!< Damaged stretches a repair may refetch; alternating with intact ones they must fit the 32-range progress map.
+constexpr int kMaxRepairRanges = 15;
+//!< Bytes a task may hold in memory when the manager has not assigned a budget.
+constexpr qint64 kDefaultBufferWatermark = 64ll * 1024 * 1024;
+
+//!< Bytes left in the whole download below which idle connections race slow tails.
+constexpr qint64 kEndgameRemainingBytes = 16ll * 1024 * 1024;
+//!< Duplicate requests in flight at once.
+constexpr int kEndgameMaxRaces = 2;
+//!< Tails expected to finish sooner than this are not worth a duplicate.
+constexpr qint64 kEndgameMinEtaMs = 1500;
+//!< Failed requests after which a mirror is no longer given segments.
+constexpr int kMirrorMaxFailures = 2;
+
+//!< ETag without the weak marker, for comparing validators across mirrors.
+QByteArray normalizedEtag(const QByteArray& etag)
+{
+    QByteArray value = etag.trimmed();
+    if (value.startsWith("W/")) value = value.mid(2);
+    return value;
+}
+
+//!< Stop a reply the task no longer wants; its late signals must not reach @p receiver.
+void abandonReply(QNetworkReply* reply, const QObject* receiver)
+{
+    QObject::disconnect(reply, nullptr, receiver, nullptr);
+    reply->abort();
+    reply->deleteLater();
+}
+
+} // namespace
+
 DownloaderTask::DownloaderTask(const QUrl& url,
                                const QString& filePath,
                                int segments,
@@ -41,19 +100,29 @@ DownloaderTask::DownloaderTask(const QUrl& url,
     clearErrorState();
     resetAdaptiveStats();
     resetNetworkManager();
+    m_rateNode = RateLimiter::instance().createNode();
+}
+
+DownloaderTask::~DownloaderTask()
+{
+    // Replies belong to the shared session, so they outlive the task unless stopped here.
+    blockSignals(true);
+    releaseTransfers(false);
+    ConnectionArbiter::instance().leave(this);
+    NetworkSessionPool::instance().release(m_manager);
+    RateLimiter::instance().removeNode(m_rateNode);
 }
 
 void DownloaderTask::resetNetworkManager()
 {
-    if (m_manager) {
-        m_manager->deleteLater();
-        m_manager = nullptr;
-    }
-    m_manager = new QNetworkAccessManager(this);
+    QNetworkProxy proxy(QNetworkProxy::DefaultProxy);
     if (!m_proxyHost.isEmpty() && m_proxyPort > 0) {
-        QNetworkProxy proxy(QNetworkProxy::HttpProxy, m_proxyHost, m_proxyPort, m_proxyUser, m_proxyPassword);
-        m_manager->setProxy(proxy);
+        proxy = QNetworkProxy(QNetworkProxy::HttpProxy, m_proxyHost, m_proxyPort, m_proxyUser, m_proxyPassword);
     }
+    // Acquire before releasing so an unchanged proxy keeps the same session and its connections.
+    QNetworkAccessManager* previous = m_manager;
+    m_manager = NetworkSessionPool::instance().acquire(proxy);
+    NetworkSessionPool::instance().release(previous);
 }
 
 QUrl DownloaderTask::currentUrl() const
@@ -66,6 +135,7 @@ QUrl DownloaderTask::currentUrl() const
 
 void DownloaderTask::applyNetworkOptions(QNetworkRequest& req) const
 {
+    NetworkSessionPool::instance().prepare(req);
     const QString ua = m_userAgent.trimmed();
     if (!ua.isEmpty() && !req.hasRawHeader("User-Agent")) {
         req.setRawHeader("User-Agent", ua.toUtf8());
@@ -129,6 +199,148 @@ bool DownloaderTask::advanceMirror()
     return true;
 }
 
+QUrl DownloaderTask::segmentUrl(const Segment& segment) const
+{
+    if (segment.mirror >= 0 && segment.mirror < m_mirrorUrls.size()) {
+        return QUrl(m_mirrorUrls.at(segment.mirror));
+    }
+    return currentUrl();
+}
+
+void DownloaderTask::prepareMirrorSpread()
+{
+    m_mirrorLinks = QVector<MirrorLink>(m_mirrorUrls.size());
+    m_mirrorSampleMs = 0;
+    int usable = 0;
+    for (int i = 0; i < m_mirrorUrls.size(); ++i) {
+        const QUrl url(m_mirrorUrls.at(i));
+        MirrorLink& link = m_mirrorLinks[i];
+        link.verified = (i == m_mirrorIndex);
+        // Mirrors the task already failed over from stay out of this run.
+        link.rejected = !url.isValid() || url.isRelative() || i < m_mirrorIndex;
+        if (!link.rejected) ++usable;
+    }
+    m_mirrorSpread = usable > 1 && m_useRange && m_serverSupportsRange;
+    if (m_mirrorSpread) {
+        appendLog(QStringLiteral("Spreading segments over %1 mirrors").arg(usable));
+    }
+}
+
+qreal DownloaderTask::mirrorWeight(int mirror) const
+{
+    qreal best = 0.0;
+    for (const MirrorLink& link : m_mirrorLinks) {
+        best = qMax(best, link.rate);
+    }
+    const qreal rate = m_mirrorLinks.at(mirror).rate;
+    // Unmeasured mirrors are treated as the fastest so they get sampled.
+    if (rate <= 0.0) return best > 0.0 ? best : 1.0;
+    return rate;
+}
+
+int DownloaderTask::pickMirror() const
+{
+    QVector<int> active(m_mirrorLinks.size(), 0);
+    for (const Segment& s : m_segmentsInfo) {
+        if (s.reply && s.mirror >= 0 && s.mirror < active.size()) ++active[s.mirror];
+    }
+    int best = -1;
+    qreal bestScore = 0.0;
+    for (int i = 0; i < m_mirrorLinks.size(); ++i) {
+        if (m_mirrorLinks.at(i).rejected) continue;
+        // Connections to one mirror share its bandwidth, so prefer the one the next connection helps most.
+        const qreal score = mirrorWeight(i) / (active.at(i) + 1);
+        if (best < 0 || score > bestScore) {
+            best = i;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+void DownloaderTask::rejectMirror(int mirror, const QString& reason)
+{
+    if (mirror < 0 || mirror >= m_mirrorLinks.size() || m_mirrorLinks.at(mirror).rejected) return;
+    m_mirrorLinks[mirror].rejected = true;
+    appendLog(QStringLiteral("Mirror dropped (%1): %2").arg(reason, m_mirrorUrls.at(mirror)));
+}
+
+bool DownloaderTask::verifyMirrorReply(int mirror, const QNetworkReply* reply)
+{
+    if (mirror < 0 || mirror >= m_mirrorLinks.size()) return true;
+    MirrorLink& link = m_mirrorLinks[mirror];
+    if (link.verified) return true;
+
+    qint64 first = -1;
+    qint64 last = -1;
+    qint64 total = -1;
+    if (!parseContentRange(reply->rawHeader("Content-Range"), &first, &last, &total) || total != m_totalSize) {
+        rejectMirror(mirror, QStringLiteral("size differs from primary"));
+        return false;
+    }
+    const QByteArray etag = normalizedEtag(reply->rawHeader("ETag"));
+    const QByteArray primaryEtag = normalizedEtag(m_etag.toUtf8());
+    if (!etag.isEmpty() && !primaryEtag.isEmpty() && etag != primaryEtag) {
+        rejectMirror(mirror, QStringLiteral("ETag differs from primary"));
+        return false;
+    }
+    link.verified = true;
+    appendLog(QStringLiteral("Mirror verified: %1").arg(m_mirrorUrls.at(mirror)));
+    return true;
+}
+
+bool DownloaderTask::reassignSegment(Segment* segment, const QString& reason)
+{
+    if (!m_mirrorSpread || m_state != State::Downloading) return false;
+    const int failed = segment->mirror;
+    if (failed >= 0 && failed < m_mirrorLinks.size() && ++m_mirrorLinks[failed].failures >= kMirrorMaxFailures) {
+        rejectMirror(failed, reason);
+    }
+    const int next = pickMirror();
+    if (next < 0) return false;
+
+    if (segment->reply) {
+        QNetworkReply* reply = segment->reply;
+        segment->reply = nullptr;
+        abandonReply(reply, this);
+    }
+    segment->mirror = next;
+    appendLog(QStringLiteral("Segment [%1-%2] moved to %3 (%4)")
+                  .arg(segment->start)
+                  .arg(segment->end)
+                  .arg(m_mirrorUrls.at(next), reason));
+    // Bytes already received stay; the new request continues right after them. Without a free
+    // connection the range waits idle like any other (see startPendingSegments()).
+    if (claimConnection()) startSegment(segment);
+    return true;
+}
+
+void DownloaderTask::sampleMirrorThroughput()
+{
+    if (!m_mirrorSpread) return;
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    if (m_mirrorSampleMs <= 0) {
+        m_mirrorSampleMs = nowMs;
+        return;
+    }
+    const qint64 elapsedMs = nowMs - m_mirrorSampleMs;
+    if (elapsedMs < 1000) return;
+    m_mirrorSampleMs = nowMs;
+
+    QVector<int> active(m_mirrorLinks.size(), 0);
+    for (const Segment& s : m_segmentsInfo) {
+        if (s.reply && s.mirror >= 0 && s.mirror < active.size()) ++active[s.mirror];
+    }
+    for (int i = 0; i < m_mirrorLinks.size(); ++i) {
+        MirrorLink& link = m_mirrorLinks[i];
+        if (active.at(i) > 0) {
+            const qreal perConnection = link.sampleBytes * 1000.0 / elapsedMs / active.at(i);
+            link.rate = link.rate > 0.0 ? (0.7 * link.rate + 0.3 * perConnection) : perConnection;
+        }
+        link.sampleBytes = 0;
+    }
+}
+
 void DownloaderTask::setChecksumAlgorithm(const QString& algo)
 {
     if (m_checksumAlgorithm == algo) return;
@@ -338,6 +550,27 @@ void DownloaderTask::setAdaptiveSegmentsEnabled(bool enabled)
     emit adaptiveSegmentsChanged();
 }
 
+void DownloaderTask::setDirectPlacement(bool enabled)
+{
+    if (m_directPlacement == enabled) return;
+    m_directPlacement = enabled;
+    emit directPlacementChanged();
+}
+
+void DownloaderTask::setSparseTarget(bool enabled)
+{
+    if (m_sparseTarget == enabled) return;
+    m_sparseTarget = enabled;
+    emit sparseTargetChanged();
+}
+
+void DownloaderTask::setNativeTransport(bool enabled)
+{
+    if (m_nativeTransport == enabled) return;
+    m_nativeTransport = enabled;
+    emit networkOptionsChanged();
+}
+
 void DownloaderTask::sampleWriteLatency(qint64 elapsedMs)
 {
     if (elapsedMs <= 0) return;
@@ -402,6 +635,7 @@ void DownloaderTask::sampleCpuLoad()
 void DownloaderTask::sampleNetworkRead(qint64 bytes)
 {
     if (bytes <= 0) return;
+    m_adaptiveWindowBytes += bytes;
     m_adaptiveReadEvents = qMin<qint64>(1000000, m_adaptiveReadEvents + 1);
     const qint64 total = m_adaptiveReadEvents + m_adaptiveErrorEvents;
     if (total > 0) {
@@ -461,61 +695,64 @@ void DownloaderTask::resetAdaptiveStats()
     m_adaptiveCpuLastClockTicks = static_cast<qint64>(std::clock());
     m_adaptiveCpuLastWallMs = QDateTime::currentMSecsSinceEpoch();
     m_adaptiveLastEvalMs = QDateTime::currentMSecsSinceEpoch();
+    m_adaptiveWindowBytes = 0;
+    m_adaptiveStallMark = m_backpressureStalls;
     emit adaptiveMetricsChanged();
 }
 
-int DownloaderTask::recommendedAdaptiveTarget() const
+int DownloaderTask::connectionTarget() const
 {
-    if (!m_adaptiveSegmentsEnabled) {
-        return qBound(1, m_segments, 32);
-    }
-    if (!m_serverSupportsRange || !m_useRange) {
-        return 1;
-    }
+    if (m_multiplexed) return 1;
+    // HTTP/1.1 segments beyond the session's per-host cap wait for a free connection.
+    return qBound(1, m_parallelTarget, NetworkSessionPool::instance().connectionsPerHost());
+}
 
-    int target = 6;
-    const qint64 speedBps = qMax<qint64>(0, m_speed);
-    if (speedBps >= 8 * 1024 * 1024) target = 10;
-    if (speedBps >= 20 * 1024 * 1024) target = 14;
-    if (speedBps >= 50 * 1024 * 1024) target = 20;
-    if (speedBps >= 120 * 1024 * 1024) target = 28;
+void DownloaderTask::noteProtocol(const QNetworkReply* reply)
+{
+    if (!reply) return;
+    const bool http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+    if (http2 == m_multiplexed) return;
+    m_multiplexed = http2;
+    appendLog(http2 ? QStringLiteral("Server negotiated HTTP/2; segments share one connection")
+                    : QStringLiteral("Server uses HTTP/1.x; one connection per segment"));
+    emit adaptiveSegmentsChanged();
+}
 
-    if (m_totalSize > 0 && m_totalSize < (64ll * 1024 * 1024)) {
-        target = qMin(target, 8);
+int DownloaderTask::heldConnections() const
+{
+    // Segments waiting for the native transport's host lookup already own their slot.
+    int held = m_races.size() + m_nativeWaiting.size();
+    for (const Segment& s : m_segmentsInfo) {
+        if (transferring(s)) ++held;
     }
+    return m_multiplexed ? qMin(held, 1) : held;
+}
 
-    if (m_adaptiveCpuSamples > 4) {
-        if (m_adaptiveCpuLoadPct > 80.0) {
-            target -= 8;
-        } else if (m_adaptiveCpuLoadPct > 60.0) {
-            target -= 4;
-        }
-    }
+void DownloaderTask::noteServerThrottle()
+{
+    m_adaptiveServerThrottleHints = qMin(m_adaptiveServerThrottleHints + 1, 100);
+    m_serverThrottleEvents = qMin(m_serverThrottleEvents + 1, 1000);
+}
 
-    if (m_adaptiveWriteSamples > 8) {
-        if (m_adaptiveWriteLatencyMs > 18.0) {
-            target -= 8;
-        } else if (m_adaptiveWriteLatencyMs > 10.0) {
-            target -= 4;
-        }
-    }
-    if (m_adaptiveThrottleHits > 6) {
-        target -= 2;
-    }
-    if (m_adaptiveErrors > 1) {
-        target -= 4;
-    }
-    if (m_adaptiveServerThrottleHints > 0) {
-        target -= 4;
-    }
-    if (m_adaptivePacketLossHints > 2 || m_adaptivePacketLossRate > 0.08) {
-        target -= 6;
-    } else if (m_adaptivePacketLossRate > 0.03) {
-        target -= 3;
-    }
+void DownloaderTask::applyHostProfile(const HostProfile& profile)
+{
+    m_warmSegments = profile.segments >= 2 ? profile.segments : 0;
+    m_hostRangeless = profile.knownRangeless(QDateTime::currentMSecsSinceEpoch());
+}
 
-    target = qBound(4, target, 32);
-    return target;
+HostObservation DownloaderTask::hostObservation() const
+{
+    HostObservation o;
+    if (m_adaptiveSegmentsEnabled && m_segmentController.bestConnections() > 0) {
+        o.segments = m_segmentController.bestConnections();
+        o.bytesPerSec = m_segmentController.bestBytesPerSec();
+    } else {
+        o.bytesPerSec = m_lastSpeed;
+    }
+    o.rttMs = m_probeRttMs;
+    o.throttleEvents = m_serverThrottleEvents;
+    o.rangeSupport = m_rangeVerdict;
+    return o;
 }
 
 void DownloaderTask::evaluateAdaptiveSegments()
@@ -526,23 +763,39 @@ void DownloaderTask::evaluateAdaptiveSegments()
 
     const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
     if (m_adaptiveLastEvalMs > 0 && nowMs - m_adaptiveLastEvalMs < 3000) return;
+    const qint64 windowMs = m_adaptiveLastEvalMs > 0 ? nowMs - m_adaptiveLastEvalMs : 0;
     m_adaptiveLastEvalMs = nowMs;
     sampleCpuLoad();
 
-    const int nextTarget = recommendedAdaptiveTarget();
+    SegmentController::Sample sample;
+    sample.bytesPerSec = windowMs > 0 ? m_adaptiveWindowBytes * 1000 / windowMs : 0;
+    sample.connections = m_races.size();
+    for (const Segment& s : m_segmentsInfo) {
+        if (transferring(s)) ++sample.connections;
+    }
+    // HTTP/2 streams share one connection whose errors hit them all alike; fewer streams
+    // would not relieve it. Server pressure limits requests in flight either way.
+    sample.errors = m_multiplexed ? 0 : m_adaptiveErrors;
+    sample.serverThrottle = m_adaptiveServerThrottleHints;
+    sample.writeStalled = (m_adaptiveWriteSamples > 8 && m_adaptiveWriteLatencyMs > 18.0)
+                          || m_backpressureStalls > m_adaptiveStallMark;
+    sample.cpuSaturated = m_adaptiveCpuSamples > 4 && m_adaptiveCpuLoadPct > 80.0;
+
+    const int nextTarget = m_segmentController.update(sample, nowMs);
+    m_parallelTarget = nextTarget;
     if (nextTarget != m_adaptiveTarget) {
+        appendLog(QStringLiteral("Adaptive segments: %1").arg(m_segmentController.traceLines().constLast()));
         m_adaptiveTarget = nextTarget;
-        emit adaptiveSegmentsChanged();
-    }
-    if (nextTarget != m_parallelTarget) {
-        m_parallelTarget = qBound(1, nextTarget, 32);
     }
+    emit adaptiveSegmentsChanged();
 
-    // Decay counters to react quickly but avoid oscillation.
-    m_adaptiveErrors = qMax(0, m_adaptiveErrors - 1);
-    m_adaptiveThrottleHits = qMax(0, m_adaptiveThrottleHits - 2);
-    m_adaptiveServerThrottleHints = qMax(0, m_adaptiveServerThrottleHints - 1);
-    m_adaptivePacketLossHints = qMax(0, m_adaptivePacketLossHints - 1);
+    // Counters describe one window each.
+    m_adaptiveWindowBytes = 0;
+    m_adaptiveStallMark = m_backpressureStalls;
+    m_adaptiveErrors = 0;
+    m_adaptiveThrottleHits = 0;
+    m_adaptiveServerThrottleHints = 0;
+    m_adaptivePacketLossHints = 0;
 }
 
 bool DownloaderTask::ensureOutputWritable(QString* why) const
@@ -611,6 +864,21 @@ qint64 DownloaderTask::parseContentRangeStart(const QByteArray& contentRange) co
     return ok ? start : -1;
 }
 
+bool DownloaderTask::parseContentRange(const QByteArray& contentRange, qint64* first, qint64* last, qint64* total) const
+{
+    static const QRegularExpression re(QStringLiteral("^bytes\\s+(\\d+)-(\\d+)/(\\d+)$"),
+                                       QRegularExpression::CaseInsensitiveOption);
+    const QRegularExpressionMatch match = re.match(QString::fromUtf8(contentRange).trimmed());
+    if (!match.hasMatch()) return false;
+    bool okFirst = false;
+    bool okLast = false;
+    bool okTotal = false;
+    *first = match.captured(1).toLongLong(&okFirst);
+    *last = match.captured(2).toLongLong(&okLast);
+    *total = match.captured(3).toLongLong(&okTotal);
+    return okFirst && okLast && okTotal && *first <= *last && *last < *total;
+}
+
 void DownloaderTask::recordError(const QString& category,
                                  const QString& code,
                                  const QString& message,
@@ -696,9 +964,11 @@ void DownloaderTask::start()
     }
 
     const bool hasExistingFile = QFile::exists(m_filePath) && QFileInfo(m_filePath).size() > 0;
+    const bool hasPlacementData = QFile::exists(utils::placementMapPath(m_filePath));
     bool hasPartialSegments = false;
     if (m_segments > 1) {
-        for (int i = 0; i < m_segments; ++i) {
+        // Dynamic splits number their parts past the configured segment count.
+        for (int i = 0; i < 32; ++i) {
             QString partPath = QString("%1.part%2").arg(m_filePath).arg(i);
             if (QFile::exists(partPath)) {
                 hasPartialSegments = true;
@@ -707,10 +977,17 @@ void DownloaderTask::start()
         }
     }
 
+    prepareStreamHash(hasExistingFile || hasPlacementData || hasPartialSegments || QFile::exists(m_filePath + ".part"));
+    m_journalActive = false;
+    m_mirrorSpread = false;
+    m_rangeVerdict = 0;
+    m_probeRttMs = 0;
+    m_serverThrottleEvents = 0;
+    m_nativeFailed = false;
+    m_nativeAddress.clear();
+
     m_speedTimer.start();
     m_lastBytes = 0;
-    m_throttleTimer.start();
-    m_throttleBytes = 0;
     m_lastProgressEmitMs = 0;
     m_lastRebalanceMs = 0;
 
@@ -731,20 +1008,64 @@ void DownloaderTask::start()
     m_state = State::Downloading;
     emit stateChanged();
 
-    QNetworkRequest headReq(activeUrl);
+    // A fresh download probes with a ranged GET whose body becomes the first segment. Resumes,
+    // and tasks whose server mishandled that probe, ask with HEAD.
+    const bool fresh = !hasExistingFile && !hasPlacementData && !hasPartialSegments
+                       && !QFile::exists(m_filePath + ".part");
+    // Earlier downloads showed the host ignores ranges: HEAD for the size, then one stream.
+    m_skipSegmentation = fresh && m_hostRangeless;
+    if (m_skipSegmentation) {
+        appendLog(QStringLiteral("Host is known to ignore ranges; using a single stream"));
+        sendHeadProbe(false, false, false);
+    } else if (fresh && m_useRange && !m_rangeProbeFailed) {
+        sendRangeProbe();
+    } else {
+        sendHeadProbe(hasExistingFile, hasPartialSegments, hasPlacementData);
+    }
+}
+
+void DownloaderTask::dropProbeReply()
+{
+    if (!m_headReply) return;
+    QNetworkReply* probe = m_headReply;
+    m_headReply = nullptr;
+    abandonReply(probe, this);
+}
+
+void DownloaderTask::recordProbeHeaders(const QNetworkReply* reply)
+{
+    noteProtocol(reply);
+    if (m_probeSentMs > 0) {
+        m_probeRttMs = static_cast<int>(QDateTime::currentMSecsSinceEpoch() - m_probeSentMs);
+        m_probeSentMs = 0;
+    }
+    const QByteArray etag = reply->rawHeader("ETag");
+    if (!etag.isEmpty()) {
+        m_etag = QString::fromUtf8(etag);
+    }
+    const QByteArray lastMod = reply->rawHeader("Last-Modified");
+    if (!lastMod.isEmpty()) {
+        m_lastModified = QString::fromUtf8(lastMod);
+    }
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (statusCode > 0) {
+        m_lastHttpStatus = statusCode;
+        emit errorStateChanged();
+        if (statusCode == 429 || statusCode == 503 || statusCode == 504) {
+            noteServerThrottle();
+        }
+    }
+}
+
+void DownloaderTask::sendHeadProbe(bool hasExistingFile, bool hasPartialSegments, bool hasPlacementData)
+{
+    QNetworkRequest headReq(currentUrl());
     headReq.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
                          QNetworkRequest::NoLessSafeRedirectPolicy);
     applyNetworkOptions(headReq);
-    if (m_headReply) {
-        QPointer<QNetworkReply> oldHead = m_headReply;
-        m_headReply = nullptr;
-        if (oldHead) {
-            QObject::disconnect(oldHead, nullptr, this, nullptr);
-            oldHead->abort();
-            if (oldHead) oldHead->deleteLater();
-        }
-    }
+    dropProbeReply();
 
+    m_probeSentMs = QDateTime::currentMSecsSinceEpoch();
     QNetworkReply* headReply = m_manager->head(headReq);
     m_headReply = headReply;
 
@@ -768,11 +1089,11 @@ void DownloaderTask::start()
     });
 #endif
 
-		    connect(headReply, &QNetworkReply::finished, this, [this, headReply, hasExistingFile, hasPartialSegments]() {
-		        m_headReply = nullptr;
-		        if (m_state != State::Downloading) {
-		            headReply->deleteLater();
-		            return;
+    connect(headReply, &QNetworkReply::finished, this, [this, headReply, hasExistingFile, hasPartialSegments, hasPlacementData]() {
+        m_headReply = nullptr;
+        if (m_state != State::Downloading) {
+            headReply->deleteLater();
+            return;
         }
         if (headReply->error() != QNetworkReply::NoError) {
             qDebug() << "HEAD failed, fallback to single stream:" << headReply->errorString();
@@ -786,24 +1107,9 @@ void DownloaderTask::start()
             startSingleStream(hasExistingFile);
             return;
         }
-        const QByteArray etag = headReply->rawHeader("ETag");
-        if (!etag.isEmpty()) {
-            m_etag = QString::fromUtf8(etag);
-        }
-        const QByteArray lastMod = headReply->rawHeader("Last-Modified");
-        if (!lastMod.isEmpty()) {
-            m_lastModified = QString::fromUtf8(lastMod);
-        }
-        QVariant cl = headReply->header(QNetworkRequest::ContentLengthHeader);
-        QByteArray acceptRanges = headReply->rawHeader("Accept-Ranges");
-        const int statusCode = headReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-        if (statusCode > 0) {
-            m_lastHttpStatus = statusCode;
-            emit errorStateChanged();
-            if (statusCode == 429 || statusCode == 503 || statusCode == 504) {
-                m_adaptiveServerThrottleHints = qMin(m_adaptiveServerThrottleHints + 1, 100);
-            }
-        }
+        recordProbeHeaders(headReply);
+        const QVariant cl = headReply->header(QNetworkRequest::ContentLengthHeader);
+        const QByteArray acceptRanges = headReply->rawHeader("Accept-Ranges");
         headReply->deleteLater();
 
         if (!cl.isValid() || cl.toLongLong() <= 0) {
@@ -814,61 +1120,222 @@ void DownloaderTask::start()
             startSingleStream(false);
             return;
         }
+        planTransfer(cl.toLongLong(), acceptRanges.toLower() == "bytes", nullptr,
+                     hasExistingFile, hasPartialSegments, hasPlacementData);
+    });
+}
 
-        m_totalSize = cl.toLongLong();
-        QString localSafetyError;
-        if (!ensureDiskCapacity(m_totalSize, utils::bytesReceivedOnDisk(m_filePath, m_segments), &localSafetyError)) {
-            m_anyError = true;
-            recordError(QStringLiteral("disk"),
-                        QStringLiteral("insufficient_space"),
-                        localSafetyError);
-            m_state = State::Finished;
-            emit stateChanged();
-            emit finished(false);
+void DownloaderTask::sendRangeProbe()
+{
+    QNetworkRequest req(currentUrl());
+    req.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                     QNetworkRequest::NoLessSafeRedirectPolicy);
+    req.setRawHeader("Range", "bytes=0-");
+    applyNetworkOptions(req);
+    dropProbeReply();
+
+    m_probeSentMs = QDateTime::currentMSecsSinceEpoch();
+    QNetworkReply* probe = m_manager->get(req);
+    probe->setReadBufferSize(kReplyReadBufferSize);
+    m_headReply = probe;
+    QPointer<QNetworkReply> probePtr(probe);
+
+    const auto fallBackToHead = [this](const QString& why) {
+        m_rangeProbeFailed = true;
+        appendLog(QStringLiteral("Range probe failed (%1); probing with HEAD").arg(why));
+        sendHeadProbe(false, false, false);
+    };
+
+    connect(probe, &QNetworkReply::metaDataChanged, this, [this, probePtr, fallBackToHead]() {
+        if (!probePtr || probePtr != m_headReply) return;
+        const int status = probePtr->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 0) return; // not available yet
+
+        // The reply now either becomes segment 0 or is dropped; its probe handlers are done.
+        QNetworkReply* reply = probePtr;
+        m_headReply = nullptr;
+        QObject::disconnect(reply, nullptr, this, nullptr);
+        recordProbeHeaders(reply);
+
+        qint64 first = -1;
+        qint64 last = -1;
+        qint64 total = -1;
+        if (status == 206 && parseContentRange(reply->rawHeader("Content-Range"), &first, &last, &total)
+            && first == 0 && total > 0) {
+            appendLog(QStringLiteral("Range probe: %1 bytes, ranges supported").arg(total));
+            // A server that caps range lengths answered only part of the file; use its headers, not its body.
+            if (last != total - 1) {
+                abandonReply(reply, this);
+                reply = nullptr;
+            }
+            planTransfer(total, true, reply, false, false, false);
             return;
         }
-        if (acceptRanges.toLower() != "bytes") {
-            qDebug() << "Server does not support ranges";
-            m_useRange = false;
-            m_serverSupportsRange = false;
-        } else {
-            m_serverSupportsRange = true;
+        if (status == 200) {
+            // The whole body is on its way; it becomes the single stream instead of a second GET.
+            const qint64 length = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+            appendLog(QStringLiteral("Range probe: server ignored Range"));
+            if (length > 0) {
+                planTransfer(length, false, reply, false, false, false);
+            } else {
+                m_totalSize = 0;
+                m_useRange = false;
+                m_effectiveSegments = 1;
+                startSingleStream(false, reply);
+            }
+            return;
         }
+        abandonReply(reply, this);
+        fallBackToHead(QStringLiteral("HTTP %1").arg(status));
+    });
 
-        if (m_adaptiveSegmentsEnabled) {
-            m_parallelTarget = qBound(4, m_segments, 32);
-            m_adaptiveTarget = m_parallelTarget;
-            emit adaptiveSegmentsChanged();
+    connect(probe, &QNetworkReply::errorOccurred, this, [this, probePtr](QNetworkReply::NetworkError err) {
+        if (err == QNetworkReply::OperationCanceledError || m_state == State::Paused || m_state == State::Canceled)
+            return;
+        if (probePtr) appendLog(QStringLiteral("Range probe error: %1").arg(probePtr->errorString()));
+    });
+#if QT_CONFIG(ssl)
+    connect(probe, &QNetworkReply::sslErrors, this, [this, probePtr](const QList<QSslError>& errors) {
+        qWarning() << "Range probe SSL errors:" << errors;
+        if (m_allowInsecureSsl && probePtr) {
+            probePtr->ignoreSslErrors(errors);
+            appendLog(QStringLiteral("Range probe SSL errors ignored by policy"));
         }
+    });
+#endif
 
-        if (!m_useRange || m_segments == 1) {
-            m_effectiveSegments = 1;
-            startSingleStream(hasExistingFile);
+    // Only reached when the probe ends before any headers arrived.
+    connect(probe, &QNetworkReply::finished, this, [this, probePtr, fallBackToHead]() {
+        if (!probePtr) return;
+        probePtr->deleteLater();
+        if (probePtr != m_headReply) return;
+        m_headReply = nullptr;
+        if (m_state != State::Downloading) return;
+        fallBackToHead(probePtr->errorString());
+    });
+}
+
+void DownloaderTask::planTransfer(qint64 totalSize,
+                                  bool rangesSupported,
+                                  QNetworkReply* probe,
+                                  bool hasExistingFile,
+                                  bool hasPartialSegments,
+                                  bool hasPlacementData)
+{
+    // A probe that becomes neither segment 0 nor the single stream is stopped.
+    const auto dropProbe = [this, &probe] {
+        if (!probe) return;
+        abandonReply(probe, this);
+        probe = nullptr;
+    };
+
+    m_totalSize = totalSize;
+    QString localSafetyError;
+    if (!ensureDiskCapacity(m_totalSize, utils::bytesReceivedOnDisk(m_filePath, m_segments), &localSafetyError)) {
+        m_anyError = true;
+        recordError(QStringLiteral("disk"),
+                    QStringLiteral("insufficient_space"),
+                    localSafetyError);
+        dropProbe();
+        m_state = State::Finished;
+        emit stateChanged();
+        emit finished(false);
+        return;
+    }
+    if (!rangesSupported) {
+        qDebug() << "Server does not support ranges";
+        m_useRange = false;
+        m_serverSupportsRange = false;
+    } else {
+        m_serverSupportsRange = true;
+    }
+    // A skipped check says nothing new about the host.
+    if (!m_skipSegmentation) m_rangeVerdict = rangesSupported ? 1 : -1;
+
+    const bool warmStart = m_adaptiveSegmentsEnabled && m_warmSegments > 0;
+    if (m_adaptiveSegmentsEnabled) {
+        // Small files finish before many connections could pay off.
+        const bool small = totalSize > 0 && totalSize < (64ll * 1024 * 1024);
+        m_segmentController.reset(warmStart ? m_warmSegments : qBound(4, m_segments, 32),
+                                  small ? 8 : SegmentController::kMaxTarget);
+        m_parallelTarget = m_segmentController.target();
+        m_adaptiveTarget = m_parallelTarget;
+        m_adaptiveWindowBytes = 0;
+        m_adaptiveLastEvalMs = QDateTime::currentMSecsSinceEpoch();
+        emit adaptiveSegmentsChanged();
+    }
+
+    // Placement data (an interrupted run or a repair) keeps its own ranges whatever the segment setting.
+    // A probe answer starts at offset 0 and runs to the end, so a single stream carries on with it.
+    if (!m_useRange || m_skipSegmentation || (m_segments == 1 && !hasPlacementData)) {
+        m_effectiveSegments = 1;
+        startSingleStream(hasExistingFile, std::exchange(probe, nullptr));
+        return;
+    }
+
+    int segCount = qMax(1, m_segments);
+    // A fresh layout starts where earlier downloads from this host did best.
+    if (warmStart && !hasPartialSegments && !hasPlacementData) {
+        segCount = qMin(m_warmSegments, m_parallelTarget);
+        appendLog(QStringLiteral("Warm start from host profile: %1 segments").arg(segCount));
+    }
+    if (m_totalSize > 0) {
+        segCount = static_cast<int>(qMin<qint64>(segCount, m_totalSize));
+    }
+    m_arbiterHost = utils::normalizeHost(currentUrl().host());
+    if (segCount <= 1 && !hasPlacementData) {
+        m_effectiveSegments = 1;
+        startSingleStream(hasExistingFile, std::exchange(probe, nullptr));
+        return;
+    }
+    m_effectiveSegments = segCount;
+
+    // Prepare segments
+    m_segmentsInfo.clear();
+    m_segmentsInfo.reserve(kMaxSegments);
+
+    const bool manifestLoaded = prepareBlockManifest();
+
+    // Keep legacy `.partN` data from an earlier run instead of discarding it.
+    m_placementActive = hasPlacementData || (m_directPlacement && !hasPartialSegments);
+    m_journalActive = !m_placementActive;
+    if (m_placementActive) {
+        if (!prepareDirectPlacement(segCount)) {
+            dropProbe();
+            m_anyError = true;
+            m_state = State::Finished;
+            emit stateChanged();
+            emit finished(false);
             return;
         }
-
-        int segCount = qMax(1, m_segments);
-        if (m_totalSize > 0) {
-            segCount = static_cast<int>(qMin<qint64>(segCount, m_totalSize));
+        for (int i = 0; i < 32; ++i) {
+            QFile::remove(QString("%1.part%2").arg(m_filePath).arg(i));
         }
-        if (segCount <= 1) {
-            m_effectiveSegments = 1;
-            startSingleStream(hasExistingFile);
-            return;
+        QFile::remove(utils::segmentJournalPath(m_filePath));
+    } else {
+        // The journal restores the exact map, dynamic splits included; otherwise split evenly.
+        qint64 journalTotal = 0;
+        QList<utils::PlacementRange> ranges;
+        const bool replayed = hasPartialSegments
+                              && utils::readSegmentJournal(m_filePath, &journalTotal, &ranges)
+                              && journalTotal == m_totalSize
+                              && ranges.size() <= 32;
+        if (replayed) {
+            appendLog(QStringLiteral("Segment journal: restored %1 ranges").arg(ranges.size()));
+        } else {
+            ranges.clear();
+            const qint64 segSize = m_totalSize / segCount;
+            for (int i = 0; i < segCount; ++i) {
+                const qint64 start = i * segSize;
+                ranges.append(utils::PlacementRange{ start, (i == segCount - 1) ? (m_totalSize - 1) : ((i + 1) * segSize - 1), 0 });
+            }
         }
-        m_effectiveSegments = segCount;
+        bool discardedParts = false;
 
-        // Prepare segments
-        m_segmentsInfo.clear();
-        m_segmentsInfo.reserve(32);
-        qint64 segSize = m_totalSize / segCount;
-
-        for (int i = 0; i < segCount; ++i) {
+        for (int i = 0; i < ranges.size(); ++i) {
             Segment s;
-            s.start = i * segSize;
-            s.end = (i == segCount - 1)
-                        ? (m_totalSize - 1)
-                        : ((i + 1) * segSize - 1);
+            s.start = ranges.at(i).start;
+            s.end = ranges.at(i).end;
             s.tempFilePath = QString("%1.part%2").arg(m_filePath).arg(i);
             if (hasPartialSegments && QFile::exists(s.tempFilePath)) {
                 QFileInfo info(s.tempFilePath);
@@ -877,32 +1344,101 @@ void DownloaderTask::start()
             } else {
                 QFile::remove(s.tempFilePath);
                 s.downloaded = 0;
+                discardedParts = discardedParts || hasPartialSegments;
             }
-            s.file = nullptr;
+            s.fileId = 0;
             s.processing = false;
             s.buffer.clear();
             m_segmentsInfo.push_back(s);
         }
 
-	        for (int i = segCount; i < m_segments; ++i) {
-	            QFile::remove(QString("%1.part%2").arg(m_filePath).arg(i));
-	        }
+        for (int i = m_segmentsInfo.size(); i < 32; ++i) {
+            QFile::remove(QString("%1.part%2").arg(m_filePath).arg(i));
+        }
+        m_effectiveSegments = m_segmentsInfo.size();
+        if (!hasPartialSegments) {
+            restartIntegrity();
+        } else if (discardedParts && m_streamHash) {
+            m_streamHash->invalidate();
+        }
+    }
+    updateIntegrityLayout();
+    validateResumedSegments(manifestLoaded);
+    if (m_journalActive) compactSegmentJournal();
+    // Segments take the mirror with the most expected throughput as they start.
+    prepareMirrorSpread();
+
+    int pending = 0;
+    for (const Segment& s : m_segmentsInfo) {
+        if (unreceivedBytes(s) > 0) ++pending;
+    }
+    if (pending == 0) {
+        // All segments already on disk; just merge and finish.
+        dropProbe();
+        onSegmentFinished();
+        return;
+    }
+
+    // Fresh or resumed, ranges only open as the host's connection budget allows; the rest stay
+    // idle until rebalanceSegments() gets slots. The probe is already open and counts as held.
+    int started = 0;
+    if (probe) {
+        for (Segment& s : m_segmentsInfo) {
+            if (s.start != 0 || s.downloaded != 0 || unreceivedBytes(s) <= 0) continue;
+            // The probe already streams from offset 0; reads stop at this segment's end.
+            s.mirror = m_mirrorIndex;
+            attachSegmentReply(&s, probe);
+            s.replyFrom = 0;
+            s.replyEnd = m_totalSize - 1;
+            probe = nullptr;
+            started = 1;
+            break;
+        }
+    }
+    dropProbe();
+    int allowed = pending;
+    if (!m_multiplexed && pending > started) {
+        const int granted = ConnectionArbiter::instance().request(this, m_arbiterHost, m_priority, started, pending - started);
+        // A task with nothing open still gets one connection, or it would never make progress.
+        allowed = qMax(1, started + granted);
+        if (allowed < pending) {
+            appendLog(QStringLiteral("Host connection budget: starting %1 of %2 ranges").arg(allowed).arg(pending));
+        }
+    }
+    for (Segment& s : m_segmentsInfo) {
+        if (started >= allowed) break;
+        if (transferring(s) || unreceivedBytes(s) <= 0) continue;
+        startSegment(&s);
+        ++started;
+    }
+    ConnectionArbiter::instance().report(this, m_arbiterHost, m_priority, heldConnections());
+}
+
+bool DownloaderTask::claimConnection()
+{
+    // HTTP/2 streams share the one connection the host already counts.
+    if (m_multiplexed) return true;
+    ConnectionArbiter& arbiter = ConnectionArbiter::instance();
+    const int held = heldConnections();
+    if (held == 0) {
+        // A task with nothing open always keeps one connection.
+        arbiter.report(this, m_arbiterHost, m_priority, 1);
+        return true;
+    }
+    return arbiter.request(this, m_arbiterHost, m_priority, held, 1) > 0;
+}
 
-	        bool anyStarted = false;
-	        for (Segment& s : m_segmentsInfo) {
-	            const qint64 segLen = s.end - s.start + 1;
-	            if (s.downloaded >= segLen) continue;
-	            startSegment(&s);
-	            anyStarted = true;
-	        }
-	        if (!anyStarted) {
-	            // All segments already on disk; just merge and finish.
-	            onSegmentFinished();
-	        }
-	    });
+void DownloaderTask::startPendingSegments()
+{
+    for (int i = 0; i < m_segmentsInfo.size(); ++i) {
+        Segment& s = m_segmentsInfo[i];
+        if (transferring(s) || unreceivedBytes(s) <= 0 || m_nativeWaiting.contains(i)) continue;
+        if (!claimConnection()) return;
+        startSegment(&s);
+    }
 }
 
-void DownloaderTask::startSingleStream(bool resume)
+void DownloaderTask::startSingleStream(bool resume, QNetworkReply* adopted)
 {
     m_effectiveSegments = 1;
 
@@ -920,26 +1456,42 @@ void DownloaderTask::startSingleStream(bool resume)
         }
     }
 
-    if (m_singleFile) {
-        m_singleFile->close();
-        m_singleFile->deleteLater();
-        m_singleFile = nullptr;
+    // A fresh channel guarantees no completion from a previous attempt touches this one.
+    if (m_writeChannel) {
+        DiskWriterPool::instance().closeChannel(m_writeChannel);
+        m_writeChannel = 0;
     }
+    m_singleFileId = 0;
+    m_singleQueued = 0;
 
     m_singleBuffer.clear();
     m_singleProcessing = false;
-    m_resumeSingle = resume && m_useRange;
+    // An adopted probe streams the whole body from offset 0, so nothing on disk is kept.
+    m_resumeSingle = resume && m_useRange && !adopted;
 
     const QString tempPath = m_filePath + ".part";
     bool hasTemp = QFile::exists(tempPath);
     bool hasMain = QFile::exists(m_filePath);
     m_useSingleTemp = hasTemp || !hasMain;
     m_singleTempPath = m_useSingleTemp ? tempPath : m_filePath;
+    const bool manifestLoaded = prepareBlockManifest();
 
     qint64 existingSize = 0;
     if (m_resumeSingle && QFile::exists(m_singleTempPath)) {
         QFileInfo info(m_singleTempPath);
         existingSize = info.size();
+        if (existingSize > 0 && m_blockManifest) {
+            m_blockManifest->setLayout({ DiskExtent { 0, m_totalSize, m_singleTempPath, 0 } });
+            const qint64 verified = manifestLoaded ? m_blockManifest->verifiedEnd(0, existingSize) : existingSize;
+            if (verified < existingSize) {
+                appendLog(QStringLiteral("Resume check: kept %1 of %2 bytes").arg(verified).arg(existingSize));
+                setResumeWarning(QStringLiteral("Damaged data found on resume; refetching"));
+                QFile::resize(m_singleTempPath, verified);
+                existingSize = verified;
+                if (m_streamHash) m_streamHash->invalidate();
+            }
+            m_blockManifest->markCommitted(0, existingSize);
+        }
         if (existingSize > 0) {
             req.setRawHeader("Range", QByteArray("bytes=") + QByteArray::number(existingSize) + "-");
             if (!m_etag.isEmpty()) {
@@ -957,35 +1509,50 @@ void DownloaderTask::startSingleStream(bool resume)
         recordError(QStringLiteral("disk"),
                     QStringLiteral("insufficient_space"),
                     spaceError);
+        if (adopted) abandonReply(adopted, this);
         m_state = State::Finished;
         emit stateChanged();
         emit finished(false);
         return;
     }
 
-    m_singleFile = new QFile(m_singleTempPath);
-    QIODevice::OpenMode mode = QIODevice::WriteOnly | (m_resumeSingle ? QIODevice::Append : QIODevice::Truncate);
-    if (!m_singleFile->open(mode)) {
-        qWarning() << "Cannot open output file" << m_singleTempPath;
-        delete m_singleFile; m_singleFile = nullptr;
-        m_anyError = true;
-        recordError(QStringLiteral("disk"),
-                    QStringLiteral("open_failed"),
-                    QStringLiteral("Cannot open output file: %1").arg(m_singleTempPath));
-        m_state = State::Finished;
-        emit stateChanged();
-        emit finished(false);
-        return;
+    // The writer opens the file on its own thread; open failures come back as completions.
+    m_singleFileId = ++m_nextFileId;
+    m_singleWritten = m_resumeSingle ? existingSize : 0;
+    updateIntegrityLayout();
+    if (!m_resumeSingle) {
+        restartIntegrity();
+        DiskWriterPool::Job truncate;
+        truncate.op = DiskWriterPool::Op::Resize;
+        truncate.fileId = m_singleFileId;
+        truncate.path = m_singleTempPath;
+        truncate.offset = 0;
+        truncate.tag = kSingleStreamTag;
+        DiskWriterPool::instance().submit(writeChannel(), std::move(truncate), true);
+    }
+    if (m_totalSize > m_singleWritten && !m_sparseTarget) {
+        // Reserve the rest without growing the file: its size is what a resume trusts.
+        DiskWriterPool::Job reserve;
+        reserve.op = DiskWriterPool::Op::Allocate;
+        reserve.fileId = m_singleFileId;
+        reserve.path = m_singleTempPath;
+        reserve.offset = m_singleWritten;
+        reserve.length = m_totalSize - m_singleWritten;
+        reserve.keepSize = true;
+        reserve.tag = kSingleStreamTag;
+        DiskWriterPool::instance().submit(writeChannel(), std::move(reserve), true);
+    }
+
+    QNetworkReply* reply = adopted;
+    if (!reply) {
+        applyNetworkOptions(req);
+        reply = m_manager->get(req);
+        reply->setReadBufferSize(kReplyReadBufferSize);
     }
-
-    m_singleWritten = m_resumeSingle ? existingSize : 0;
-
-    applyNetworkOptions(req);
-    QNetworkReply* reply = m_manager->get(req);
     m_singleReply = reply;
     QPointer<QNetworkReply> replyPtr(reply);
 
-    connect(reply, &QNetworkReply::metaDataChanged, this, [this, replyPtr, existingSize]() {
+    const auto onMetaData = [this, replyPtr, existingSize]() {
         if (!replyPtr || replyPtr != m_singleReply) return;
         int status = replyPtr->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
         if (status > 0 && status != m_lastHttpStatus) {
@@ -993,7 +1560,7 @@ void DownloaderTask::startSingleStream(bool resume)
             emit errorStateChanged();
         }
         if (status == 429 || status == 503 || status == 504) {
-            m_adaptiveServerThrottleHints = qMin(m_adaptiveServerThrottleHints + 1, 100);
+            noteServerThrottle();
         }
         const QByteArray etag = replyPtr->rawHeader("ETag");
         if (!etag.isEmpty()) {
@@ -1008,14 +1575,18 @@ void DownloaderTask::startSingleStream(bool resume)
             if (m_resumeSingle && existingSize > 0) {
                 const qint64 start = parseContentRangeStart(replyPtr->rawHeader("Content-Range"));
                 if (start >= 0 && start != existingSize) {
-                    if (m_singleFile) {
-                        m_singleFile->close();
-                        if (!m_singleFile->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-                            qWarning() << "Cannot reopen output file for resume reset" << m_singleTempPath;
-                        }
+                    if (m_singleFileId) {
+                        DiskWriterPool::Job truncate;
+                        truncate.op = DiskWriterPool::Op::Resize;
+                        truncate.fileId = m_singleFileId;
+                        truncate.path = m_singleTempPath;
+                        truncate.offset = 0;
+                        truncate.tag = kSingleStreamTag;
+                        DiskWriterPool::instance().submit(writeChannel(), std::move(truncate), true);
                     }
                     m_resumeSingle = false;
                     m_singleWritten = 0;
+                    restartIntegrity();
                     setResumeWarning(QStringLiteral("Resume mismatch; restarted"));
                     appendLog(QStringLiteral("Resume mismatch (Content-Range start mismatch); restarted"));
                 }
@@ -1032,11 +1603,6 @@ void DownloaderTask::startSingleStream(bool resume)
                 activeReply->abort();
                 if (activeReply) activeReply->deleteLater();
             }
-            if (m_singleFile) {
-                m_singleFile->close();
-                m_singleFile->deleteLater();
-                m_singleFile = nullptr;
-            }
             m_resumeSingle = false;
             m_singleWritten = 0;
             setResumeWarning(QStringLiteral("Resume rejected; restarting"));
@@ -1051,14 +1617,18 @@ void DownloaderTask::startSingleStream(bool resume)
             return;
         }
         if (status != 206) {
-            if (m_singleFile) {
-                m_singleFile->close();
-                if (!m_singleFile->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-                    qWarning() << "Cannot reopen output file for restart" << m_singleTempPath;
-                }
+            if (m_singleFileId) {
+                DiskWriterPool::Job truncate;
+                truncate.op = DiskWriterPool::Op::Resize;
+                truncate.fileId = m_singleFileId;
+                truncate.path = m_singleTempPath;
+                truncate.offset = 0;
+                truncate.tag = kSingleStreamTag;
+                DiskWriterPool::instance().submit(writeChannel(), std::move(truncate), true);
             }
             m_resumeSingle = false;
             m_singleWritten = 0;
+            restartIntegrity();
             if (existingSize > 0) {
                 setResumeWarning(QStringLiteral("Resume not supported; restarted"));
                 appendLog(QStringLiteral("Resume not supported; restarted"));
@@ -1070,7 +1640,8 @@ void DownloaderTask::startSingleStream(bool resume)
                         QStringLiteral("HTTP status %1").arg(status),
                         status);
         }
-    });
+    };
+    connect(reply, &QNetworkReply::metaDataChanged, this, onMetaData);
 
     connect(reply, &QNetworkReply::errorOccurred, this, [this, replyPtr](QNetworkReply::NetworkError err) {
         if (err == QNetworkReply::OperationCanceledError || m_state == State::Paused || m_state == State::Canceled)
@@ -1098,13 +1669,7 @@ void DownloaderTask::startSingleStream(bool resume)
 
     connect(reply, &QNetworkReply::readyRead, this, [this, replyPtr]() mutable {
         if (!replyPtr || replyPtr != m_singleReply) return;
-        QByteArray data = replyPtr->readAll();
-        sampleNetworkRead(data.size());
-        // append to single buffer
-        m_singleBuffer.append(data);
-
-        // try to process buffer (non-blocking)
-        if (!m_singleProcessing) processSingleBuffer();
+        readSingleData();
     });
 
     connect(reply, &QNetworkReply::finished, this, [this, replyPtr]() mutable {
@@ -1122,34 +1687,15 @@ void DownloaderTask::startSingleStream(bool resume)
                         static_cast<int>(replyPtr->error()));
         }
 
+        // Bytes left in the reply by backpressure are bounded by its read buffer; take them now.
+        sampleNetworkRead(m_singleBuffer.readFrom(replyPtr));
+
         // ensure buffer fully processed
         if (!m_singleProcessing && m_singleBuffer.size() > 0) processSingleBuffer();
 
-        // Final drain after network close: flush any buffered bytes regardless of throttle.
-        if (m_singleFile && !m_singleBuffer.isEmpty()) {
-            while (!m_singleBuffer.isEmpty()) {
-                QElapsedTimer writeTimer;
-                writeTimer.start();
-                const qint64 written = m_singleFile->write(m_singleBuffer.constData(), m_singleBuffer.size());
-                sampleWriteLatency(writeTimer.elapsed());
-                if (written <= 0) {
-                    m_anyError = true;
-                    recordError(QStringLiteral("disk"),
-                                QStringLiteral("write_failed"),
-                                QStringLiteral("Failed writing output buffer"));
-                    break;
-                }
-                m_singleBuffer.remove(0, written);
-                m_singleWritten += written;
-            }
-            emit progress(totalDownloaded(), m_totalSize);
-            updateSpeedAndETA();
-        }
-
-        if (m_singleFile) {
-            m_singleFile->close();
-            m_singleFile->deleteLater();
-            m_singleFile = nullptr;
+        // Final drain after network close: queue any buffered bytes regardless of throttle.
+        if (m_singleFileId && !m_singleBuffer.isEmpty()) {
+            submitSingleWrite(m_singleBuffer.takeAll(), true);
         }
 
         replyPtr->deleteLater();
@@ -1158,90 +1704,80 @@ void DownloaderTask::startSingleStream(bool resume)
         if (m_state == State::Paused || m_state == State::Canceled)
             return;
 
-        if (m_useSingleTemp && !m_singleTempPath.isEmpty() && m_singleTempPath != m_filePath) {
-            if (QFile::exists(m_filePath)) {
-                QFile::remove(m_filePath);
-            }
-            if (!QFile::rename(m_singleTempPath, m_filePath)) {
-                m_anyError = true;
-            }
+        if (m_singleFileId) {
+            // The close completes after every queued write; finishing continues from there.
+            submitClose(m_singleFileId, kSingleStreamTag);
+            return;
         }
+        finishSingleStream();
+    });
 
-        if (!m_anyError && m_totalSize > 0) {
-            const QFileInfo info(m_filePath);
-            if (info.exists() && info.size() != m_totalSize) {
-                m_anyError = true;
-                recordError(QStringLiteral("disk"),
-                            QStringLiteral("final_size_mismatch"),
-                            QStringLiteral("Final file size mismatch (%1 != %2)")
-                                .arg(info.size())
-                                .arg(m_totalSize));
-            }
+    if (adopted) {
+        // Its headers arrived while it was the probe; body bytes follow through readyRead.
+        onMetaData();
+    }
+}
+
+void DownloaderTask::finishSingleStream()
+{
+    if (m_state != State::Downloading)
+        return;
+
+    if (m_useSingleTemp && !m_singleTempPath.isEmpty() && m_singleTempPath != m_filePath) {
+        if (QFile::exists(m_filePath)) {
+            QFile::remove(m_filePath);
+        }
+        if (!QFile::rename(m_singleTempPath, m_filePath)) {
+            m_anyError = true;
         }
+    }
 
-        m_state = State::Finished;
-        emit stateChanged();
-        emit finished(!m_anyError);
-    });
+    if (!m_anyError && m_totalSize > 0) {
+        const QFileInfo info(m_filePath);
+        if (info.exists() && info.size() != m_totalSize) {
+            m_anyError = true;
+            recordError(QStringLiteral("disk"),
+                        QStringLiteral("final_size_mismatch"),
+                        QStringLiteral("Final file size mismatch (%1 != %2)")
+                            .arg(info.size())
+                            .arg(m_totalSize));
+        }
+    }
+
+    // Kept after completion so a later repair can find damaged blocks.
+    checkpointBlockManifest(true);
+    m_state = State::Finished;
+    emit stateChanged();
+    emit finished(!m_anyError);
 }
 
 void DownloaderTask::processSingleBuffer()
 {
-    if (!m_singleFile) return;
+    if (!m_singleFileId) return;
     if (m_singleProcessing) return;
     if (m_singleBuffer.isEmpty()) return;
     if (m_state != State::Downloading) return;
 
     m_singleProcessing = true;
 
-    // how many bytes allowed to write now based on throttle window
-    qint64 elapsedMs = m_throttleTimer.elapsed();
-    if (elapsedMs == 0) elapsedMs = 1;
-    qint64 allowed = (m_maxSpeed > 0) ? (m_maxSpeed * elapsedMs / 1000 - m_throttleBytes) : m_singleBuffer.size();
-
-    if (allowed <= 0) {
-        m_adaptiveThrottleHits = qMin(m_adaptiveThrottleHits + 1, 100);
-        // schedule later
-        QTimer::singleShot(50, this, [this]{ m_singleProcessing = false; processSingleBuffer(); });
-        return;
-    }
-
-    qint64 toWrite = qMin<qint64>(allowed, m_singleBuffer.size());
-    QElapsedTimer writeTimer;
-    writeTimer.start();
-    qint64 written = m_singleFile->write(m_singleBuffer.constData(), toWrite);
-    sampleWriteLatency(writeTimer.elapsed());
-    if (written > 0) {
-        m_singleBuffer.remove(0, written);
-        m_throttleBytes += written;
-        m_singleWritten += written;
-    } else if (written < 0) {
-        recordError(QStringLiteral("disk"),
-                    QStringLiteral("write_failed"),
-                    QStringLiteral("Failed writing output buffer"));
-    }
-
-    // reset throttle window if > 1000 ms
-    if (m_throttleTimer.elapsed() >= 1000) {
-        m_throttleTimer.restart();
-        m_throttleBytes = 0;
-    }
-
-    // update progress and speed/eta (rate-limited for smoother UI under caps)
-    const qint64 totalDownloadedBytes = totalDownloaded();
-    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
-    const bool finishedNow = (m_totalSize > 0 && totalDownloadedBytes >= m_totalSize);
-    if (m_lastProgressEmitMs <= 0 || nowMs - m_lastProgressEmitMs >= 120 || finishedNow) {
-        m_lastProgressEmitMs = nowMs;
-        emit progress(totalDownloadedBytes, m_totalSize);
-        updateSpeedAndETA();
+    RateLimiter& limiter = RateLimiter::instance();
+    while (m_singleFileId && !m_singleBuffer.isEmpty()) {
+        const qint64 toWrite = limiter.acquire(m_rateNode, m_singleBuffer.size());
+        if (toWrite <= 0) {
+            // Out of tokens somewhere on the task/queue/global path; resume when they refill.
+            m_adaptiveThrottleHits = qMin(m_adaptiveThrottleHits + 1, 100);
+            limiter.waitFor(m_rateNode, m_singleBuffer.size(), this, kSingleStreamTag, [this] { processSingleBuffer(); });
+            break;
+        }
+        // A saturated writer keeps the bytes here; its next completion resumes processing.
+        if (!submitSingleWrite(m_singleBuffer.peek(toWrite), false)) {
+            limiter.refund(m_rateNode, toWrite);
+            break;
+        }
+        m_singleBuffer.consume(toWrite);
     }
 
     m_singleProcessing = false;
-
-    if (!m_singleBuffer.isEmpty()) {
-        QTimer::singleShot(10, this, [this]{ processSingleBuffer(); });
-    }
 }
 
 void DownloaderTask::startSegment(Segment* segment)
@@ -1249,35 +1785,27 @@ void DownloaderTask::startSegment(Segment* segment)
     if (m_state != State::Downloading)
         return;
 
-    // open file for append if not opened
-    if (!segment->file) {
-        segment->file = new QFile(segment->tempFilePath);
-        if (!segment->file->open(QIODevice::WriteOnly | QIODevice::Append)) {
-            qWarning() << "Cannot open temp file" << segment->tempFilePath;
-            delete segment->file;
-            segment->file = nullptr;
-            m_anyError = true;
-            recordError(QStringLiteral("disk"),
-                        QStringLiteral("open_failed"),
-                        QStringLiteral("Cannot open temporary segment file"));
-            m_state = State::Finished;
-            emit stateChanged();
-            cleanup(false);
-            emit finished(false);
-            return;
-        }
+    if (m_mirrorSpread && (segment->mirror < 0 || segment->mirror >= m_mirrorLinks.size()
+                           || m_mirrorLinks.at(segment->mirror).rejected)) {
+        segment->mirror = pickMirror();
     }
+    // Continue after everything already received, which includes bytes still buffered or queued.
+    const qint64 from = segment->end + 1 - unreceivedBytes(*segment);
+    segment->replyFrom = from;
 
-    QNetworkRequest req(currentUrl());
+    QNetworkRequest req(segmentUrl(*segment));
     req.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
                      QNetworkRequest::NoLessSafeRedirectPolicy);
     req.setRawHeader(
         "Range",
         QString("bytes=%1-%2")
-            .arg(segment->start + segment->downloaded)
+            .arg(from)
             .arg(segment->end)
             .toUtf8());
-    if (segment->downloaded > 0) {
+    // The primary's validators mean nothing to a mirror that has not been checked yet.
+    const bool validatorsApply = !m_mirrorSpread || segment->mirror < 0 || segment->mirror == m_mirrorIndex
+                                 || m_mirrorLinks.at(segment->mirror).verified;
+    if (from > segment->start && validatorsApply) {
         if (!m_etag.isEmpty()) {
             req.setRawHeader("If-Range", m_etag.toUtf8());
         } else if (!m_lastModified.isEmpty()) {
@@ -1286,12 +1814,218 @@ void DownloaderTask::startSegment(Segment* segment)
     }
 
     applyNetworkOptions(req);
+    if (nativeEligible(*segment)) {
+        startNativeSegment(segment, req, from);
+        return;
+    }
     QNetworkReply* reply = m_manager->get(req);
+    reply->setReadBufferSize(kReplyReadBufferSize);
+    attachSegmentReply(segment, reply);
+}
+
+bool DownloaderTask::nativeEligible(const Segment& segment) const
+{
+    if ((!m_nativeTransport && !m_nativeHost) || m_nativeFailed || m_mirrorSpread) return false;
+    if (!RangeEngine::isSupported()) return false;
+    // Spliced bytes never pass the token buckets, and proxies need Qt's client.
+    if (RateLimiter::instance().limited(m_rateNode)) return false;
+    if (!m_proxyHost.isEmpty() || QNetworkProxy::applicationProxy().type() != QNetworkProxy::NoProxy
+        || QNetworkProxyFactory::usesSystemConfiguration()) {
+        return false;
+    }
+    const QUrl url = segmentUrl(segment);
+    return url.scheme() == QLatin1String("http") && !url.host().isEmpty() && url.userInfo().isEmpty();
+}
+
+void DownloaderTask::startNativeSegment(Segment* segment, const QNetworkRequest& req, qint64 from)
+{
+    const int index = static_cast<int>(segment - m_segmentsInfo.constData());
+    const QUrl url = req.url();
+    if (m_nativeAddress.isNull()) {
+        // The probe resolved the host through Qt already, so its cache normally answers at once.
+        if (!m_nativeWaiting.contains(index)) m_nativeWaiting.append(index);
+        if (m_nativeLookup >= 0) return;
+        m_nativeLookup = QHostInfo::lookupHost(url.host(), this, [this](const QHostInfo& info) {
+            m_nativeLookup = -1;
+            const QVector<int> waiting = std::exchange(m_nativeWaiting, {});
+            if (m_state != State::Downloading) return;
+            if (info.error() == QHostInfo::NoError && !info.addresses().isEmpty()) {
+                m_nativeAddress = info.addresses().constFirst();
+                appendLog(QStringLiteral("Native transport: splicing segments from %1").arg(m_nativeAddress.toString()));
+            } else {
+                m_nativeFailed = true;
+                appendLog(QStringLiteral("Native transport: lookup failed (%1); using Qt").arg(info.errorString()));
+            }
+            for (int i : waiting) {
+                if (i >= m_segmentsInfo.size()) continue;
+                Segment& s = m_segmentsInfo[i];
+                if (!transferring(s) && unreceivedBytes(s) > 0) startSegment(&s);
+            }
+        });
+        return;
+    }
+
+    RangeEngine::Request request;
+    request.address = m_nativeAddress;
+    request.port = static_cast<quint16>(url.port(80));
+    request.target = url.toEncoded(QUrl::RemoveScheme | QUrl::RemoveAuthority | QUrl::RemoveFragment);
+    request.host = url.authority(QUrl::RemoveUserInfo | QUrl::FullyEncoded).toUtf8();
+    const QList<QByteArray> names = req.rawHeaderList();
+    for (const QByteArray& name : names) {
+        request.headers.append({ name, req.rawHeader(name) });
+    }
+    request.ifRange = req.rawHeader("If-Range");
+    request.from = from;
+    request.to = segment->end;
+    request.totalSize = m_totalSize;
+    request.path = segment->tempFilePath;
+    // Part files hold only their own range; the placement file is addressed absolutely.
+    request.fileOffset = m_placementActive ? from : from - segment->start;
+    if (m_streamHash || m_blockManifest) {
+        request.onCommitted = [hasher = m_streamHash,
+                               hashGeneration = m_streamHash ? m_streamHash->generation() : 0,
+                               manifest = m_blockManifest,
+                               manifestGeneration = m_blockManifest ? m_blockManifest->generation() : 0](qint64 offset, qint64 length) {
+            if (hasher) hasher->committed(hashGeneration, offset, length);
+            if (manifest) manifest->committed(manifestGeneration, offset, length);
+        };
+    }
+
+    const int transfer = RangeEngine::instance().start(std::move(request), this, [this, index](const RangeEngine::Event& event) {
+        onNativeEvent(index, event);
+    });
+    if (transfer <= 0) {
+        m_nativeFailed = true;
+        startSegment(segment);
+        return;
+    }
+    segment->nativeTransfer = transfer;
+    segment->replyEnd = segment->end;
+    segment->replyStartMs = QDateTime::currentMSecsSinceEpoch();
+    segment->replyBytes = 0;
+}
+
+void DownloaderTask::onNativeEvent(int index, const RangeEngine::Event& event)
+{
+    if (index < 0 || index >= m_segmentsInfo.size()) return;
+    Segment& s = m_segmentsInfo[index];
+    if (s.nativeTransfer != event.transfer) return;
+
+    if (event.kind == RangeEngine::EventKind::Headers) {
+        if (event.status > 0 && event.status != m_lastHttpStatus) {
+            m_lastHttpStatus = event.status;
+            emit errorStateChanged();
+        }
+        if (event.status == 429 || event.status == 503 || event.status == 504) {
+            noteServerThrottle();
+        }
+        if (event.status == 206) {
+            if (!event.etag.isEmpty()) m_etag = QString::fromUtf8(event.etag);
+            if (!event.lastModified.isEmpty()) m_lastModified = QString::fromUtf8(event.lastModified);
+        }
+        return;
+    }
+
+    // The engine reports bytes once they are in the file, like a completed write.
+    const qint64 delta = event.bytes - s.replyBytes;
+    if (delta > 0) {
+        s.replyBytes = event.bytes;
+        s.downloaded += delta;
+        sampleNetworkRead(delta);
+        reportProgress();
+        checkpointSegments(false);
+        checkpointBlockManifest(false);
+    }
+
+    if (event.kind == RangeEngine::EventKind::Progress) {
+        // A limit set meanwhile applies to the rest of the range through the token buckets.
+        if (RateLimiter::instance().limited(m_rateNode)) {
+            fallBackFromNative(&s, QStringLiteral("speed limit set"));
+            return;
+        }
+        rebalanceSoon();
+        return;
+    }
+
+    s.nativeTransfer = 0;
+    if (m_state != State::Downloading) return;
+    if (!event.ok) {
+        // Whatever went wrong (redirect, refused range, lost connection) Qt knows how to handle.
+        m_nativeFailed = true;
+        fallBackFromNative(&s, event.errorMessage.isEmpty() ? event.errorCode : event.errorMessage);
+        return;
+    }
+    if (unreceivedBytes(s) > 0) {
+        if (claimConnection()) startSegment(&s);
+        return;
+    }
+    if (s.fileId) {
+        submitClose(s.fileId, index);
+        return;
+    }
+    onSegmentFinished();
+}
+
+void DownloaderTask::fallBackFromNative(Segment* segment, const QString& reason)
+{
+    if (segment->nativeTransfer) {
+        RangeEngine::instance().cancel(segment->nativeTransfer);
+        segment->nativeTransfer = 0;
+    }
+    appendLog(QStringLiteral("Native transport stopped for [%1-%2] (%3); continuing with Qt")
+                  .arg(segment->start + segment->downloaded)
+                  .arg(segment->end)
+                  .arg(reason));
+    if (m_state != State::Downloading) return;
+    if (unreceivedBytes(*segment) > 0) {
+        if (claimConnection()) startSegment(segment);
+        return;
+    }
+    if (segment->fileId) {
+        submitClose(segment->fileId, static_cast<int>(segment - m_segmentsInfo.constData()));
+        return;
+    }
+    onSegmentFinished();
+}
+
+DownloaderTask::Segment* DownloaderTask::replySegment(int index, const QNetworkReply* reply)
+{
+    if (!reply || index < 0 || index >= m_segmentsInfo.size()) return nullptr;
+    Segment* segment = &m_segmentsInfo[index];
+    return segment->reply == reply ? segment : nullptr;
+}
+
+void DownloaderTask::attachSegmentReply(Segment* segment, QNetworkReply* reply)
+{
+    // The writer opens the segment's file (or the shared placement file) lazily
+    // on its own thread; failures come back as completions.
+    if (!segment->fileId) {
+        segment->fileId = ++m_nextFileId;
+        segment->queued = 0;
+        if (!m_placementActive && !m_sparseTarget) {
+            // Part files keep their size (resume reads progress from it) but get their blocks up front.
+            DiskWriterPool::Job reserve;
+            reserve.op = DiskWriterPool::Op::Allocate;
+            reserve.fileId = segment->fileId;
+            reserve.path = segment->tempFilePath;
+            reserve.offset = 0;
+            reserve.length = segment->end - segment->start + 1;
+            reserve.keepSize = true;
+            reserve.tag = static_cast<int>(segment - m_segmentsInfo.constData());
+            DiskWriterPool::instance().submit(writeChannel(), std::move(reserve), true);
+        }
+    }
     segment->reply = reply;
+    segment->replyEnd = segment->end;
+    segment->replyStartMs = QDateTime::currentMSecsSinceEpoch();
+    segment->replyBytes = 0;
     QPointer<QNetworkReply> replyPtr(reply);
+    // Handlers find the segment by index: the list may be rebuilt while the reply is alive.
+    const int index = static_cast<int>(segment - m_segmentsInfo.constData());
 
-    connect(reply, &QNetworkReply::metaDataChanged, this, [this, segment, replyPtr]() {
-        if (!replyPtr || replyPtr != segment->reply) return;
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, index, replyPtr]() {
+        Segment* segment = replySegment(index, replyPtr);
+        if (!segment) return;
 
         const int status = replyPtr->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
         if (status > 0 && status != m_lastHttpStatus) {
@@ -1299,22 +2033,47 @@ void DownloaderTask::startSegment(Segment* segment)
             emit errorStateChanged();
         }
         if (status == 429 || status == 503 || status == 504) {
-            m_adaptiveServerThrottleHints = qMin(m_adaptiveServerThrottleHints + 1, 100);
-        }
-        const QByteArray etag = replyPtr->rawHeader("ETag");
-        if (!etag.isEmpty()) {
-            m_etag = QString::fromUtf8(etag);
+            noteServerThrottle();
         }
-        const QByteArray lastMod = replyPtr->rawHeader("Last-Modified");
-        if (!lastMod.isEmpty()) {
-            m_lastModified = QString::fromUtf8(lastMod);
+        const bool fromPrimary = !m_mirrorSpread || segment->mirror < 0 || segment->mirror == m_mirrorIndex;
+        if (fromPrimary) {
+            const QByteArray etag = replyPtr->rawHeader("ETag");
+            if (!etag.isEmpty()) {
+                m_etag = QString::fromUtf8(etag);
+            }
+            const QByteArray lastMod = replyPtr->rawHeader("Last-Modified");
+            if (!lastMod.isEmpty()) {
+                m_lastModified = QString::fromUtf8(lastMod);
+            }
         }
         if (status == 0) return; // not available yet
+        noteProtocol(replyPtr);
+        if (!fromPrimary) {
+            // Another mirror's bytes are mixed in only once it has shown it serves the same file.
+            QString problem;
+            if (status == 200) {
+                rejectMirror(segment->mirror, QStringLiteral("Range ignored"));
+                problem = QStringLiteral("mirror ignored Range");
+            } else if (status == 206 && !verifyMirrorReply(segment->mirror, replyPtr)) {
+                problem = QStringLiteral("mirror serves a different file");
+            } else if (status >= 400) {
+                problem = QStringLiteral("mirror HTTP %1").arg(status);
+            }
+            if (!problem.isEmpty() && !reassignSegment(segment, problem)) {
+                m_anyError = true;
+                recordError(QStringLiteral("network"), QStringLiteral("mirror_failed"), problem, status);
+                abandonReply(replyPtr, this);
+                segment->reply = nullptr;
+                if (segment->fileId) submitClose(segment->fileId, static_cast<int>(segment - m_segmentsInfo.constData()));
+            }
+            return;
+        }
         if (status == 206) {
-            if (segment->downloaded > 0) {
-                const qint64 expectedStart = segment->start + segment->downloaded;
+            // Compare with what was asked for: a restart skips bytes still buffered or queued,
+            // which downloaded does not count yet.
+            if (segment->replyFrom > segment->start) {
                 const qint64 actualStart = parseContentRangeStart(replyPtr->rawHeader("Content-Range"));
-                if (actualStart >= 0 && actualStart != expectedStart) {
+                if (actualStart >= 0 && actualStart != segment->replyFrom) {
                     qWarning() << "Content-Range mismatch, fallback to single stream";
                     m_useRange = false;
                     m_serverSupportsRange = false;
@@ -1347,7 +2106,7 @@ void DownloaderTask::startSegment(Segment* segment)
             qWarning() << "SEGMENT GET returned 200 (Range ignored), falling back to single stream";
             m_useRange = false;
             m_serverSupportsRange = false;
-            m_adaptiveServerThrottleHints = qMin(m_adaptiveServerThrottleHints + 1, 100);
+            noteServerThrottle();
             setResumeWarning(QStringLiteral("Range ignored; switched to single stream"));
             appendLog(QStringLiteral("Range ignored; switched to single stream"));
             recordError(QStringLiteral("network"),
@@ -1395,59 +2154,38 @@ void DownloaderTask::startSegment(Segment* segment)
     });
 #endif
 
-    connect(reply, &QNetworkReply::readyRead, this, [this, segment, replyPtr]() mutable {
-        if (!replyPtr || replyPtr != segment->reply) return;
-        QByteArray data = replyPtr->readAll();
-        sampleNetworkRead(data.size());
-        // append to segment buffer
-        segment->buffer.append(data);
-
-        // try to process buffer (non-blocking)
-        if (!segment->processing) processSegmentBuffer(segment);
+    connect(reply, &QNetworkReply::readyRead, this, [this, index, replyPtr]() {
+        if (Segment* segment = replySegment(index, replyPtr)) readSegmentData(segment);
     });
 
-    connect(reply, &QNetworkReply::finished, this, [this, segment, replyPtr]() mutable {
+    connect(reply, &QNetworkReply::finished, this, [this, index, replyPtr]() {
         if (!replyPtr) return;
-        if (replyPtr != segment->reply) {
+        Segment* segment = replySegment(index, replyPtr);
+        if (!segment) {
             replyPtr->deleteLater();
             return;
         }
-        if (m_state == State::Downloading && segment->reply && segment->reply->error() != QNetworkReply::NoError) {
+        const bool failed = m_state == State::Downloading && replyPtr->error() != QNetworkReply::NoError;
+        const QString failure = failed ? replyPtr->errorString() : QString();
+        const int failureStatus = replyPtr->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        const int failureError = static_cast<int>(replyPtr->error());
+        if (failed && !m_mirrorSpread) {
             m_anyError = true;
             recordError(QStringLiteral("network"),
                         QStringLiteral("download_failed"),
-                        segment->reply->errorString(),
-                        segment->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(),
-                        static_cast<int>(segment->reply->error()));
+                        failure,
+                        failureStatus,
+                        failureError);
         }
+        // Bytes left in the reply by backpressure are bounded by its read buffer; take them now.
+        sampleNetworkRead(segment->buffer.readFrom(replyPtr, unreceivedBytes(*segment)));
+
         // ensure buffer fully processed later
         if (!segment->processing && segment->buffer.size() > 0) processSegmentBuffer(segment);
 
-        // Final drain after network close: flush any buffered bytes regardless of throttle.
-        if (segment->file && !segment->buffer.isEmpty()) {
-            while (!segment->buffer.isEmpty()) {
-                QElapsedTimer writeTimer;
-                writeTimer.start();
-                const qint64 written = segment->file->write(segment->buffer.constData(), segment->buffer.size());
-                sampleWriteLatency(writeTimer.elapsed());
-                if (written <= 0) {
-                    m_anyError = true;
-                    recordError(QStringLiteral("disk"),
-                                QStringLiteral("write_failed"),
-                                QStringLiteral("Failed writing segment buffer"));
-                    break;
-                }
-                segment->buffer.remove(0, written);
-                segment->downloaded += written;
-            }
-            emit progress(totalDownloaded(), m_totalSize);
-            updateSpeedAndETA();
-        }
-
-        if (segment->file) {
-            segment->file->close();
-            segment->file->deleteLater();
-            segment->file = nullptr;
+        // Final drain after network close: queue any buffered bytes regardless of throttle.
+        if (segment->fileId && !segment->buffer.isEmpty()) {
+            submitSegmentWrite(segment, segment->buffer.takeAll(), true);
         }
 
         if (segment->reply) {
@@ -1458,52 +2196,407 @@ void DownloaderTask::startSegment(Segment* segment)
         if (m_state == State::Paused || m_state == State::Canceled)
             return;
 
+        // With several mirrors a failed request moves to another one instead of failing the task.
+        if (failed && m_mirrorSpread) {
+            if (reassignSegment(segment, failure)) return;
+            m_anyError = true;
+            recordError(QStringLiteral("network"),
+                        QStringLiteral("download_failed"),
+                        failure,
+                        failureStatus,
+                        failureError);
+        }
+
+        if (segment->fileId) {
+            // The close completes after this range's queued writes; finishing continues from there.
+            submitClose(segment->fileId, static_cast<int>(segment - m_segmentsInfo.constData()));
+            return;
+        }
         onSegmentFinished();
     });
 }
 
 void DownloaderTask::processSegmentBuffer(Segment* s)
 {
-    if (!s->file) return;
+    if (!s->fileId) return;
     if (s->processing) return;
     if (s->buffer.isEmpty()) return;
     if (m_state != State::Downloading) return;
 
     s->processing = true;
 
-    qint64 elapsedMs = m_throttleTimer.elapsed();
-    if (elapsedMs == 0) elapsedMs = 1;
-    qint64 allowed = (m_maxSpeed > 0) ? (m_maxSpeed * elapsedMs / 1000 - m_throttleBytes) : s->buffer.size();
+    RateLimiter& limiter = RateLimiter::instance();
+    const int index = static_cast<int>(s - m_segmentsInfo.constData());
+    while (s->fileId && !s->buffer.isEmpty()) {
+        const qint64 toWrite = limiter.acquire(m_rateNode, s->buffer.size());
+        if (toWrite <= 0) {
+            // Out of tokens somewhere on the task/queue/global path; resume when they refill.
+            // The wake-up looks the segment up by index since the list may be rebuilt meanwhile.
+            m_adaptiveThrottleHits = qMin(m_adaptiveThrottleHits + 1, 100);
+            limiter.waitFor(m_rateNode, s->buffer.size(), this, index, [this, index] {
+                if (index < m_segmentsInfo.size()) processSegmentBuffer(&m_segmentsInfo[index]);
+            });
+            break;
+        }
+        // A saturated writer keeps the bytes here; its next completion resumes processing.
+        if (!submitSegmentWrite(s, s->buffer.peek(toWrite), false)) {
+            limiter.refund(m_rateNode, toWrite);
+            break;
+        }
+        s->buffer.consume(toWrite);
+    }
 
-    if (allowed <= 0) {
-        m_adaptiveThrottleHits = qMin(m_adaptiveThrottleHits + 1, 100);
-        // schedule for later
-        s->processing = false;
-        QTimer::singleShot(50, this, [this, s]{ processSegmentBuffer(s); });
+    s->processing = false;
+
+    // Re-run dynamic balancing once buffered bytes are committed.
+    rebalanceSoon();
+}
+
+void DownloaderTask::setMaxSpeed(qint64 v)
+{
+    if (v < 0) v = 0;
+    if (m_maxSpeed == v) return;
+    m_maxSpeed = v;
+    // The bucket starts empty, so a new limit applies immediately.
+    RateLimiter::instance().setRate(m_rateNode, v);
+    emit maxSpeedChanged();
+}
+
+void DownloaderTask::setRateParent(int node)
+{
+    RateLimiter::instance().setParent(m_rateNode, node);
+}
+
+qint64 DownloaderTask::bufferRoom() const
+{
+    const qint64 limit = m_bufferBudget > 0 ? m_bufferBudget : kDefaultBufferWatermark;
+    return limit - bufferedBytes();
+}
+
+void DownloaderTask::readSegmentData(Segment* s)
+{
+    if (!s->reply) return;
+    // Over the watermark, leave data in the reply; its bounded read buffer then stalls the socket.
+    const qint64 room = bufferRoom();
+    if (room <= 0) {
+        ++m_backpressureStalls;
         return;
     }
+    // Never read past the range end, which a split may have moved below what the reply was asked for.
+    const qint64 received = s->buffer.readFrom(s->reply, qMin(room, unreceivedBytes(*s)));
+    sampleNetworkRead(received);
+    s->replyBytes += received;
+    if (m_mirrorSpread && s->mirror >= 0 && s->mirror < m_mirrorLinks.size()) {
+        m_mirrorLinks[s->mirror].sampleBytes += received;
+    }
 
-    qint64 toWrite = qMin<qint64>(allowed, s->buffer.size());
-    QElapsedTimer writeTimer;
-    writeTimer.start();
-    qint64 written = s->file->write(s->buffer.constData(), toWrite);
-    sampleWriteLatency(writeTimer.elapsed());
-    if (written > 0) {
-        s->buffer.remove(0, written);
-        s->downloaded += written;
-        m_throttleBytes += written;
-    } else if (written < 0) {
-        recordError(QStringLiteral("disk"),
-                    QStringLiteral("write_failed"),
-                    QStringLiteral("Failed writing segment buffer"));
+    // try to process buffer (non-blocking)
+    if (!s->processing) processSegmentBuffer(s);
+
+    if (s->reply && s->replyEnd > s->end && unreceivedBytes(*s) <= 0) finishShortenedSegment(s);
+}
+
+qint64 DownloaderTask::unreceivedBytes(const Segment& s)
+{
+    return qMax<qint64>(0, (s.end - s.start + 1) - (s.downloaded + s.queued + s.buffer.size()));
+}
+
+void DownloaderTask::finishShortenedSegment(Segment* s)
+{
+    // The rest of the response belongs to the segment that took the tail; HTTP/1.1 cannot stop
+    // a body early, so the connection is closed here rather than drained.
+    QPointer<QNetworkReply> reply = s->reply;
+    s->reply = nullptr;
+    if (reply) {
+        QObject::disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        if (reply) reply->deleteLater();
+    }
+
+    if (!s->processing && !s->buffer.isEmpty()) processSegmentBuffer(s);
+    if (s->fileId && !s->buffer.isEmpty()) {
+        submitSegmentWrite(s, s->buffer.takeAll(), true);
     }
+    if (s->fileId) {
+        submitClose(s->fileId, static_cast<int>(s - m_segmentsInfo.constData()));
+        return;
+    }
+    onSegmentFinished();
+}
+
+void DownloaderTask::readSingleData()
+{
+    if (!m_singleReply) return;
+    const qint64 room = bufferRoom();
+    if (room <= 0) {
+        ++m_backpressureStalls;
+        return;
+    }
+    sampleNetworkRead(m_singleBuffer.readFrom(m_singleReply, room));
+
+    // try to process buffer (non-blocking)
+    if (!m_singleProcessing) processSingleBuffer();
+}
+
+void DownloaderTask::resumeReads()
+{
+    if (m_state != State::Downloading) return;
+    // readyRead does not fire again for bytes already sitting in a reply, so pull them here.
+    for (Segment& s : m_segmentsInfo) {
+        if (bufferRoom() <= 0) return;
+        if (s.reply && s.reply->bytesAvailable() > 0) readSegmentData(&s);
+    }
+    if (m_singleReply && m_singleReply->bytesAvailable() > 0 && bufferRoom() > 0) readSingleData();
+}
 
-    // reset throttle window if >= 1000 ms
-    if (m_throttleTimer.elapsed() >= 1000) {
-        m_throttleTimer.restart();
-        m_throttleBytes = 0;
+void DownloaderTask::setBufferBudget(qint64 bytes)
+{
+    const qint64 next = qMax<qint64>(0, bytes);
+    if (m_bufferBudget == next) return;
+    const qint64 roomBefore = bufferRoom();
+    m_bufferBudget = next;
+    emit bufferStatsChanged();
+    if (bufferRoom() > roomBefore) resumeReads();
+}
+
+int DownloaderTask::writeChannel()
+{
+    if (m_writeChannel == 0) {
+        m_writeChannel = DiskWriterPool::instance().openChannel(
+            m_filePath, this, [this](const DiskWriterPool::Result& result) {
+                onDiskWriteCompleted(result);
+            });
     }
+    return m_writeChannel;
+}
+
+bool DownloaderTask::submitSegmentWrite(Segment* s, QVector<BufferSlice> data, bool force)
+{
+    if (data.isEmpty()) return true;
+    // Part files hold only their own range; the placement file is addressed absolutely.
+    const qint64 base = m_placementActive ? s->start : 0;
+    DiskWriterPool::Job job;
+    job.op = DiskWriterPool::Op::Write;
+    job.fileId = s->fileId;
+    job.path = s->tempFilePath;
+    job.offset = base + s->downloaded + s->queued;
+    job.data = std::move(data);
+    job.tag = static_cast<int>(s - m_segmentsInfo.constData());
+    attachWriteObservers(job, s->start + s->downloaded + s->queued);
+    const qint64 size = job.size();
+    if (!DiskWriterPool::instance().submit(writeChannel(), std::move(job), force)) return false;
+    s->queued += size;
+    return true;
+}
+
+bool DownloaderTask::submitSingleWrite(QVector<BufferSlice> data, bool force)
+{
+    if (data.isEmpty()) return true;
+    DiskWriterPool::Job job;
+    job.op = DiskWriterPool::Op::Write;
+    job.fileId = m_singleFileId;
+    job.path = m_singleTempPath;
+    job.offset = m_singleWritten + m_singleQueued;
+    job.data = std::move(data);
+    job.tag = kSingleStreamTag;
+    attachWriteObservers(job, job.offset);
+    const qint64 size = job.size();
+    if (!DiskWriterPool::instance().submit(writeChannel(), std::move(job), force)) return false;
+    m_singleQueued += size;
+    return true;
+}
 
+void DownloaderTask::submitClose(int fileId, int tag)
+{
+    DiskWriterPool::Job job;
+    job.op = DiskWriterPool::Op::Close;
+    job.fileId = fileId;
+    job.tag = tag;
+    DiskWriterPool::instance().submit(writeChannel(), std::move(job), true);
+}
+
+void DownloaderTask::prepareStreamHash(bool hasExistingData)
+{
+    const bool wanted = m_verifyOnComplete || !m_checksumExpected.trimmed().isEmpty();
+    QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha256;
+    if (!wanted || !utils::checksumHashAlgorithm(utils::resolveChecksumAlgo(m_checksumAlgorithm, m_checksumExpected), &algorithm)) {
+        m_streamHash.reset();
+        return;
+    }
+    if (!hasExistingData) {
+        m_streamHash = std::make_shared<StreamHasher>(algorithm);
+        return;
+    }
+    // Resuming within this process keeps the context; after an app restart it is gone and
+    // verification falls back to reading the whole file.
+    if (m_streamHash && (m_streamHash->algorithm() != algorithm || !m_streamHash->isValid())) {
+        m_streamHash.reset();
+    }
+}
+
+void DownloaderTask::restartIntegrity()
+{
+    if (m_streamHash) m_streamHash->restart();
+    if (m_blockManifest) m_blockManifest->restart();
+}
+
+void DownloaderTask::updateIntegrityLayout()
+{
+    if (!m_streamHash && !m_blockManifest) return;
+    QVector<DiskExtent> layout;
+    if (m_singleFileId) {
+        layout.append(DiskExtent { 0, std::numeric_limits<qint64>::max(), m_singleTempPath, 0 });
+    } else if (m_placementActive) {
+        layout.append(DiskExtent { 0, m_totalSize, utils::placementDataPath(m_filePath), 0 });
+    } else {
+        for (const Segment& s : m_segmentsInfo) {
+            layout.append(DiskExtent { s.start, s.end + 1, s.tempFilePath, 0 });
+        }
+    }
+    if (m_blockManifest) m_blockManifest->setLayout(layout);
+    if (m_streamHash) m_streamHash->setLayout(std::move(layout));
+}
+
+void DownloaderTask::attachWriteObservers(DiskWriterPool::Job& job, qint64 streamOffset)
+{
+    if (!m_streamHash && !m_blockManifest) return;
+    job.onWritten = [hasher = m_streamHash,
+                     hashGeneration = m_streamHash ? m_streamHash->generation() : 0,
+                     manifest = m_blockManifest,
+                     manifestGeneration = m_blockManifest ? m_blockManifest->generation() : 0,
+                     streamOffset](const DiskWriterPool::Job& written) {
+        if (hasher) hasher->written(hashGeneration, streamOffset, written.data);
+        if (manifest) manifest->written(manifestGeneration, streamOffset, written.data);
+    };
+}
+
+bool DownloaderTask::prepareBlockManifest()
+{
+    if (m_totalSize <= 0) {
+        m_blockManifest.reset();
+        return false;
+    }
+    // Checksums kept in memory since an earlier run of this process are current; no need to re-check.
+    if (m_blockManifest && m_blockManifest->totalSize() == m_totalSize) return false;
+
+    m_lastManifestSaveMs = 0;
+    m_blockManifest = BlockManifest::load(utils::blockManifestPath(m_filePath), m_totalSize);
+    if (m_blockManifest) return true;
+    m_blockManifest = std::make_shared<BlockManifest>(m_totalSize);
+    return false;
+}
+
+void DownloaderTask::validateResumedSegments(bool loaded)
+{
+    if (!m_blockManifest) return;
+
+    bool trimmed = false;
+    for (Segment& s : m_segmentsInfo) {
+        if (s.downloaded <= 0) continue;
+        if (loaded) {
+            const qint64 verified = m_blockManifest->verifiedEnd(s.start, s.start + s.downloaded) - s.start;
+            if (verified < s.downloaded) {
+                appendLog(QStringLiteral("Resume check: kept %1 of %2 bytes at offset %3")
+                              .arg(verified)
+                              .arg(s.downloaded)
+                              .arg(s.start));
+                s.downloaded = verified;
+                if (!m_placementActive) QFile::resize(s.tempFilePath, verified);
+                trimmed = true;
+            }
+        }
+        m_blockManifest->markCommitted(s.start, s.start + s.downloaded);
+    }
+
+    // Ranges with nothing on disk are fetched again, so old checksums of blocks inside them no longer apply.
+    constexpr qint64 block = BlockManifest::kBlockSize;
+    for (const Segment& s : m_segmentsInfo) {
+        if (s.downloaded > 0) continue;
+        const qint64 first = (s.start + block - 1) / block;
+        const qint64 last = s.end + 1 == m_totalSize ? (s.end / block) : ((s.end + 1) / block - 1);
+        for (qint64 index = first; index <= last; ++index) m_blockManifest->forgetBlock(static_cast<int>(index));
+    }
+
+    if (!trimmed) return;
+    if (m_streamHash) m_streamHash->invalidate();
+    setResumeWarning(QStringLiteral("Damaged data found on resume; refetching"));
+    checkpointSegments(true);
+}
+
+void DownloaderTask::checkpointBlockManifest(bool force)
+{
+    if (!m_blockManifest || !m_blockManifest->isDirty()) return;
+
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    if (!force && m_lastManifestSaveMs > 0 && nowMs - m_lastManifestSaveMs < 2000) return;
+    m_lastManifestSaveMs = nowMs;
+
+    if (!m_blockManifest->save(utils::blockManifestPath(m_filePath))) {
+        qWarning() << "Cannot write block manifest for" << m_filePath;
+    }
+}
+
+void DownloaderTask::onDiskWriteCompleted(const DiskWriterPool::Result& result)
+{
+    // A failed checkpoint sync costs resume progress, not the download.
+    if (result.tag == kPlacementTag && result.op == DiskWriterPool::Op::Sync) {
+        onPlacementSynced(result);
+        return;
+    }
+    if (!result.ok) {
+        failWithDiskError(result.op == DiskWriterPool::Op::Allocate ? QStringLiteral("preallocate_failed") : result.errorCode,
+                          result.errorMessage);
+        return;
+    }
+
+    if (result.tag == kPlacementTag) {
+        if (result.op == DiskWriterPool::Op::Allocate) {
+            appendLog(result.bytes > 0
+                          ? QStringLiteral("Reserved %1 MB for the output file").arg(result.bytes / (1024 * 1024))
+                          : QStringLiteral("Filesystem cannot reserve space; output file is sized only"));
+        }
+        return;
+    }
+
+    if (result.tag == kSingleStreamTag) {
+        if (result.fileId != m_singleFileId) return;
+        if (result.op == DiskWriterPool::Op::Write) {
+            m_singleQueued = qMax<qint64>(0, m_singleQueued - result.bytes);
+            m_singleWritten += result.bytes;
+            sampleWriteLatency(result.elapsedMs);
+            reportProgress();
+            checkpointBlockManifest(false);
+            if (!m_singleProcessing && !m_singleBuffer.isEmpty()) processSingleBuffer();
+            resumeReads();
+        } else if (result.op == DiskWriterPool::Op::Close) {
+            m_singleFileId = 0;
+            finishSingleStream();
+        }
+        return;
+    }
+
+    if (result.tag < 0 || result.tag >= m_segmentsInfo.size()) return;
+    Segment& s = m_segmentsInfo[result.tag];
+    if (result.fileId != s.fileId) return;
+
+    if (result.op == DiskWriterPool::Op::Write) {
+        s.queued = qMax<qint64>(0, s.queued - result.bytes);
+        s.downloaded += result.bytes;
+        sampleWriteLatency(result.elapsedMs);
+        reportProgress();
+        checkpointSegments(false);
+        checkpointBlockManifest(false);
+        if (!s.processing && !s.buffer.isEmpty()) processSegmentBuffer(&s);
+        resumeReads();
+    } else if (result.op == DiskWriterPool::Op::Close) {
+        s.fileId = 0;
+        checkpointSegments(true);
+        if (m_state == State::Downloading) onSegmentFinished();
+    }
+}
+
+void DownloaderTask::reportProgress()
+{
     // update progress and speed/eta (rate-limited for smoother UI under caps)
     const qint64 totalDownloadedBytes = totalDownloaded();
     const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
@@ -1513,126 +2606,448 @@ void DownloaderTask::processSegmentBuffer(Segment* s)
         emit progress(totalDownloadedBytes, m_totalSize);
         updateSpeedAndETA();
     }
+}
 
-    s->processing = false;
-    const bool hasPending = !s->buffer.isEmpty();
-    if (hasPending) {
-        QTimer::singleShot(10, this, [this, s]{ processSegmentBuffer(s); });
-    }
+void DownloaderTask::failWithDiskError(const QString& code, const QString& message)
+{
+    m_anyError = true;
+    recordError(QStringLiteral("disk"),
+                code.isEmpty() ? QStringLiteral("write_failed") : code,
+                message);
+    if (m_state != State::Downloading) return;
 
-    // Re-run dynamic balancing once buffered bytes are committed.
-    // Skip aggressive balancing while speed-capped to avoid churn.
-    if (m_maxSpeed <= 0) {
-        const qint64 rebalanceNowMs = QDateTime::currentMSecsSinceEpoch();
-        if (m_lastRebalanceMs <= 0 || rebalanceNowMs - m_lastRebalanceMs >= 800) {
-            m_lastRebalanceMs = rebalanceNowMs;
-            rebalanceSegments();
+    qWarning() << "Disk error for" << m_filePath << ":" << message;
+    appendLog(QStringLiteral("Disk error: %1").arg(message));
+    releaseTransfers(false);
+    checkpointSegments(true);
+    checkpointBlockManifest(true);
+    m_state = State::Finished;
+    emit stateChanged();
+    emit finished(false);
+}
+
+void DownloaderTask::releaseTransfers(bool waitForDisk)
+{
+    for (Segment& s : m_segmentsInfo) {
+        if (s.reply) {
+            QPointer<QNetworkReply> segReply = s.reply;
+            s.reply = nullptr;
+            if (segReply) {
+                QObject::disconnect(segReply, nullptr, this, nullptr);
+                segReply->abort();
+                if (segReply) segReply->deleteLater();
+            }
+        }
+        if (s.nativeTransfer) {
+            RangeEngine::instance().cancel(s.nativeTransfer, waitForDisk);
+            s.nativeTransfer = 0;
+        }
+        s.fileId = 0;
+        s.queued = 0;
+        s.buffer.clear();
+        s.processing = false;
+    }
+    if (m_headReply) {
+        QPointer<QNetworkReply> oldHead = m_headReply;
+        m_headReply = nullptr;
+        if (oldHead) {
+            QObject::disconnect(oldHead, nullptr, this, nullptr);
+            oldHead->abort();
+            if (oldHead) oldHead->deleteLater();
+        }
+    }
+    if (m_singleReply) {
+        QPointer<QNetworkReply> oldReply = m_singleReply;
+        m_singleReply = nullptr;
+        if (oldReply) {
+            QObject::disconnect(oldReply, nullptr, this, nullptr);
+            oldReply->abort();
+            if (oldReply) oldReply->deleteLater();
         }
     }
+    m_singleFileId = 0;
+    m_singleQueued = 0;
+    m_singleBuffer.clear();
+    m_singleProcessing = false;
+    if (m_nativeLookup >= 0) {
+        QHostInfo::abortHostLookup(m_nativeLookup);
+        m_nativeLookup = -1;
+    }
+    m_nativeWaiting.clear();
+    for (const Race& race : std::as_const(m_races)) {
+        if (race.reply) abandonReply(race.reply, this);
+    }
+    m_races.clear();
+    ConnectionArbiter::instance().leave(this);
+    RateLimiter::instance().cancelWaits(this);
+
+    // Queued writes are dropped; committed offsets never count them, so resume refetches.
+    // A pending map sync goes with them; the next checkpoint queues a fresh one.
+    if (m_writeChannel) {
+        DiskWriterPool::instance().closeChannel(m_writeChannel, waitForDisk);
+        m_writeChannel = 0;
+    }
+    m_placementSyncId = 0;
+    m_placementPending.clear();
+    m_placementDirty = false;
+    emit bufferStatsChanged();
+}
+
+void DownloaderTask::rebalanceSoon()
+{
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    if (m_lastRebalanceMs > 0 && nowMs - m_lastRebalanceMs < 800) return;
+    m_lastRebalanceMs = nowMs;
+    // Ranges the host budget held back start whatever the speed cap; only splits and races wait.
+    if (m_maxSpeed > 0) {
+        if (m_state == State::Downloading && !m_anyError) startPendingSegments();
+        return;
+    }
+    rebalanceSegments();
 }
 
 void DownloaderTask::rebalanceSegments()
 {
     if (m_state != State::Downloading) return;
     if (!m_useRange || !m_serverSupportsRange) return;
-    if (!m_adaptiveSegmentsEnabled) return;
     if (m_anyError) return;
+    // Ranges left idle by the host's connection budget come before any new split.
+    startPendingSegments();
+    if (!m_adaptiveSegmentsEnabled) return;
     if (m_segmentsInfo.size() < 2) return;
 
-    constexpr int kMaxSegments = 32;
     const int desiredConnections = qBound(1, m_parallelTarget, kMaxSegments);
 
-    int activeConnections = 0;
+    int activeConnections = m_races.size() + m_nativeWaiting.size();
     for (const Segment& s : m_segmentsInfo) {
-        if (s.reply) {
+        if (transferring(s)) {
             ++activeConnections;
         }
     }
     int freeSlots = desiredConnections - activeConnections;
-    if (freeSlots <= 0) return;
+    ConnectionArbiter& arbiter = ConnectionArbiter::instance();
+    if (freeSlots <= 0) {
+        arbiter.report(this, m_arbiterHost, m_priority, heldConnections());
+        return;
+    }
+    // HTTP/2 streams share the one connection the host already counts.
+    if (!m_multiplexed) {
+        freeSlots = arbiter.request(this, m_arbiterHost, m_priority, heldConnections(), freeSlots);
+        if (freeSlots <= 0) return;
+    }
 
     while (freeSlots > 0) {
         if (!splitLargestRemainingSegment()) break;
         --freeSlots;
     }
+    // Tails too small to split are raced instead.
+    if (freeSlots > 0) startEndgameRaces(freeSlots);
 }
 
 bool DownloaderTask::splitLargestRemainingSegment()
 {
     if (!m_adaptiveSegmentsEnabled) return false;
     constexpr qint64 kMinChunkBytes = 256 * 1024;
-    constexpr int kMaxSegments = 32;
-    if (m_segmentsInfo.size() >= kMaxSegments) return false;
+    // Every running race may still turn into a segment of its own (see finishRace()).
+    if (m_segmentsInfo.size() + m_races.size() >= kMaxSegments) return false;
 
+    // Donors keep streaming, so what they still have to receive is what can be taken.
     int donorIndex = -1;
     qint64 donorRemaining = 0;
     for (int i = 0; i < m_segmentsInfo.size(); ++i) {
         const Segment& s = m_segmentsInfo.at(i);
-        if (!s.reply) continue;
-        if (s.processing || !s.buffer.isEmpty()) continue;
+        if (!transferring(s) || isRaced(i)) continue;
 
-        const qint64 total = qMax<qint64>(0, s.end - s.start + 1);
-        const qint64 remaining = qMax<qint64>(0, total - s.downloaded);
+        const qint64 remaining = unreceivedBytes(s);
         if (remaining < (kMinChunkBytes * 2)) continue;
         if (remaining > donorRemaining) {
             donorRemaining = remaining;
             donorIndex = i;
         }
-    }
-
-    if (donorIndex < 0) return false;
-
-    Segment& donor = m_segmentsInfo[donorIndex];
-    const qint64 nextOffset = donor.start + donor.downloaded;
-    const qint64 oldEnd = donor.end;
-    const qint64 remaining = oldEnd - nextOffset + 1;
-    if (remaining < (kMinChunkBytes * 2)) return false;
+    }
+
+    if (donorIndex < 0) return false;
+
+    Segment& donor = m_segmentsInfo[donorIndex];
+    const qint64 nextOffset = donor.end + 1 - unreceivedBytes(donor);
+    const qint64 oldEnd = donor.end;
+    const qint64 remaining = oldEnd - nextOffset + 1;
+    if (remaining < (kMinChunkBytes * 2)) return false;
+
+    // Across mirrors the new range is sized by its mirror's speed relative to the donor's,
+    // so slow mirrors take smaller ranges.
+    int tailMirror = -1;
+    qint64 tailBytes = remaining - remaining / 2;
+    if (m_mirrorSpread) {
+        tailMirror = pickMirror();
+        if (tailMirror < 0) return false;
+        const qreal tailWeight = mirrorWeight(tailMirror);
+        const qreal donorWeight = donor.mirror >= 0 ? mirrorWeight(donor.mirror) : tailWeight;
+        const qreal share = qBound(0.2, tailWeight / (tailWeight + donorWeight), 0.8);
+        tailBytes = qBound(kMinChunkBytes, static_cast<qint64>(remaining * share), remaining - kMinChunkBytes);
+    }
+    const qint64 firstHalf = remaining - tailBytes;
+    const qint64 donorNewEnd = nextOffset + firstHalf - 1;
+    qint64 splitStart = donorNewEnd + 1;
+    if (splitStart > oldEnd || donorNewEnd < nextOffset) return false;
+    if (donor.nativeTransfer) {
+        // The engine reports behind what it has taken from the socket; the cut goes after that.
+        const qint64 kept = RangeEngine::instance().shorten(donor.nativeTransfer, donorNewEnd);
+        if (kept < 0 || kept >= oldEnd) return false;
+        splitStart = kept + 1;
+    }
+
+    // The donor's request keeps running; reads stop at the new end (see readSegmentData()).
+    Segment* tail = splitOffTail(donorIndex, splitStart, tailMirror);
+    const Segment& shortened = m_segmentsInfo.at(donorIndex);
+    appendLog(QStringLiteral("Dynamic split [%1-%2] + [%3-%4]")
+                  .arg(shortened.start)
+                  .arg(shortened.end)
+                  .arg(tail->start)
+                  .arg(tail->end));
+
+    startSegment(tail);
+    return true;
+}
+
+DownloaderTask::Segment* DownloaderTask::splitOffTail(int donorIndex, qint64 splitStart, int mirror)
+{
+    Segment& donor = m_segmentsInfo[donorIndex];
+    const qint64 oldEnd = donor.end;
+    donor.end = splitStart - 1;
+
+    Segment splitSegment;
+    splitSegment.start = splitStart;
+    splitSegment.end = oldEnd;
+    splitSegment.downloaded = 0;
+    splitSegment.processing = false;
+    splitSegment.reply = nullptr;
+    splitSegment.fileId = 0;
+    splitSegment.queued = 0;
+    splitSegment.buffer.clear();
+    splitSegment.mirror = mirror;
+    if (m_placementActive) {
+        splitSegment.tempFilePath = donor.tempFilePath;
+    } else {
+        splitSegment.tempFilePath = QString("%1.part%2").arg(m_filePath).arg(m_segmentsInfo.size());
+        QFile::remove(splitSegment.tempFilePath);
+    }
+
+    m_segmentsInfo.push_back(splitSegment);
+    m_effectiveSegments = m_segmentsInfo.size();
+    // Journal the split before the new part receives data, so a restart keeps its bytes.
+    if (m_journalActive) {
+        if (utils::appendSegmentSplit(m_filePath, donorIndex, donor.end, oldEnd)) {
+            ++m_journalRecords;
+        } else {
+            compactSegmentJournal();
+        }
+    }
+    checkpointSegments(true);
+    updateIntegrityLayout();
+    return &m_segmentsInfo.last();
+}
+
+void DownloaderTask::startEndgameRaces(int freeSlots)
+{
+    // Duplicates bypass the token buckets, so no race while the task, its queue or the global limit caps it.
+    if (RateLimiter::instance().limited(m_rateNode)) return;
+    qint64 remaining = 0;
+    for (const Segment& s : m_segmentsInfo) {
+        remaining += unreceivedBytes(s);
+    }
+    if (remaining <= 0 || remaining > kEndgameRemainingBytes) return;
+
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    while (freeSlots > 0 && m_races.size() < kEndgameMaxRaces
+           && m_segmentsInfo.size() + m_races.size() < kMaxSegments) {
+        // Race the tail expected to finish last at its own pace.
+        int slowest = -1;
+        qint64 slowestEtaMs = kEndgameMinEtaMs;
+        for (int i = 0; i < m_segmentsInfo.size(); ++i) {
+            const Segment& s = m_segmentsInfo.at(i);
+            const qint64 left = unreceivedBytes(s);
+            if (!s.reply || left <= 0 || isRaced(i)) continue;
+            const qint64 elapsedMs = nowMs - s.replyStartMs;
+            if (elapsedMs < 1000) continue; // too early to judge its pace
+            const qint64 rate = s.replyBytes * 1000 / elapsedMs;
+            const qint64 etaMs = rate > 0 ? left * 1000 / rate : std::numeric_limits<qint64>::max();
+            if (etaMs > slowestEtaMs) {
+                slowestEtaMs = etaMs;
+                slowest = i;
+            }
+        }
+        if (slowest < 0) break;
+        startRace(slowest);
+        --freeSlots;
+    }
+}
+
+bool DownloaderTask::isRaced(int segmentIndex) const
+{
+    for (const Race& race : m_races) {
+        if (race.segment == segmentIndex) return true;
+    }
+    return false;
+}
+
+int DownloaderTask::raceIndexOf(const QNetworkReply* reply) const
+{
+    for (int i = 0; i < m_races.size(); ++i) {
+        if (m_races.at(i).reply == reply) return i;
+    }
+    return -1;
+}
+
+void DownloaderTask::startRace(int segmentIndex)
+{
+    const Segment& s = m_segmentsInfo.at(segmentIndex);
+    Race race;
+    race.segment = segmentIndex;
+    race.from = s.end + 1 - unreceivedBytes(s);
+    race.startedMs = QDateTime::currentMSecsSinceEpoch();
+
+    // A second verified mirror is the best bet; otherwise a fresh connection to the same one.
+    QUrl url = segmentUrl(s);
+    bool validatorsApply = !m_mirrorSpread || s.mirror < 0 || s.mirror == m_mirrorIndex;
+    if (m_mirrorSpread) {
+        int alternative = -1;
+        for (int i = 0; i < m_mirrorLinks.size(); ++i) {
+            const MirrorLink& link = m_mirrorLinks.at(i);
+            if (i == s.mirror || link.rejected || !link.verified) continue;
+            if (alternative < 0 || mirrorWeight(i) > mirrorWeight(alternative)) alternative = i;
+        }
+        if (alternative >= 0) {
+            url = QUrl(m_mirrorUrls.at(alternative));
+            validatorsApply = true;
+        } else if (s.mirror >= 0 && s.mirror < m_mirrorLinks.size()) {
+            validatorsApply = validatorsApply || m_mirrorLinks.at(s.mirror).verified;
+        }
+    }
+
+    QNetworkRequest req(url);
+    req.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                     QNetworkRequest::NoLessSafeRedirectPolicy);
+    req.setRawHeader("Range", QString("bytes=%1-%2").arg(race.from).arg(s.end).toUtf8());
+    if (validatorsApply) {
+        if (!m_etag.isEmpty()) {
+            req.setRawHeader("If-Range", m_etag.toUtf8());
+        } else if (!m_lastModified.isEmpty()) {
+            req.setRawHeader("If-Range", m_lastModified.toUtf8());
+        }
+    }
+    applyNetworkOptions(req);
+    QNetworkReply* reply = m_manager->get(req);
+    reply->setReadBufferSize(kReplyReadBufferSize);
+    race.reply = reply;
+    m_races.push_back(race);
+    appendLog(QStringLiteral("End-game: racing [%1-%2] of segment %3")
+                  .arg(race.from)
+                  .arg(s.end)
+                  .arg(segmentIndex));
+
+    QPointer<QNetworkReply> replyPtr(reply);
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, replyPtr]() {
+        const int index = raceIndexOf(replyPtr);
+        if (index < 0) return;
+        const int status = replyPtr->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 0) return;
+        qint64 first = -1;
+        qint64 last = -1;
+        qint64 total = -1;
+        const Race& race = m_races.at(index);
+        if (status != 206 || !parseContentRange(replyPtr->rawHeader("Content-Range"), &first, &last, &total)
+            || first != race.from || total != m_totalSize) {
+            dropRace(index, QStringLiteral("unexpected answer (HTTP %1)").arg(status));
+        }
+    });
+#if QT_CONFIG(ssl)
+    connect(reply, &QNetworkReply::sslErrors, this, [this, replyPtr](const QList<QSslError>& errors) {
+        if (m_allowInsecureSsl && replyPtr) replyPtr->ignoreSslErrors(errors);
+    });
+#endif
+    connect(reply, &QNetworkReply::readyRead, this, [this, replyPtr]() {
+        const int index = raceIndexOf(replyPtr);
+        if (index < 0) return;
+        Race& race = m_races[index];
+        const qint64 wanted = m_segmentsInfo.at(race.segment).end + 1 - race.from - race.buffer.size();
+        sampleNetworkRead(race.buffer.readFrom(replyPtr, qMax<qint64>(0, wanted)));
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, replyPtr]() {
+        const int index = raceIndexOf(replyPtr);
+        if (index < 0) return;
+        if (replyPtr->error() != QNetworkReply::NoError) {
+            dropRace(index, replyPtr->errorString());
+            return;
+        }
+        Race& race = m_races[index];
+        const qint64 wanted = m_segmentsInfo.at(race.segment).end + 1 - race.from;
+        race.buffer.readFrom(replyPtr, qMax<qint64>(0, wanted - race.buffer.size()));
+        if (race.buffer.size() < wanted) {
+            dropRace(index, QStringLiteral("short answer"));
+            return;
+        }
+        finishRace(index);
+    });
+}
 
-    const qint64 firstHalf = remaining / 2;
-    const qint64 donorNewEnd = nextOffset + firstHalf - 1;
-    const qint64 splitStart = donorNewEnd + 1;
-    if (splitStart > oldEnd || donorNewEnd < nextOffset) return false;
+void DownloaderTask::dropRace(int index, const QString& reason)
+{
+    Race race = m_races.takeAt(index);
+    if (race.reply) abandonReply(race.reply, this);
+    appendLog(QStringLiteral("End-game: duplicate of segment %1 dropped (%2)").arg(race.segment).arg(reason));
+}
 
-    if (donor.reply) {
-        QPointer<QNetworkReply> donorReply = donor.reply;
-        donor.reply = nullptr;
-        if (donorReply) {
-            QObject::disconnect(donorReply, nullptr, this, nullptr);
-            donorReply->abort();
-            if (donorReply) donorReply->deleteLater();
-        }
-    }
-    if (donor.file) {
-        donor.file->flush();
-        donor.file->close();
-        donor.file->deleteLater();
-        donor.file = nullptr;
+void DownloaderTask::settleRaces()
+{
+    for (int i = m_races.size() - 1; i >= 0; --i) {
+        const Segment& s = m_segmentsInfo.at(m_races.at(i).segment);
+        if (unreceivedBytes(s) > 0) continue;
+        dropRace(i, QStringLiteral("original finished first"));
     }
-    donor.end = donorNewEnd;
-
-    Segment splitSegment;
-    splitSegment.start = splitStart;
-    splitSegment.end = oldEnd;
-    splitSegment.downloaded = 0;
-    splitSegment.processing = false;
-    splitSegment.reply = nullptr;
-    splitSegment.file = nullptr;
-    splitSegment.buffer.clear();
-    splitSegment.tempFilePath = QString("%1.part%2").arg(m_filePath).arg(m_segmentsInfo.size());
-    QFile::remove(splitSegment.tempFilePath);
+}
 
-    m_segmentsInfo.push_back(splitSegment);
-    m_effectiveSegments = m_segmentsInfo.size();
+void DownloaderTask::finishRace(int index)
+{
+    Race race = m_races.takeAt(index);
+    race.reply->deleteLater();
+    if (m_state != State::Downloading) return;
 
-    appendLog(QStringLiteral("Dynamic split [%1-%2] + [%3-%4]")
-                  .arg(donor.start)
-                  .arg(donor.end)
-                  .arg(splitSegment.start)
-                  .arg(splitSegment.end));
+    Segment& original = m_segmentsInfo[race.segment];
+    const qint64 have = original.end + 1 - unreceivedBytes(original);
+    const qint64 oldEnd = original.end;
+    if (have > oldEnd) return; // the original got there in the same turn
+    if (m_segmentsInfo.size() >= kMaxSegments) {
+        // No room for the tail; the original keeps going.
+        appendLog(QStringLiteral("End-game: duplicate of segment %1 dropped (segment limit)").arg(race.segment));
+        return;
+    }
 
-    startSegment(&m_segmentsInfo[donorIndex]);
-    startSegment(&m_segmentsInfo.last());
-    return true;
+    // What the original would still have needed at its pace since the race began.
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    const qint64 raceMs = qMax<qint64>(1, nowMs - race.startedMs);
+    const qint64 originalRate = (have - race.from) * 1000 / raceMs;
+    const QString saved = originalRate > 0
+                              ? QStringLiteral("~%1 s saved").arg((oldEnd + 1 - have) / static_cast<double>(originalRate), 0, 'f', 1)
+                              : QStringLiteral("original had stalled");
+
+    // The duplicate wins: the original stops at what it already has, a new segment takes the rest
+    // from the duplicate's bytes.
+    race.buffer.consume(have - race.from);
+    Segment* tail = splitOffTail(race.segment, have, -1);
+    const int tailIndex = static_cast<int>(tail - m_segmentsInfo.constData());
+    Segment& shortened = m_segmentsInfo[race.segment];
+    if (shortened.reply) finishShortenedSegment(&shortened);
+
+    tail->fileId = ++m_nextFileId;
+    tail->queued = 0;
+    submitSegmentWrite(tail, race.buffer.takeAll(), true);
+    submitClose(tail->fileId, tailIndex);
+
+    appendLog(QStringLiteral("End-game: duplicate won [%1-%2], %3")
+                  .arg(have)
+                  .arg(oldEnd)
+                  .arg(saved));
 }
 
 void DownloaderTask::onSegmentFinished()
@@ -1640,12 +3055,19 @@ void DownloaderTask::onSegmentFinished()
     if (m_state != State::Downloading)
         return;
 
+    settleRaces();
+    ConnectionArbiter::instance().report(this, m_arbiterHost, m_priority, heldConnections());
     rebalanceSegments();
 
+    bool complete = true;
+    bool busy = false;
     for (const Segment& s : m_segmentsInfo) {
-        if (s.downloaded < (s.end - s.start + 1))
-            return;
+        if (s.downloaded < (s.end - s.start + 1)) complete = false;
+        if (transferring(s) || s.fileId) busy = true;
     }
+    // After an error nothing restarts idle segments, so stop once the rest has wound down.
+    if (!complete && !(m_anyError && !busy))
+        return;
 
     if (m_anyError) {
         if (m_errorCode.isEmpty()) {
@@ -1659,7 +3081,15 @@ void DownloaderTask::onSegmentFinished()
         return;
     }
 
-    if (!mergeSegments()) {
+    if (m_placementActive) {
+        if (!finalizeDirectPlacement()) {
+            m_anyError = true;
+            m_state = State::Finished;
+            emit stateChanged();
+            emit finished(false);
+            return;
+        }
+    } else if (!mergeSegments()) {
         m_anyError = true;
         recordError(QStringLiteral("disk"),
                     QStringLiteral("merge_failed"),
@@ -1670,6 +3100,8 @@ void DownloaderTask::onSegmentFinished()
         return;
     }
 
+    // Kept after completion so a later repair can find damaged blocks.
+    checkpointBlockManifest(true);
     m_state = State::Finished;
     emit stateChanged();
     emit finished(true);
@@ -1678,7 +3110,7 @@ void DownloaderTask::onSegmentFinished()
 bool DownloaderTask::mergeSegments()
 {
     QFile out(m_filePath);
-    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
         recordError(QStringLiteral("disk"),
                     QStringLiteral("merge_open_failed"),
                     QStringLiteral("Cannot open output file for merge"));
@@ -1694,34 +3126,24 @@ bool DownloaderTask::mergeSegments()
         return a->start < b->start;
     });
 
+    // Kernel-side copies (reflink, copy_file_range, sendfile) first; the buffered loop is the last resort.
+    PartMerger merger(&out);
+    QElapsedTimer mergeTimer;
+    mergeTimer.start();
     for (const Segment* seg : ordered) {
         if (!seg) continue;
-        QFile part(seg->tempFilePath);
-        if (!part.open(QIODevice::ReadOnly)) {
-            recordError(QStringLiteral("disk"),
-                        QStringLiteral("merge_part_missing"),
-                        QStringLiteral("Cannot open segment part: %1").arg(seg->tempFilePath));
+        if (!merger.append(seg->tempFilePath)) {
+            recordError(QStringLiteral("disk"), merger.errorCode(), merger.errorMessage());
             out.close();
             return false;
         }
-        QByteArray buffer;
-        buffer.resize(1024 * 1024);
-        while (!part.atEnd()) {
-            qint64 readBytes = part.read(buffer.data(), buffer.size());
-            if (readBytes <= 0) break;
-            qint64 written = out.write(buffer.constData(), readBytes);
-            if (written != readBytes) {
-                recordError(QStringLiteral("disk"),
-                            QStringLiteral("merge_write_failed"),
-                            QStringLiteral("Failed while merging segments"));
-                part.close();
-                out.close();
-                return false;
-            }
-        }
-        part.close();
-        part.remove();
+        QFile::remove(seg->tempFilePath);
     }
+    appendLog(QStringLiteral("Merged %1 parts (%2 MB) in %3 s: %4")
+                  .arg(ordered.size())
+                  .arg(merger.size() / (1024 * 1024))
+                  .arg(mergeTimer.nsecsElapsed() / 1e9, 0, 'f', 2)
+                  .arg(merger.summary()));
     out.close();
     const QFileInfo mergedInfo(m_filePath);
     if (m_totalSize > 0 && mergedInfo.exists() && mergedInfo.size() != m_totalSize) {
@@ -1732,6 +3154,193 @@ bool DownloaderTask::mergeSegments()
                         .arg(m_totalSize));
         return false;
     }
+    QFile::remove(utils::segmentJournalPath(m_filePath));
+    return true;
+}
+
+bool DownloaderTask::prepareDirectPlacement(int segCount)
+{
+    // A sync still in flight belongs to the previous layout; its map must not replace this one.
+    m_placementSyncId = 0;
+    m_placementPending.clear();
+    m_placementDirty = false;
+
+    const QString dataPath = utils::placementDataPath(m_filePath);
+    qint64 mappedTotal = 0;
+    QList<utils::PlacementRange> ranges;
+    const bool canResume = QFileInfo(dataPath).size() == m_totalSize
+                           && utils::readPlacementMap(m_filePath, &mappedTotal, &ranges)
+                           && mappedTotal == m_totalSize
+                           && ranges.size() <= 32;
+
+    if (canResume) {
+        for (const utils::PlacementRange& r : ranges) {
+            Segment s;
+            s.start = r.start;
+            s.end = r.end;
+            s.downloaded = r.done;
+            s.tempFilePath = dataPath;
+            m_segmentsInfo.push_back(s);
+        }
+        appendLog(QStringLiteral("Direct placement: restored %1 ranges").arg(ranges.size()));
+    } else {
+        QFile::remove(utils::placementMapPath(m_filePath));
+        QFile::remove(dataPath);
+        restartIntegrity();
+    }
+
+    // Sizing runs on the writer ahead of every segment write queued behind it. Reserving
+    // again on resume only fills the holes of a file an earlier run left sparse.
+    if (!canResume || !m_sparseTarget) {
+        const int allocId = ++m_nextFileId;
+        DiskWriterPool::Job allocate;
+        allocate.op = m_sparseTarget ? DiskWriterPool::Op::Resize : DiskWriterPool::Op::Allocate;
+        allocate.fileId = allocId;
+        allocate.path = dataPath;
+        allocate.offset = m_sparseTarget ? m_totalSize : 0;
+        allocate.length = m_totalSize;
+        allocate.tag = kPlacementTag;
+        if (!DiskWriterPool::instance().submit(writeChannel(), std::move(allocate), true)) {
+            recordError(QStringLiteral("disk"),
+                        QStringLiteral("preallocate_failed"),
+                        QStringLiteral("Cannot preallocate output file: %1").arg(dataPath));
+            return false;
+        }
+        submitClose(allocId, kPlacementTag);
+    }
+
+    if (!canResume) {
+        const qint64 segSize = m_totalSize / segCount;
+        for (int i = 0; i < segCount; ++i) {
+            Segment s;
+            s.start = i * segSize;
+            s.end = (i == segCount - 1) ? (m_totalSize - 1) : ((i + 1) * segSize - 1);
+            s.downloaded = 0;
+            s.tempFilePath = dataPath;
+            m_segmentsInfo.push_back(s);
+        }
+    }
+
+    m_effectiveSegments = m_segmentsInfo.size();
+    m_lastSegmentSaveMs = 0;
+    checkpointSegments(true);
+    return true;
+}
+
+void DownloaderTask::checkpointSegments(bool force)
+{
+    if (!(m_placementActive || m_journalActive) || m_totalSize <= 0 || m_segmentsInfo.isEmpty()) return;
+
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    if (!force && m_lastSegmentSaveMs > 0 && nowMs - m_lastSegmentSaveMs < 1000) return;
+    m_lastSegmentSaveMs = nowMs;
+
+    if (m_journalActive) {
+        QList<qint64> done;
+        done.reserve(m_segmentsInfo.size());
+        for (const Segment& s : m_segmentsInfo) done.append(s.downloaded);
+        if (done == m_journalDone) return;
+        if (m_journalRecords >= kJournalCompactRecords) {
+            compactSegmentJournal();
+            return;
+        }
+        if (!utils::appendSegmentCommit(m_filePath, done)) {
+            qWarning() << "Cannot append to segment journal for" << m_filePath;
+            return;
+        }
+        m_journalDone = done;
+        ++m_journalRecords;
+        return;
+    }
+
+    // The map may only claim bytes on stable storage, so it waits for a sync of the data file.
+    // One sync at a time; a checkpoint arriving meanwhile is taken up when it completes.
+    if (m_placementSyncId) {
+        m_placementDirty = true;
+        return;
+    }
+    syncPlacement();
+}
+
+void DownloaderTask::syncPlacement()
+{
+    // Counted offsets come from delivered write completions, so those writes sit ahead of the
+    // sync on the channel; transport writes made through other handles are flushed with the file.
+    m_placementPending.clear();
+    m_placementPending.reserve(m_segmentsInfo.size());
+    for (const Segment& s : m_segmentsInfo) {
+        m_placementPending.append(utils::PlacementRange{ s.start, s.end, s.downloaded });
+    }
+    m_placementDirty = false;
+    m_placementSyncId = ++m_nextFileId;
+
+    DiskWriterPool::Job sync;
+    sync.op = DiskWriterPool::Op::Sync;
+    sync.fileId = m_placementSyncId;
+    sync.path = utils::placementDataPath(m_filePath);
+    sync.tag = kPlacementTag;
+    DiskWriterPool::instance().submit(writeChannel(), std::move(sync), true);
+    submitClose(m_placementSyncId, kPlacementTag);
+}
+
+void DownloaderTask::onPlacementSynced(const DiskWriterPool::Result& result)
+{
+    if (result.fileId != m_placementSyncId) return;
+    m_placementSyncId = 0;
+    const QList<utils::PlacementRange> ranges = std::exchange(m_placementPending, {});
+    // A finished download has moved the data file into place and removed the map.
+    if (!m_placementActive || !QFile::exists(utils::placementDataPath(m_filePath))) return;
+    if (!result.ok) {
+        // The map keeps its older offsets, which were synced; a resume refetches the rest.
+        qWarning() << "Cannot sync placement data for" << m_filePath << ":" << result.errorMessage;
+        m_placementDirty = false;
+        return;
+    }
+    if (!utils::writePlacementMap(m_filePath, m_totalSize, ranges)) {
+        qWarning() << "Cannot write placement map for" << m_filePath;
+    }
+    if (m_placementDirty) syncPlacement();
+}
+
+void DownloaderTask::compactSegmentJournal()
+{
+    QList<utils::PlacementRange> ranges;
+    ranges.reserve(m_segmentsInfo.size());
+    m_journalDone.clear();
+    for (const Segment& s : m_segmentsInfo) {
+        ranges.append(utils::PlacementRange{ s.start, s.end, s.downloaded });
+        m_journalDone.append(s.downloaded);
+    }
+    m_journalRecords = 0;
+    if (!utils::resetSegmentJournal(m_filePath, m_totalSize, ranges)) {
+        qWarning() << "Cannot write segment journal for" << m_filePath;
+        m_journalDone.clear();
+    }
+}
+
+bool DownloaderTask::finalizeDirectPlacement()
+{
+    const QString dataPath = utils::placementDataPath(m_filePath);
+    const QFileInfo dataInfo(dataPath);
+    if (!dataInfo.exists() || (m_totalSize > 0 && dataInfo.size() != m_totalSize)) {
+        recordError(QStringLiteral("disk"),
+                    QStringLiteral("final_size_mismatch"),
+                    QStringLiteral("Final file size mismatch (%1 != %2)")
+                        .arg(dataInfo.size())
+                        .arg(m_totalSize));
+        return false;
+    }
+
+    if (QFile::exists(m_filePath)) {
+        QFile::remove(m_filePath);
+    }
+    if (!QFile::rename(dataPath, m_filePath)) {
+        recordError(QStringLiteral("disk"),
+                    QStringLiteral("rename_failed"),
+                    QStringLiteral("Cannot move completed file into place"));
+        return false;
+    }
+    QFile::remove(utils::placementMapPath(m_filePath));
     return true;
 }
 
@@ -1758,55 +3367,11 @@ void DownloaderTask::pause()
     emit speedChanged(0);
     emit etaChanged(-1);
 
-    for (Segment& s : m_segmentsInfo) {
-        if (s.reply) {
-            QPointer<QNetworkReply> segReply = s.reply;
-            s.reply = nullptr;
-            if (segReply) {
-                QObject::disconnect(segReply, nullptr, this, nullptr);
-                segReply->abort();
-                if (segReply) segReply->deleteLater();
-            }
-        }
-        if (s.file) {
-            s.file->flush();
-            s.file->close();
-            s.file->deleteLater();
-            s.file = nullptr;
-        }
-        s.buffer.clear();
-        s.processing = false;
-    }
-    if (m_headReply) {
-        QPointer<QNetworkReply> oldHead = m_headReply;
-        m_headReply = nullptr;
-        if (oldHead) {
-            QObject::disconnect(oldHead, nullptr, this, nullptr);
-            oldHead->abort();
-            if (oldHead) oldHead->deleteLater();
-        }
-    }
-    // For single-stream
-    if (m_singleReply) {
-        QPointer<QNetworkReply> oldReply = m_singleReply;
-        m_singleReply = nullptr;
-        if (oldReply) {
-            QObject::disconnect(oldReply, nullptr, this, nullptr);
-            oldReply->abort();
-            if (oldReply) oldReply->deleteLater();
-        }
-    }
-    if (m_singleFile) {
-        m_singleFile->flush();
-        m_singleFile->close();
-        m_singleFile->deleteLater();
-        m_singleFile = nullptr;
-    }
-    m_singleBuffer.clear();
-    m_singleProcessing = false;
+    releaseTransfers(false);
+    checkpointSegments(true);
+    checkpointBlockManifest(true);
 
-    // On some platforms, reusing a QNetworkAccessManager after aborting can cause subsequent
-    // requests to stall. Resetting here makes resume/start reliable.
+    // Picks up proxy changes made while paused; the shared session itself is kept.
     resetNetworkManager();
 }
 
@@ -1964,55 +3529,8 @@ void DownloaderTask::recover()
 
     appendLog(QStringLiteral("Recover requested"));
 
-    for (Segment& s : m_segmentsInfo) {
-        if (s.reply) {
-            QPointer<QNetworkReply> segReply = s.reply;
-            s.reply = nullptr;
-            if (segReply) {
-                QObject::disconnect(segReply, nullptr, this, nullptr);
-                segReply->abort();
-                if (segReply) segReply->deleteLater();
-            }
-        }
-        if (s.file) {
-            s.file->flush();
-            s.file->close();
-            s.file->deleteLater();
-            s.file = nullptr;
-        }
-        s.buffer.clear();
-        s.processing = false;
-    }
-
-    if (m_headReply) {
-        QPointer<QNetworkReply> oldHead = m_headReply;
-        m_headReply = nullptr;
-        if (oldHead) {
-            QObject::disconnect(oldHead, nullptr, this, nullptr);
-            oldHead->abort();
-            if (oldHead) oldHead->deleteLater();
-        }
-    }
-
-    if (m_singleReply) {
-        QPointer<QNetworkReply> oldReply = m_singleReply;
-        m_singleReply = nullptr;
-        if (oldReply) {
-            QObject::disconnect(oldReply, nullptr, this, nullptr);
-            oldReply->abort();
-            if (oldReply) oldReply->deleteLater();
-        }
-    }
-
-    if (m_singleFile) {
-        m_singleFile->flush();
-        m_singleFile->close();
-        m_singleFile->deleteLater();
-        m_singleFile = nullptr;
-    }
-
-    m_singleBuffer.clear();
-    m_singleProcessing = false;
+    releaseTransfers(false);
+    checkpointSegments(true);
     m_singleWritten = 0;
 
     if (!m_pauseReason.isEmpty()) {
@@ -2035,6 +3553,84 @@ void DownloaderTask::recover()
     start();
 }
 
+bool DownloaderTask::repairBlocks(const QList<int>& badBlocks)
+{
+    if (m_state != State::Finished || m_anyError || !m_serverSupportsRange || badBlocks.isEmpty())
+        return false;
+
+    const qint64 totalSize = QFileInfo(m_filePath).size();
+    if (totalSize <= 0) return false;
+    if (!m_blockManifest || m_blockManifest->totalSize() != totalSize) {
+        m_blockManifest = BlockManifest::load(utils::blockManifestPath(m_filePath), totalSize);
+        if (!m_blockManifest) return false;
+    }
+
+    QList<int> blocks = badBlocks;
+    std::sort(blocks.begin(), blocks.end());
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+    // Damaged stretches [start, end); the closest ones are merged until the progress map can hold them.
+    QList<std::pair<qint64, qint64>> bad;
+    for (int index : blocks) {
+        if (index < 0 || index >= m_blockManifest->blockCount()) continue;
+        const qint64 start = static_cast<qint64>(index) * BlockManifest::kBlockSize;
+        const qint64 end = qMin(totalSize, start + BlockManifest::kBlockSize);
+        if (!bad.isEmpty() && bad.last().second == start) {
+            bad.last().second = end;
+        } else {
+            bad.append({ start, end });
+        }
+    }
+    if (bad.isEmpty()) return false;
+    while (bad.size() > kMaxRepairRanges) {
+        int merge = 0;
+        for (int i = 1; i + 1 < bad.size(); ++i) {
+            if (bad.at(i + 1).first - bad.at(i).second < bad.at(merge + 1).first - bad.at(merge).second) merge = i;
+        }
+        bad[merge].second = bad.at(merge + 1).second;
+        bad.removeAt(merge + 1);
+    }
+
+    // Put the file back into the direct placement layout with only the damaged ranges missing.
+    const QString dataPath = utils::placementDataPath(m_filePath);
+    QFile::remove(dataPath);
+    if (!QFile::rename(m_filePath, dataPath)) {
+        appendLog(QStringLiteral("Repair: cannot move %1 aside").arg(m_filePath));
+        return false;
+    }
+    QList<utils::PlacementRange> ranges;
+    qint64 pos = 0;
+    for (const auto& [start, end] : bad) {
+        if (start > pos) ranges.append(utils::PlacementRange{ pos, start - 1, start - pos });
+        ranges.append(utils::PlacementRange{ start, end - 1, 0 });
+        pos = end;
+    }
+    if (pos < totalSize) ranges.append(utils::PlacementRange{ pos, totalSize - 1, totalSize - pos });
+    if (!utils::writePlacementMap(m_filePath, totalSize, ranges)) {
+        QFile::rename(dataPath, m_filePath);
+        appendLog(QStringLiteral("Repair: cannot write placement map"));
+        return false;
+    }
+
+    int refetched = 0;
+    for (const auto& [start, end] : bad) {
+        const int first = static_cast<int>(start / BlockManifest::kBlockSize);
+        const int last = static_cast<int>((end - 1) / BlockManifest::kBlockSize);
+        for (int index = first; index <= last; ++index) m_blockManifest->forgetBlock(index);
+        refetched += last - first + 1;
+    }
+    m_lastManifestSaveMs = 0;
+    checkpointBlockManifest(true);
+
+    m_totalSize = totalSize;
+    appendLog(QStringLiteral("Repair: refetching %1 block(s) in %2 range(s)").arg(refetched).arg(bad.size()));
+    clearErrorState();
+    m_state = State::Idle;
+    emit stateChanged();
+    start();
+    return true;
+}
+
 void DownloaderTask::seedPersistedStats(qint64 lastSpeed, int lastEta, qint64 pausedAtMs, const QString& pauseReason)
 {
     if (lastSpeed < 0) lastSpeed = 0;
@@ -2120,6 +3716,7 @@ void DownloaderTask::updateSpeedAndETA() {
 
     qint64 speed = (bytesDelta * 1000) / (elapsed == 0 ? 1 : elapsed); // bytes/sec
     m_speed = speed;
+    sampleMirrorThroughput();
     emit speedChanged(m_speed);
     appendSpeedSample(m_speed);
     if (speed > 0 && m_lastSpeed != speed) {
@@ -2139,6 +3736,7 @@ void DownloaderTask::updateSpeedAndETA() {
         m_eta = -1;
         emit etaChanged(m_eta);
     }
+    emit bufferStatsChanged();
     evaluateAdaptiveSegments();
 }
 
@@ -2151,6 +3749,20 @@ void DownloaderTask::restart()
     start();
 }
 
+qint64 DownloaderTask::bufferedBytes() const
+{
+    qint64 total = m_singleBuffer.size() + m_singleQueued;
+    for (const Segment& s : m_segmentsInfo) total += s.buffer.size() + s.queued;
+    return total;
+}
+
+qint64 DownloaderTask::bufferMemoryBytes() const
+{
+    qint64 total = m_singleBuffer.memoryBytes();
+    for (const Segment& s : m_segmentsInfo) total += s.buffer.memoryBytes();
+    return total;
+}
+
 qint64 DownloaderTask::totalDownloaded() const
 {
     qint64 total = 0;
@@ -2199,11 +3811,11 @@ bool DownloaderTask::segmentActive(int index) const
     if (!m_segmentsInfo.isEmpty()) {
         if (index >= m_segmentsInfo.size()) return false;
         const Segment& s = m_segmentsInfo.at(index);
-        return s.reply || s.processing || !s.buffer.isEmpty();
+        return transferring(s) || s.processing || !s.buffer.isEmpty() || s.queued > 0;
     }
 
     if (m_effectiveSegments <= 1 && index == 0) {
-        return m_singleReply || m_singleProcessing || !m_singleBuffer.isEmpty();
+        return m_singleReply || m_singleProcessing || !m_singleBuffer.isEmpty() || m_singleQueued > 0;
     }
     return false;
 }
@@ -2243,61 +3855,25 @@ QString DownloaderTask::stateString() const
 
 void DownloaderTask::cleanup(bool emitFinished)
 {
+    // Wait for the writer to drop its handles so the files below can be removed.
+    releaseTransfers(true);
     for (Segment& s : m_segmentsInfo) {
-        if (s.reply) {
-            QPointer<QNetworkReply> segReply = s.reply;
-            s.reply = nullptr;
-            if (segReply) {
-                QObject::disconnect(segReply, nullptr, this, nullptr);
-                segReply->abort();
-                if (segReply) segReply->deleteLater();
-            }
-        }
-        if (s.file) {
-            s.file->flush();
-            s.file->close();
-            s.file->deleteLater();
-            s.file = nullptr;
-        }
-        s.buffer.clear();
-        s.processing = false;
         s.downloaded = 0;
         QFile::remove(s.tempFilePath);
     }
-
-    if (m_singleFile) {
-        m_singleFile->flush();
-        m_singleFile->close();
-        m_singleFile->deleteLater();
-        m_singleFile = nullptr;
-    }
-    if (m_singleReply) {
-        QPointer<QNetworkReply> oldReply = m_singleReply;
-        m_singleReply = nullptr;
-        if (oldReply) {
-            QObject::disconnect(oldReply, nullptr, this, nullptr);
-            oldReply->abort();
-            if (oldReply) oldReply->deleteLater();
-        }
-    }
-    if (m_headReply) {
-        QPointer<QNetworkReply> oldHead = m_headReply;
-        m_headReply = nullptr;
-        if (oldHead) {
-            QObject::disconnect(oldHead, nullptr, this, nullptr);
-            oldHead->abort();
-            if (oldHead) oldHead->deleteLater();
-        }
-    }
-
-    m_singleBuffer.clear();
-    m_singleProcessing = false;
     m_singleWritten = 0;
     if (m_useSingleTemp && !m_singleTempPath.isEmpty()) {
         QFile::remove(m_singleTempPath);
     } else {
         QFile::remove(m_filePath);
     }
+    QFile::remove(utils::placementDataPath(m_filePath));
+    QFile::remove(utils::placementMapPath(m_filePath));
+    QFile::remove(utils::blockManifestPath(m_filePath));
+    QFile::remove(utils::segmentJournalPath(m_filePath));
+    m_placementActive = false;
+    m_journalActive = false;
+    m_blockManifest.reset();
 
     resetNetworkManager();
 
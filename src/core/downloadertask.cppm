@@ -30,13 +30,23 @@ module;
 #include <QTimer>
 #include <QVector>
 #include <QFile>
+#include <QHostAddress>
 #include <QUrl>
 #include <QElapsedTimer>
 #include <QStringList>
 #include <QVariantList>
+#include <memory>
 
 #ifndef Q_MOC_RUN
 export module raad.core.downloadertask;
+import raad.core.chunkring;
+import raad.core.diskwriter;
+import raad.core.hostprofile;
+import raad.core.rangeengine;
+import raad.core.ratelimiter;
+import raad.core.segmentcontroller;
+import raad.core.streamhash;
+import raad.utils.download_utils;
 #endif
 
 #ifdef Q_MOC_RUN
@@ -173,9 +183,27 @@ RAAD_MODULE_EXPORT class DownloaderTask : public QObject {
     //!< @brief Whether adaptive segment controller is enabled.
     Q_PROPERTY(bool adaptiveSegmentsEnabled READ adaptiveSegmentsEnabled WRITE setAdaptiveSegmentsEnabled NOTIFY adaptiveSegmentsChanged)
 
+    //!< @brief Whether segments write in place into one preallocated file.
+    Q_PROPERTY(bool directPlacement READ directPlacement WRITE setDirectPlacement NOTIFY directPlacementChanged)
+
+    //!< @brief Whether the output file is left sparse instead of reserving its full size.
+    Q_PROPERTY(bool sparseTarget READ sparseTarget WRITE setSparseTarget NOTIFY sparseTargetChanged)
+
+    //!< @brief Whether plain-HTTP segments use the native zero-copy transport.
+    Q_PROPERTY(bool nativeTransport READ nativeTransport WRITE setNativeTransport NOTIFY networkOptionsChanged)
+
     //!< @brief Current adaptive target segment count.
     Q_PROPERTY(int adaptiveTarget READ adaptiveTarget NOTIFY adaptiveSegmentsChanged)
 
+    //!< @brief Recent adaptive controller decisions, oldest first.
+    Q_PROPERTY(QStringList adaptiveTrace READ adaptiveTrace NOTIFY adaptiveSegmentsChanged)
+
+    //!< @brief Whether segments are HTTP/2 streams sharing one connection.
+    Q_PROPERTY(bool multiplexed READ multiplexed NOTIFY adaptiveSegmentsChanged)
+
+    //!< @brief Connections the segments are expected to use.
+    Q_PROPERTY(int connectionTarget READ connectionTarget NOTIFY adaptiveSegmentsChanged)
+
     //!< @brief Estimated process CPU load used by adaptive controller.
     Q_PROPERTY(qreal adaptiveCpuLoad READ adaptiveCpuLoad NOTIFY adaptiveMetricsChanged)
 
@@ -185,6 +213,18 @@ RAAD_MODULE_EXPORT class DownloaderTask : public QObject {
     //!< @brief Estimated network loss/instability ratio (0..1).
     Q_PROPERTY(qreal adaptivePacketLoss READ adaptivePacketLoss NOTIFY adaptiveMetricsChanged)
 
+    //!< @brief Downloaded bytes held in memory (buffered or queued for disk).
+    Q_PROPERTY(qint64 bufferedBytes READ bufferedBytes NOTIFY bufferStatsChanged)
+
+    //!< @brief Pooled block memory held by this task's buffers.
+    Q_PROPERTY(qint64 bufferMemoryBytes READ bufferMemoryBytes NOTIFY bufferStatsChanged)
+
+    //!< @brief Memory share assigned by the manager (0 = default watermark).
+    Q_PROPERTY(qint64 bufferBudget READ bufferBudget WRITE setBufferBudget NOTIFY bufferStatsChanged)
+
+    //!< @brief Reads deferred because the buffer watermark was reached.
+    Q_PROPERTY(int backpressureStalls READ backpressureStalls NOTIFY bufferStatsChanged)
+
     //!< @brief Last structured error category.
     Q_PROPERTY(QString errorCategory READ errorCategory NOTIFY errorStateChanged)
 
@@ -213,6 +253,9 @@ public:
                             int segments = 4,
                             QObject* parent = nullptr);
 
+    //!< @brief Detach from the disk writer so no completion outlives the task.
+    ~DownloaderTask() override;
+
     //!< @brief Start the download.
     Q_INVOKABLE void start();
 
@@ -237,6 +280,17 @@ public:
     //!< @brief Recover from a paused/error state while preserving partial data.
     Q_INVOKABLE void recover();
 
+    /**
+     * @brief Refetch damaged blocks of a completed download in place.
+     *
+     * Moves the finished file back into the placement layout with only the
+     * given blocks marked missing, then starts the task again.
+     *
+     * @param badBlocks Block indexes (BlockManifest::kBlockSize units) to download again.
+     * @return false if the task is not a successfully finished ranged download.
+     */
+    bool repairBlocks(const QList<int>& badBlocks);
+
     //!< @brief Mark the task as paused without network state.
     void markPaused();
 
@@ -280,15 +334,19 @@ public:
      * @brief Set max speed limit.
      * @param v Speed limit in bytes/sec (0 = unlimited).
      */
-    Q_INVOKABLE void setMaxSpeed(qint64 v) {
-        if (m_maxSpeed != v) {
-            m_maxSpeed = v;
-            emit maxSpeedChanged();
-            // reset throttle window so limit applies immediately
-            m_throttleTimer.restart();
-            m_throttleBytes = 0;
-        }
-    }
+    Q_INVOKABLE void setMaxSpeed(qint64 v);
+
+    /**
+     * @brief Share a parent rate limit with other tasks (e.g. a queue or global cap).
+     * @param node RateLimiter node id (0 = no parent).
+     */
+    void setRateParent(int node);
+
+    //!< @brief Return this task's RateLimiter node id.
+    int rateNode() const { return m_rateNode; }
+
+    //!< @brief Return the checksum fed by committed writes (null when not tracked this run).
+    std::shared_ptr<StreamHasher> streamHash() const { return m_streamHash; }
     //!< @brief Return max speed limit.
     qint64 maxSpeed() const { return m_maxSpeed; }
 
@@ -579,9 +637,75 @@ public:
      */
     void setAdaptiveSegmentsEnabled(bool enabled);
 
+    //!< @brief Return direct-placement write mode toggle.
+    bool directPlacement() const { return m_directPlacement; }
+
+    /**
+     * @brief Enable/disable direct-placement writes.
+     *
+     * When enabled, segmented downloads write at their absolute offsets into
+     * a single preallocated file instead of separate `.partN` files, so no
+     * merge pass is needed on completion. Takes effect on the next start.
+     *
+     * @param enabled Toggle state.
+     */
+    void setDirectPlacement(bool enabled);
+
+    //!< @brief Return whether the output file is kept sparse.
+    bool sparseTarget() const { return m_sparseTarget; }
+
+    /**
+     * @brief Keep the output file sparse instead of reserving its blocks.
+     *
+     * By default the engine reserves the whole download with fallocate()
+     * before the first byte arrives, so the disk cannot fill up halfway and
+     * the file gets contiguous extents. A sparse target is only sized; the
+     * placement map's completed ranges, not the file size, say what has
+     * arrived. Takes effect on the next start.
+     *
+     * @param enabled Toggle state.
+     */
+    void setSparseTarget(bool enabled);
+
+    //!< @brief Return whether the native transport was asked for this task.
+    bool nativeTransport() const { return m_nativeTransport; }
+
+    /**
+     * @brief Enable/disable the native range transport.
+     *
+     * Segments of plain-HTTP downloads without proxy or speed limit then go
+     * through RangeEngine, which splices body bytes from the socket into the
+     * file. Anything else, and any segment the engine fails on, stays on the
+     * Qt network stack.
+     *
+     * @param enabled Toggle state.
+     */
+    void setNativeTransport(bool enabled);
+
+    //!< @brief Let the next run use the native transport because its host is listed for it.
+    void setNativeTransportHost(bool enabled) { m_nativeHost = enabled; }
+
+    /**
+     * @brief Start the next run from what earlier downloads learned about the host.
+     * @param profile Host profile (an unknown host clears the warm start).
+     */
+    void applyHostProfile(const HostProfile& profile);
+
+    //!< @brief Return what the last run learned about its host.
+    HostObservation hostObservation() const;
+
     //!< @brief Return current adaptive target segment count.
     int adaptiveTarget() const { return m_adaptiveTarget; }
 
+    //!< @brief Return the adaptive controller's recent decisions, one line each.
+    QStringList adaptiveTrace() const { return m_segmentController.traceLines(); }
+
+    //!< @brief Return whether the server negotiated HTTP/2, so segments are multiplexed streams.
+    bool multiplexed() const { return m_multiplexed; }
+
+    //!< @brief Return the number of connections the current segment target needs.
+    int connectionTarget() const;
+
     //!< @brief Return adaptive process CPU load estimate.
     qreal adaptiveCpuLoad() const { return m_adaptiveCpuLoadPct; }
 
@@ -591,6 +715,24 @@ public:
     //!< @brief Return adaptive packet-loss/instability estimate (0..1).
     qreal adaptivePacketLoss() const { return m_adaptivePacketLossRate; }
 
+    //!< @brief Return downloaded bytes held in memory (buffered or queued for disk).
+    qint64 bufferedBytes() const;
+
+    //!< @brief Return pooled block memory held by this task's buffers.
+    qint64 bufferMemoryBytes() const;
+
+    //!< @brief Return the assigned memory share (0 = default watermark).
+    qint64 bufferBudget() const { return m_bufferBudget; }
+
+    /**
+     * @brief Set how many downloaded bytes the task may hold in memory.
+     * @param bytes Budget in bytes (0 = default watermark).
+     */
+    void setBufferBudget(qint64 bytes);
+
+    //!< @brief Return reads deferred by backpressure since the task was created.
+    int backpressureStalls() const { return m_backpressureStalls; }
+
     //!< @brief Return error category.
     QString errorCategory() const { return m_errorCategory; }
 
@@ -723,6 +865,15 @@ signals:
     //!< @brief Emitted when adaptive metrics change.
     void adaptiveMetricsChanged();
 
+    //!< @brief Emitted when direct placement is switched on or off.
+    void directPlacementChanged();
+
+    //!< @brief Emitted when the sparse-target setting changes.
+    void sparseTargetChanged();
+
+    //!< @brief Emitted when buffered bytes or buffer memory change.
+    void bufferStatsChanged();
+
     //!< @brief Emitted when structured error state changes.
     void errorStateChanged();
 
@@ -749,22 +900,53 @@ private:
     };
 
 
+    /**
+     * @brief Per-mirror state while segments are spread over several mirrors.
+     */
+    struct MirrorLink {
+        qint64 sampleBytes = 0;             //!< Bytes received since the last throughput sample.
+        qreal rate = 0.0;                   //!< Throughput per connection in bytes/sec (EMA, 0 = unmeasured).
+        int failures = 0;                   //!< Failed requests during this run.
+        bool verified = false;              //!< Size and ETag matched the primary mirror.
+        bool rejected = false;              //!< No longer used: mismatch, no range support or repeated failures.
+    };
+
+    /**
+     * @brief Duplicate request racing the slow tail of a segment during the end game.
+     */
+    struct Race {
+        int segment = -1;                   //!< Index of the raced segment.
+        qint64 from = 0;                    //!< First offset requested (the segment's receive point at start).
+        QNetworkReply* reply = nullptr;     //!< Duplicate request.
+        ChunkRing buffer;                   //!< Bytes received so far; tails are small enough to keep in memory.
+        qint64 startedMs = 0;               //!< When the race started.
+    };
+
     /**
      * @brief Metadata and runtime state for a download segment.
      *
-     * Each segment represents a byte range request with its own temporary
-     * storage and buffering state. Segments are merged on successful completion.
+     * Each segment represents a byte range request with its own buffering
+     * state. In the legacy layout every segment owns a `.partN` file that is
+     * merged on completion; with direct placement all segments share one
+     * preallocated file and write at their absolute offsets.
      */
     struct Segment {
         qint64 start = 0;                   //!< Byte range start offset.
         qint64 end = 0;                     //!< Byte range end offset.
         qint64 downloaded = 0;              //!< Bytes downloaded so far.
         QNetworkReply* reply = nullptr;     //!< Active network reply.
-        QString tempFilePath;               //!< Temporary file path.
+        int nativeTransfer = 0;             //!< Active RangeEngine transfer (0 = none).
+        qint64 replyFrom = 0;               //!< First offset the active reply was asked for.
+        qint64 replyEnd = -1;               //!< Last offset the active reply was asked for (past @ref end after a split).
+        int mirror = -1;                    //!< Mirror serving the segment (-1 = currentUrl()).
+        qint64 replyStartMs = 0;            //!< When the active reply was attached.
+        qint64 replyBytes = 0;              //!< Bytes the active reply has delivered.
+        QString tempFilePath;               //!< Temporary file path (shared in direct placement).
 
         // Throttling and buffering
-        QByteArray buffer;                  //!< Buffered incoming data.
-        QFile* file = nullptr;              //!< Output file handle.
+        ChunkRing buffer;                   //!< Buffered incoming data (pooled blocks).
+        int fileId = 0;                     //!< Disk writer handle id (0 = not opened).
+        qint64 queued = 0;                  //!< Bytes handed to the writer, not yet committed.
         bool processing = false;            //!< Buffer processing flag.
     };
 
@@ -777,13 +959,26 @@ private:
     qint64 m_totalSize = 0;                         //!< Total content size.
 
     QVector<Segment> m_segmentsInfo;                //!< Segment list.
-    QNetworkAccessManager* m_manager = nullptr;     //!< Network manager.
-    QNetworkReply* m_headReply = nullptr;           //!< HEAD request reply.
+    QVector<Race> m_races;                          //!< End-game duplicates in flight.
+    QVector<MirrorLink> m_mirrorLinks;              //!< Mirror states, parallel to m_mirrorUrls.
+    bool m_mirrorSpread = false;                    //!< Segments are fetched from all usable mirrors at once.
+    qint64 m_mirrorSampleMs = 0;                    //!< Start of the current mirror throughput window.
+    QNetworkAccessManager* m_manager = nullptr;     //!< Network session borrowed from NetworkSessionPool.
+    QNetworkReply* m_headReply = nullptr;           //!< Probe reply (HEAD or ranged GET) until its headers are handled.
 
     State m_state = State::Idle;            //!< Current state.
     bool m_useRange = true;                 //!< Whether range requests are enabled.
     bool m_anyError = false;                //!< Error flag.
     bool m_serverSupportsRange = true;      //!< Server range support flag.
+    bool m_rangeProbeFailed = false;        //!< The ranged GET probe misbehaved; later starts probe with HEAD.
+    int m_warmSegments = 0;                 //!< Segment count learned for the host (0 = none).
+    bool m_hostRangeless = false;           //!< The host is known to ignore ranges.
+    bool m_skipSegmentation = false;        //!< This run uses a single stream because of m_hostRangeless.
+    int m_rangeVerdict = 0;                 //!< Range support seen this run: 1 yes, -1 no, 0 not checked.
+    qint64 m_probeSentMs = 0;               //!< When the probe request went out.
+    int m_probeRttMs = 0;                   //!< Probe latency until its headers arrived.
+    int m_serverThrottleEvents = 0;         //!< 429/503 answers this run.
+    QString m_arbiterHost;                  //!< Host whose connection budget the segments draw on.
 
     QElapsedTimer m_speedTimer;             //!< Speed/ETA update timer.
     qint64 m_lastBytes = 0;                 //!< Bytes at last speed sample.
@@ -827,6 +1022,7 @@ private:
     int m_priority = 100;                   //!< Task priority.
     bool m_adaptiveSegmentsEnabled = true;  //!< Adaptive segment controller toggle.
     int m_adaptiveTarget = 0;               //!< Adaptive segment target.
+    bool m_multiplexed = false;             //!< Last reply used HTTP/2; segments are streams on a shared connection.
     QString m_errorCategory;                //!< Last error category.
     QString m_errorCode;                    //!< Last error code.
     QString m_errorMessage;                 //!< Last error message.
@@ -846,17 +1042,41 @@ private:
     qint64 m_adaptiveCpuLastClockTicks = 0; //!< Last process CPU clock sample.
     qint64 m_adaptiveCpuLastWallMs = 0;     //!< Last wall-time CPU sample.
     qint64 m_adaptiveLastEvalMs = 0;        //!< Last adaptive evaluate timestamp.
-
-    // throttle window (non-blocking)
-    QElapsedTimer m_throttleTimer;          //!< Throttle timer.
-    qint64 m_throttleBytes = 0;             //!< Bytes written in current throttle window.
+    qint64 m_adaptiveWindowBytes = 0;       //!< Bytes received since the last evaluation.
+    int m_adaptiveStallMark = 0;            //!< Backpressure stalls at the last evaluation.
+    SegmentController m_segmentController;  //!< Throughput-driven segment target.
+    bool m_directPlacement = true;          //!< Preferred write layout for segmented downloads.
+    bool m_sparseTarget = false;            //!< Size output files without reserving their blocks.
+    bool m_nativeTransport = false;         //!< Plain-HTTP segments may use RangeEngine.
+    bool m_nativeHost = false;              //!< The manager listed the host for the native transport.
+    bool m_nativeFailed = false;            //!< A native transfer failed this run; later segments use Qt.
+    QHostAddress m_nativeAddress;           //!< Resolved segment host for native transfers.
+    int m_nativeLookup = -1;                //!< Pending host lookup id (-1 = none).
+    QVector<int> m_nativeWaiting;           //!< Segments waiting for the host lookup.
+    bool m_placementActive = false;         //!< Current run writes into the preallocated file.
+    bool m_journalActive = false;           //!< Current run writes `.partN` files tracked by the segment journal.
+    qint64 m_lastSegmentSaveMs = 0;         //!< Last progress map / journal checkpoint timestamp.
+    int m_journalRecords = 0;               //!< Records appended since the journal was last compacted.
+    QList<qint64> m_journalDone;            //!< Committed offsets in the last journal record.
+    int m_placementSyncId = 0;              //!< Writer handle of the data-file sync in flight (0 = none).
+    QList<raad::utils::PlacementRange> m_placementPending;  //!< Progress map to write once that sync completes.
+    bool m_placementDirty = false;          //!< A checkpoint came in while the sync was in flight.
+
+    // speed limit
+    int m_rateNode = 0;                     //!< Token bucket node in the shared RateLimiter.
+
+    // streaming checksum
+    std::shared_ptr<StreamHasher> m_streamHash;  //!< Hash of committed bytes (null = state lost).
+    std::shared_ptr<BlockManifest> m_blockManifest;  //!< Per-block checksums (null = size unknown).
+    qint64 m_lastManifestSaveMs = 0;        //!< Last block manifest checkpoint timestamp.
     qint64 m_maxSpeed = 0;                  //!< Max speed in bytes/sec.
     qint64 m_lastProgressEmitMs = 0;        //!< Last progress signal timestamp.
     qint64 m_lastRebalanceMs = 0;           //!< Last segment rebalance timestamp.
 
     // single-stream helpers
-    QByteArray m_singleBuffer;              //!< Single-stream buffer.
-    QFile* m_singleFile = nullptr;          //!< Single-stream file handle.
+    ChunkRing m_singleBuffer;               //!< Single-stream buffer (pooled blocks).
+    int m_singleFileId = 0;                 //!< Single-stream disk writer handle id.
+    qint64 m_singleQueued = 0;              //!< Single-stream bytes queued in the writer.
     QNetworkReply* m_singleReply = nullptr; //!< Single-stream reply.
     bool m_singleProcessing = false;        //!< Single-stream processing flag.
     qint64 m_singleWritten = 0;             //!< Single-stream bytes written.
@@ -864,6 +1084,14 @@ private:
     QString m_singleTempPath;               //!< Single-stream temp path.
     bool m_useSingleTemp = true;            //!< Use temp file for single stream.
 
+    // asynchronous disk writes
+    int m_writeChannel = 0;                 //!< Disk writer channel id (0 = not opened).
+    int m_nextFileId = 0;                   //!< Last issued disk writer handle id.
+
+    // backpressure
+    qint64 m_bufferBudget = 0;              //!< Memory share from the manager (0 = default watermark).
+    int m_backpressureStalls = 0;           //!< Reads deferred at the watermark.
+
     /**
      * @brief Start a network request for a specific segment.
      *
@@ -872,18 +1100,163 @@ private:
      */
     void startSegment(Segment* segment);
 
+    /**
+     * @brief Make @p reply the active request of a segment and wire its handlers.
+     * @param segment Segment to feed.
+     * @param reply Reply delivering the segment's bytes from its current offset.
+     */
+    void attachSegmentReply(Segment* segment, QNetworkReply* reply);
+
+    //!< @brief Return segment @p index if @p reply still feeds it, else nullptr.
+    Segment* replySegment(int index, const QNetworkReply* reply);
+
+    //!< @brief Return whether a segment has a request in flight (Qt reply or native transfer).
+    static bool transferring(const Segment& s) { return s.reply || s.nativeTransfer; }
+
+    //!< @brief Return whether a segment may go through RangeEngine.
+    bool nativeEligible(const Segment& segment) const;
+
+    /**
+     * @brief Fetch a segment through RangeEngine, resolving its host first if needed.
+     * @param segment Segment to fetch.
+     * @param req Request Qt would have sent; its URL and headers are reused.
+     * @param from First offset to fetch.
+     */
+    void startNativeSegment(Segment* segment, const QNetworkRequest& req, qint64 from);
+
+    //!< @brief Handle an event of a segment's native transfer.
+    void onNativeEvent(int index, const RangeEngine::Event& event);
+
+    //!< @brief Give a segment back to the Qt transport after its native transfer stopped.
+    void fallBackFromNative(Segment* segment, const QString& reason);
+
+    /**
+     * @brief Learn size and range support with a HEAD request, then plan the transfer.
+     * @param hasExistingFile Output file already has data.
+     * @param hasPartialSegments `.partN` files from an earlier run exist.
+     * @param hasPlacementData A placement map from an earlier run or a repair exists.
+     */
+    void sendHeadProbe(bool hasExistingFile, bool hasPartialSegments, bool hasPlacementData);
+
+    /**
+     * @brief Probe a fresh download with `GET Range: bytes=0-`.
+     *
+     * A 206 answer gives size, validators and range support, and its body
+     * is kept as segment 0. Errors and unexpected answers fall back to
+     * sendHeadProbe().
+     */
+    void sendRangeProbe();
+
+    //!< @brief Abort a probe still waiting for headers.
+    void dropProbeReply();
+
+    //!< @brief Return the URL a segment requests (its mirror, or currentUrl()).
+    QUrl segmentUrl(const Segment& segment) const;
+
+    //!< @brief Reset mirror states and decide whether segments spread over the mirrors.
+    void prepareMirrorSpread();
+
+    //!< @brief Return the expected per-connection throughput of a mirror (unmeasured ones count as the best).
+    qreal mirrorWeight(int mirror) const;
+
+    //!< @brief Return the usable mirror with the most expected throughput per extra connection, or -1.
+    int pickMirror() const;
+
+    /**
+     * @brief Stop using a mirror for the rest of the run.
+     * @param mirror Mirror index.
+     * @param reason Log message.
+     */
+    void rejectMirror(int mirror, const QString& reason);
+
+    /**
+     * @brief Check a mirror's 206 answer against the primary before its data is used.
+     * @return false if the mirror was rejected.
+     */
+    bool verifyMirrorReply(int mirror, const QNetworkReply* reply);
+
+    //!< @brief Restart a segment whose mirror failed on another mirror; false when none is left.
+    bool reassignSegment(Segment* segment, const QString& reason);
+
+    //!< @brief Fold received bytes into per-mirror throughput, about once a second.
+    void sampleMirrorThroughput();
+
+    //!< @brief Take validators, status and protocol from a probe reply.
+    void recordProbeHeaders(const QNetworkReply* reply);
+
+    /**
+     * @brief Choose single-stream or segmented transfer once the size is known, and start it.
+     * @param totalSize Content length.
+     * @param rangesSupported Server accepts byte ranges.
+     * @param probe Ranged GET probe reading from offset 0 to adopt as segment 0, or null.
+     * @param hasExistingFile Output file already has data.
+     * @param hasPartialSegments `.partN` files from an earlier run exist.
+     * @param hasPlacementData A placement map from an earlier run or a repair exists.
+     */
+    void planTransfer(qint64 totalSize,
+                      bool rangesSupported,
+                      QNetworkReply* probe,
+                      bool hasExistingFile,
+                      bool hasPartialSegments,
+                      bool hasPlacementData);
+
     //!< @brief Rebalance in-flight ranges by splitting large active segments.
     void rebalanceSegments();
 
+    //!< @brief Call rebalanceSegments() at most every 800 ms, and not while speed-capped.
+    void rebalanceSoon();
+
     //!< @brief Split the largest remaining active segment to keep connections busy.
     bool splitLargestRemainingSegment();
 
+    //!< @brief Return bytes of a segment's range not yet taken from the network.
+    static qint64 unreceivedBytes(const Segment& s);
+
+    //!< @brief Drop the reply of a segment that was shortened by a split and has reached its new end.
+    void finishShortenedSegment(Segment* s);
+
+    /**
+     * @brief Move [splitStart, end] of a segment into a new, idle segment.
+     * @param donorIndex Segment to shorten.
+     * @param splitStart First offset of the new segment.
+     * @param mirror Mirror for the new segment (-1 = pick when it starts).
+     * @return The new segment.
+     */
+    Segment* splitOffTail(int donorIndex, qint64 splitStart, int mirror);
+
+    /**
+     * @brief Race duplicates for the slowest unsplittable tails once little data is left.
+     * @param freeSlots Connections available for duplicates.
+     */
+    void startEndgameRaces(int freeSlots);
+
+    //!< @brief Request the unreceived tail of a segment a second time.
+    void startRace(int segmentIndex);
+
+    //!< @brief Return the race fed by @p reply, or -1.
+    int raceIndexOf(const QNetworkReply* reply) const;
+
+    //!< @brief Return whether a segment is being raced.
+    bool isRaced(int segmentIndex) const;
+
+    //!< @brief Cancel a race and discard its bytes.
+    void dropRace(int index, const QString& reason);
+
+    //!< @brief Use a completed duplicate for what the raced segment still lacks and cancel the original.
+    void finishRace(int index);
+
+    //!< @brief Cancel duplicates whose segment completed first.
+    void settleRaces();
+
     /**
      * @brief Start or resume a single-stream download.
      *
      * Used when segmented downloads are unavailable or disabled.
+     *
+     * @param resume Continue after the bytes already on disk.
+     * @param adopted Probe reply streaming the body from offset 0 to use instead of a new GET.
      */
-    void startSingleStream(bool resume);
+    void startSingleStream(bool resume, QNetworkReply* adopted = nullptr);
 
     /**
      * @brief Merge completed segment files into the final output file.
@@ -892,6 +1265,39 @@ private:
      */
     bool mergeSegments();
 
+    /**
+     * @brief Build the segment list over the preallocated data file.
+     *
+     * Restores ranges and committed offsets from the progress map when it
+     * matches the current size, otherwise preallocates a fresh data file and
+     * splits it evenly into @p segCount ranges.
+     *
+     * @return true if the data file is ready for positional writes.
+     */
+    bool prepareDirectPlacement(int segCount);
+
+    /**
+     * @brief Persist committed segment offsets to the progress map or segment journal.
+     * @param force Write even if the last checkpoint is recent.
+     */
+    void checkpointSegments(bool force);
+
+    //!< @brief Queue a sync of the placement data file behind every counted write; the map follows it.
+    void syncPlacement();
+
+    //!< @brief Write the progress map held for a completed data-file sync.
+    void onPlacementSynced(const DiskWriterPool::Result& result);
+
+    //!< @brief Rewrite the segment journal as one layout record holding the current segment map.
+    void compactSegmentJournal();
+
+    /**
+     * @brief Move the completed data file into its final location.
+     *
+     * @return true if the file was renamed and has the expected size.
+     */
+    bool finalizeDirectPlacement();
+
     /**
      * @brief Sum total downloaded bytes.
      * @return Total bytes downloaded.
@@ -916,7 +1322,88 @@ private:
     //!< @brief Process buffered single-stream data.
     void processSingleBuffer();
 
-    //!< @brief Reset the network manager with current proxy settings.
+    //!< @brief Complete a single-stream download once its output is closed.
+    void finishSingleStream();
+
+    //!< @brief Return the disk writer channel, opening it on first use.
+    int writeChannel();
+
+    //!< @brief Return bytes that may still be buffered before reads are deferred.
+    qint64 bufferRoom() const;
+
+    //!< @brief Move available reply data into a segment buffer, within the watermark.
+    void readSegmentData(Segment* s);
+
+    //!< @brief Move available reply data into the single-stream buffer, within the watermark.
+    void readSingleData();
+
+    //!< @brief Pull data left in replies by backpressure once buffer room frees up.
+    void resumeReads();
+
+    /**
+     * @brief Hand a chunk of segment data to the disk writer.
+     * @param s Segment pointer.
+     * @param data Slices that follow the segment's committed and queued data.
+     * @param force Queue even if the channel is over capacity.
+     * @return false if the writer is saturated and the caller should keep the data.
+     */
+    bool submitSegmentWrite(Segment* s, QVector<BufferSlice> data, bool force);
+
+    //!< @brief Hand a chunk of single-stream data to the disk writer.
+    bool submitSingleWrite(QVector<BufferSlice> data, bool force);
+
+    //!< @brief Queue a close for a writer handle; its completion continues the flow.
+    void submitClose(int fileId, int tag);
+
+    /**
+     * @brief Decide whether this run can hash committed bytes as they are written.
+     * @param hasExistingData Data from an earlier run is on disk.
+     */
+    void prepareStreamHash(bool hasExistingData);
+
+    //!< @brief Start the streaming checksum and block manifest over after the download data was discarded.
+    void restartIntegrity();
+
+    //!< @brief Tell the streaming checksum and block manifest where each range lives on disk.
+    void updateIntegrityLayout();
+
+    //!< @brief Let a write job feed the streaming checksum and block manifest once it is on disk.
+    void attachWriteObservers(DiskWriterPool::Job& job, qint64 streamOffset);
+
+    /**
+     * @brief Load or create the block manifest for the current total size.
+     * @return true if checksums were loaded from the sidecar (resume must check against them).
+     */
+    bool prepareBlockManifest();
+
+    /**
+     * @brief Cut each resumed segment back to the bytes that match the block manifest.
+     * @param loaded Checksums came from the sidecar rather than from this process.
+     */
+    void validateResumedSegments(bool loaded);
+
+    /**
+     * @brief Persist the block manifest sidecar.
+     * @param force Write even if the last checkpoint is recent.
+     */
+    void checkpointBlockManifest(bool force);
+
+    //!< @brief Apply a completed disk writer job to task state.
+    void onDiskWriteCompleted(const DiskWriterPool::Result& result);
+
+    //!< @brief Emit progress and refresh speed/ETA, rate-limited for the UI.
+    void reportProgress();
+
+    /**
+     * @brief Abort replies and detach from the disk writer without touching files.
+     * @param waitForDisk Block until the writer has released its file handles.
+     */
+    void releaseTransfers(bool waitForDisk);
+
+    //!< @brief Stop the task after a disk writer failure, keeping partial data.
+    void failWithDiskError(const QString& code, const QString& message);
+
+    //!< @brief Borrow the shared network session matching the current proxy settings.
     void resetNetworkManager();
 
     //!< @brief Return the active URL (mirror-aware).
@@ -943,8 +1430,20 @@ private:
     //!< @brief Evaluate and apply adaptive segment target.
     void evaluateAdaptiveSegments();
 
-    //!< @brief Determine a recommended adaptive segment target.
-    int recommendedAdaptiveTarget() const;
+    //!< @brief Record whether @p reply was served over HTTP/2.
+    void noteProtocol(const QNetworkReply* reply);
+
+    //!< @brief Record a 429/503/504 answer.
+    void noteServerThrottle();
+
+    //!< @brief Return the connections the segments and races hold (one for all HTTP/2 streams).
+    int heldConnections() const;
+
+    //!< @brief Ask the host's budget for one more connection; true if it may be opened.
+    bool claimConnection();
+
+    //!< @brief Start idle unfinished segments while the host's budget grants connections.
+    void startPendingSegments();
 
     //!< @brief Reset adaptive controller samples.
     void resetAdaptiveStats();
@@ -958,6 +1457,12 @@ private:
     //!< @brief Parse start offset from a Content-Range header.
     [[nodiscard]] qint64 parseContentRangeStart(const QByteArray& contentRange) const;
 
+    /**
+     * @brief Parse a complete `bytes first-last/total` Content-Range header.
+     * @return false if the header is missing, open-ended or inconsistent.
+     */
+    [[nodiscard]] bool parseContentRange(const QByteArray& contentRange, qint64* first, qint64* last, qint64* total) const;
+
     //!< @brief Set structured error state.
     void recordError(const QString& category,
                      const QString& code,
@@ -1,5 +1,6 @@
 module;
 #include <limits>
+#include <memory>
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDesktopServices>
@@ -47,6 +48,12 @@ module;
 
 module raad.core.downloadmanager;
 
+import raad.core.connectionarbiter;
+import raad.core.diskwriter;
+import raad.core.hostprofile;
+import raad.core.networksession;
+import raad.core.ratelimiter;
+import raad.core.streamhash;
 import raad.utils.download_utils;
 import raad.utils.category_utils;
 
@@ -165,9 +172,16 @@ qint64 currentProcessResidentBytes()
 #endif
 }
 
+//!< Outcome of re-checking a finished file against its block manifest.
+struct RepairScan {
+    bool ok = false;            //!< The file and its manifest could be read.
+    QList<int> badBlocks;       //!< Blocks that no longer match (or never had a checksum).
+};
+
 } // namespace
 
 DownloadManager::DownloadManager(QObject* parent) : QObject(parent) {
+    m_globalRateNode = RateLimiter::instance().createNode();
     m_saveTimer.setSingleShot(true);
     m_saveTimer.setInterval(400);
     connect(&m_saveTimer, &QTimer::timeout, this, &DownloadManager::saveSession);
@@ -282,7 +296,19 @@ void DownloadManager::updateRuntimeStats()
     const bool reachabilityChanged = nextReachability != m_networkReachability;
     const bool segmentsChanged = qAbs(nextAverageSegments - m_averageActiveSegments) >= 0.1;
 
-    if (!cpuChanged && !memoryChanged && !diskChanged && !reachabilityChanged && !segmentsChanged) {
+    const QString nextWriterBackend = DiskWriterPool::backendName(DiskWriterPool::instance().activeBackend());
+    const bool writerBackendChanged = nextWriterBackend != m_activeDiskWriterBackend;
+
+    distributeMemoryBudget();
+    qint64 nextBufferedBytes = 0;
+    for (DownloaderTask* task : m_queue) {
+        if (task) nextBufferedBytes += task->bufferedBytes();
+    }
+    const bool bufferedChanged = qAbs(nextBufferedBytes - m_bufferedBytes) >= (256 * 1024)
+                                 || (nextBufferedBytes == 0) != (m_bufferedBytes == 0);
+
+    if (!cpuChanged && !memoryChanged && !diskChanged && !reachabilityChanged && !segmentsChanged
+        && !writerBackendChanged && !bufferedChanged) {
         return;
     }
 
@@ -291,6 +317,8 @@ void DownloadManager::updateRuntimeStats()
     m_diskFreeBytes = nextDiskFreeBytes;
     m_networkReachability = nextReachability;
     m_averageActiveSegments = nextAverageSegments;
+    m_activeDiskWriterBackend = nextWriterBackend;
+    m_bufferedBytes = nextBufferedBytes;
     emit runtimeStatsChanged();
 }
 
@@ -428,12 +456,12 @@ void DownloadManager::handleNetworkReachabilityChanged()
 
         if (!online && task->isRunning()) {
             task->pauseWithReason(QStringLiteral("Network offline"));
-            m_taskPausedByNetwork[task] = true;
+            setTaskPausedBy(task, TaskRegistry::PausedByNetwork, true);
             continue;
         }
 
-        if (online && m_taskPausedByNetwork.value(task, false) && task->stateString() == "Paused") {
-            m_taskPausedByNetwork[task] = false;
+        if (online && taskPausedBy(task, TaskRegistry::PausedByNetwork) && task->stateString() == "Paused") {
+            setTaskPausedBy(task, TaskRegistry::PausedByNetwork, false);
             task->recover();
         }
     }
@@ -591,7 +619,9 @@ DownloaderTask* DownloadManager::addDownloadInternal(const QString &urlStr,
     DownloaderTask* task = createTask(url, normalizedPath, resolvedQueue, resolvedCategory, segments);
     if (task && options) {
         applyTaskOptions(task, *options);
-        m_taskPriority[task] = task->priority();
+        const TaskRegistry::Id id = m_tasks.id(task);
+        if (id != TaskRegistry::kNoTask) m_tasks.priority(id) = task->priority();
+        syncSchedule(task);
     }
     if (startPaused && task) {
         task->markPaused();
@@ -685,6 +715,15 @@ void DownloadManager::applyTaskOptions(DownloaderTask* task, const QVariantMap&
     if (options.contains("adaptiveSegments")) {
         task->setAdaptiveSegmentsEnabled(options.value("adaptiveSegments").toBool());
     }
+    if (options.contains("nativeTransport")) {
+        task->setNativeTransport(options.value("nativeTransport").toBool());
+    }
+    if (options.contains("directPlacement")) {
+        task->setDirectPlacement(options.value("directPlacement").toBool());
+    }
+    if (options.contains("sparseTarget")) {
+        task->setSparseTarget(options.value("sparseTarget").toBool());
+    }
 
     if (options.contains("postOpenFile")) task->setPostOpenFile(options.value("postOpenFile").toBool());
     if (options.contains("postRevealFolder")) task->setPostRevealFolder(options.value("postRevealFolder").toBool());
@@ -704,8 +743,14 @@ void DownloadManager::onTaskFinishedWrapper(bool success) {
         return;
     }
 
-    m_taskSpeed[t] = 0;
-    m_taskCompletedAt[t] = QDateTime::currentMSecsSinceEpoch();
+    // Removed tasks report their cancel here too; they no longer have a row.
+    const TaskRegistry::Id id = m_tasks.id(t);
+    const qint64 completedAt = QDateTime::currentMSecsSinceEpoch();
+    if (id != TaskRegistry::kNoTask) {
+        m_tasks.setSpeed(id, 0);
+        m_tasks.cold(id).completedAt = completedAt;
+    }
+    ConnectionArbiter::instance().leave(t);
 
     const QString state = t->stateString();
     const QString name = QFileInfo(t->fileName()).fileName();
@@ -720,10 +765,16 @@ void DownloadManager::onTaskFinishedWrapper(bool success) {
                             {QStringLiteral("networkError"), t->lastNetworkError()}
                         });
 
+    if (state == "Done" || state == "Error") {
+        m_hostProfiles.learn(taskHost(t), t->hostObservation(), completedAt);
+    }
+
     if (state == "Done") {
         // Ensure final progress metadata is consistent for completed tasks.
-        qint64 finalReceived = qMax(m_taskReceived.value(t, 0), m_taskTotal.value(t, 0));
-        qint64 finalTotal = qMax(m_taskTotal.value(t, 0), finalReceived);
+        const qint64 knownReceived = id != TaskRegistry::kNoTask ? m_tasks.received(id) : 0;
+        const qint64 knownTotal = id != TaskRegistry::kNoTask ? m_tasks.total(id) : 0;
+        qint64 finalReceived = qMax(knownReceived, knownTotal);
+        qint64 finalTotal = qMax(knownTotal, finalReceived);
         const QString normalized = utils::normalizeFilePath(t->fileName());
         const QFileInfo info(normalized);
         if (info.exists() && info.isFile()) {
@@ -735,12 +786,13 @@ void DownloadManager::onTaskFinishedWrapper(bool success) {
         } else if (finalReceived <= 0) {
             finalReceived = 0;
         }
-        m_taskReceived[t] = finalReceived;
-        m_taskLastReceived[t] = finalReceived;
-        m_taskTotal[t] = finalTotal;
+        if (id != TaskRegistry::kNoTask) {
+            m_tasks.setProgress(id, finalReceived, finalTotal);
+            m_tasks.lastReceived(id) = finalReceived;
+            m_tasks.cold(id).retryCount = 0;
+        }
         m_model.seedProgress(t, finalReceived, finalTotal);
 
-        m_taskRetryCount[t] = 0;
         emit toastRequested(QStringLiteral("Download finished: %1").arg(name), QStringLiteral("success"));
         applyPostActions(t);
         if (t->verifyOnComplete() || !t->checksumExpected().isEmpty()) {
@@ -760,10 +812,10 @@ void DownloadManager::onTaskFinishedWrapper(bool success) {
             startQueued();
         } else {
             const int maxRetries = t->retryMax() >= 0 ? t->retryMax() : m_autoRetryMax;
-            int attempts = m_taskRetryCount.value(t, 0);
+            const int attempts = id != TaskRegistry::kNoTask ? m_tasks.cold(id).retryCount : 0;
             const bool retryable = isRetryableFailure(t);
             if (retryable && attempts < maxRetries) {
-                m_taskRetryCount[t] = attempts + 1;
+                if (id != TaskRegistry::kNoTask) m_tasks.cold(id).retryCount = attempts + 1;
                 QPointer<DownloaderTask> taskPtr(t);
                 const int delayMs = nextRetryDelayMs(t, attempts);
                 const int delaySecUi = qMax(1, delayMs / 1000);
@@ -794,7 +846,7 @@ void DownloadManager::onTaskFinishedWrapper(bool success) {
             } else if (retryable) {
                 const QString reason = pauseReasonForFailure(t);
                 t->pauseAfterFailure(reason);
-                m_taskPausedByNetwork[t] = isConnectivityFailure(t);
+                setTaskPausedBy(t, TaskRegistry::PausedByNetwork, isConnectivityFailure(t));
                 emit toastRequested(QStringLiteral("Paused: %1 (%2)").arg(name, reason), QStringLiteral("warning"));
             } else if (!retryable) {
                 emit toastRequested(QStringLiteral("Not retryable: %1").arg(name), QStringLiteral("warning"));
@@ -828,6 +880,22 @@ void DownloadManager::setPerHostMaxConcurrent(int value)
     scheduleSave();
 }
 
+int DownloadManager::perHostMaxConnections() const
+{
+    return NetworkSessionPool::instance().connectionsPerHost();
+}
+
+void DownloadManager::setPerHostMaxConnections(int value)
+{
+    value = qBound(1, value, NetworkSessionPool::kMaxConnectionsPerHost);
+    if (perHostMaxConnections() == value) return;
+    // The same number caps each session's sockets and the budget all tasks share per host.
+    NetworkSessionPool::instance().setConnectionsPerHost(value);
+    ConnectionArbiter::instance().setBudget(value);
+    emit schedulingPolicyChanged();
+    scheduleSave();
+}
+
 void DownloadManager::setPersistSensitiveOptions(bool enabled)
 {
     if (m_persistSensitiveOptions == enabled) return;
@@ -844,6 +912,42 @@ void DownloadManager::setTelemetryEnabled(bool enabled)
     scheduleSave();
 }
 
+void DownloadManager::setDiskWriterBackend(const QString& name)
+{
+    const DiskWriterPool::Backend backend = DiskWriterPool::backendFromName(name);
+    const QString next = DiskWriterPool::backendName(backend);
+    if (m_diskWriterBackend == next) return;
+    m_diskWriterBackend = next;
+    DiskWriterPool::instance().setBackend(backend);
+    emit diskWriterPolicyChanged();
+    updateRuntimeStats();
+    scheduleSave();
+}
+
+void DownloadManager::setMemoryBudget(qint64 bytes)
+{
+    // Below a few pooled blocks per task, segments would stall on every read.
+    const qint64 next = qMax<qint64>(16ll * 1024 * 1024, bytes);
+    if (m_memoryBudget == next) return;
+    m_memoryBudget = next;
+    emit memoryBudgetChanged();
+    distributeMemoryBudget();
+    scheduleSave();
+}
+
+void DownloadManager::distributeMemoryBudget()
+{
+    int running = 0;
+    for (DownloaderTask* task : m_queue) {
+        if (task && task->isRunning()) ++running;
+    }
+    if (running == 0) return;
+    const qint64 share = qMax<qint64>(1024 * 1024, m_memoryBudget / running);
+    for (DownloaderTask* task : m_queue) {
+        if (task && task->isRunning()) task->setBufferBudget(share);
+    }
+}
+
 void DownloadManager::setDefaultUserAgent(const QString& value)
 {
     const QString next = value.trimmed().isEmpty()
@@ -929,6 +1033,7 @@ void DownloadManager::setGlobalMaxSpeed(qint64 v)
     if (v < 0) v = 0;
     if (m_globalMaxSpeed == v) return;
     m_globalMaxSpeed = v;
+    RateLimiter::instance().setRate(m_globalRateNode, v);
     emit globalMaxSpeedChanged();
     for (DownloaderTask* t : m_queue) {
         if (t) applyTaskSpeed(t);
@@ -966,96 +1071,86 @@ void DownloadManager::updatePowerState()
 
 void DownloadManager::startQueued()
 {
-    QHash<QString, int> runningPerQueue;
-    QHash<QString, int> runningPerHost;
-    int running = 0;
-    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
-    for (DownloaderTask* t : m_queue) {
-        if (t && t->isRunning()) {
-            running++;
-            const QString qname = m_taskQueue.value(t, defaultQueueName());
-            runningPerQueue[qname] = runningPerQueue.value(qname, 0) + 1;
-            const QString host = taskHost(t);
-            if (!host.isEmpty()) {
-                runningPerHost[host] = runningPerHost.value(host, 0) + 1;
-            }
-        }
-    }
-
-    const QTime now = QTime::currentTime();
     if (m_pauseOnBattery && m_onBattery) {
         emit countsChanged();
         return;
     }
 
-    QVector<DownloaderTask*> candidates;
-    candidates.reserve(m_queue.size());
-    for (DownloaderTask* candidate : m_queue) {
-        if (!candidate || !candidate->isIdle()) continue;
-        candidates.append(candidate);
-    }
+    const QTime now = QTime::currentTime();
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    const auto hostAllowed = [this, nowMs](const QString& host) {
+        if (host.isEmpty()) return true;
+        if (!hostCooldownAllowsStart(host, nowMs)) return false;
+        return m_perHostMaxConcurrent <= 0 || m_ready.runningOnHost(host) < m_perHostMaxConcurrent;
+    };
 
-    while (running < m_maxConcurrent) {
-        DownloaderTask* best = nullptr;
-        QString bestQueue;
-        QString bestHost;
+    while (m_ready.running() < m_maxConcurrent && m_ready.readyCount() > 0) {
+        // Each queue offers its best startable task; the queues then compete on
+        // priority, their own load and age.
+        ReadyQueue::Id best = ReadyQueue::kNone;
         int bestPriority = std::numeric_limits<int>::min();
         int bestQueuePressure = std::numeric_limits<int>::max();
-        int bestHostPressure = std::numeric_limits<int>::max();
         qint64 bestOrder = std::numeric_limits<qint64>::max();
 
-        for (DownloaderTask* candidate : candidates) {
-            if (!candidate || !candidate->isIdle()) continue;
-
-            const QString qname = m_taskQueue.value(candidate, defaultQueueName());
+        const QStringList queues = m_ready.readyQueues();
+        for (const QString& qname : queues) {
             if (!m_queues.contains(qname)) createQueue(qname);
             const QueueInfo* info = queueInfo(qname);
             if (!info) continue;
             if (!isQueueAllowed(*info, now)) continue;
 
             const int queueLimit = info->maxConcurrent > 0 ? info->maxConcurrent : m_maxConcurrent;
-            const int queuePressure = runningPerQueue.value(qname, 0);
+            const int queuePressure = m_ready.runningInQueue(qname);
             if (queuePressure >= queueLimit) continue;
 
-            const QString host = taskHost(candidate);
-            if (!host.isEmpty()) {
-                if (!hostCooldownAllowsStart(host, nowMs)) continue;
-                if (m_perHostMaxConcurrent > 0 && runningPerHost.value(host, 0) >= m_perHostMaxConcurrent) continue;
-            }
-
-            const int priority = m_taskPriority.value(candidate, candidate->priority());
-            const int hostPressure = host.isEmpty() ? 0 : runningPerHost.value(host, 0);
-            const qint64 createdOrder = m_taskCreatedOrder.value(candidate, std::numeric_limits<qint64>::max());
+            const ReadyQueue::Id candidate = m_ready.best(qname, hostAllowed);
+            if (candidate == ReadyQueue::kNone) continue;
+            const int priority = m_ready.priority(candidate);
+            const qint64 createdOrder = m_ready.order(candidate);
 
             const bool better =
                 (priority > bestPriority) ||
                 (priority == bestPriority && queuePressure < bestQueuePressure) ||
-                (priority == bestPriority && queuePressure == bestQueuePressure && hostPressure < bestHostPressure) ||
-                (priority == bestPriority && queuePressure == bestQueuePressure && hostPressure == bestHostPressure && createdOrder < bestOrder);
+                (priority == bestPriority && queuePressure == bestQueuePressure && createdOrder < bestOrder);
 
             if (better) {
                 best = candidate;
-                bestQueue = qname;
-                bestHost = host;
                 bestPriority = priority;
                 bestQueuePressure = queuePressure;
-                bestHostPressure = hostPressure;
                 bestOrder = createdOrder;
             }
         }
 
-        if (!best) break;
-        applyTaskSpeed(best);
-        best->start();
-        running++;
-        runningPerQueue[bestQueue] = runningPerQueue.value(bestQueue, 0) + 1;
-        if (!bestHost.isEmpty()) {
-            runningPerHost[bestHost] = runningPerHost.value(bestHost, 0) + 1;
-        }
+        if (best == ReadyQueue::kNone) break;
+        DownloaderTask* task = static_cast<DownloaderTask*>(m_tasks.task(best));
+        const QString host = m_ready.host(best);
+        applyTaskSpeed(task);
+        task->applyHostProfile(m_hostProfiles.profile(host));
+        task->setNativeTransportHost(m_nativeTransportHosts.contains(host));
+        task->start();
+        // start() always leaves Idle, and stateChanged moves the task out of the
+        // ready set; never spin on a task that stayed behind.
+        syncSchedule(task);
+        if (m_ready.status(best) == ReadyQueue::Status::Ready) break;
     }
+    distributeMemoryBudget();
     emit countsChanged();
 }
 
+void DownloadManager::syncSchedule(DownloaderTask* task)
+{
+    const TaskRegistry::Id id = m_tasks.id(task);
+    if (id == TaskRegistry::kNoTask) return;
+    ReadyQueue::Status status = ReadyQueue::Status::None;
+    if (task->isRunning()) {
+        status = ReadyQueue::Status::Running;
+    } else if (task->isIdle()) {
+        status = ReadyQueue::Status::Ready;
+    }
+    const TaskRegistry::Cold& cold = m_tasks.cold(id);
+    m_ready.update(id, status, cold.queue, cold.host, m_tasks.priority(id), m_tasks.createdOrder(id));
+}
+
 void DownloadManager::removeDownload(int index)
 {
     removeDownloadWithOptions(index, false);
@@ -1069,21 +1164,8 @@ void DownloadManager::removeDownloadWithOptions(int index, bool deleteFromDisk)
     const int configuredSegments = task->segments();
     const int effectiveSegments = task->effectiveSegments();
     m_queue.removeAll(task);
-    m_taskSpeed.remove(task);
-    m_taskReceived.remove(task);
-    m_taskTotal.remove(task);
-    m_taskLastReceived.remove(task);
-    m_taskMaxSpeed.remove(task);
-    m_taskCompletedAt.remove(task);
-    m_taskRetryCount.remove(task);
-    m_taskPriority.remove(task);
-    m_taskCreatedOrder.remove(task);
-    m_taskQueue.remove(task);
-    m_taskCategory.remove(task);
-    m_taskPausedBySchedule.remove(task);
-    m_taskPausedByQuota.remove(task);
-    m_taskPausedByBattery.remove(task);
-    m_taskPausedByNetwork.remove(task);
+    m_ready.remove(m_tasks.id(task));
+    m_tasks.remove(task);
     if (m_checksumWatchers.contains(task)) {
         if (QPointer<QFutureWatcher<QString>> watcher = m_checksumWatchers.take(task)) {
             watcher->cancel();
@@ -1107,21 +1189,8 @@ void DownloadManager::clearCompleted()
             DownloaderTask* task = m_model.taskAt(i);
             if (task) {
                 m_queue.removeAll(task);
-                m_taskSpeed.remove(task);
-                m_taskReceived.remove(task);
-                m_taskTotal.remove(task);
-                m_taskLastReceived.remove(task);
-                m_taskMaxSpeed.remove(task);
-                m_taskCompletedAt.remove(task);
-                m_taskRetryCount.remove(task);
-                m_taskPriority.remove(task);
-                m_taskCreatedOrder.remove(task);
-                m_taskQueue.remove(task);
-                m_taskCategory.remove(task);
-                m_taskPausedBySchedule.remove(task);
-                m_taskPausedByQuota.remove(task);
-                m_taskPausedByBattery.remove(task);
-                m_taskPausedByNetwork.remove(task);
+                m_ready.remove(m_tasks.id(task));
+                m_tasks.remove(task);
                 if (m_checksumWatchers.contains(task)) {
                     if (QPointer<QFutureWatcher<QString>> watcher = m_checksumWatchers.take(task)) {
                         watcher->cancel();
@@ -1164,21 +1233,8 @@ void DownloadManager::cancelAll()
     }
     m_bulkCancelInProgress = false;
     m_queue.clear();
-    m_taskSpeed.clear();
-    m_taskReceived.clear();
-    m_taskTotal.clear();
-    m_taskLastReceived.clear();
-    m_taskMaxSpeed.clear();
-    m_taskCompletedAt.clear();
-    m_taskRetryCount.clear();
-    m_taskPriority.clear();
-    m_taskCreatedOrder.clear();
-    m_taskQueue.clear();
-    m_taskCategory.clear();
-    m_taskPausedBySchedule.clear();
-    m_taskPausedByQuota.clear();
-    m_taskPausedByBattery.clear();
-    m_taskPausedByNetwork.clear();
+    m_tasks.clear();
+    m_ready.clear();
     updateTotals();
     emit countsChanged();
     scheduleSave();
@@ -1309,25 +1365,15 @@ void DownloadManager::verifyChecksumAsync(DownloaderTask* task)
         return;
     }
 
-    QString algo = task->checksumAlgorithm().trimmed();
     const QString expectedRaw = task->checksumExpected().trimmed();
-    if (algo.isEmpty()) {
-        if (!expectedRaw.isEmpty()) {
-            algo = utils::detectChecksumAlgo(expectedRaw);
-        }
-        if (algo.isEmpty()) {
-            algo = QStringLiteral("SHA256");
-        }
+    const QString algo = utils::resolveChecksumAlgo(task->checksumAlgorithm(), expectedRaw);
+    if (task->checksumAlgorithm().trimmed().isEmpty()) {
         task->setChecksumAlgorithm(algo);
     }
 
     const QString algoUpper = algo.toUpper();
     QCryptographicHash::Algorithm hashAlgo = QCryptographicHash::Sha256;
-    if (algoUpper == "MD5") hashAlgo = QCryptographicHash::Md5;
-    else if (algoUpper == "SHA1") hashAlgo = QCryptographicHash::Sha1;
-    else if (algoUpper == "SHA256") hashAlgo = QCryptographicHash::Sha256;
-    else if (algoUpper == "SHA512") hashAlgo = QCryptographicHash::Sha512;
-    else {
+    if (!utils::checksumHashAlgorithm(algo, &hashAlgo)) {
         task->setChecksumState(QStringLiteral("Unknown"));
         emit toastRequested(QStringLiteral("Unknown checksum algorithm"), QStringLiteral("warning"));
         return;
@@ -1338,14 +1384,39 @@ void DownloadManager::verifyChecksumAsync(DownloaderTask* task)
         return;
     }
 
+    // Bytes hashed while downloading are reused; a lost or mismatched stream means a full read.
+    std::shared_ptr<StreamHasher> stream = task->streamHash();
+    if (stream && (stream->algorithm() != hashAlgo || !stream->isValid())) {
+        stream.reset();
+    }
+    const qint64 fileSize = QFileInfo(path).size();
+    if (stream) {
+        const QByteArray digest = stream->completedDigest(fileSize);
+        if (!digest.isEmpty()) {
+            task->appendLog(QStringLiteral("Checksum computed while downloading (%1)").arg(algoUpper));
+            applyChecksumResult(task, QString::fromUtf8(digest.toHex()), expectedRaw);
+            return;
+        }
+    }
+
     task->setChecksumState(QStringLiteral("Verifying"));
-    task->appendLog(QStringLiteral("Checksum verify started (%1)").arg(algoUpper));
+    if (stream) {
+        task->appendLog(QStringLiteral("Checksum verify started (%1, %2 bytes streamed)")
+                            .arg(algoUpper)
+                            .arg(stream->hashedBytes()));
+    } else {
+        task->appendLog(QStringLiteral("Checksum verify started (%1)").arg(algoUpper));
+    }
 
     QPointer<DownloaderTask> taskPtr(task);
     QPointer<QFutureWatcher<QString>> watcher = new QFutureWatcher<QString>(this);
     m_checksumWatchers.insert(task, watcher);
 
-    QFuture<QString> future = QtConcurrent::run([path, hashAlgo]() -> QString {
+    QFuture<QString> future = QtConcurrent::run([path, hashAlgo, stream, fileSize]() -> QString {
+        if (stream) {
+            const QByteArray digest = stream->finish(path, fileSize);
+            if (!digest.isEmpty()) return QString::fromUtf8(digest.toHex());
+        }
         QFile file(path);
         if (!file.open(QIODevice::ReadOnly)) return QString();
         QCryptographicHash hash(hashAlgo);
@@ -1368,69 +1439,77 @@ void DownloadManager::verifyChecksumAsync(DownloaderTask* task)
         const QString actual = watcher ? watcher->result() : QString();
         if (watcher) watcher->deleteLater();
         m_checksumWatchers.remove(taskPtr);
-
-        if (actual.isEmpty()) {
-            taskPtr->setChecksumState(QStringLiteral("Failed"));
-            taskPtr->appendLog(QStringLiteral("Checksum failed"));
-            emit toastRequested(QStringLiteral("Checksum failed"), QStringLiteral("danger"));
-            return;
-        }
-        taskPtr->setChecksumActual(actual);
-        if (expectedRaw.isEmpty()) {
-            taskPtr->setChecksumState(QStringLiteral("Computed"));
-            taskPtr->appendLog(QStringLiteral("Checksum computed"));
-            emit toastRequested(QStringLiteral("Checksum computed"), QStringLiteral("info"));
-            return;
-        }
-        const QString expected = utils::normalizeChecksum(expectedRaw);
-        const QString actualNorm = utils::normalizeChecksum(actual);
-        if (expected == actualNorm) {
-            taskPtr->setChecksumState(QStringLiteral("OK"));
-            taskPtr->appendLog(QStringLiteral("Checksum OK"));
-            emit toastRequested(QStringLiteral("Checksum OK"), QStringLiteral("success"));
-        } else {
-            taskPtr->setChecksumState(QStringLiteral("Mismatch"));
-            taskPtr->appendLog(QStringLiteral("Checksum mismatch"));
-            emit toastRequested(QStringLiteral("Checksum mismatch"), QStringLiteral("danger"));
-        }
+        applyChecksumResult(taskPtr, actual, expectedRaw);
     });
 
     watcher->setFuture(future);
 }
 
+void DownloadManager::applyChecksumResult(DownloaderTask* task, const QString& actual, const QString& expectedRaw)
+{
+    if (actual.isEmpty()) {
+        task->setChecksumState(QStringLiteral("Failed"));
+        task->appendLog(QStringLiteral("Checksum failed"));
+        emit toastRequested(QStringLiteral("Checksum failed"), QStringLiteral("danger"));
+        return;
+    }
+    task->setChecksumActual(actual);
+    if (expectedRaw.isEmpty()) {
+        task->setChecksumState(QStringLiteral("Computed"));
+        task->appendLog(QStringLiteral("Checksum computed"));
+        emit toastRequested(QStringLiteral("Checksum computed"), QStringLiteral("info"));
+        return;
+    }
+    const QString expected = utils::normalizeChecksum(expectedRaw);
+    const QString actualNorm = utils::normalizeChecksum(actual);
+    if (expected == actualNorm) {
+        task->setChecksumState(QStringLiteral("OK"));
+        task->appendLog(QStringLiteral("Checksum OK"));
+        emit toastRequested(QStringLiteral("Checksum OK"), QStringLiteral("success"));
+    } else {
+        task->setChecksumState(QStringLiteral("Mismatch"));
+        task->appendLog(QStringLiteral("Checksum mismatch"));
+        emit toastRequested(QStringLiteral("Checksum mismatch"), QStringLiteral("danger"));
+    }
+}
+
 qint64 DownloadManager::taskMaxSpeed(int index) const
 {
     DownloaderTask* task = m_model.taskAt(index);
     if (!task) return 0;
-    return m_taskMaxSpeed.value(task, 0);
+    const TaskRegistry::Id id = m_tasks.id(task);
+    return id != TaskRegistry::kNoTask ? m_tasks.maxSpeed(id) : 0;
 }
 
 qint64 DownloadManager::taskBytesReceived(int index) const
 {
     DownloaderTask* task = m_model.taskAt(index);
     if (!task) return 0;
-    return m_taskReceived.value(task, 0);
+    const TaskRegistry::Id id = m_tasks.id(task);
+    return id != TaskRegistry::kNoTask ? m_tasks.received(id) : 0;
 }
 
 qint64 DownloadManager::taskBytesTotal(int index) const
 {
     DownloaderTask* task = m_model.taskAt(index);
     if (!task) return 0;
-    return m_taskTotal.value(task, 0);
+    const TaskRegistry::Id id = m_tasks.id(task);
+    return id != TaskRegistry::kNoTask ? m_tasks.total(id) : 0;
 }
 
 qint64 DownloadManager::taskCompletedAt(int index) const
 {
     DownloaderTask* task = m_model.taskAt(index);
     if (!task) return 0;
-    return m_taskCompletedAt.value(task, 0);
+    const TaskRegistry::Id id = m_tasks.id(task);
+    return id != TaskRegistry::kNoTask ? m_tasks.cold(id).completedAt : 0;
 }
 
 int DownloadManager::taskPriority(int index) const
 {
     DownloaderTask* task = m_model.taskAt(index);
     if (!task) return 100;
-    return m_taskPriority.value(task, task->priority());
+    return priorityOf(task);
 }
 
 void DownloadManager::setTaskMaxSpeed(int index, qint64 bytesPerSecond)
@@ -1438,8 +1517,9 @@ void DownloadManager::setTaskMaxSpeed(int index, qint64 bytesPerSecond)
     DownloaderTask* task = m_model.taskAt(index);
     if (!task) return;
     if (bytesPerSecond < 0) bytesPerSecond = 0;
-    if (m_taskMaxSpeed.value(task, 0) == bytesPerSecond) return;
-    m_taskMaxSpeed[task] = bytesPerSecond;
+    const TaskRegistry::Id id = m_tasks.id(task);
+    if (id == TaskRegistry::kNoTask || m_tasks.maxSpeed(id) == bytesPerSecond) return;
+    m_tasks.maxSpeed(id) = bytesPerSecond;
     applyTaskSpeed(task);
     scheduleSave();
 }
@@ -1449,9 +1529,11 @@ void DownloadManager::setTaskPriority(int index, int priority)
     DownloaderTask* task = m_model.taskAt(index);
     if (!task) return;
     const int normalized = qBound(0, priority, 1000);
-    if (m_taskPriority.value(task, task->priority()) == normalized) return;
-    m_taskPriority[task] = normalized;
+    if (priorityOf(task) == normalized) return;
+    const TaskRegistry::Id id = m_tasks.id(task);
+    if (id != TaskRegistry::kNoTask) m_tasks.priority(id) = normalized;
     task->setPriority(normalized);
+    syncSchedule(task);
     scheduleSave();
     startQueued();
 }
@@ -1460,7 +1542,7 @@ void DownloadManager::pauseTask(int index)
 {
     DownloaderTask* task = m_model.taskAt(index);
     if (!task) return;
-    m_taskPausedByNetwork[task] = false;
+    setTaskPausedBy(task, TaskRegistry::PausedByNetwork, false);
     task->pause();
     scheduleSave();
 }
@@ -1484,14 +1566,13 @@ QObject* DownloadManager::taskObjectAt(int index) const
 QString DownloadManager::taskQueueName(int index) const
 {
     DownloaderTask* task = m_model.taskAt(index);
-    return task ? m_taskQueue.value(task, defaultQueueName()) : defaultQueueName();
+    return task ? queueOf(task) : defaultQueueName();
 }
 
 QString DownloadManager::taskCategoryName(int index) const
 {
     DownloaderTask* task = m_model.taskAt(index);
-    return task ? m_taskCategory.value(task, utils::toString(utils::detectCategory(task->fileName())))
-                : QStringLiteral("Other");
+    return task ? categoryOf(task) : QStringLiteral("Other");
 }
 
 void DownloadManager::resumeTask(int index)
@@ -1504,7 +1585,7 @@ void DownloadManager::resumeTask(int index)
             && !pauseReason.isEmpty()
             && pauseReason != QStringLiteral("User"));
     if (needsRecoveryResume) {
-        m_taskPausedByNetwork[task] = false;
+        setTaskPausedBy(task, TaskRegistry::PausedByNetwork, false);
         task->recover();
     } else {
         task->resume();
@@ -1519,12 +1600,12 @@ void DownloadManager::togglePause(int index)
     if (!task) return;
     const QString state = task->stateString();
     if (state == "Active") {
-        m_taskPausedByNetwork[task] = false;
+        setTaskPausedBy(task, TaskRegistry::PausedByNetwork, false);
         task->pause();
     } else if (state == "Paused") {
         const QString pauseReason = task->pauseReason().trimmed();
         if (!pauseReason.isEmpty() && pauseReason != QStringLiteral("User")) {
-            m_taskPausedByNetwork[task] = false;
+            setTaskPausedBy(task, TaskRegistry::PausedByNetwork, false);
             task->recover();
         } else {
             task->resume();
@@ -1634,11 +1715,11 @@ void DownloadManager::exportList(const QString& path)
         QJsonObject obj;
         obj.insert("url", task->url());
         obj.insert("filePath", task->fileName());
-        obj.insert("queueName", m_taskQueue.value(task, defaultQueueName()));
-        obj.insert("category", m_taskCategory.value(task, utils::toString(utils::detectCategory(task->fileName()))));
+        obj.insert("queueName", queueOf(task));
+        obj.insert("category", categoryOf(task));
         obj.insert("state", task->stateString());
-        obj.insert("bytesReceived", static_cast<double>(m_taskReceived.value(task, 0)));
-        obj.insert("bytesTotal", static_cast<double>(m_taskTotal.value(task, 0)));
+        obj.insert("bytesReceived", static_cast<double>(taskBytesReceived(i)));
+        obj.insert("bytesTotal", static_cast<double>(taskBytesTotal(i)));
         items.append(obj);
     }
     root.insert("items", items);
@@ -1667,23 +1748,9 @@ void DownloadManager::resetPersistentState()
     m_checksumWatchers.clear();
 
     m_queue.clear();
-    m_taskSpeed.clear();
-    m_taskReceived.clear();
-    m_taskTotal.clear();
-    m_taskLastReceived.clear();
-    m_taskMaxSpeed.clear();
-    m_taskCompletedAt.clear();
-    m_taskRetryCount.clear();
-    m_taskPriority.clear();
-    m_taskCreatedOrder.clear();
-    m_taskQueue.clear();
-    m_taskCategory.clear();
-    m_taskPausedBySchedule.clear();
-    m_taskPausedByQuota.clear();
-    m_taskPausedByBattery.clear();
-    m_taskPausedByNetwork.clear();
+    m_tasks.clear();
+    m_ready.clear();
     m_hostCooldownUntilMs.clear();
-    m_taskOrderCounter = 0;
 
     for (int i = m_model.rowCount() - 1; i >= 0; --i) {
         m_model.removeAt(i);
@@ -1695,16 +1762,21 @@ void DownloadManager::resetPersistentState()
 
     m_categoryFolders.clear();
     m_domainRules.clear();
+    m_nativeTransportHosts.clear();
     emit categoryFoldersChanged();
     emit domainRulesChanged();
+    emit nativeTransportHostsChanged();
 
     setMaxConcurrent(2);
     setGlobalMaxSpeed(0);
     setPauseOnBattery(false);
     setResumeOnAC(true);
     setPerHostMaxConcurrent(8);
+    setPerHostMaxConnections(NetworkSessionPool::kDefaultConnectionsPerHost);
     setPersistSensitiveOptions(false);
     setTelemetryEnabled(true);
+    setDiskWriterBackend(QStringLiteral("qfile"));
+    setMemoryBudget(256ll * 1024 * 1024);
     setDefaultUserAgent(QStringLiteral("raad/1.0"));
     setDefaultAllowInsecureSsl(false);
     setDefaultProxyHost(QString());
@@ -1735,6 +1807,57 @@ void DownloadManager::verifyTask(int index)
     verifyChecksumAsync(task);
 }
 
+void DownloadManager::repairTask(int index)
+{
+    DownloaderTask* task = m_model.taskAt(index);
+    if (!task) return;
+    if (task->stateString() != "Done") {
+        emit toastRequested(QStringLiteral("Only completed downloads can be repaired"), QStringLiteral("warning"));
+        return;
+    }
+    const QString path = utils::normalizeFilePath(task->fileName());
+    const QString manifestPath = utils::blockManifestPath(path);
+    if (!utils::fileExistsPath(path) || !QFile::exists(manifestPath)) {
+        emit toastRequested(QStringLiteral("No integrity data to repair with"), QStringLiteral("warning"));
+        return;
+    }
+
+    task->appendLog(QStringLiteral("Repair: checking blocks"));
+    QPointer<DownloaderTask> taskPtr(task);
+    auto* watcher = new QFutureWatcher<RepairScan>(this);
+    connect(watcher, &QFutureWatcher<RepairScan>::finished, this, [this, taskPtr, watcher]() {
+        const RepairScan scan = watcher->result();
+        watcher->deleteLater();
+        if (!taskPtr) return;
+        const QString name = QFileInfo(taskPtr->fileName()).fileName();
+        if (!scan.ok) {
+            taskPtr->appendLog(QStringLiteral("Repair: cannot read file or manifest"));
+            emit toastRequested(QStringLiteral("Repair failed: %1").arg(name), QStringLiteral("danger"));
+            return;
+        }
+        if (scan.badBlocks.isEmpty()) {
+            taskPtr->appendLog(QStringLiteral("Repair: all blocks match"));
+            emit toastRequested(QStringLiteral("No damage found: %1").arg(name), QStringLiteral("success"));
+            return;
+        }
+        taskPtr->appendLog(QStringLiteral("Repair: %1 damaged block(s)").arg(scan.badBlocks.size()));
+        if (!taskPtr->repairBlocks(scan.badBlocks)) {
+            emit toastRequested(QStringLiteral("Repair failed: %1").arg(name), QStringLiteral("danger"));
+            return;
+        }
+        emit toastRequested(QStringLiteral("Refetching %1 damaged block(s): %2").arg(scan.badBlocks.size()).arg(name),
+                            QStringLiteral("warning"));
+        startQueued();
+        scheduleSave();
+    });
+    watcher->setFuture(QtConcurrent::run([path, manifestPath]() -> RepairScan {
+        RepairScan scan;
+        const std::shared_ptr<BlockManifest> manifest = BlockManifest::load(manifestPath, QFileInfo(path).size());
+        if (manifest) scan.ok = manifest->verifyFile(path, &scan.badBlocks);
+        return scan;
+    }));
+}
+
 void DownloadManager::testUrl(const QString& urlStr)
 {
     const QString trimmed = urlStr.trimmed();
@@ -1918,13 +2041,15 @@ void DownloadManager::removeQueue(const QString& name)
     if (name == defaultQueueName()) return;
 
     const QString fallback = defaultQueueName();
-    for (auto it = m_taskQueue.begin(); it != m_taskQueue.end(); ++it) {
-        if (it.value() == name) {
-            it.value() = fallback;
-            m_model.updateMetadata(it.key(), fallback, m_taskCategory.value(it.key()));
-            applyTaskSpeed(it.key());
-        }
-    }
+    m_tasks.forEach([&](TaskRegistry::Id id, QObject* object) {
+        const TaskRegistry::Cold& cold = m_tasks.cold(id);
+        if (cold.queue != name) return;
+        m_tasks.setQueue(id, fallback);
+        DownloaderTask* task = static_cast<DownloaderTask*>(object);
+        m_model.updateMetadata(task, fallback, cold.category);
+        applyTaskSpeed(task);
+        syncSchedule(task);
+    });
 
     bool domainRulesWereChanged = false;
     for (auto it = m_domainRules.begin(); it != m_domainRules.end(); ++it) {
@@ -1936,6 +2061,7 @@ void DownloadManager::removeQueue(const QString& name)
 
     m_queues.remove(name);
     m_queueOrder.removeAll(name);
+    RateLimiter::instance().removeNode(m_queueRateNodes.take(name));
     emit queuesChanged();
     if (domainRulesWereChanged) {
         emit domainRulesChanged();
@@ -1954,6 +2080,9 @@ void DownloadManager::renameQueue(const QString& oldName, const QString& newName
     QueueInfo info = m_queues.take(oldName);
     info.name = trimmed;
     m_queues.insert(trimmed, info);
+    if (m_queueRateNodes.contains(oldName)) {
+        m_queueRateNodes.insert(trimmed, m_queueRateNodes.take(oldName));
+    }
 
     for (int i = 0; i < m_queueOrder.size(); ++i) {
         if (m_queueOrder[i] == oldName) {
@@ -1961,12 +2090,14 @@ void DownloadManager::renameQueue(const QString& oldName, const QString& newName
         }
     }
 
-    for (auto it = m_taskQueue.begin(); it != m_taskQueue.end(); ++it) {
-        if (it.value() == oldName) {
-            it.value() = trimmed;
-            m_model.updateMetadata(it.key(), trimmed, m_taskCategory.value(it.key()));
-        }
-    }
+    m_tasks.forEach([&](TaskRegistry::Id id, QObject* object) {
+        const TaskRegistry::Cold& cold = m_tasks.cold(id);
+        if (cold.queue != oldName) return;
+        m_tasks.setQueue(id, trimmed);
+        DownloaderTask* task = static_cast<DownloaderTask*>(object);
+        m_model.updateMetadata(task, trimmed, cold.category);
+        syncSchedule(task);
+    });
 
     bool domainRulesWereChanged = false;
     for (auto it = m_domainRules.begin(); it != m_domainRules.end(); ++it) {
@@ -1989,8 +2120,11 @@ void DownloadManager::setTaskQueue(int index, const QString& name)
     if (!task) return;
     const QString resolved = name.isEmpty() ? defaultQueueName() : name;
     if (!m_queues.contains(resolved)) createQueue(resolved);
-    m_taskQueue[task] = resolved;
-    m_model.updateMetadata(task, resolved, m_taskCategory.value(task));
+    const TaskRegistry::Id id = m_tasks.id(task);
+    if (id == TaskRegistry::kNoTask) return;
+    m_tasks.setQueue(id, resolved);
+    m_model.updateMetadata(task, resolved, m_tasks.cold(id).category);
+    syncSchedule(task);
     applyTaskSpeed(task);
     scheduleSave();
     startQueued();
@@ -2001,9 +2135,10 @@ void DownloadManager::setTaskCategory(int index, const QString& category)
     DownloaderTask* task = m_model.taskAt(index);
     if (!task) return;
     const QString resolved = category.isEmpty() ? utils::toString(utils::detectCategory(task->fileName())) : category;
-    if (m_taskCategory.value(task) == resolved) return;
-    m_taskCategory[task] = resolved;
-    m_model.updateMetadata(task, m_taskQueue.value(task, defaultQueueName()), resolved);
+    const TaskRegistry::Id id = m_tasks.id(task);
+    if (id == TaskRegistry::kNoTask || m_tasks.cold(id).category == resolved) return;
+    m_tasks.cold(id).category = resolved;
+    m_model.updateMetadata(task, m_tasks.cold(id).queue, resolved);
     scheduleSave();
 }
 
@@ -2042,11 +2177,9 @@ void DownloadManager::setQueueMaxSpeed(const QString& name, qint64 value)
     if (value < 0) value = 0;
     if (info->maxSpeed == value) return;
     info->maxSpeed = value;
-    for (auto it = m_taskQueue.constBegin(); it != m_taskQueue.constEnd(); ++it) {
-        if (it.value() == name) {
-            applyTaskSpeed(it.key());
-        }
-    }
+    m_tasks.forEach([&](TaskRegistry::Id id, QObject* object) {
+        if (m_tasks.cold(id).queue == name) applyTaskSpeed(static_cast<DownloaderTask*>(object));
+    });
     scheduleSave();
 }
 
@@ -2140,6 +2273,26 @@ qint64 DownloadManager::queueDownloadedToday(const QString& name) const
     return info ? info->downloadedToday : 0;
 }
 
+QVariantMap DownloadManager::queueTotals(const QString& name) const
+{
+    const TaskRegistry::Totals totals = m_tasks.queueTotals(name);
+    return {
+        {QStringLiteral("speed"), totals.speed},
+        {QStringLiteral("received"), totals.received},
+        {QStringLiteral("size"), totals.total}
+    };
+}
+
+QVariantMap DownloadManager::hostTotals(const QString& host) const
+{
+    const TaskRegistry::Totals totals = m_tasks.hostTotals(utils::normalizeHost(host));
+    return {
+        {QStringLiteral("speed"), totals.speed},
+        {QStringLiteral("received"), totals.received},
+        {QStringLiteral("size"), totals.total}
+    };
+}
+
 QString DownloadManager::defaultQueueName() const
 {
     return m_queueOrder.isEmpty() ? QStringLiteral("General") : m_queueOrder.first();
@@ -2207,6 +2360,27 @@ void DownloadManager::removeDomainRule(const QString& host)
     emit domainRulesChanged();
 }
 
+QStringList DownloadManager::nativeTransportHosts() const
+{
+    QStringList hosts = m_nativeTransportHosts.values();
+    hosts.sort();
+    return hosts;
+}
+
+void DownloadManager::setNativeTransportHost(const QString& host, bool enabled)
+{
+    const QString key = utils::normalizeHost(host);
+    if (key.isEmpty()) return;
+    if (m_nativeTransportHosts.contains(key) == enabled) return;
+    if (enabled) {
+        m_nativeTransportHosts.insert(key);
+    } else {
+        m_nativeTransportHosts.remove(key);
+    }
+    scheduleSave();
+    emit nativeTransportHostsChanged();
+}
+
 QString DownloadManager::detectCategoryForName(const QString& name) const
 {
     if (name.isEmpty()) return QStringLiteral("Other");
@@ -2324,6 +2498,14 @@ QString DownloadManager::processApiCommand(const QString& commandJson)
         }
     } else if (cmd == QStringLiteral("retryFailed")) {
         retryFailed();
+    } else if (cmd == QStringLiteral("repair")) {
+        const int index = req.value(QStringLiteral("index")).toInt(-1);
+        if (!m_model.taskAt(index)) {
+            res[QStringLiteral("ok")] = false;
+            res.insert(QStringLiteral("error"), QStringLiteral("invalid_index"));
+        } else {
+            repairTask(index);
+        }
     } else {
         res[QStringLiteral("ok")] = false;
         res.insert(QStringLiteral("error"), QStringLiteral("unknown_cmd"));
@@ -2336,20 +2518,19 @@ void DownloadManager::onTaskProgress(qint64 bytesReceived, qint64 bytesTotal)
 {
     auto* task = qobject_cast<DownloaderTask*>(sender());
     if (!task) return;
-    qint64 previous = m_taskLastReceived.value(task, 0);
-    qint64 delta = bytesReceived - previous;
+    const TaskRegistry::Id id = m_tasks.id(task);
+    if (id == TaskRegistry::kNoTask) return;
+    qint64 delta = bytesReceived - m_tasks.lastReceived(id);
     if (delta < 0) delta = 0;
-    m_taskLastReceived[task] = bytesReceived;
+    m_tasks.lastReceived(id) = bytesReceived;
 
-    const QString queueName = m_taskQueue.value(task, defaultQueueName());
-    if (QueueInfo* info = queueInfo(queueName)) {
+    if (QueueInfo* info = queueInfo(m_tasks.cold(id).queue)) {
         info->downloadedToday += delta;
         if (info->quotaEnabled && info->quotaBytes > 0 && info->downloadedToday >= info->quotaBytes) {
             enforceQueuePolicies();
         }
     }
-    m_taskReceived[task] = bytesReceived;
-    m_taskTotal[task] = bytesTotal;
+    m_tasks.setProgress(id, bytesReceived, bytesTotal);
     const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
     const bool forceUpdate = (bytesTotal > 0 && bytesReceived >= bytesTotal);
     if (forceUpdate || m_lastTotalsUpdateMs <= 0 || (nowMs - m_lastTotalsUpdateMs) >= 120) {
@@ -2362,30 +2543,20 @@ void DownloadManager::onTaskSpeedChanged(qint64 bytesPerSecond)
 {
     auto* task = qobject_cast<DownloaderTask*>(sender());
     if (!task) return;
-    m_taskSpeed[task] = bytesPerSecond;
+    const TaskRegistry::Id id = m_tasks.id(task);
+    if (id == TaskRegistry::kNoTask) return;
+    m_tasks.setSpeed(id, bytesPerSecond);
     updateTotals();
 }
 
 void DownloadManager::updateTotals()
 {
-    qint64 speed = 0;
-    qint64 received = 0;
-    qint64 total = 0;
-
-    for (auto it = m_taskSpeed.constBegin(); it != m_taskSpeed.constEnd(); ++it) {
-        speed += it.value();
-    }
-    for (auto it = m_taskReceived.constBegin(); it != m_taskReceived.constEnd(); ++it) {
-        received += it.value();
-    }
-    for (auto it = m_taskTotal.constBegin(); it != m_taskTotal.constEnd(); ++it) {
-        total += it.value();
-    }
-
-    if (speed != m_totalSpeed || received != m_totalReceived || total != m_totalSize) {
-        m_totalSpeed = speed;
-        m_totalReceived = received;
-        m_totalSize = total;
+    // The registry keeps the sums current as task values change; this only publishes them.
+    const TaskRegistry::Totals& totals = m_tasks.totals();
+    if (totals.speed != m_totalSpeed || totals.received != m_totalReceived || totals.total != m_totalSize) {
+        m_totalSpeed = totals.speed;
+        m_totalReceived = totals.received;
+        m_totalSize = totals.total;
         emit totalsChanged();
     }
 }
@@ -2403,26 +2574,30 @@ DownloaderTask* DownloadManager::createTask(const QUrl& url,
     task->setProxyPort(qBound(0, m_defaultProxyPort, 65535));
     task->setProxyUser(m_defaultProxyUser);
     task->setProxyPassword(m_defaultProxyPassword);
-    m_taskQueue[task] = queueName;
-    m_taskCategory[task] = category;
-    m_taskLastReceived[task] = 0;
-    m_taskMaxSpeed[task] = 0;
-    m_taskCompletedAt[task] = 0;
-    m_taskRetryCount[task] = 0;
-    m_taskPriority[task] = task->priority();
-    m_taskCreatedOrder[task] = ++m_taskOrderCounter;
+    const TaskRegistry::Id id = m_tasks.add(task);
+    m_tasks.setQueue(id, queueName);
+    m_tasks.setHost(id, taskHost(task));
+    m_tasks.cold(id).category = category;
+    m_tasks.priority(id) = task->priority();
     applyTaskSpeed(task);
 
     m_model.addDownload(task, queueName, category);
     m_queue.append(task);
 
     connect(task, &DownloaderTask::finished, this, &DownloadManager::onTaskFinishedWrapper);
+    connect(task, &DownloaderTask::stateChanged, this, [this, task]() { syncSchedule(task); });
     connect(task, &DownloaderTask::stateChanged, this, &DownloadManager::countsChanged);
     connect(task, &DownloaderTask::stateChanged, this, &DownloadManager::scheduleSave);
     connect(task, &DownloaderTask::progress, this, &DownloadManager::onTaskProgress);
     connect(task, &DownloaderTask::speedChanged, this, &DownloadManager::onTaskSpeedChanged);
     connect(task, &DownloaderTask::mirrorUrlsChanged, this, &DownloadManager::scheduleSave);
     connect(task, &DownloaderTask::mirrorIndexChanged, this, &DownloadManager::scheduleSave);
+    connect(task, &DownloaderTask::mirrorIndexChanged, this, [this, task]() {
+        const TaskRegistry::Id id = m_tasks.id(task);
+        if (id == TaskRegistry::kNoTask) return;
+        m_tasks.setHost(id, taskHost(task));
+        syncSchedule(task);
+    });
     connect(task, &DownloaderTask::checksumChanged, this, &DownloadManager::scheduleSave);
     connect(task, &DownloaderTask::verifyOnCompleteChanged, this, &DownloadManager::scheduleSave);
     connect(task, &DownloaderTask::resumeWarningChanged, this, &DownloadManager::scheduleSave);
@@ -2433,7 +2608,9 @@ DownloaderTask* DownloadManager::createTask(const QUrl& url,
     connect(task, &DownloaderTask::networkOptionsChanged, this, &DownloadManager::scheduleSave);
     connect(task, &DownloaderTask::priorityChanged, this, [this, task]() {
         if (!task) return;
-        m_taskPriority[task] = task->priority();
+        const TaskRegistry::Id id = m_tasks.id(task);
+        if (id != TaskRegistry::kNoTask) m_tasks.priority(id) = task->priority();
+        syncSchedule(task);
         scheduleSave();
         startQueued();
     });
@@ -2448,6 +2625,7 @@ DownloaderTask* DownloadManager::createTask(const QUrl& url,
                                 {QStringLiteral("networkError"), task ? task->lastNetworkError() : -1}
                             });
     });
+    syncSchedule(task);
 
     return task;
 }
@@ -2466,8 +2644,11 @@ void DownloadManager::loadSession()
     if (root.contains("pauseOnBattery")) setPauseOnBattery(root.value("pauseOnBattery").toBool(false));
     if (root.contains("resumeOnAC")) setResumeOnAC(root.value("resumeOnAC").toBool(true));
     if (root.contains("perHostMaxConcurrent")) setPerHostMaxConcurrent(root.value("perHostMaxConcurrent").toInt(m_perHostMaxConcurrent));
+    if (root.contains("perHostMaxConnections")) setPerHostMaxConnections(root.value("perHostMaxConnections").toInt(perHostMaxConnections()));
     if (root.contains("persistSensitiveOptions")) setPersistSensitiveOptions(root.value("persistSensitiveOptions").toBool(false));
     if (root.contains("telemetryEnabled")) setTelemetryEnabled(root.value("telemetryEnabled").toBool(true));
+    if (root.contains("diskWriterBackend")) setDiskWriterBackend(root.value("diskWriterBackend").toString());
+    if (root.contains("memoryBudget")) setMemoryBudget(static_cast<qint64>(root.value("memoryBudget").toDouble(m_memoryBudget)));
     if (root.contains("defaultUserAgent")) setDefaultUserAgent(root.value("defaultUserAgent").toString(m_defaultUserAgent));
     if (root.contains("defaultAllowInsecureSsl")) setDefaultAllowInsecureSsl(root.value("defaultAllowInsecureSsl").toBool(m_defaultAllowInsecureSsl));
     const QJsonObject defaultProxyObj = root.value("defaultProxy").toObject();
@@ -2522,6 +2703,15 @@ void DownloadManager::loadSession()
         }
     }
 
+    m_hostProfiles.fromJson(root.value("hostProfiles").toObject());
+
+    m_nativeTransportHosts.clear();
+    const QJsonArray nativeHosts = root.value("nativeTransportHosts").toArray();
+    for (const QJsonValue& v : nativeHosts) {
+        const QString key = utils::normalizeHost(v.toString());
+        if (!key.isEmpty()) m_nativeTransportHosts.insert(key);
+    }
+
     const QJsonArray items = root.value("items").toArray();
     for (const QJsonValue& v : items) {
         if (!v.isObject()) continue;
@@ -2549,6 +2739,9 @@ void DownloadManager::loadSession()
         const bool adaptiveSegments = obj.contains("adaptiveSegments")
             ? obj.value("adaptiveSegments").toBool(true)
             : true;
+        const bool directPlacement = obj.value("directPlacement").toBool(true);
+        const bool sparseTarget = obj.value("sparseTarget").toBool(false);
+        const bool nativeTransport = obj.value("nativeTransport").toBool(false);
         const QJsonArray mirrorsArray = obj.value("mirrors").toArray();
         QStringList mirrorUrls;
         for (const QJsonValue& mv : mirrorsArray) {
@@ -2614,7 +2807,18 @@ void DownloadManager::loadSession()
                     }
                 }
 
-                for (int i = 0; i < segments; ++i) {
+                const QString oldPlacement = utils::placementDataPath(oldLocalPath);
+                if (QFile::exists(oldPlacement) && !QFile::exists(utils::placementDataPath(newLocalPath))) {
+                    if (QFile::rename(oldPlacement, utils::placementDataPath(newLocalPath))) {
+                        QFile::rename(utils::placementMapPath(oldLocalPath), utils::placementMapPath(newLocalPath));
+                        switchedToNew = true;
+                    }
+                }
+
+                QList<utils::PlacementRange> journal;
+                utils::readSegmentJournal(oldLocalPath, nullptr, &journal);
+                const int partCount = qMax(segments, static_cast<int>(journal.size()));
+                for (int i = 0; i < partCount; ++i) {
                     const QString oldPart = QString("%1.part%2").arg(oldLocalPath).arg(i);
                     if (!QFile::exists(oldPart)) continue;
 
@@ -2625,11 +2829,15 @@ void DownloadManager::loadSession()
                         switchedToNew = true;
                     }
                 }
+                if (switchedToNew) {
+                    QFile::rename(utils::blockManifestPath(oldLocalPath), utils::blockManifestPath(newLocalPath));
+                    QFile::rename(utils::segmentJournalPath(oldLocalPath), utils::segmentJournalPath(newLocalPath));
+                }
 
                 // If nothing exists yet, prefer the nicer name for future writes.
                 if (!switchedToNew) {
                     const bool oldExists = oldMainInfo.exists();
-                    bool anyOldParts = false;
+                    bool anyOldParts = QFile::exists(utils::placementDataPath(oldLocalPath));
                     for (int i = 0; i < segments; ++i) {
                         if (QFile::exists(QString("%1.part%2").arg(oldLocalPath).arg(i))) {
                             anyOldParts = true;
@@ -2652,6 +2860,7 @@ void DownloadManager::loadSession()
         }
 
         DownloaderTask* task = createTask(url, filePath, queueName, category, segments);
+        const TaskRegistry::Id id = m_tasks.id(task);
         task->setMirrorUrls(mirrorUrls);
         task->setMirrorIndex(mirrorIndex);
         task->setChecksumAlgorithm(checksumAlgo);
@@ -2677,9 +2886,13 @@ void DownloadManager::loadSession()
         if (retryDelay >= 0) task->setRetryDelaySec(retryDelay);
         task->setPriority(qBound(0, priority, 1000));
         task->setAdaptiveSegmentsEnabled(adaptiveSegments);
-        m_taskPriority[task] = task->priority();
+        task->setDirectPlacement(directPlacement);
+        task->setSparseTarget(sparseTarget);
+        task->setNativeTransport(nativeTransport);
+        m_tasks.priority(id) = task->priority();
+        syncSchedule(task);
         if (taskMaxSpeed > 0) {
-            m_taskMaxSpeed[task] = taskMaxSpeed;
+            m_tasks.maxSpeed(id) = taskMaxSpeed;
             applyTaskSpeed(task);
         }
         if (state == "Paused") {
@@ -2704,11 +2917,10 @@ void DownloadManager::loadSession()
             ? actualCompletedSize
             : (bytesTotal > 0 ? bytesTotal : 0);
         m_model.seedProgress(task, received, total);
-        m_taskReceived[task] = received;
-        m_taskTotal[task] = total;
-        m_taskLastReceived[task] = received;
+        m_tasks.setProgress(id, received, total);
+        m_tasks.lastReceived(id) = received;
         if (completedAt > 0) {
-            m_taskCompletedAt[task] = completedAt;
+            m_tasks.cold(id).completedAt = completedAt;
         }
 
         qint64 pausedAtSeed = 0;
@@ -2727,6 +2939,7 @@ void DownloadManager::loadSession()
     emit queuesChanged();
     emit categoryFoldersChanged();
     emit domainRulesChanged();
+    emit nativeTransportHostsChanged();
     updateTotals();
     startQueued();
 }
@@ -2750,8 +2963,11 @@ void DownloadManager::saveSession()
     root.insert("pauseOnBattery", m_pauseOnBattery);
     root.insert("resumeOnAC", m_resumeOnAC);
     root.insert("perHostMaxConcurrent", m_perHostMaxConcurrent);
+    root.insert("perHostMaxConnections", perHostMaxConnections());
     root.insert("persistSensitiveOptions", m_persistSensitiveOptions);
     root.insert("telemetryEnabled", m_telemetryEnabled);
+    root.insert("diskWriterBackend", m_diskWriterBackend);
+    root.insert("memoryBudget", static_cast<double>(m_memoryBudget));
     root.insert("defaultUserAgent", m_defaultUserAgent);
     root.insert("defaultAllowInsecureSsl", m_defaultAllowInsecureSsl);
     QJsonObject defaultProxyObj;
@@ -2793,6 +3009,8 @@ void DownloadManager::saveSession()
         domainRules.insert(it.key(), it.value());
     }
     root.insert("domainRules", domainRules);
+    root.insert("hostProfiles", m_hostProfiles.toJson());
+    root.insert("nativeTransportHosts", QJsonArray::fromStringList(nativeTransportHosts()));
 
     QJsonArray items;
     for (int i = 0; i < m_model.rowCount(); ++i) {
@@ -2804,17 +3022,17 @@ void DownloadManager::saveSession()
         obj.insert("url", task->url());
         obj.insert("filePath", task->fileName());
         obj.insert("segments", task->segments());
-        obj.insert("queueName", m_taskQueue.value(task, defaultQueueName()));
-        obj.insert("category", m_taskCategory.value(task, utils::toString(utils::detectCategory(task->fileName()))));
+        obj.insert("queueName", queueOf(task));
+        obj.insert("category", categoryOf(task));
         obj.insert("state", state);
-        obj.insert("taskMaxSpeed", static_cast<double>(m_taskMaxSpeed.value(task, 0)));
-        obj.insert("bytesReceived", static_cast<double>(m_taskReceived.value(task, 0)));
-        obj.insert("bytesTotal", static_cast<double>(m_taskTotal.value(task, 0)));
+        obj.insert("taskMaxSpeed", static_cast<double>(taskMaxSpeed(i)));
+        obj.insert("bytesReceived", static_cast<double>(taskBytesReceived(i)));
+        obj.insert("bytesTotal", static_cast<double>(taskBytesTotal(i)));
         obj.insert("lastSpeed", static_cast<double>(task->lastSpeed()));
         obj.insert("lastEta", task->lastEta());
         obj.insert("pausedAt", static_cast<double>(task->pausedAt()));
         obj.insert("pauseReason", task->pauseReason());
-        obj.insert("completedAt", static_cast<double>(m_taskCompletedAt.value(task, 0)));
+        obj.insert("completedAt", static_cast<double>(taskCompletedAt(i)));
         obj.insert("etag", task->etag());
         obj.insert("lastModified", task->lastModified());
         obj.insert("resumeWarning", task->resumeWarning());
@@ -2834,8 +3052,11 @@ void DownloadManager::saveSession()
         obj.insert("postScript", task->postScript());
         obj.insert("retryMax", task->retryMax());
         obj.insert("retryDelaySec", task->retryDelaySec());
-        obj.insert("priority", m_taskPriority.value(task, task->priority()));
+        obj.insert("priority", priorityOf(task));
         obj.insert("adaptiveSegments", task->adaptiveSegmentsEnabled());
+        obj.insert("directPlacement", task->directPlacement());
+        obj.insert("sparseTarget", task->sparseTarget());
+        obj.insert("nativeTransport", task->nativeTransport());
         obj.insert("userAgent", task->userAgent());
         obj.insert("allowInsecureSsl", task->allowInsecureSsl());
         obj.insert("errorCategory", task->errorCategory());
@@ -2952,7 +3173,28 @@ bool DownloadManager::renameTaskFilesOnDisk(const QString& oldPath, const QStrin
         ok = ok && QFile::rename(oldSingle, newSingle);
     }
 
-    const int maxParts = qMax(1, segments);
+    const QString oldPlacement = utils::placementDataPath(oldPath);
+    if (QFile::exists(oldPlacement)) {
+        ok = ok && QFile::rename(oldPlacement, utils::placementDataPath(newPath));
+    }
+    const QString oldPlacementMap = utils::placementMapPath(oldPath);
+    if (QFile::exists(oldPlacementMap)) {
+        ok = ok && QFile::rename(oldPlacementMap, utils::placementMapPath(newPath));
+    }
+    const QString oldManifest = utils::blockManifestPath(oldPath);
+    if (QFile::exists(oldManifest)) {
+        ok = ok && QFile::rename(oldManifest, utils::blockManifestPath(newPath));
+    }
+
+    // Split segments add parts past the configured count; the journal lists them.
+    QList<utils::PlacementRange> journal;
+    utils::readSegmentJournal(oldPath, nullptr, &journal);
+    const QString oldJournal = utils::segmentJournalPath(oldPath);
+    if (QFile::exists(oldJournal)) {
+        ok = ok && QFile::rename(oldJournal, utils::segmentJournalPath(newPath));
+    }
+
+    const int maxParts = qMax(1, qMax(segments, static_cast<int>(journal.size())));
     for (int i = 0; i < maxParts; ++i) {
         const QString oldPart = QString("%1.part%2").arg(oldPath).arg(i);
         const QString newPart = QString("%1.part%2").arg(newPath).arg(i);
@@ -2982,8 +3224,15 @@ bool DownloadManager::deleteTaskFilesOnDisk(const QString& filePath, int segment
 
     removeIfExists(filePath);
     removeIfExists(filePath + ".part");
+    removeIfExists(utils::placementDataPath(filePath));
+    removeIfExists(utils::placementMapPath(filePath));
+    removeIfExists(utils::blockManifestPath(filePath));
+
+    QList<utils::PlacementRange> journal;
+    utils::readSegmentJournal(filePath, nullptr, &journal);
+    removeIfExists(utils::segmentJournalPath(filePath));
 
-    const int maxParts = qMax(1, qMax(segments, effectiveSegments));
+    const int maxParts = qMax(1, qMax(qMax(segments, effectiveSegments), static_cast<int>(journal.size())));
     for (int i = 0; i < maxParts; ++i) {
         removeIfExists(QString("%1.part%2").arg(filePath).arg(i));
     }
@@ -2991,26 +3240,71 @@ bool DownloadManager::deleteTaskFilesOnDisk(const QString& filePath, int segment
     return removedAnything && ok;
 }
 
+QString DownloadManager::queueOf(const DownloaderTask* task) const
+{
+    const TaskRegistry::Id id = m_tasks.id(task);
+    return id != TaskRegistry::kNoTask ? m_tasks.cold(id).queue : defaultQueueName();
+}
+
+QString DownloadManager::categoryOf(const DownloaderTask* task) const
+{
+    const TaskRegistry::Id id = m_tasks.id(task);
+    return id != TaskRegistry::kNoTask ? m_tasks.cold(id).category
+                                       : utils::toString(utils::detectCategory(task->fileName()));
+}
+
+int DownloadManager::priorityOf(const DownloaderTask* task) const
+{
+    const TaskRegistry::Id id = m_tasks.id(task);
+    return id != TaskRegistry::kNoTask ? m_tasks.priority(id) : task->priority();
+}
+
+bool DownloadManager::taskPausedBy(const DownloaderTask* task, TaskRegistry::PauseCause cause) const
+{
+    const TaskRegistry::Id id = m_tasks.id(task);
+    return id != TaskRegistry::kNoTask && m_tasks.pausedBy(id, cause);
+}
+
+void DownloadManager::setTaskPausedBy(const DownloaderTask* task, TaskRegistry::PauseCause cause, bool paused)
+{
+    const TaskRegistry::Id id = m_tasks.id(task);
+    if (id != TaskRegistry::kNoTask) m_tasks.setPausedBy(id, cause, paused);
+}
+
 void DownloadManager::applyTaskSpeed(DownloaderTask* task)
 {
     if (!task) return;
-    const QString qname = m_taskQueue.value(task, defaultQueueName());
-    const QueueInfo* info = queueInfo(qname);
+    const TaskRegistry::Id id = m_tasks.id(task);
+    const QueueInfo* info = queueInfo(queueOf(task));
     qint64 effective = m_globalMaxSpeed;
     if (info && info->maxSpeed > 0) {
         if (effective == 0 || info->maxSpeed < effective) {
             effective = info->maxSpeed;
         }
     }
-    const qint64 taskLimit = m_taskMaxSpeed.value(task, 0);
+    const qint64 taskLimit = id != TaskRegistry::kNoTask ? m_tasks.maxSpeed(id) : 0;
     if (taskLimit > 0) {
         if (effective == 0 || taskLimit < effective) {
             effective = taskLimit;
         }
     }
+    // The queue and global buckets are shared, so their caps bound the sum over all tasks
+    // while tokens an idle task leaves unused go to its siblings.
+    const int queueNode = queueRateNode(qname);
+    RateLimiter::instance().setRate(queueNode, info ? info->maxSpeed : 0);
+    task->setRateParent(queueNode);
     task->setMaxSpeed(effective);
 }
 
+int DownloadManager::queueRateNode(const QString& name)
+{
+    auto it = m_queueRateNodes.find(name);
+    if (it == m_queueRateNodes.end()) {
+        it = m_queueRateNodes.insert(name, RateLimiter::instance().createNode(m_globalRateNode));
+    }
+    return it.value();
+}
+
 bool DownloadManager::isWithinSchedule(const QueueInfo& info, const QTime& now) const
 {
     if (!info.scheduleEnabled) return true;
@@ -3047,13 +3341,12 @@ void DownloadManager::enforceQueuePolicies()
         const bool allowed = isQueueAllowed(info, now);
         for (DownloaderTask* task : m_queue) {
             if (!task) continue;
-            const QString qname = m_taskQueue.value(task, defaultQueueName());
-            if (qname != info.name) continue;
+            if (queueOf(task) != info.name) continue;
 
             if (task->isRunning()) {
                 if (blockByBattery) {
                     task->pauseWithReason(QStringLiteral("Battery"));
-                    m_taskPausedByBattery[task] = true;
+                    setTaskPausedBy(task, TaskRegistry::PausedByBattery, true);
                 } else if (!allowed) {
                     if (info.scheduleEnabled && !isWithinSchedule(info, now)) {
                         task->pauseWithReason(QStringLiteral("Schedule"));
@@ -3063,23 +3356,23 @@ void DownloadManager::enforceQueuePolicies()
                         task->pause();
                     }
                     if (info.scheduleEnabled && !isWithinSchedule(info, now)) {
-                        m_taskPausedBySchedule[task] = true;
+                        setTaskPausedBy(task, TaskRegistry::PausedBySchedule, true);
                     }
                     if (info.quotaEnabled && info.quotaBytes > 0 && info.downloadedToday >= info.quotaBytes) {
-                        m_taskPausedByQuota[task] = true;
+                        setTaskPausedBy(task, TaskRegistry::PausedByQuota, true);
                     }
                 }
             }
 
             if (task->stateString() == "Paused") {
-                const bool pausedBySchedule = m_taskPausedBySchedule.value(task, false);
-                const bool pausedByQuota = m_taskPausedByQuota.value(task, false);
-                const bool pausedByBattery = m_taskPausedByBattery.value(task, false);
+                const bool pausedBySchedule = taskPausedBy(task, TaskRegistry::PausedBySchedule);
+                const bool pausedByQuota = taskPausedBy(task, TaskRegistry::PausedByQuota);
+                const bool pausedByBattery = taskPausedBy(task, TaskRegistry::PausedByBattery);
                 const bool canResume = allowed && (!blockByBattery) && (resumeOnAC() || !pausedByBattery);
                 if (canResume && (pausedBySchedule || pausedByQuota || pausedByBattery)) {
-                    m_taskPausedBySchedule[task] = false;
-                    m_taskPausedByQuota[task] = false;
-                    m_taskPausedByBattery[task] = false;
+                    setTaskPausedBy(task, TaskRegistry::PausedBySchedule, false);
+                    setTaskPausedBy(task, TaskRegistry::PausedByQuota, false);
+                    setTaskPausedBy(task, TaskRegistry::PausedByBattery, false);
                     task->resume();
                 }
             }
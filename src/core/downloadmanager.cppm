@@ -25,6 +25,7 @@
 module;
 #include <QObject>
 #include <QHash>
+#include <QSet>
 #include <QDate>
 #include <QStringList>
 #include <QTimer>
@@ -38,8 +39,12 @@ module;
 
 #ifndef Q_MOC_RUN
 export module raad.core.downloadmanager;
+import raad.core.diskwriter;
 import raad.core.downloadertask;
 import raad.core.downloadmodel;
+import raad.core.hostprofile;
+import raad.core.readyqueue;
+import raad.core.taskregistry;
 import raad.services.power_monitor;
 #endif
 
@@ -112,6 +117,21 @@ RAAD_MODULE_EXPORT class DownloadManager : public QObject {
     //!< @brief Average effective segment count across active downloads.
     Q_PROPERTY(qreal averageActiveSegments READ averageActiveSegments NOTIFY runtimeStatsChanged)
 
+    //!< @brief Disk writer backend actually in use ("qfile" or "io_uring").
+    Q_PROPERTY(QString activeDiskWriterBackend READ activeDiskWriterBackend NOTIFY runtimeStatsChanged)
+
+    //!< @brief Requested disk writer backend ("qfile" or "io_uring").
+    Q_PROPERTY(QString diskWriterBackend READ diskWriterBackend WRITE setDiskWriterBackend NOTIFY diskWriterPolicyChanged)
+
+    //!< @brief Whether the io_uring disk writer backend can be used on this system.
+    Q_PROPERTY(bool ioUringAvailable READ ioUringAvailable CONSTANT)
+
+    //!< @brief Process-wide memory budget for downloaded data not yet on disk (bytes).
+    Q_PROPERTY(qint64 memoryBudget READ memoryBudget WRITE setMemoryBudget NOTIFY memoryBudgetChanged)
+
+    //!< @brief Downloaded bytes currently held in memory across all tasks.
+    Q_PROPERTY(qint64 bufferedBytes READ bufferedBytes NOTIFY runtimeStatsChanged)
+
     //!< @brief Automatically pause downloads when running on battery power.
     Q_PROPERTY(bool pauseOnBattery READ pauseOnBattery WRITE setPauseOnBattery NOTIFY powerPolicyChanged)
 
@@ -133,6 +153,9 @@ RAAD_MODULE_EXPORT class DownloadManager : public QObject {
     //!< @brief Max concurrent active downloads per host.
     Q_PROPERTY(int perHostMaxConcurrent READ perHostMaxConcurrent WRITE setPerHostMaxConcurrent NOTIFY schedulingPolicyChanged)
 
+    //!< @brief Max connections to one host, shared by all tasks downloading from it.
+    Q_PROPERTY(int perHostMaxConnections READ perHostMaxConnections WRITE setPerHostMaxConnections NOTIFY schedulingPolicyChanged)
+
     //!< @brief Persist potentially sensitive network options in session.
     Q_PROPERTY(bool persistSensitiveOptions READ persistSensitiveOptions WRITE setPersistSensitiveOptions NOTIFY persistencePolicyChanged)
 
@@ -518,6 +541,20 @@ public:
      */
     Q_INVOKABLE qint64 queueDownloadedToday(const QString& name) const;
 
+    /**
+     * @brief Get the aggregate speed and byte counters of a queue's tasks.
+     * @param name Queue name.
+     * @return Map with speed, received and size, like totalSpeed/totalReceived/totalSize.
+     */
+    Q_INVOKABLE QVariantMap queueTotals(const QString& name) const;
+
+    /**
+     * @brief Get the aggregate speed and byte counters of the tasks on a host.
+     * @param host Host name.
+     * @return Map with speed, received and size.
+     */
+    Q_INVOKABLE QVariantMap hostTotals(const QString& host) const;
+
     /**
      * @brief Return the default queue name.
      * @return Default queue name.
@@ -570,6 +607,19 @@ public:
      */
     Q_INVOKABLE void removeDomainRule(const QString& host);
 
+    /**
+     * @brief Return hosts whose plain-HTTP downloads use the native transport.
+     * @return Normalized host names.
+     */
+    Q_INVOKABLE QStringList nativeTransportHosts() const;
+
+    /**
+     * @brief List or unlist a host for the native range transport.
+     * @param host Host name.
+     * @param enabled true to use the native transport for downloads from it.
+     */
+    Q_INVOKABLE void setNativeTransportHost(const QString& host, bool enabled);
+
     /**
      * @brief Detect the category for a filename.
      * @param name File name or path.
@@ -609,6 +659,12 @@ public:
      */
     Q_INVOKABLE void verifyTask(int index);
 
+    /**
+     * @brief Re-check a completed download block by block and refetch only damaged blocks.
+     * @param index Row index.
+     */
+    Q_INVOKABLE void repairTask(int index);
+
     /**
      * @brief Test a URL with a HEAD request.
      * @param urlStr URL to test.
@@ -687,6 +743,33 @@ public:
     //!< @brief Return average active segment count.
     qreal averageActiveSegments() const { return m_averageActiveSegments; }
 
+    //!< @brief Return the disk writer backend actually in use.
+    QString activeDiskWriterBackend() const { return m_activeDiskWriterBackend; }
+
+    //!< @brief Return the requested disk writer backend.
+    QString diskWriterBackend() const { return m_diskWriterBackend; }
+
+    /**
+     * @brief Select the disk writer backend; applies to writes queued afterwards.
+     * @param name "qfile" or "io_uring" (falls back to "qfile" when unavailable).
+     */
+    void setDiskWriterBackend(const QString& name);
+
+    //!< @brief Return whether the io_uring backend can be used.
+    bool ioUringAvailable() const { return DiskWriterPool::ioUringAvailable(); }
+
+    //!< @brief Return the process-wide download memory budget.
+    qint64 memoryBudget() const { return m_memoryBudget; }
+
+    /**
+     * @brief Set the process-wide download memory budget.
+     * @param bytes Budget in bytes, split evenly across running tasks.
+     */
+    void setMemoryBudget(qint64 bytes);
+
+    //!< @brief Return downloaded bytes held in memory across all tasks.
+    qint64 bufferedBytes() const { return m_bufferedBytes; }
+
     //!< @brief Return pause-on-battery policy.
     bool pauseOnBattery() const { return m_pauseOnBattery; }
 
@@ -726,6 +809,19 @@ public:
      */
     void setPerHostMaxConcurrent(int value);
 
+    //!< @brief Return the per-host connection limit of the shared network sessions.
+    int perHostMaxConnections() const;
+
+    /**
+     * @brief Set the per-host connection limit.
+     *
+     * Caps the sockets of each shared network session and the segment
+     * budget the connection arbiter shares between tasks on one host.
+     *
+     * @param value Max connections to one host across all tasks.
+     */
+    void setPerHostMaxConnections(int value);
+
     //!< @brief Return whether sensitive options are persisted.
     bool persistSensitiveOptions() const { return m_persistSensitiveOptions; }
 
@@ -812,6 +908,9 @@ signals:
     //!< @brief Emitted when domain rule mapping changes.
     void domainRulesChanged();
 
+    //!< @brief Emitted when the native transport host list changes.
+    void nativeTransportHostsChanged();
+
     //!< @brief Emitted when global max speed changes.
     void globalMaxSpeedChanged();
 
@@ -845,6 +944,12 @@ signals:
     //!< @brief Emitted when telemetry policy changes.
     void telemetryPolicyChanged();
 
+    //!< @brief Emitted when the requested disk writer backend changes.
+    void diskWriterPolicyChanged();
+
+    //!< @brief Emitted when the download memory budget changes.
+    void memoryBudgetChanged();
+
     //!< @brief Emitted when default network options change.
     void networkDefaultsChanged();
 
@@ -884,6 +989,9 @@ private slots:
     //!< @brief Refresh process CPU and memory telemetry.
     void updateRuntimeStats();
 
+    //!< @brief Split the memory budget evenly across running tasks.
+    void distributeMemoryBudget();
+
 private:
     /**
      * @brief Runtime configuration and accounting data for a download queue.
@@ -932,12 +1040,33 @@ private:
     //!< @brief Ensure a default queue exists.
     void ensureDefaultQueue();
 
+    //!< @brief Return a task's queue name (default queue if unregistered).
+    QString queueOf(const DownloaderTask* task) const;
+
+    //!< @brief Return a task's category name (detected from the file name if unregistered).
+    QString categoryOf(const DownloaderTask* task) const;
+
+    //!< @brief Return a task's scheduling priority.
+    int priorityOf(const DownloaderTask* task) const;
+
+    //!< @brief Return whether the manager paused a task for @p cause.
+    bool taskPausedBy(const DownloaderTask* task, TaskRegistry::PauseCause cause) const;
+
+    //!< @brief Set or clear a pause cause (ignored for unregistered tasks).
+    void setTaskPausedBy(const DownloaderTask* task, TaskRegistry::PauseCause cause, bool paused);
+
     /**
      * @brief Apply effective speed limits to a task.
      * @param task Task instance.
      */
     void applyTaskSpeed(DownloaderTask* task);
 
+    /**
+     * @brief Return the rate limiter node shared by a queue's tasks, creating it on first use.
+     * @param name Queue name.
+     */
+    int queueRateNode(const QString& name);
+
     /**
      * @brief Enforces queue scheduling and quota policies.
      *
@@ -974,7 +1103,13 @@ private:
     void startQueued();
 
     /**
-     * @brief Recompute aggregate speed and byte counters.
+     * @brief Report a task's state, queue, host and priority to the scheduler index.
+     * @param task Task instance.
+     */
+    void syncSchedule(DownloaderTask* task);
+
+    /**
+     * @brief Publish the aggregate speed and byte counters kept by the task registry.
      *
      * Emits totalsChanged() when values are updated.
      */
@@ -1036,6 +1171,14 @@ private:
      */
     void verifyChecksumAsync(DownloaderTask* task);
 
+    /**
+     * @brief Store a computed checksum on a task and compare it with the expected value.
+     * @param task Task instance.
+     * @param actual Hex digest (empty = hashing failed).
+     * @param expectedRaw Expected checksum as entered (may be empty).
+     */
+    void applyChecksumResult(DownloaderTask* task, const QString& actual, const QString& expectedRaw);
+
     /**
      * @brief Reveal a file path in the file manager.
      * @param path File path.
@@ -1081,26 +1224,15 @@ private:
     DownloadModel m_model;                                                          //!< Backing list model.
     int m_maxConcurrent = 3;                                                        //!< Global max concurrent downloads.
     qint64 m_globalMaxSpeed = 0;                                                    //!< Global speed limit in bytes/sec.
+    int m_globalRateNode = 0;                                                       //!< Root token bucket for the global limit.
+    QHash<QString, int> m_queueRateNodes;                                           //!< Per-queue token buckets (children of the root).
     qint64 m_totalSpeed = 0;                                                        //!< Aggregate speed in bytes/sec.
     qint64 m_totalReceived = 0;                                                     //!< Aggregate received bytes.
     qint64 m_totalSize = 0;                                                         //!< Aggregate total bytes.
     qint64 m_lastTotalsUpdateMs = 0;                                                //!< Last totals refresh timestamp.
 
-    QHash<DownloaderTask*, qint64> m_taskSpeed;                                     //!< Per-task current speed.
-    QHash<DownloaderTask*, qint64> m_taskReceived;                                  //!< Per-task received bytes.
-    QHash<DownloaderTask*, qint64> m_taskTotal;                                     //!< Per-task total bytes.
-    QHash<DownloaderTask*, qint64> m_taskLastReceived;                              //!< Per-task last received bytes.
-    QHash<DownloaderTask*, qint64> m_taskMaxSpeed;                                  //!< Per-task speed limit.
-    QHash<DownloaderTask*, qint64> m_taskCompletedAt;                               //!< Per-task completion time.
-    QHash<DownloaderTask*, int> m_taskRetryCount;                                   //!< Per-task retry count.
-    QHash<DownloaderTask*, int> m_taskPriority;                                     //!< Per-task priority.
-    QHash<DownloaderTask*, qint64> m_taskCreatedOrder;                              //!< Per-task insertion order.
-    QHash<DownloaderTask*, QString> m_taskQueue;                                    //!< Per-task queue mapping.
-    QHash<DownloaderTask*, QString> m_taskCategory;                                 //!< Per-task category mapping.
-    QHash<DownloaderTask*, bool> m_taskPausedBySchedule;                            //!< Paused by schedule.
-    QHash<DownloaderTask*, bool> m_taskPausedByQuota;                               //!< Paused by quota.
-    QHash<DownloaderTask*, bool> m_taskPausedByBattery;                             //!< Paused by battery.
-    QHash<DownloaderTask*, bool> m_taskPausedByNetwork;                             //!< Paused by transient network issues.
+    TaskRegistry m_tasks;                                                           //!< Per-task counters, priorities, queues and pause causes.
+    ReadyQueue m_ready;                                                             //!< Ready tasks and running counts for the scheduler.
     QHash<DownloaderTask*, QPointer<QFutureWatcher<QString>>> m_checksumWatchers;   //!< Async checksum watchers.
 
     QVector<DownloaderTask*> m_queue;                                               //!< Queue in insertion order.
@@ -1108,7 +1240,9 @@ private:
     QStringList m_queueOrder;                                                       //!< Queue ordering list.
     QHash<QString, QString> m_categoryFolders;                                      //!< Category folder mapping.
     QHash<QString, QString> m_domainRules;                                          //!< Host-to-queue mapping.
+    QSet<QString> m_nativeTransportHosts;                                           //!< Hosts served through RangeEngine.
     QHash<QString, qint64> m_hostCooldownUntilMs;                                   //!< Per-host cooldown deadline.
+    HostProfileStore m_hostProfiles;                                                //!< Learned per-host operating points.
     QTimer m_saveTimer;                                                             //!< Debounced session save timer.
     QTimer m_schedulerTimer;                                                        //!< Scheduler tick timer.
     QTimer m_powerTimer;                                                            //!< Power polling timer.
@@ -1119,7 +1253,6 @@ private:
     bool m_onBattery = false;                                                       //!< Cached power state.
     bool m_restoreInProgress = false;                                               //!< Session restore guard.
     bool m_bulkCancelInProgress = false;                                            //!< Bulk cancel guard.
-    qint64 m_taskOrderCounter = 0;                                                  //!< Task insertion sequence.
     int m_autoRetryMax = 2;                                                         //!< Default retry attempts.
     int m_autoRetryDelaySec = 5;                                                    //!< Default retry delay in seconds.
     int m_perHostMaxConcurrent = 8;                                                 //!< Max active downloads per host.
@@ -1139,6 +1272,10 @@ private:
     qint64 m_diskFreeBytes = 0;                                                     //!< Free bytes on downloads volume.
     QString m_networkReachability = QStringLiteral("Unknown");                      //!< Cached reachability label.
     qreal m_averageActiveSegments = 0.0;                                            //!< Avg effective segments across active tasks.
+    QString m_diskWriterBackend = QStringLiteral("qfile");                          //!< Requested disk writer backend.
+    QString m_activeDiskWriterBackend = QStringLiteral("qfile");                    //!< Disk writer backend in use.
+    qint64 m_memoryBudget = 256ll * 1024 * 1024;                                    //!< Download memory budget.
+    qint64 m_bufferedBytes = 0;                                                     //!< Bytes buffered across tasks.
     qint64 m_lastProcessCpuTimeNs = 0;                                              //!< Previous CPU time sample.
     QElapsedTimer m_runtimeStatsClock;                                              //!< Wall clock for CPU sampling.
 
@@ -0,0 +1,92 @@
+module;
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+#include <QtGlobal>
+#include <cmath>
+
+module raad.core.hostprofile;
+
+namespace {
+
+//!< Weight of the newest run in smoothed values.
+constexpr qreal kBlend = 0.4;
+
+qint64 blend(qint64 previous, qint64 next)
+{
+    if (previous <= 0) return next;
+    if (next <= 0) return previous;
+    return static_cast<qint64>(std::llround((1.0 - kBlend) * previous + kBlend * next));
+}
+
+} // namespace
+
+void HostProfileStore::learn(const QString& host, const HostObservation& observation, qint64 nowMs)
+{
+    if (host.isEmpty()) return;
+    HostProfile& p = m_profiles[host];
+
+    if (observation.segments > 0) {
+        int segments = static_cast<int>(blend(p.segments, observation.segments));
+        // A run the server pushed back on found its best point before the pushback; start below it.
+        if (observation.throttleEvents > 0) {
+            segments = qMin(segments, static_cast<int>(observation.segments * 0.7));
+        }
+        p.segments = qBound(1, segments, 32);
+    }
+    p.bytesPerSec = blend(p.bytesPerSec, observation.bytesPerSec);
+    p.rttMs = static_cast<int>(blend(p.rttMs, observation.rttMs));
+    p.throttleScore = qMin(p.throttleScore / 2 + observation.throttleEvents, 1000);
+    if (observation.rangeSupport != 0) {
+        p.rangeSupport = observation.rangeSupport;
+        p.rangeCheckedMs = nowMs;
+    }
+    p.samples = qMin(p.samples + 1, 1000000);
+    p.updatedMs = nowMs;
+
+    if (m_profiles.size() > kMaxHosts) {
+        auto oldest = m_profiles.begin();
+        for (auto it = m_profiles.begin(); it != m_profiles.end(); ++it) {
+            if (it->updatedMs < oldest->updatedMs) oldest = it;
+        }
+        m_profiles.erase(oldest);
+    }
+}
+
+QJsonObject HostProfileStore::toJson() const
+{
+    QJsonObject json;
+    for (auto it = m_profiles.begin(); it != m_profiles.end(); ++it) {
+        const HostProfile& p = it.value();
+        QJsonObject obj;
+        obj.insert("segments", p.segments);
+        obj.insert("bytesPerSec", static_cast<double>(p.bytesPerSec));
+        obj.insert("rttMs", p.rttMs);
+        obj.insert("throttleScore", p.throttleScore);
+        obj.insert("rangeSupport", p.rangeSupport);
+        obj.insert("rangeCheckedMs", static_cast<double>(p.rangeCheckedMs));
+        obj.insert("samples", p.samples);
+        obj.insert("updatedMs", static_cast<double>(p.updatedMs));
+        json.insert(it.key(), obj);
+    }
+    return json;
+}
+
+void HostProfileStore::fromJson(const QJsonObject& json)
+{
+    m_profiles.clear();
+    for (auto it = json.begin(); it != json.end(); ++it) {
+        if (it.key().isEmpty() || !it.value().isObject()) continue;
+        const QJsonObject obj = it.value().toObject();
+        HostProfile p;
+        p.segments = qBound(0, obj.value("segments").toInt(), 32);
+        p.bytesPerSec = qMax<qint64>(0, static_cast<qint64>(obj.value("bytesPerSec").toDouble()));
+        p.rttMs = qMax(0, obj.value("rttMs").toInt());
+        p.throttleScore = qMax(0, obj.value("throttleScore").toInt());
+        p.rangeSupport = qBound(-1, obj.value("rangeSupport").toInt(), 1);
+        p.rangeCheckedMs = static_cast<qint64>(obj.value("rangeCheckedMs").toDouble());
+        p.samples = qMax(0, obj.value("samples").toInt());
+        p.updatedMs = static_cast<qint64>(obj.value("updatedMs").toDouble());
+        m_profiles.insert(it.key(), p);
+    }
+}
@@ -0,0 +1,110 @@
+/*!
+ * @file        hostprofile.cppm
+ * @brief       Per-host performance learned from finished downloads.
+ * @details     Each finished task reports what it learned about its server:
+ *              the segment count at which it moved the most bytes, the rate
+ *              it reached, the latency of its first request, how often the
+ *              server pushed back with 429/503, and whether byte ranges
+ *              worked. The profile blends these over runs so one unusual
+ *              download does not overwrite the history.
+ *
+ *              New tasks start at the learned segment count instead of the
+ *              fixed default, and hosts known to ignore ranges go straight
+ *              to a single stream.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+
+#ifndef Q_MOC_RUN
+export module raad.core.hostprofile;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+/**
+ * @brief What one task learned about its host.
+ */
+RAAD_MODULE_EXPORT struct HostObservation {
+    int segments = 0;                       //!< Connections at the best measured rate (0 = not measured).
+    qint64 bytesPerSec = 0;                 //!< Best measured rate.
+    int rttMs = 0;                          //!< Latency of the first request (0 = not measured).
+    int throttleEvents = 0;                 //!< 429/503 answers seen.
+    int rangeSupport = 0;                   //!< 1 ranges worked, -1 ignored, 0 unknown.
+};
+
+/**
+ * @brief Learned operating point of one host.
+ */
+RAAD_MODULE_EXPORT struct HostProfile {
+    static constexpr qint64 kRangeVerdictMs = 7ll * 24 * 60 * 60 * 1000;   //!< How long a range verdict is trusted.
+
+    int segments = 0;                       //!< Segment count to start with (0 = unknown).
+    qint64 bytesPerSec = 0;                 //!< Smoothed achieved rate.
+    int rttMs = 0;                          //!< Smoothed first-request latency.
+    int throttleScore = 0;                  //!< Recent 429/503 history; halves with every run.
+    int rangeSupport = 0;                   //!< 1 ranges work, -1 ignored, 0 unknown.
+    qint64 rangeCheckedMs = 0;              //!< When the range verdict was last confirmed.
+    int samples = 0;                        //!< Runs blended in.
+    qint64 updatedMs = 0;                   //!< Last update (epoch ms).
+
+    //!< @brief Return whether the host is known to ignore ranges as of @p nowMs.
+    bool knownRangeless(qint64 nowMs) const
+    {
+        return rangeSupport < 0 && nowMs - rangeCheckedMs < kRangeVerdictMs;
+    }
+};
+
+/**
+ * @brief Host profiles keyed by normalized host name.
+ *
+ * Not thread-safe: owned by the download manager.
+ */
+RAAD_MODULE_EXPORT class HostProfileStore {
+public:
+    static constexpr int kMaxHosts = 256;               //!< Least recently updated hosts beyond this are dropped.
+
+    /**
+     * @brief Return the profile of a host.
+     * @param host Normalized host name.
+     * @return Profile, or a default one (all unknown) for a new host.
+     */
+    HostProfile profile(const QString& host) const { return m_profiles.value(host); }
+
+    //!< @brief Return whether a host has a profile.
+    bool contains(const QString& host) const { return m_profiles.contains(host); }
+
+    //!< @brief Return the number of profiled hosts.
+    int size() const { return static_cast<int>(m_profiles.size()); }
+
+    /**
+     * @brief Blend one finished task's observation into its host's profile.
+     * @param host Normalized host name (empty is ignored).
+     * @param observation What the task learned.
+     * @param nowMs Current time (epoch ms).
+     */
+    void learn(const QString& host, const HostObservation& observation, qint64 nowMs);
+
+    //!< @brief Drop every profile.
+    void clear() { m_profiles.clear(); }
+
+    //!< @brief Serialize all profiles.
+    QJsonObject toJson() const;
+
+    //!< @brief Replace all profiles with ones read by toJson().
+    void fromJson(const QJsonObject& json);
+
+private:
+    QHash<QString, HostProfile> m_profiles;     //!< Profiles by host.
+};
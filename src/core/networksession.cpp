@@ -0,0 +1,114 @@
+module;
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QHttp1Configuration>
+#include <QNetworkAccessManager>
+#include <QNetworkProxy>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+
+module raad.core.networksession;
+
+NetworkSessionPool& NetworkSessionPool::instance()
+{
+    static NetworkSessionPool pool;
+    return pool;
+}
+
+NetworkSessionPool::NetworkSessionPool()
+{
+    m_clock.start();
+}
+
+QString NetworkSessionPool::keyFor(const QNetworkProxy& proxy)
+{
+    if (proxy.type() == QNetworkProxy::NoProxy || proxy.type() == QNetworkProxy::DefaultProxy || proxy.hostName().isEmpty()) {
+        return QStringLiteral("direct");
+    }
+    return QStringLiteral("%1|%2|%3|%4|%5")
+        .arg(int(proxy.type()))
+        .arg(proxy.hostName())
+        .arg(proxy.port())
+        .arg(proxy.user(), proxy.password());
+}
+
+QNetworkAccessManager* NetworkSessionPool::acquire(const QNetworkProxy& proxy)
+{
+    expireIdle();
+    const QString key = keyFor(proxy);
+    Session& session = m_sessions[key];
+    if (!session.manager) {
+        // Parent to the application when possible so the manager dies before Qt's network internals.
+        QCoreApplication* app = QCoreApplication::instance();
+        QObject* parent = (app && app->thread() == QThread::currentThread()) ? app : nullptr;
+        session.manager = new QNetworkAccessManager(parent);
+        if (key != QStringLiteral("direct")) session.manager->setProxy(proxy);
+        session.borrowers = 0;
+    }
+    ++session.borrowers;
+    return session.manager;
+}
+
+void NetworkSessionPool::release(QNetworkAccessManager* manager)
+{
+    if (!manager) return;
+    for (Session& session : m_sessions) {
+        if (session.manager != manager) continue;
+        if (session.borrowers > 0 && --session.borrowers == 0) {
+            session.idleSinceMs = m_clock.elapsed();
+            QTimer::singleShot(kIdleLingerMs, manager, [this] { expireIdle(); });
+        }
+        return;
+    }
+}
+
+void NetworkSessionPool::expireIdle()
+{
+    const qint64 now = m_clock.elapsed();
+    for (auto it = m_sessions.begin(); it != m_sessions.end();) {
+        if (!it->manager) {
+            it = m_sessions.erase(it);
+        } else if (it->borrowers == 0 && now - it->idleSinceMs >= kIdleLingerMs) {
+            // Replies handed out earlier may still be unwinding; let the event loop finish them.
+            it->manager->deleteLater();
+            it = m_sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void NetworkSessionPool::setConnectionsPerHost(int connections)
+{
+    m_connectionsPerHost = qBound(1, connections, kMaxConnectionsPerHost);
+}
+
+void NetworkSessionPool::prepare(QNetworkRequest& req) const
+{
+    QHttp1Configuration http1;
+    http1.setNumberOfConnectionsPerHost(static_cast<qsizetype>(m_connectionsPerHost));
+    req.setHttp1Configuration(http1);
+    // Segments to an HTTP/2 server become streams on the session's single connection to it.
+    req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+}
+
+int NetworkSessionPool::sessionCount() const
+{
+    int count = 0;
+    for (const Session& session : m_sessions) {
+        if (session.manager) ++count;
+    }
+    return count;
+}
+
+int NetworkSessionPool::borrowers(const QNetworkAccessManager* manager) const
+{
+    for (const Session& session : m_sessions) {
+        if (session.manager == manager) return session.borrowers;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*!
+ * @file        networksession.cppm
+ * @brief       Network sessions shared by download tasks.
+ * @details     Tasks borrow a QNetworkAccessManager for their proxy settings
+ *              instead of owning one, so downloads from the same server reuse
+ *              keep-alive connections, TLS sessions and HTTP/2 connections
+ *              across tasks. A batch of small files then pays for one
+ *              handshake per connection rather than one per file.
+ *
+ *              Each session caps the connections it opens per host. Requests
+ *              past the cap wait inside the session for a free connection
+ *              instead of opening another one. A session nobody borrows is
+ *              kept for a short while so back-to-back tasks find its idle
+ *              connections still open.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QElapsedTimer>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QNetworkProxy>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QString>
+
+#ifndef Q_MOC_RUN
+export module raad.core.networksession;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+/**
+ * @brief Process-wide set of network sessions keyed by proxy configuration.
+ *
+ * Not thread-safe: use it from the thread that runs the download engine. The
+ * managers live on that thread and are parented to the application, so they
+ * are torn down with it.
+ */
+RAAD_MODULE_EXPORT class NetworkSessionPool {
+public:
+    static constexpr int kDefaultConnectionsPerHost = 16;       //!< Connection cap per host and session.
+    static constexpr int kMaxConnectionsPerHost = 64;           //!< Highest accepted cap.
+    static constexpr int kIdleLingerMs = 30000;                 //!< Lifetime of an unborrowed session.
+
+    //!< @brief Return the shared pool.
+    static NetworkSessionPool& instance();
+
+    NetworkSessionPool(const NetworkSessionPool&) = delete;
+    NetworkSessionPool& operator=(const NetworkSessionPool&) = delete;
+
+    /**
+     * @brief Borrow the session for a proxy configuration, creating it if needed.
+     * @param proxy Proxy to use (NoProxy / DefaultProxy for none).
+     * @return Network manager; hand it back with release().
+     */
+    QNetworkAccessManager* acquire(const QNetworkProxy& proxy);
+
+    /**
+     * @brief Return a session borrowed with acquire().
+     * @param manager Network manager (null is ignored).
+     */
+    void release(QNetworkAccessManager* manager);
+
+    /**
+     * @brief Set how many connections a session may open to one host.
+     *
+     * Applies to connections opened after the call; hosts with open
+     * connections keep their cap until those connections expire.
+     *
+     * @param connections Connection cap (clamped to [1, kMaxConnectionsPerHost]).
+     */
+    void setConnectionsPerHost(int connections);
+
+    //!< @brief Return the per-host connection cap.
+    int connectionsPerHost() const { return m_connectionsPerHost; }
+
+    /**
+     * @brief Apply session-wide settings to a request before it is sent.
+     * @param req Request to modify.
+     */
+    void prepare(QNetworkRequest& req) const;
+
+    //!< @brief Return the number of live sessions (borrowed or lingering).
+    int sessionCount() const;
+
+    //!< @brief Return how many tasks borrow the session of @p manager.
+    int borrowers(const QNetworkAccessManager* manager) const;
+
+private:
+    NetworkSessionPool();
+
+    struct Session {
+        QPointer<QNetworkAccessManager> manager;    //!< Shared manager.
+        int borrowers = 0;                          //!< Outstanding acquire() calls.
+        qint64 idleSinceMs = 0;                     //!< Clock reading when the last borrower left.
+    };
+
+    //!< @brief Return the lookup key of a proxy configuration.
+    static QString keyFor(const QNetworkProxy& proxy);
+
+    //!< @brief Drop sessions that have been unborrowed for kIdleLingerMs.
+    void expireIdle();
+
+    QHash<QString, Session> m_sessions;     //!< Sessions by proxy key.
+    int m_connectionsPerHost = kDefaultConnectionsPerHost;  //!< Per-host connection cap.
+    QElapsedTimer m_clock;                  //!< Monotonic clock for idle expiry.
+};
@@ -0,0 +1,193 @@
+module;
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+#include <array>
+
+#if defined(Q_OS_LINUX)
+#include <cerrno>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+module raad.core.partmerger;
+
+namespace {
+
+#if defined(Q_OS_LINUX)
+//!< Largest single copy_file_range()/sendfile() request.
+constexpr qint64 kKernelChunk = 1ll << 30;
+
+//!< Whether a copy error means the call cannot work for these files at all.
+bool unavailable(int error)
+{
+    return error == ENOSYS || error == EOPNOTSUPP || error == EXDEV || error == EINVAL || error == ENOTTY;
+}
+#endif
+
+} // namespace
+
+PartMerger::PartMerger(QFile* out)
+    : m_out(out)
+{
+}
+
+void PartMerger::setFirstStrategy(Strategy strategy)
+{
+    m_first = static_cast<int>(strategy);
+}
+
+bool PartMerger::append(const QString& partPath)
+{
+    QFile part(partPath);
+    if (!part.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        fail(QStringLiteral("merge_part_missing"), QStringLiteral("Cannot open segment part: %1").arg(partPath));
+        return false;
+    }
+    const qint64 length = part.size();
+    qint64 done = 0;
+    for (int rung = m_first; done < length && rung < kStrategyCount; ++rung) {
+        QElapsedTimer timer;
+        timer.start();
+        qint64 copied = 0;
+        const Step step = copy(static_cast<Strategy>(rung), part, done, length - done, &copied);
+        Usage& usage = m_usage[rung];
+        usage.elapsedNs += timer.nsecsElapsed();
+        if (copied > 0) {
+            ++usage.parts;
+            usage.bytes += copied;
+            done += copied;
+            m_offset += copied;
+        }
+        if (step == Step::Failed) return false;
+        if (step == Step::Unavailable) m_first = qMax(m_first, rung + 1);
+        if (step == Step::Done) break;
+    }
+    if (done < length) {
+        fail(QStringLiteral("merge_write_failed"), QStringLiteral("Failed while merging segments"));
+        return false;
+    }
+    return true;
+}
+
+PartMerger::Step PartMerger::copy(Strategy strategy, QFile& part, qint64 partOffset, qint64 length, qint64* copied)
+{
+    if (strategy == Strategy::Buffered) return copyBuffered(part, partOffset, length, copied);
+#if defined(Q_OS_LINUX)
+    const int in = part.handle();
+    const int out = m_out->handle();
+    switch (strategy) {
+    case Strategy::Reflink: {
+        // Clones need block-aligned offsets; part boundaries are arbitrary byte offsets.
+        struct stat info {};
+        const qint64 block = ::fstat(out, &info) == 0 && info.st_blksize > 0 ? info.st_blksize : 4096;
+        if (m_offset % block != 0 || partOffset % block != 0) return Step::Unsupported;
+        file_clone_range range {};
+        range.src_fd = in;
+        range.src_offset = static_cast<__u64>(partOffset);
+        range.src_length = static_cast<__u64>(length);
+        range.dest_offset = static_cast<__u64>(m_offset);
+        if (::ioctl(out, FICLONERANGE, &range) == 0) {
+            *copied = length;
+            return Step::Done;
+        }
+        // EINVAL is an alignment or range complaint about this part only.
+        return errno == EINVAL ? Step::Unsupported : Step::Unavailable;
+    }
+    case Strategy::CopyRange: {
+        loff_t from = static_cast<loff_t>(partOffset);
+        loff_t to = static_cast<loff_t>(m_offset);
+        while (*copied < length) {
+            const ssize_t n = ::copy_file_range(in, &from, out, &to,
+                                                static_cast<size_t>(qMin(length - *copied, kKernelChunk)), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && unavailable(errno)) return Step::Unavailable;
+            if (n < 0) return fail(QStringLiteral("merge_write_failed"), qt_error_string(errno));
+            if (n == 0) return fail(QStringLiteral("merge_write_failed"), QStringLiteral("Segment part ended early"));
+            *copied += n;
+        }
+        return Step::Done;
+    }
+    case Strategy::SendFile: {
+        // sendfile() writes at the output's file position.
+        if (::lseek(out, static_cast<off_t>(m_offset), SEEK_SET) < 0) return Step::Unavailable;
+        off_t from = static_cast<off_t>(partOffset);
+        while (*copied < length) {
+            const ssize_t n = ::sendfile(out, in, &from, static_cast<size_t>(qMin(length - *copied, kKernelChunk)));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && unavailable(errno)) return Step::Unavailable;
+            if (n < 0) return fail(QStringLiteral("merge_write_failed"), qt_error_string(errno));
+            if (n == 0) return fail(QStringLiteral("merge_write_failed"), QStringLiteral("Segment part ended early"));
+            *copied += n;
+        }
+        return Step::Done;
+    }
+    case Strategy::Buffered:
+        break;
+    }
+#else
+    Q_UNUSED(part);
+    Q_UNUSED(partOffset);
+    Q_UNUSED(length);
+    Q_UNUSED(copied);
+#endif
+    return Step::Unavailable;
+}
+
+PartMerger::Step PartMerger::copyBuffered(QFile& part, qint64 partOffset, qint64 length, qint64* copied)
+{
+    if (!part.seek(partOffset) || !m_out->seek(m_offset)) {
+        return fail(QStringLiteral("merge_write_failed"), QStringLiteral("Failed while merging segments"));
+    }
+    QByteArray buffer(static_cast<qsizetype>(qMin(length, kBufferBytes)), Qt::Uninitialized);
+    while (*copied < length) {
+        const qint64 readBytes = part.read(buffer.data(), qMin<qint64>(buffer.size(), length - *copied));
+        if (readBytes <= 0) {
+            return fail(QStringLiteral("merge_write_failed"), QStringLiteral("Segment part ended early"));
+        }
+        if (m_out->write(buffer.constData(), readBytes) != readBytes) {
+            return fail(QStringLiteral("merge_write_failed"), QStringLiteral("Failed while merging segments"));
+        }
+        *copied += readBytes;
+    }
+    return Step::Done;
+}
+
+PartMerger::Step PartMerger::fail(const QString& code, const QString& message)
+{
+    m_errorCode = code;
+    m_error = message;
+    return Step::Failed;
+}
+
+QString PartMerger::summary() const
+{
+    QStringList used;
+    for (int i = 0; i < kStrategyCount; ++i) {
+        const Usage& u = m_usage[i];
+        if (u.parts == 0) continue;
+        used << QStringLiteral("%1 %2 parts %3 MB %4 s")
+                    .arg(strategyName(static_cast<Strategy>(i)))
+                    .arg(u.parts)
+                    .arg(u.bytes / (1024 * 1024))
+                    .arg(u.elapsedNs / 1e9, 0, 'f', 2);
+    }
+    return used.isEmpty() ? QStringLiteral("nothing copied") : used.join(QStringLiteral(", "));
+}
+
+QString PartMerger::strategyName(Strategy strategy)
+{
+    switch (strategy) {
+    case Strategy::Reflink: return QStringLiteral("reflink");
+    case Strategy::CopyRange: return QStringLiteral("copy_file_range");
+    case Strategy::SendFile: return QStringLiteral("sendfile");
+    case Strategy::Buffered: return QStringLiteral("buffered");
+    }
+    return QString();
+}
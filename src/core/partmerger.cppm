@@ -0,0 +1,127 @@
+/*!
+ * @file        partmerger.cppm
+ * @brief       Concatenates `.partN` segment files into the final output file.
+ * @details     Copying every part through a user-space buffer costs two copies
+ *              per byte and a syscall per megabyte. The merger instead walks a
+ *              ladder of kernel-side strategies per part and falls through to
+ *              the next rung as soon as one is not supported:
+ *
+ *              1. reflink (FICLONERANGE): shares extents on Btrfs, XFS and
+ *                 other copy-on-write filesystems; needs block-aligned offsets.
+ *              2. copy_file_range(): copies inside the kernel (and reflinks
+ *                 aligned extents on its own where the filesystem can).
+ *              3. sendfile(): file-to-file page cache copy.
+ *              4. buffered read/write, available everywhere.
+ *
+ *              Bytes and time spent are recorded per strategy so the task can
+ *              log how the merge went.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QFile>
+#include <QString>
+#include <array>
+
+#ifndef Q_MOC_RUN
+export module raad.core.partmerger;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+/**
+ * @brief Appends part files to an output file with the cheapest available copy.
+ *
+ * One merger serves one merge pass; strategies found unsupported for the
+ * output file are skipped for the remaining parts.
+ */
+RAAD_MODULE_EXPORT class PartMerger {
+public:
+    static constexpr qint64 kBufferBytes = 1024 * 1024;     //!< Buffered strategy chunk size.
+
+    /**
+     * @brief Copy strategies, cheapest first.
+     */
+    enum class Strategy {
+        Reflink,    //!< Share extents (FICLONERANGE).
+        CopyRange,  //!< copy_file_range().
+        SendFile,   //!< sendfile() between files.
+        Buffered    //!< User-space read/write loop.
+    };
+    static constexpr int kStrategyCount = 4;                //!< Number of strategies.
+
+    /**
+     * @brief Work done by one strategy during the merge.
+     */
+    struct Usage {
+        int parts = 0;                      //!< Parts that used the strategy for some bytes.
+        qint64 bytes = 0;                   //!< Bytes moved by it.
+        qint64 elapsedNs = 0;               //!< Time spent in it.
+    };
+
+    /**
+     * @brief Start merging into an open, empty output file.
+     * @param out Output file, opened for writing (unbuffered on Unix).
+     */
+    explicit PartMerger(QFile* out);
+
+    //!< @brief Start the ladder at @p strategy instead of the top (benchmarks and tests).
+    void setFirstStrategy(Strategy strategy);
+
+    /**
+     * @brief Append a whole part file at the current end of the output.
+     * @param partPath Part file to copy.
+     * @return false on failure; see errorMessage().
+     */
+    bool append(const QString& partPath);
+
+    //!< @brief Return the bytes appended so far.
+    qint64 size() const { return m_offset; }
+
+    //!< @brief Return what a strategy did so far.
+    const Usage& usage(Strategy strategy) const { return m_usage[static_cast<int>(strategy)]; }
+
+    //!< @brief Return a one-line, per-strategy summary for the task log.
+    QString summary() const;
+
+    //!< @brief Return the structured code of the last error.
+    QString errorCode() const { return m_errorCode; }
+
+    //!< @brief Return the last error message.
+    QString errorMessage() const { return m_error; }
+
+    //!< @brief Return the log name of a strategy.
+    static QString strategyName(Strategy strategy);
+
+private:
+    enum class Step {
+        Done,           //!< The requested bytes were copied.
+        Unsupported,    //!< The strategy cannot serve this copy; try the next one.
+        Unavailable,    //!< The strategy does not work for this output at all.
+        Failed          //!< A real I/O error; the merge stops.
+    };
+
+    //!< @brief Copy @p length bytes of @p part at @p partOffset to the output at m_offset.
+    Step copy(Strategy strategy, QFile& part, qint64 partOffset, qint64 length, qint64* copied);
+
+    //!< @brief User-space copy loop.
+    Step copyBuffered(QFile& part, qint64 partOffset, qint64 length, qint64* copied);
+
+    //!< @brief Record a failure and return Step::Failed.
+    Step fail(const QString& code, const QString& message);
+
+    QFile* m_out = nullptr;                                 //!< Output file.
+    qint64 m_offset = 0;                                    //!< Output bytes written so far.
+    int m_first = 0;                                        //!< First strategy still worth trying.
+    std::array<Usage, kStrategyCount> m_usage {};           //!< Per-strategy counters.
+    QString m_errorCode;                                    //!< Last error code.
+    QString m_error;                                        //!< Last error message.
+};
@@ -0,0 +1,694 @@
+module;
+#include <QtGlobal>
+#include <QByteArray>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QThread>
+#include <cstring>
+#include <utility>
+
+#if defined(Q_OS_LINUX)
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+module raad.core.rangeengine;
+
+namespace {
+
+constexpr qint64 kCopyBuffer = 256 * 1024;          //!< Read size on the copy path.
+constexpr qint64 kTurnBytes = 4 * 1024 * 1024;      //!< Bytes one transfer moves before the others get a turn.
+constexpr int kMaxEvents = 64;                      //!< epoll events taken per wake-up.
+
+//!< Monotonic milliseconds for the engine's timers.
+qint64 nowMs()
+{
+    static const QElapsedTimer clock = [] {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return clock.elapsed();
+}
+
+struct ResponseHead {
+    int status = 0;
+    QByteArray contentRange;
+    QByteArray transferEncoding;
+    QByteArray etag;
+    QByteArray lastModified;
+};
+
+// Parse the status line and the headers the engine cares about.
+bool parseHead(const QByteArray& text, ResponseHead* head)
+{
+    const QList<QByteArray> lines = text.split('\n');
+    const QList<QByteArray> statusLine = lines.first().trimmed().split(' ');
+    if (statusLine.size() < 2 || !statusLine.first().startsWith("HTTP/1.")) return false;
+    bool ok = false;
+    head->status = statusLine.at(1).toInt(&ok);
+    if (!ok) return false;
+
+    for (qsizetype i = 1; i < lines.size(); ++i) {
+        const QByteArray& line = lines.at(i);
+        const qsizetype colon = line.indexOf(':');
+        if (colon <= 0) continue;
+        const QByteArray name = line.left(colon).trimmed().toLower();
+        const QByteArray value = line.mid(colon + 1).trimmed();
+        if (name == "content-range") {
+            head->contentRange = value;
+        } else if (name == "transfer-encoding") {
+            head->transferEncoding = value.toLower();
+        } else if (name == "etag") {
+            head->etag = value;
+        } else if (name == "last-modified") {
+            head->lastModified = value;
+        }
+    }
+    return true;
+}
+
+// Parse "bytes first-last/total"; total is -1 when the server sends "*".
+bool parseContentRange(const QByteArray& value, qint64* first, qint64* last, qint64* total)
+{
+    if (!value.startsWith("bytes ")) return false;
+    const QByteArray spec = value.mid(6).trimmed();
+    const qsizetype dash = spec.indexOf('-');
+    const qsizetype slash = spec.indexOf('/');
+    if (dash <= 0 || slash <= dash) return false;
+    bool okFirst = false;
+    bool okLast = false;
+    *first = spec.left(dash).toLongLong(&okFirst);
+    *last = spec.mid(dash + 1, slash - dash - 1).toLongLong(&okLast);
+    const QByteArray totalText = spec.mid(slash + 1);
+    *total = totalText == "*" ? -1 : totalText.toLongLong();
+    return okFirst && okLast && *first <= *last;
+}
+
+} // namespace
+
+struct RangeEngine::Transfer {
+    enum class Phase { Connecting, Sending, Head, Body, Done };
+
+    int id = 0;
+    Request request;
+    QObject* receiver = nullptr;
+    Handler handler;
+
+    // Guarded by the engine mutex.
+    bool cancelled = false;
+    qint64 to = 0;                          // last byte wanted
+    qint64 claimed = 0;                     // next byte not yet taken from the socket
+
+    // Touched by the engine thread only.
+    Phase phase = Phase::Connecting;
+    int sock = -1;
+    int pipeRead = -1;
+    int pipeWrite = -1;
+    int file = -1;
+    bool splice = true;
+    QByteArray out;
+    qint64 sent = 0;
+    QByteArray head;
+    QByteArray buffer;
+    int status = 0;
+    qint64 written = 0;                     // next byte not yet in the file
+    qint64 reported = 0;                    // end of what progress and onCommitted have seen
+    qint64 reportedMs = 0;
+    qint64 activeMs = 0;
+};
+
+RangeEngine& RangeEngine::instance()
+{
+    static RangeEngine engine;
+    return engine;
+}
+
+RangeEngine::RangeEngine() = default;
+
+bool RangeEngine::isSupported()
+{
+#if defined(Q_OS_LINUX)
+    return true;
+#else
+    return false;
+#endif
+}
+
+QByteArray RangeEngine::requestHead(const Request& request)
+{
+    QByteArray head;
+    head.reserve(512);
+    head += "GET " + (request.target.isEmpty() ? QByteArray("/") : request.target) + " HTTP/1.1\r\n";
+    head += "Host: " + request.host + "\r\n";
+    head += "Range: bytes=" + QByteArray::number(request.from) + '-' + QByteArray::number(request.to) + "\r\n";
+    if (!request.ifRange.isEmpty()) head += "If-Range: " + request.ifRange + "\r\n";
+    for (const auto& [name, value] : request.headers) {
+        const QByteArray lower = name.trimmed().toLower();
+        // Framing is the engine's business: an identity body on a connection used once.
+        if (lower == "host" || lower == "range" || lower == "if-range" || lower == "accept-encoding"
+            || lower == "connection" || lower == "te") {
+            continue;
+        }
+        head += name + ": " + value + "\r\n";
+    }
+    head += "Accept-Encoding: identity\r\nConnection: close\r\n\r\n";
+    return head;
+}
+
+#if defined(Q_OS_LINUX)
+
+RangeEngine::~RangeEngine()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_thread) return;
+        m_stopping = true;
+        wake();
+    }
+    m_thread->wait();
+    delete m_thread;
+    ::close(m_epollFd);
+    ::close(m_wakeFd);
+}
+
+void RangeEngine::wake()
+{
+    const std::uint64_t one = 1;
+    [[maybe_unused]] const ssize_t n = ::write(m_wakeFd, &one, sizeof(one));
+}
+
+int RangeEngine::start(Request request, QObject* receiver, Handler handler)
+{
+    auto t = std::make_shared<Transfer>();
+    t->receiver = receiver;
+    t->handler = std::move(handler);
+    t->to = request.to;
+    t->claimed = request.from;
+    t->written = request.from;
+    t->reported = request.from;
+    t->request = std::move(request);
+
+    QMutexLocker lock(&m_mutex);
+    if (!m_thread) {
+        m_epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        m_wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epoll_event ev {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = 0;
+        if (m_epollFd < 0 || m_wakeFd < 0 || ::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev) != 0) {
+            qWarning() << "Range engine setup failed:" << qt_error_string(errno);
+            if (m_epollFd >= 0) ::close(m_epollFd);
+            if (m_wakeFd >= 0) ::close(m_wakeFd);
+            m_epollFd = -1;
+            m_wakeFd = -1;
+            return 0;
+        }
+        m_thread = QThread::create([this] { run(); });
+        m_thread->setObjectName(QStringLiteral("raad-range-engine"));
+        m_thread->start();
+    }
+    t->id = m_nextId++;
+    m_transfers.insert(t->id, t);
+    m_incoming.append(t);
+    wake();
+    return t->id;
+}
+
+qint64 RangeEngine::shorten(int transfer, qint64 to)
+{
+    QMutexLocker lock(&m_mutex);
+    const std::shared_ptr<Transfer> t = m_transfers.value(transfer);
+    if (!t || t->cancelled) return -1;
+    t->to = qBound(t->claimed - 1, to, t->to);
+    // The transfer may already hold everything it now needs.
+    wake();
+    return t->to;
+}
+
+void RangeEngine::cancel(int transfer, bool wait)
+{
+    QMutexLocker lock(&m_mutex);
+    const std::shared_ptr<Transfer> t = m_transfers.value(transfer);
+    if (!t) return;
+    t->cancelled = true;
+    wake();
+    if (!wait) return;
+    while (m_transfers.contains(transfer)) {
+        m_dropped.wait(&m_mutex);
+    }
+}
+
+int RangeEngine::activeTransfers() const
+{
+    QMutexLocker lock(&m_mutex);
+    return static_cast<int>(m_transfers.size());
+}
+
+void RangeEngine::run()
+{
+    QHash<int, std::shared_ptr<Transfer>> live;
+    epoll_event events[kMaxEvents];
+
+    for (;;) {
+        const int ready = ::epoll_wait(m_epollFd, events, kMaxEvents, 1000);
+
+        QList<std::shared_ptr<Transfer>> incoming;
+        QList<std::shared_ptr<Transfer>> cancelled;
+        {
+            QMutexLocker lock(&m_mutex);
+            if (m_stopping) break;
+            incoming.swap(m_incoming);
+            for (const std::shared_ptr<Transfer>& t : std::as_const(live)) {
+                if (t->cancelled) cancelled.append(t);
+            }
+            for (const std::shared_ptr<Transfer>& t : std::as_const(incoming)) {
+                if (t->cancelled) cancelled.append(t);
+            }
+        }
+        for (const std::shared_ptr<Transfer>& t : std::as_const(cancelled)) {
+            drop(t->id);
+            t->phase = Transfer::Phase::Done;
+        }
+        for (const std::shared_ptr<Transfer>& t : std::as_const(incoming)) {
+            live.insert(t->id, t);
+            if (t->phase != Transfer::Phase::Done) open(*t);
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.u64 == 0) {
+                std::uint64_t count = 0;
+                [[maybe_unused]] const ssize_t n = ::read(m_wakeFd, &count, sizeof(count));
+                continue;
+            }
+            const std::shared_ptr<Transfer> t = live.value(static_cast<int>(events[i].data.u64));
+            if (!t || t->phase == Transfer::Phase::Done) continue;
+            drive(*t);
+        }
+
+        // Transfers shortened to what they already wrote, and silent ones, end here.
+        const qint64 now = nowMs();
+        for (const std::shared_ptr<Transfer>& t : std::as_const(live)) {
+            if (t->phase == Transfer::Phase::Done) continue;
+            if (t->phase == Transfer::Phase::Body) {
+                bool complete = false;
+                {
+                    QMutexLocker lock(&m_mutex);
+                    complete = t->claimed > t->to && t->written == t->claimed;
+                }
+                if (complete) {
+                    finish(*t, true);
+                    continue;
+                }
+            }
+            if (now - t->activeMs > kTimeoutMs) {
+                finish(*t, false, QStringLiteral("timeout"), QStringLiteral("No data for %1 s").arg(kTimeoutMs / 1000));
+            }
+        }
+        live.removeIf([](const auto& it) { return it.value()->phase == Transfer::Phase::Done; });
+    }
+
+    for (const std::shared_ptr<Transfer>& t : std::as_const(live)) {
+        if (t->phase != Transfer::Phase::Done) drop(t->id);
+    }
+}
+
+void RangeEngine::open(Transfer& t)
+{
+    t.activeMs = nowMs();
+    t.file = ::open(QFile::encodeName(t.request.path).constData(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (t.file < 0) {
+        finish(t, false, QStringLiteral("open_failed"), QStringLiteral("Cannot open output file: %1").arg(t.request.path));
+        return;
+    }
+
+    int fds[2] = { -1, -1 };
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0) {
+        t.pipeRead = fds[0];
+        t.pipeWrite = fds[1];
+        // A larger pipe moves more per splice; the default (64 KiB) still works if the limit refuses.
+        ::fcntl(t.pipeWrite, F_SETPIPE_SZ, static_cast<int>(kPipeSize));
+    } else {
+        t.splice = false;
+    }
+
+    sockaddr_storage address {};
+    socklen_t addressLength = 0;
+    if (t.request.address.protocol() == QAbstractSocket::IPv4Protocol) {
+        auto* in = reinterpret_cast<sockaddr_in*>(&address);
+        in->sin_family = AF_INET;
+        in->sin_port = htons(t.request.port);
+        in->sin_addr.s_addr = htonl(t.request.address.toIPv4Address());
+        addressLength = sizeof(sockaddr_in);
+    } else {
+        auto* in6 = reinterpret_cast<sockaddr_in6*>(&address);
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(t.request.port);
+        const Q_IPV6ADDR raw = t.request.address.toIPv6Address();
+        std::memcpy(&in6->sin6_addr, &raw, sizeof(raw));
+        addressLength = sizeof(sockaddr_in6);
+    }
+
+    t.sock = ::socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (t.sock < 0) {
+        finish(t, false, QStringLiteral("connect_failed"), qt_error_string(errno));
+        return;
+    }
+    const int one = 1;
+    ::setsockopt(t.sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    const int rc = ::connect(t.sock, reinterpret_cast<const sockaddr*>(&address), addressLength);
+    if (rc != 0 && errno != EINPROGRESS) {
+        finish(t, false, QStringLiteral("connect_failed"), qt_error_string(errno));
+        return;
+    }
+
+    t.out = requestHead(t.request);
+    t.phase = rc == 0 ? Transfer::Phase::Sending : Transfer::Phase::Connecting;
+    epoll_event ev {};
+    ev.events = EPOLLOUT;
+    ev.data.u64 = static_cast<std::uint64_t>(t.id);
+    if (::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, t.sock, &ev) != 0) {
+        finish(t, false, QStringLiteral("connect_failed"), qt_error_string(errno));
+    }
+}
+
+void RangeEngine::drive(Transfer& t)
+{
+    t.activeMs = nowMs();
+
+    if (t.phase == Transfer::Phase::Connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (::getsockopt(t.sock, SOL_SOCKET, SO_ERROR, &error, &length) != 0) error = errno;
+        if (error != 0) {
+            finish(t, false, QStringLiteral("connect_failed"), qt_error_string(error));
+            return;
+        }
+        t.phase = Transfer::Phase::Sending;
+    }
+
+    if (t.phase == Transfer::Phase::Sending) {
+        while (t.sent < t.out.size()) {
+            const ssize_t n = ::send(t.sock, t.out.constData() + t.sent, static_cast<size_t>(t.out.size() - t.sent), MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (n < 0) {
+                finish(t, false, QStringLiteral("network_error"), qt_error_string(errno));
+                return;
+            }
+            t.sent += n;
+        }
+        t.out.clear();
+        t.phase = Transfer::Phase::Head;
+        epoll_event ev {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.u64 = static_cast<std::uint64_t>(t.id);
+        ::epoll_ctl(m_epollFd, EPOLL_CTL_MOD, t.sock, &ev);
+        return;
+    }
+
+    if (t.phase == Transfer::Phase::Head && !readHead(t)) return;
+    if (t.phase == Transfer::Phase::Body) pumpBody(t);
+}
+
+bool RangeEngine::readHead(Transfer& t)
+{
+    char chunk[4096];
+    for (;;) {
+        const ssize_t n = ::recv(t.sock, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+        if (n < 0) {
+            finish(t, false, QStringLiteral("network_error"), qt_error_string(errno));
+            return false;
+        }
+        if (n == 0) {
+            finish(t, false, QStringLiteral("network_error"), QStringLiteral("Connection closed before the response head"));
+            return false;
+        }
+        t.head.append(chunk, n);
+        if (t.head.indexOf("\r\n\r\n") >= 0) break;
+        if (t.head.size() > kMaxHeaderBytes) {
+            finish(t, false, QStringLiteral("bad_response"), QStringLiteral("Response head too large"));
+            return false;
+        }
+    }
+
+    const qsizetype headEnd = t.head.indexOf("\r\n\r\n");
+    const QByteArray early = t.head.mid(headEnd + 4);
+    ResponseHead head;
+    if (!parseHead(t.head.left(headEnd), &head)) {
+        finish(t, false, QStringLiteral("bad_response"), QStringLiteral("Malformed response head"));
+        return false;
+    }
+    t.head.clear();
+    t.status = head.status;
+
+    Event headers;
+    headers.kind = EventKind::Headers;
+    headers.transfer = t.id;
+    headers.status = head.status;
+    headers.etag = head.etag;
+    headers.lastModified = head.lastModified;
+    post(t, headers);
+
+    if (head.status != 206) {
+        finish(t, false, QStringLiteral("range_refused"), QStringLiteral("HTTP status %1").arg(head.status));
+        return false;
+    }
+    qint64 first = -1;
+    qint64 last = -1;
+    qint64 total = -1;
+    if (!parseContentRange(head.contentRange, &first, &last, &total) || first != t.request.from
+        || last < t.request.to || (t.request.totalSize > 0 && total >= 0 && total != t.request.totalSize)) {
+        finish(t, false, QStringLiteral("range_mismatch"), QStringLiteral("Unexpected Content-Range: %1")
+                                                                .arg(QString::fromLatin1(head.contentRange)));
+        return false;
+    }
+    if (!head.transferEncoding.isEmpty() && head.transferEncoding != "identity") {
+        finish(t, false, QStringLiteral("bad_response"), QStringLiteral("Transfer-Encoding %1 not supported")
+                                                              .arg(QString::fromLatin1(head.transferEncoding)));
+        return false;
+    }
+
+    t.phase = Transfer::Phase::Body;
+    if (!early.isEmpty()) {
+        // Body bytes that arrived with the head are already in user space.
+        qint64 take = 0;
+        {
+            QMutexLocker lock(&m_mutex);
+            take = qBound<qint64>(0, t.to + 1 - t.claimed, early.size());
+            t.claimed += take;
+        }
+        if (take > 0 && !writeCopied(t, early.constData(), take)) return false;
+    }
+    return true;
+}
+
+bool RangeEngine::pumpBody(Transfer& t)
+{
+    qint64 moved = 0;
+    while (moved < kTurnBytes) {
+        // Claim under the lock so shorten() never cuts below bytes already taken from the socket.
+        qint64 want = 0;
+        {
+            QMutexLocker lock(&m_mutex);
+            want = qBound<qint64>(0, t.to + 1 - t.claimed, t.splice ? kPipeSize : kCopyBuffer);
+            t.claimed += want;
+        }
+        if (want <= 0) {
+            finish(t, true);
+            return false;
+        }
+
+        ssize_t got = 0;
+        if (t.splice) {
+            got = ::splice(t.sock, nullptr, t.pipeWrite, nullptr, static_cast<size_t>(want), SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        } else {
+            if (t.buffer.isEmpty()) t.buffer.resize(kCopyBuffer);
+            got = ::recv(t.sock, t.buffer.data(), static_cast<size_t>(want), 0);
+        }
+        const int error = errno;
+        if (got < want) {
+            QMutexLocker lock(&m_mutex);
+            t.claimed -= want - qMax<qint64>(0, got);
+        }
+        if (got < 0) {
+            if (error == EINTR) continue;
+            if (error == EAGAIN || error == EWOULDBLOCK) break;
+            if (t.splice && error == EINVAL) {
+                // Socket types that cannot splice (e.g. under some sandboxes) take the copy path.
+                t.splice = false;
+                continue;
+            }
+            finish(t, false, QStringLiteral("network_error"), qt_error_string(error));
+            return false;
+        }
+        if (got == 0) {
+            finish(t, false, QStringLiteral("network_error"), QStringLiteral("Connection closed before the range ended"));
+            return false;
+        }
+
+        if (!t.splice) {
+            if (!writeCopied(t, t.buffer.constData(), got)) return false;
+        } else {
+            qint64 left = got;
+            while (left > 0) {
+                loff_t offset = static_cast<loff_t>(t.request.fileOffset + (t.written - t.request.from));
+                const ssize_t n = ::splice(t.pipeRead, nullptr, t.file, &offset, static_cast<size_t>(left), SPLICE_F_MOVE);
+                if (n < 0 && errno == EINTR) continue;
+                if (n > 0) {
+                    t.written += n;
+                    m_spliced += n;
+                    left -= n;
+                    continue;
+                }
+                if (n < 0 && errno != EINVAL) {
+                    finish(t, false, QStringLiteral("write_failed"), qt_error_string(errno));
+                    return false;
+                }
+                // The filesystem cannot splice: copy what sits in the pipe and stop splicing.
+                t.splice = false;
+                if (t.buffer.isEmpty()) t.buffer.resize(kCopyBuffer);
+                while (left > 0) {
+                    const ssize_t r = ::read(t.pipeRead, t.buffer.data(), static_cast<size_t>(qMin(left, kCopyBuffer)));
+                    if (r < 0 && errno == EINTR) continue;
+                    if (r <= 0) {
+                        finish(t, false, QStringLiteral("write_failed"), qt_error_string(errno));
+                        return false;
+                    }
+                    if (!writeCopied(t, t.buffer.constData(), r)) return false;
+                    left -= r;
+                }
+            }
+        }
+        moved += got;
+    }
+    report(t, false);
+    return true;
+}
+
+bool RangeEngine::writeCopied(Transfer& t, const char* data, qint64 size)
+{
+    while (size > 0) {
+        const off_t offset = static_cast<off_t>(t.request.fileOffset + (t.written - t.request.from));
+        const ssize_t n = ::pwrite(t.file, data, static_cast<size_t>(size), offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            finish(t, false, QStringLiteral("write_failed"),
+                   n < 0 ? qt_error_string(errno) : QStringLiteral("No space left on device"));
+            return false;
+        }
+        t.written += n;
+        m_copied += n;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+void RangeEngine::report(Transfer& t, bool force)
+{
+    const qint64 pending = t.written - t.reported;
+    if (pending <= 0) return;
+    const qint64 now = nowMs();
+    if (!force && pending < kReportBytes && now - t.reportedMs < kReportMs) return;
+
+    if (t.request.onCommitted) t.request.onCommitted(t.reported, pending);
+    t.reported = t.written;
+    t.reportedMs = now;
+
+    Event progress;
+    progress.kind = EventKind::Progress;
+    progress.transfer = t.id;
+    progress.status = t.status;
+    progress.bytes = t.written - t.request.from;
+    post(t, progress);
+}
+
+void RangeEngine::finish(Transfer& t, bool ok, const QString& code, const QString& message)
+{
+    if (t.phase == Transfer::Phase::Done) return;
+    report(t, true);
+
+    Event done;
+    done.kind = EventKind::Finished;
+    done.transfer = t.id;
+    done.status = t.status;
+    done.bytes = t.written - t.request.from;
+    done.ok = ok;
+    done.errorCode = code;
+    done.errorMessage = message;
+    post(t, done);
+
+    t.phase = Transfer::Phase::Done;
+    drop(t.id);
+}
+
+void RangeEngine::post(const Transfer& t, Event event)
+{
+    QMutexLocker lock(&m_mutex);
+    if (t.cancelled || !t.receiver) return;
+    QMetaObject::invokeMethod(t.receiver,
+                              [handler = t.handler, event = std::move(event)]() { handler(event); },
+                              Qt::QueuedConnection);
+}
+
+void RangeEngine::drop(int transfer)
+{
+    QMutexLocker lock(&m_mutex);
+    const std::shared_ptr<Transfer> t = m_transfers.take(transfer);
+    if (t) {
+        // Closing the socket also takes it out of the epoll set.
+        for (int* fd : { &t->sock, &t->pipeRead, &t->pipeWrite, &t->file }) {
+            if (*fd >= 0) ::close(*fd);
+            *fd = -1;
+        }
+    }
+    m_dropped.wakeAll();
+}
+
+#else
+
+RangeEngine::~RangeEngine() = default;
+
+int RangeEngine::start(Request request, QObject* receiver, Handler handler)
+{
+    Q_UNUSED(request);
+    Q_UNUSED(receiver);
+    Q_UNUSED(handler);
+    return 0;
+}
+
+qint64 RangeEngine::shorten(int transfer, qint64 to)
+{
+    Q_UNUSED(transfer);
+    Q_UNUSED(to);
+    return -1;
+}
+
+void RangeEngine::cancel(int transfer, bool wait)
+{
+    Q_UNUSED(transfer);
+    Q_UNUSED(wait);
+}
+
+int RangeEngine::activeTransfers() const
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,209 @@
+/*!
+ * @file        rangeengine.cppm
+ * @brief       Native HTTP/1.1 range transport for plain-HTTP segments.
+ * @details     The Qt network stack copies every byte several times on its
+ *              way to disk: socket, reply buffer, read buffer, segment ring,
+ *              writer job. For plain-HTTP sources (LAN mirrors, caches,
+ *              TLS-terminating proxies on the local network) that copying is
+ *              the bottleneck long before the link is.
+ *
+ *              This engine runs one epoll thread that drives minimal HTTP/1.1
+ *              range requests. Body bytes move from the socket into a pipe and
+ *              from the pipe into the target file with splice(), so they never
+ *              enter user space; filesystems that cannot splice fall back to
+ *              read()/pwrite() per transfer. Only byte-range answers (206 with
+ *              the requested Content-Range and no transfer coding) are
+ *              accepted; anything else fails the transfer so the caller can
+ *              retry it through Qt.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QWaitCondition>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#ifndef Q_MOC_RUN
+export module raad.core.rangeengine;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+class QThread;
+
+/**
+ * @brief Process-wide epoll/splice transport for ranged GET requests.
+ *
+ * Transfers are started, shortened and cancelled from any thread; events are
+ * delivered on the receiver's thread through a queued call and stop as soon
+ * as cancel() returns. Only available on Linux (see isSupported()).
+ */
+RAAD_MODULE_EXPORT class RangeEngine {
+public:
+    static constexpr qint64 kPipeSize = 1024 * 1024;        //!< Pipe capacity asked for per transfer.
+    static constexpr qint64 kReportBytes = 1024 * 1024;     //!< Committed bytes between progress events.
+    static constexpr qint64 kReportMs = 100;                //!< Longest gap between progress events.
+    static constexpr qint64 kTimeoutMs = 30000;             //!< Silence after which a transfer fails.
+    static constexpr qint64 kMaxHeaderBytes = 64 * 1024;    //!< Largest response head accepted.
+
+    /**
+     * @brief One ranged GET and where its body goes.
+     */
+    struct Request {
+        QHostAddress address;               //!< Resolved server address.
+        quint16 port = 80;                  //!< Server port.
+        QByteArray target;                  //!< Request target (path and query).
+        QByteArray host;                    //!< Host header value.
+        QList<QPair<QByteArray, QByteArray>> headers;   //!< Extra headers (Range and framing are added).
+        QByteArray ifRange;                 //!< If-Range validator (empty = none).
+        qint64 from = 0;                    //!< First byte asked for.
+        qint64 to = 0;                      //!< Last byte asked for (inclusive).
+        qint64 totalSize = 0;               //!< Expected resource size (0 = unchecked).
+        QString path;                       //!< File receiving the body.
+        qint64 fileOffset = 0;              //!< File position of byte @c from.
+        std::function<void(qint64 offset, qint64 length)> onCommitted;  //!< Runs on the engine thread once a stretch is in the file.
+    };
+
+    /**
+     * @brief Kind of event reported for a transfer.
+     */
+    enum class EventKind {
+        Headers,    //!< The response head arrived (sent before it is judged).
+        Progress,   //!< More bytes reached the file.
+        Finished    //!< The transfer ended; no further events follow.
+    };
+
+    /**
+     * @brief Transfer event, delivered on the receiver's thread.
+     */
+    struct Event {
+        EventKind kind = EventKind::Progress;   //!< Event kind.
+        int transfer = 0;                   //!< Transfer id.
+        int status = 0;                     //!< HTTP status (0 before the head arrived).
+        QByteArray etag;                    //!< ETag of the response.
+        QByteArray lastModified;            //!< Last-Modified of the response.
+        qint64 bytes = 0;                   //!< Bytes written to the file so far.
+        bool ok = false;                    //!< Finished only: every byte up to the end arrived.
+        QString errorCode;                  //!< Finished only: structured error code on failure.
+        QString errorMessage;               //!< Finished only: human-readable error on failure.
+    };
+
+    using Handler = std::function<void(const Event&)>;
+
+    //!< @brief Return the shared engine.
+    static RangeEngine& instance();
+
+    RangeEngine(const RangeEngine&) = delete;
+    RangeEngine& operator=(const RangeEngine&) = delete;
+
+    //!< @brief Whether this platform has the engine (Linux only).
+    static bool isSupported();
+
+    //!< @brief Return the request head sent for @p request.
+    static QByteArray requestHead(const Request& request);
+
+    /**
+     * @brief Start a transfer.
+     * @param request What to fetch and where to put it.
+     * @param receiver Object whose thread receives events.
+     * @param handler Event callback.
+     * @return Transfer id (> 0), or 0 when the engine is not supported.
+     */
+    int start(Request request, QObject* receiver, Handler handler);
+
+    /**
+     * @brief Move the end of a running transfer down.
+     *
+     * Bytes already taken from the socket are still written, so the end
+     * cannot go below them.
+     *
+     * @param transfer Transfer id.
+     * @param to New last byte wanted (inclusive).
+     * @return The transfer's last byte from now on, or -1 if it has already ended.
+     */
+    qint64 shorten(int transfer, qint64 to);
+
+    /**
+     * @brief Stop a transfer; no events are delivered for it afterwards.
+     * @param transfer Transfer id.
+     * @param wait Block until the engine has closed the transfer's file.
+     */
+    void cancel(int transfer, bool wait = false);
+
+    //!< @brief Return the number of transfers not yet finished or cancelled.
+    int activeTransfers() const;
+
+    //!< @brief Return body bytes moved to disk with splice() since start.
+    qint64 splicedBytes() const { return m_spliced.load(); }
+
+    //!< @brief Return body bytes moved to disk through a user-space buffer since start.
+    qint64 copiedBytes() const { return m_copied.load(); }
+
+private:
+    struct Transfer;
+
+    RangeEngine();
+    ~RangeEngine();
+
+    //!< @brief Engine thread main loop.
+    void run();
+
+    //!< @brief Wake the engine thread.
+    void wake();
+
+    //!< @brief Connect a new transfer and register it with epoll (engine thread).
+    void open(Transfer& t);
+
+    //!< @brief Advance a transfer after epoll reported its socket (engine thread).
+    void drive(Transfer& t);
+
+    //!< @brief Read and check the response head (engine thread).
+    bool readHead(Transfer& t);
+
+    //!< @brief Move body bytes to the file until the socket runs dry (engine thread).
+    bool pumpBody(Transfer& t);
+
+    //!< @brief Write bytes already in user space to the file (engine thread).
+    bool writeCopied(Transfer& t, const char* data, qint64 size);
+
+    //!< @brief Report committed bytes if enough accumulated, or always when @p force.
+    void report(Transfer& t, bool force);
+
+    //!< @brief End a transfer, deliver Finished and release its resources (engine thread).
+    void finish(Transfer& t, bool ok, const QString& code = QString(), const QString& message = QString());
+
+    //!< @brief Queue an event for the transfer's receiver unless it was cancelled.
+    void post(const Transfer& t, Event event);
+
+    //!< @brief Close a transfer's descriptors and forget it (engine thread).
+    void drop(int transfer);
+
+    mutable QMutex m_mutex;                                 //!< Guards every member below except the counters.
+    QWaitCondition m_dropped;                               //!< Signalled when the engine forgets a transfer.
+    QHash<int, std::shared_ptr<Transfer>> m_transfers;      //!< Transfers not yet dropped, by id.
+    QList<std::shared_ptr<Transfer>> m_incoming;            //!< Started, not yet picked up by the engine thread.
+    QThread* m_thread = nullptr;                            //!< Engine thread (started on first use).
+    int m_epollFd = -1;                                     //!< epoll instance.
+    int m_wakeFd = -1;                                      //!< eventfd used by wake().
+    int m_nextId = 1;                                       //!< Next transfer id.
+    bool m_stopping = false;                                //!< Set by the destructor.
+    std::atomic<qint64> m_spliced { 0 };                    //!< Bytes moved with splice().
+    std::atomic<qint64> m_copied { 0 };                     //!< Bytes moved with read()/pwrite().
+};
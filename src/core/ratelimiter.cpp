@@ -0,0 +1,239 @@
+module;
+#include <QCoreApplication>
+#include <QtGlobal>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+module raad.core.ratelimiter;
+
+RateLimiter& RateLimiter::instance()
+{
+    static RateLimiter limiter;
+    return limiter;
+}
+
+RateLimiter::RateLimiter()
+{
+    m_clock.start();
+}
+
+QTimer* RateLimiter::timer()
+{
+    if (m_timer) return m_timer;
+    QCoreApplication* app = QCoreApplication::instance();
+    if (!app) return nullptr;
+    // The limiter is a function-local static that outlives the application; parenting the timer
+    // to it stops and destroys the timer with the event loop instead of during static teardown.
+    m_timer = new QTimer(app);
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    QObject::connect(m_timer, &QTimer::timeout, m_timer, [this] { wakeDue(); });
+    return m_timer;
+}
+
+int RateLimiter::createNode(int parent)
+{
+    const int id = m_nextNode++;
+    Node node;
+    node.parent = m_nodes.contains(parent) ? parent : 0;
+    m_nodes.insert(id, node);
+    return id;
+}
+
+void RateLimiter::removeNode(int node)
+{
+    auto it = m_nodes.find(node);
+    if (it == m_nodes.end()) return;
+    const int parent = it->parent;
+    m_nodes.erase(it);
+    for (Node& child : m_nodes) {
+        if (child.parent == node) child.parent = parent;
+    }
+    std::erase_if(m_waiters, [node](const Waiter& w) { return w.node == node; });
+    schedule();
+}
+
+void RateLimiter::setParent(int node, int parent)
+{
+    auto it = m_nodes.find(node);
+    if (it == m_nodes.end()) return;
+    if (!m_nodes.contains(parent)) parent = 0;
+    // Refuse anything that would make the node its own ancestor.
+    for (int id = parent; id != 0; id = m_nodes.value(id).parent) {
+        if (id == node) return;
+    }
+    if (it->parent == parent) return;
+    it->parent = parent;
+    schedule();
+}
+
+void RateLimiter::setRate(int node, qint64 bytesPerSecond)
+{
+    auto it = m_nodes.find(node);
+    if (it == m_nodes.end()) return;
+    bytesPerSecond = qMax<qint64>(0, bytesPerSecond);
+    if (it->rate == bytesPerSecond) return;
+    const qint64 now = m_clock.nsecsElapsed();
+    if (it->rate > 0) {
+        refill(*it, now);
+        it->tokens = qMin(it->tokens, capacityFor(bytesPerSecond));
+    } else {
+        // A freshly applied limit starts empty so it takes effect immediately.
+        it->tokens = 0.0;
+    }
+    it->rate = bytesPerSecond;
+    it->stampNs = now;
+    schedule();
+}
+
+qint64 RateLimiter::rate(int node) const
+{
+    return m_nodes.value(node).rate;
+}
+
+bool RateLimiter::limited(int node) const
+{
+    for (auto it = m_nodes.constFind(node); it != m_nodes.cend(); it = m_nodes.constFind(it->parent)) {
+        if (it->rate > 0) return true;
+    }
+    return false;
+}
+
+double RateLimiter::capacityFor(qint64 rate)
+{
+    // About 100 ms of traffic, enough to absorb timer jitter without allowing long bursts.
+    return static_cast<double>(qMax<qint64>(kMinBurst, rate / 10));
+}
+
+void RateLimiter::refill(Node& node, qint64 nowNs)
+{
+    if (node.rate <= 0) return;
+    const qint64 elapsed = nowNs - node.stampNs;
+    if (elapsed <= 0) return;
+    node.tokens = qMin(capacityFor(node.rate), node.tokens + static_cast<double>(node.rate) * elapsed / 1e9);
+    node.stampNs = nowNs;
+}
+
+qint64 RateLimiter::acquire(int node, qint64 want)
+{
+    if (want <= 0) return 0;
+    const qint64 now = m_clock.nsecsElapsed();
+
+    std::vector<Node*> limited;
+    double available = std::numeric_limits<double>::max();
+    qint64 slowest = 0;
+    for (auto it = m_nodes.find(node); it != m_nodes.end(); it = m_nodes.find(it->parent)) {
+        if (it->rate <= 0) continue;
+        refill(*it, now);
+        limited.push_back(&*it);
+        available = qMin(available, it->tokens);
+        slowest = slowest > 0 ? qMin(slowest, it->rate) : it->rate;
+    }
+    if (limited.empty()) return want;
+
+    // Wait for a useful amount rather than trickling tiny writes.
+    if (available < static_cast<double>(qMin(want, kMinGrant))) return 0;
+
+    // Cap each grant at ~20 ms of the tightest rate so siblings interleave.
+    const qint64 quantum = qMax<qint64>(kMinGrant, slowest / 50);
+    const qint64 grant = qMin(qMin(want, quantum), static_cast<qint64>(available));
+    for (Node* n : limited) {
+        n->tokens -= static_cast<double>(grant);
+    }
+    return grant;
+}
+
+void RateLimiter::refund(int node, qint64 bytes)
+{
+    if (bytes <= 0) return;
+    for (auto it = m_nodes.find(node); it != m_nodes.end(); it = m_nodes.find(it->parent)) {
+        if (it->rate <= 0) continue;
+        it->tokens = qMin(capacityFor(it->rate), it->tokens + static_cast<double>(bytes));
+    }
+    schedule();
+}
+
+void RateLimiter::waitFor(int node, qint64 want, QObject* context, int key, Wake wake)
+{
+    if (!context || !wake) return;
+    for (Waiter& w : m_waiters) {
+        if (w.context == context && w.key == key) {
+            w.node = node;
+            w.want = want;
+            w.wake = std::move(wake);
+            schedule();
+            return;
+        }
+    }
+    Waiter waiter;
+    waiter.node = node;
+    waiter.want = want;
+    waiter.context = context;
+    waiter.key = key;
+    waiter.wake = std::move(wake);
+    m_waiters.push_back(std::move(waiter));
+    schedule();
+}
+
+void RateLimiter::cancelWaits(QObject* context)
+{
+    std::erase_if(m_waiters, [context](const Waiter& w) { return w.context.isNull() || w.context == context; });
+    schedule();
+}
+
+qint64 RateLimiter::delayNs(const Waiter& waiter, qint64 nowNs)
+{
+    const double needed = static_cast<double>(qMin(qMax<qint64>(1, waiter.want), kMinGrant));
+    qint64 delay = 0;
+    for (auto it = m_nodes.find(waiter.node); it != m_nodes.end(); it = m_nodes.find(it->parent)) {
+        if (it->rate <= 0) continue;
+        refill(*it, nowNs);
+        const double deficit = needed - it->tokens;
+        if (deficit > 0.0) {
+            delay = qMax(delay, static_cast<qint64>(std::ceil(deficit * 1e9 / it->rate)));
+        }
+    }
+    return delay;
+}
+
+void RateLimiter::schedule()
+{
+    if (m_waiters.empty()) {
+        if (m_timer) m_timer->stop();
+        return;
+    }
+    QTimer* wakeTimer = timer();
+    if (!wakeTimer) return;
+    const qint64 now = m_clock.nsecsElapsed();
+    qint64 earliest = std::numeric_limits<qint64>::max();
+    for (const Waiter& w : m_waiters) {
+        earliest = qMin(earliest, delayNs(w, now));
+        if (earliest == 0) break;
+    }
+    wakeTimer->start(static_cast<int>(qBound<qint64>(0, (earliest + 999999) / 1000000, std::numeric_limits<int>::max())));
+}
+
+void RateLimiter::wakeDue()
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    std::vector<Waiter> due;
+    for (auto it = m_waiters.begin(); it != m_waiters.end();) {
+        if (it->context.isNull()) {
+            it = m_waiters.erase(it);
+        } else if (delayNs(*it, now) == 0) {
+            due.push_back(std::move(*it));
+            it = m_waiters.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // Waking does not reserve tokens: the first caller takes them and the rest park again
+    // at the back, which rotates access fairly among siblings.
+    for (Waiter& w : due) {
+        if (w.context) w.wake();
+    }
+    schedule();
+}
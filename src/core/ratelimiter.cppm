@@ -0,0 +1,162 @@
+/*!
+ * @file        ratelimiter.cppm
+ * @brief       Hierarchical token buckets for download speed limits.
+ * @details     Speed limits form a tree: a global node, one node per queue
+ *              and one node per task. A transfer may move bytes only when
+ *              every limited node on its path to the root holds tokens, and
+ *              the grant is deducted from all of them, so a parent caps the
+ *              sum of its children. Tokens left unused by an idle or slow
+ *              child stay in the parent and are taken by its siblings.
+ *
+ *              Callers that find no tokens park a wake-up instead of polling;
+ *              one precise timer fires when the earliest parked caller can
+ *              proceed.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <deque>
+#include <functional>
+
+#ifndef Q_MOC_RUN
+export module raad.core.ratelimiter;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+/**
+ * @brief Process-wide tree of token buckets.
+ *
+ * Nodes are addressed by positive integer ids; id 0 means "no parent". A node
+ * with rate 0 is unlimited and only forwards to its parent. Not thread-safe:
+ * use it from the thread that runs the download engine.
+ */
+RAAD_MODULE_EXPORT class RateLimiter {
+public:
+    using Wake = std::function<void()>;
+
+    static constexpr qint64 kMinBurst = 64 * 1024;              //!< Smallest bucket capacity.
+    static constexpr qint64 kMinGrant = 16 * 1024;              //!< Smallest grant worth waiting for.
+
+    //!< @brief Return the shared limiter.
+    static RateLimiter& instance();
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    /**
+     * @brief Create an unlimited node.
+     * @param parent Parent node id (0 = root).
+     * @return New node id.
+     */
+    int createNode(int parent = 0);
+
+    /**
+     * @brief Remove a node; its children move to its parent and its waiters are dropped.
+     * @param node Node id.
+     */
+    void removeNode(int node);
+
+    /**
+     * @brief Attach a node to a different parent.
+     * @param node Node id.
+     * @param parent New parent id (0 = root).
+     */
+    void setParent(int node, int parent);
+
+    /**
+     * @brief Set the refill rate of a node.
+     * @param node Node id.
+     * @param bytesPerSecond Rate in bytes/sec (0 = unlimited).
+     */
+    void setRate(int node, qint64 bytesPerSecond);
+
+    //!< @brief Return the refill rate of a node (0 = unlimited).
+    qint64 rate(int node) const;
+
+    //!< @brief Whether a node or any of its ancestors has a rate set.
+    bool limited(int node) const;
+
+    /**
+     * @brief Take up to @p want bytes worth of tokens along the path to the root.
+     * @param node Leaf node id.
+     * @param want Bytes the caller would like to move.
+     * @return Bytes granted (0 = wait; @p want when no limit applies).
+     */
+    qint64 acquire(int node, qint64 want);
+
+    /**
+     * @brief Give back tokens taken by acquire() that were not used.
+     * @param node Leaf node id.
+     * @param bytes Bytes to return.
+     */
+    void refund(int node, qint64 bytes);
+
+    /**
+     * @brief Call @p wake once a grant for @p want bytes is likely to succeed.
+     * @param node Leaf node id.
+     * @param want Bytes the caller would like to move.
+     * @param context Owner; the wake-up is skipped when it has been destroyed.
+     * @param key Caller-chosen key; a pending wait with the same context and key is replaced.
+     * @param wake Callback invoked on the limiter's thread.
+     */
+    void waitFor(int node, qint64 want, QObject* context, int key, Wake wake);
+
+    //!< @brief Drop every pending wait owned by @p context.
+    void cancelWaits(QObject* context);
+
+private:
+    RateLimiter();
+
+    struct Node {
+        int parent = 0;                     //!< Parent id (0 = root).
+        qint64 rate = 0;                    //!< Refill rate in bytes/sec (0 = unlimited).
+        double tokens = 0.0;                //!< Available bytes.
+        qint64 stampNs = 0;                 //!< Clock reading of the last refill.
+    };
+
+    struct Waiter {
+        int node = 0;                       //!< Leaf node waited on.
+        qint64 want = 0;                    //!< Bytes requested.
+        QPointer<QObject> context;          //!< Owner of the wake-up.
+        int key = 0;                        //!< Deduplication key.
+        Wake wake;                          //!< Callback.
+    };
+
+    //!< @brief Return the bucket capacity for a rate.
+    static double capacityFor(qint64 rate);
+
+    //!< @brief Add tokens accrued since the node's last refill.
+    void refill(Node& node, qint64 nowNs);
+
+    //!< @brief Return nanoseconds until a wait can proceed (0 = now).
+    qint64 delayNs(const Waiter& waiter, qint64 nowNs);
+
+    //!< @brief Return the wake-up timer, creating it on first use (nullptr without an application).
+    QTimer* timer();
+
+    //!< @brief Arm the timer for the earliest waiter.
+    void schedule();
+
+    //!< @brief Run every waiter that can proceed, in arrival order.
+    void wakeDue();
+
+    QHash<int, Node> m_nodes;               //!< Nodes by id.
+    int m_nextNode = 1;                     //!< Next node id.
+    std::deque<Waiter> m_waiters;           //!< Parked callers in arrival order.
+    QElapsedTimer m_clock;                  //!< Monotonic refill clock.
+    QPointer<QTimer> m_timer;               //!< Fires for the earliest waiter; owned by the application.
+};
@@ -0,0 +1,90 @@
+module;
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <set>
+
+module raad.core.readyqueue;
+
+void ReadyQueue::update(Id id, Status status, const QString& queue, const QString& host, int priority, qint64 order)
+{
+    if (id < 0) return;
+    if (id >= m_records.size()) m_records.resize(id + 1);
+    Record next;
+    next.status = status;
+    if (status != Status::None) {
+        next.queue = queue;
+        next.host = host;
+        next.priority = priority;
+        next.order = order;
+    }
+    Record& current = m_records[id];
+    if (current.status == next.status && current.queue == next.queue && current.host == next.host
+        && current.priority == next.priority && current.order == next.order) {
+        return;
+    }
+    detach(id, current);
+    current = next;
+    attach(id, current);
+}
+
+void ReadyQueue::remove(Id id)
+{
+    update(id, Status::None, QString(), QString(), 0, 0);
+}
+
+void ReadyQueue::clear()
+{
+    m_records.clear();
+    m_lanes.clear();
+    m_runningPerQueue.clear();
+    m_runningPerHost.clear();
+    m_running = 0;
+    m_readyCount = 0;
+}
+
+void ReadyQueue::detach(Id id, const Record& record)
+{
+    if (record.status == Status::Running) {
+        --m_running;
+        if (--m_runningPerQueue[record.queue] <= 0) m_runningPerQueue.remove(record.queue);
+        if (!record.host.isEmpty() && --m_runningPerHost[record.host] <= 0) m_runningPerHost.remove(record.host);
+        return;
+    }
+    if (record.status != Status::Ready) return;
+
+    const Entry entry {record.priority, record.order, id};
+    Lane& lane = m_lanes[record.queue];
+    std::set<Entry>& tasks = lane.byHost[record.host];
+    const bool wasHead = !tasks.empty() && *tasks.begin() == entry;
+    tasks.erase(entry);
+    if (wasHead) {
+        lane.heads.erase(entry);
+        if (!tasks.empty()) lane.heads.insert(*tasks.begin());
+    }
+    if (tasks.empty()) lane.byHost.remove(record.host);
+    if (lane.heads.empty()) m_lanes.remove(record.queue);
+    --m_readyCount;
+}
+
+void ReadyQueue::attach(Id id, const Record& record)
+{
+    if (record.status == Status::Running) {
+        ++m_running;
+        ++m_runningPerQueue[record.queue];
+        if (!record.host.isEmpty()) ++m_runningPerHost[record.host];
+        return;
+    }
+    if (record.status != Status::Ready) return;
+
+    const Entry entry {record.priority, record.order, id};
+    Lane& lane = m_lanes[record.queue];
+    std::set<Entry>& tasks = lane.byHost[record.host];
+    if (tasks.empty() || entry < *tasks.begin()) {
+        if (!tasks.empty()) lane.heads.erase(*tasks.begin());
+        lane.heads.insert(entry);
+    }
+    tasks.insert(entry);
+    ++m_readyCount;
+}
@@ -0,0 +1,161 @@
+/*!
+ * @file        readyqueue.cppm
+ * @brief       Indexed ready set and running counters for the download scheduler.
+ * @details     The scheduler used to scan every task to count running ones and
+ *              then rescan every idle task for each free slot. The ready queue
+ *              instead keeps idle tasks ordered by (priority, creation order)
+ *              per queue and, inside a queue, per host: each host contributes
+ *              only its best task to the queue's head set. Picking the next
+ *              task walks the head set and skips hosts that may not start
+ *              another transfer, so it costs O(log n) plus the number of
+ *              blocked hosts. Running counts per queue and per host are kept
+ *              up to date as tasks change state instead of being recounted.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <set>
+
+#ifndef Q_MOC_RUN
+export module raad.core.readyqueue;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+/**
+ * @brief Scheduler index of ready and running tasks.
+ *
+ * Tasks are identified by small dense ids (task registry rows). The owner
+ * reports every change of a task's status, queue, host or priority through
+ * update(). Not thread-safe: use it from the thread that runs the download
+ * engine.
+ */
+RAAD_MODULE_EXPORT class ReadyQueue {
+public:
+    using Id = int;
+    static constexpr Id kNone = -1;         //!< No task.
+
+    /**
+     * @brief Scheduling status of a task.
+     */
+    enum class Status {
+        None,       //!< Neither waiting nor running (paused, finished, unknown).
+        Ready,      //!< Idle and waiting for a slot.
+        Running     //!< Holding a slot.
+    };
+
+    /**
+     * @brief Record a task's current scheduling inputs.
+     * @param id Task id.
+     * @param status Scheduling status.
+     * @param queue Queue name.
+     * @param host Normalized host (empty = not host-limited).
+     * @param priority Priority; higher starts first.
+     * @param order Creation order; lower starts first among equal priorities.
+     */
+    void update(Id id, Status status, const QString& queue, const QString& host, int priority, qint64 order);
+
+    //!< @brief Forget a task.
+    void remove(Id id);
+
+    //!< @brief Forget every task.
+    void clear();
+
+    //!< @brief Return a task's status.
+    Status status(Id id) const { return id >= 0 && id < m_records.size() ? m_records.at(id).status : Status::None; }
+
+    //!< @brief Return the host a task was recorded with.
+    QString host(Id id) const { return id >= 0 && id < m_records.size() ? m_records.at(id).host : QString(); }
+
+    //!< @brief Return the priority a task was recorded with.
+    int priority(Id id) const { return m_records.at(id).priority; }
+
+    //!< @brief Return the creation order a task was recorded with.
+    qint64 order(Id id) const { return m_records.at(id).order; }
+
+    //!< @brief Return the number of running tasks.
+    int running() const { return m_running; }
+
+    //!< @brief Return the number of running tasks in a queue.
+    int runningInQueue(const QString& queue) const { return m_runningPerQueue.value(queue, 0); }
+
+    //!< @brief Return the number of running tasks on a host.
+    int runningOnHost(const QString& host) const { return m_runningPerHost.value(host, 0); }
+
+    //!< @brief Return the number of ready tasks.
+    int readyCount() const { return m_readyCount; }
+
+    //!< @brief Return the queues that have ready tasks.
+    QStringList readyQueues() const { return m_lanes.keys(); }
+
+    /**
+     * @brief Return the best ready task of a queue whose host is allowed to start.
+     * @param queue Queue name.
+     * @param hostAllowed Predicate called with a host name.
+     * @return Task id, or kNone.
+     */
+    template <typename HostAllowed>
+    Id best(const QString& queue, HostAllowed&& hostAllowed) const
+    {
+        const auto lane = m_lanes.constFind(queue);
+        if (lane == m_lanes.cend()) return kNone;
+        for (const Entry& head : lane->heads) {
+            if (hostAllowed(m_records.at(head.id).host)) return head.id;
+        }
+        return kNone;
+    }
+
+private:
+    struct Entry {
+        int priority = 0;                   //!< Task priority.
+        qint64 order = 0;                   //!< Creation order.
+        Id id = kNone;                      //!< Task id.
+
+        //!< Higher priority first, then older tasks.
+        bool operator<(const Entry& other) const
+        {
+            if (priority != other.priority) return priority > other.priority;
+            if (order != other.order) return order < other.order;
+            return id < other.id;
+        }
+        bool operator==(const Entry& other) const { return id == other.id && priority == other.priority && order == other.order; }
+    };
+
+    struct Lane {
+        QHash<QString, std::set<Entry>> byHost;     //!< Ready tasks of each host.
+        std::set<Entry> heads;                      //!< Best ready task of each host.
+    };
+
+    struct Record {
+        Status status = Status::None;       //!< Scheduling status.
+        QString queue;                      //!< Queue it is counted in.
+        QString host;                       //!< Host it is counted on.
+        int priority = 0;                   //!< Priority it is ordered by.
+        qint64 order = 0;                   //!< Creation order it is ordered by.
+    };
+
+    //!< @brief Undo what a record contributed to the index and counters.
+    void detach(Id id, const Record& record);
+
+    //!< @brief Add a record to the index and counters.
+    void attach(Id id, const Record& record);
+
+    QVector<Record> m_records;                      //!< Last update per id.
+    QHash<QString, Lane> m_lanes;                   //!< Queues with ready tasks.
+    QHash<QString, int> m_runningPerQueue;          //!< Running tasks per queue.
+    QHash<QString, int> m_runningPerHost;           //!< Running tasks per host.
+    int m_running = 0;                              //!< Running tasks.
+    int m_readyCount = 0;                           //!< Ready tasks.
+};
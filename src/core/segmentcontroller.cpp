@@ -0,0 +1,135 @@
+module;
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+#include <utility>
+
+module raad.core.segmentcontroller;
+
+void SegmentController::reset(int target, int ceiling)
+{
+    m_ceiling = qBound(kMinTarget, ceiling, kMaxTarget);
+    m_target = qBound(kMinTarget, target, m_ceiling);
+    m_hold = 0;
+    m_baseConnections = 0;
+    m_baseBytesPerSec = 0;
+    m_bestConnections = 0;
+    m_bestBytesPerSec = 0;
+    m_trace.clear();
+}
+
+void SegmentController::setBaseline(const Sample& sample)
+{
+    m_baseConnections = sample.connections;
+    m_baseBytesPerSec = sample.bytesPerSec;
+}
+
+int SegmentController::update(const Sample& sample, qint64 nowMs)
+{
+    Decision decision;
+    decision.atMs = nowMs;
+    decision.from = m_target;
+    decision.connections = sample.connections;
+    decision.bytesPerSec = sample.bytesPerSec;
+
+    QStringList pressure;
+    if (sample.errors > 0) pressure << QStringLiteral("%1 errors").arg(sample.errors);
+    if (sample.serverThrottle > 0) pressure << QStringLiteral("server throttling");
+    if (sample.writeStalled) pressure << QStringLiteral("write stall");
+    if (sample.cpuSaturated) pressure << QStringLiteral("CPU saturated");
+
+    if (pressure.isEmpty() && sample.connections > 0 && sample.bytesPerSec > m_bestBytesPerSec) {
+        m_bestConnections = sample.connections;
+        m_bestBytesPerSec = sample.bytesPerSec;
+    }
+
+    if (!pressure.isEmpty()) {
+        m_target = qMax(kMinTarget, static_cast<int>(m_target * kBackoff));
+        m_hold = kHoldWindows;
+        m_baseConnections = 0;
+        decision.action = Action::Backoff;
+        decision.reason = pressure.join(QStringLiteral(", "));
+    } else if (m_baseConnections > 0 && m_baseBytesPerSec > 0 && sample.connections > m_baseConnections) {
+        // Connections were added since the reference window: compare what they brought with
+        // what an average connection delivered before them.
+        const qreal perConnection = static_cast<qreal>(m_baseBytesPerSec) / m_baseConnections;
+        const qreal added = sample.connections - m_baseConnections;
+        decision.measured = true;
+        decision.marginal = (sample.bytesPerSec - m_baseBytesPerSec) / added / perConnection;
+        if (decision.marginal >= kMinGain) {
+            const int revertTo = m_baseConnections;
+            setBaseline(sample);
+            if (m_hold == 0 && sample.connections >= m_target && m_target < m_ceiling) {
+                ++m_target;
+                decision.action = Action::Grow;
+                decision.reason = QStringLiteral("added connections paid off");
+            } else {
+                decision.action = Action::Keep;
+                decision.reason = QStringLiteral("added connections paid off (was %1)").arg(revertTo);
+            }
+        } else {
+            m_target = qBound(kMinTarget, m_baseConnections, m_ceiling);
+            m_hold = kHoldWindows;
+            m_baseConnections = 0;
+            decision.action = Action::Revert;
+            decision.reason = QStringLiteral("added connections gained too little");
+        }
+    } else if (m_hold > 0) {
+        --m_hold;
+        setBaseline(sample);
+        decision.action = Action::Hold;
+        decision.reason = QStringLiteral("%1 windows until the next probe").arg(m_hold);
+    } else if (sample.connections >= m_target && m_target < m_ceiling) {
+        setBaseline(sample);
+        ++m_target;
+        decision.action = Action::Probe;
+        decision.reason = QStringLiteral("measuring one more connection");
+    } else {
+        setBaseline(sample);
+        decision.action = Action::Keep;
+        decision.reason = m_target >= m_ceiling ? QStringLiteral("at ceiling")
+                                                : QStringLiteral("fewer connections than target");
+    }
+
+    decision.to = m_target;
+    record(std::move(decision));
+    return m_target;
+}
+
+void SegmentController::record(Decision decision)
+{
+    if (m_trace.size() >= kTraceLength) m_trace.removeFirst();
+    m_trace.push_back(std::move(decision));
+}
+
+QString SegmentController::actionName(Action action)
+{
+    switch (action) {
+    case Action::Probe: return QStringLiteral("probe");
+    case Action::Grow: return QStringLiteral("grow");
+    case Action::Keep: return QStringLiteral("keep");
+    case Action::Hold: return QStringLiteral("hold");
+    case Action::Revert: return QStringLiteral("revert");
+    case Action::Backoff: return QStringLiteral("backoff");
+    }
+    return QString();
+}
+
+QStringList SegmentController::traceLines() const
+{
+    QStringList lines;
+    lines.reserve(m_trace.size());
+    for (const Decision& d : m_trace) {
+        QString line = QStringLiteral("%1 %2 -> %3 | %4 conn, %5 KiB/s")
+                           .arg(actionName(d.action))
+                           .arg(d.from)
+                           .arg(d.to)
+                           .arg(d.connections)
+                           .arg(d.bytesPerSec / 1024);
+        if (d.measured) line += QStringLiteral(", marginal %1").arg(d.marginal, 0, 'f', 2);
+        line += QStringLiteral(" | ") + d.reason;
+        lines << line;
+    }
+    return lines;
+}
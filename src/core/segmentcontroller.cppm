@@ -0,0 +1,136 @@
+/*!
+ * @file        segmentcontroller.cppm
+ * @brief       Segment count controller driven by measured throughput.
+ * @details     Every evaluation window the task reports how many bytes it
+ *              received and over how many connections. When connections were
+ *              added since the last window, the controller compares what the
+ *              newcomers delivered with what an average connection delivered
+ *              before them. Additions that pay their way are kept and the
+ *              target grows by one more; additions that do not are undone
+ *              and the controller holds for a few windows before probing
+ *              again.
+ *
+ *              Errors, 429/503 answers, write stalls and a saturated CPU cut
+ *              the target multiplicatively instead, so the count settles
+ *              where another connection stops helping rather than cycling
+ *              through fixed speed buckets.
+ *
+ *              Each decision is kept in a short trace for tuning.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#ifndef Q_MOC_RUN
+export module raad.core.segmentcontroller;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+/**
+ * @brief Additive-increase / multiplicative-decrease controller for one task's segment count.
+ *
+ * Pure bookkeeping: it never touches the network, the caller feeds it one
+ * Sample per window and applies the returned target.
+ */
+RAAD_MODULE_EXPORT class SegmentController {
+public:
+    static constexpr int kMinTarget = 2;                //!< Lowest target.
+    static constexpr int kMaxTarget = 32;               //!< Highest target.
+    static constexpr qreal kMinGain = 0.35;             //!< Share of an average connection's rate a new one must add.
+    static constexpr qreal kBackoff = 0.7;              //!< Target factor applied under pressure.
+    static constexpr int kHoldWindows = 4;              //!< Windows to wait after a revert or backoff.
+    static constexpr int kTraceLength = 32;             //!< Decisions kept in the trace.
+
+    //!< @brief What the task observed during one window.
+    struct Sample {
+        qint64 bytesPerSec = 0;                 //!< Network receive rate over the window.
+        int connections = 0;                    //!< Requests in flight at the end of the window.
+        int errors = 0;                         //!< Connection-level errors in the window.
+        int serverThrottle = 0;                 //!< 429/503 answers in the window.
+        bool writeStalled = false;              //!< Disk writes fell behind.
+        bool cpuSaturated = false;              //!< Process CPU load near the limit.
+    };
+
+    enum class Action {
+        Probe,          //!< Target raised to measure one more connection.
+        Grow,           //!< Last addition paid off; target raised again.
+        Keep,           //!< Target unchanged.
+        Hold,           //!< Waiting after a revert or backoff.
+        Revert,         //!< Last addition did not pay off; target lowered back.
+        Backoff         //!< Pressure signal; target cut multiplicatively.
+    };
+
+    //!< @brief One entry of the decision trace.
+    struct Decision {
+        qint64 atMs = 0;                        //!< Caller's timestamp.
+        Action action = Action::Keep;           //!< What was decided.
+        int from = 0;                           //!< Target before the decision.
+        int to = 0;                             //!< Target after the decision.
+        int connections = 0;                    //!< Connections in the sample.
+        qint64 bytesPerSec = 0;                 //!< Rate in the sample.
+        bool measured = false;                  //!< Whether added connections were measured.
+        qreal marginal = 0.0;                   //!< Rate per added connection relative to an average one.
+        QString reason;                         //!< Short explanation.
+    };
+
+    /**
+     * @brief Start over from a known target.
+     * @param target Initial target.
+     * @param ceiling Highest target allowed for this download (e.g. lower for small files).
+     */
+    void reset(int target, int ceiling = kMaxTarget);
+
+    //!< @brief Return the current target.
+    int target() const { return m_target; }
+
+    /**
+     * @brief Feed one window's observation and return the new target.
+     * @param sample Observation.
+     * @param nowMs Timestamp stored in the trace.
+     * @return Target for the next window.
+     */
+    int update(const Sample& sample, qint64 nowMs);
+
+    //!< @brief Return the connection count of the fastest window without pressure (0 = none yet).
+    int bestConnections() const { return m_bestConnections; }
+
+    //!< @brief Return the rate of that window.
+    qint64 bestBytesPerSec() const { return m_bestBytesPerSec; }
+
+    //!< @brief Return the most recent decisions, oldest first.
+    const QVector<Decision>& trace() const { return m_trace; }
+
+    //!< @brief Return the trace as one line per decision.
+    QStringList traceLines() const;
+
+    //!< @brief Return a readable name for an action.
+    static QString actionName(Action action);
+
+private:
+    //!< @brief Remember @p sample as the reference for the next comparison.
+    void setBaseline(const Sample& sample);
+
+    //!< @brief Append to the trace, dropping the oldest entry when full.
+    void record(Decision decision);
+
+    int m_target = 4;                           //!< Current target.
+    int m_ceiling = kMaxTarget;                 //!< Highest target.
+    int m_hold = 0;                             //!< Windows left before probing again.
+    int m_baseConnections = 0;                  //!< Connections in the reference window (0 = none).
+    qint64 m_baseBytesPerSec = 0;               //!< Rate in the reference window.
+    int m_bestConnections = 0;                  //!< Connections in the fastest healthy window.
+    qint64 m_bestBytesPerSec = 0;               //!< Rate of the fastest healthy window.
+    QVector<Decision> m_trace;                  //!< Recent decisions.
+};
@@ -0,0 +1,545 @@
+module;
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtEndian>
+#include <iterator>
+#include <utility>
+
+module raad.core.streamhash;
+
+namespace {
+
+constexpr quint32 kCrc32cPoly = 0x82F63B78u;
+
+struct Crc32cTables {
+    quint32 t[8][256];
+
+    Crc32cTables()
+    {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ kCrc32cPoly : (c >> 1);
+            t[0][i] = c;
+        }
+        for (quint32 i = 0; i < 256; ++i) {
+            for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+    }
+};
+
+const Crc32cTables& crcTables()
+{
+    static const Crc32cTables tables;
+    return tables;
+}
+
+// Feed [offset, offset + length) of the download, as mapped by the layout, to a sink.
+template <typename Sink>
+bool readLayout(const QVector<DiskExtent>& layout, qint64 offset, qint64 length, Sink&& sink)
+{
+    QByteArray buffer;
+    while (length > 0) {
+        const DiskExtent* extent = nullptr;
+        for (const DiskExtent& e : layout) {
+            if (offset >= e.start && offset < e.end) {
+                extent = &e;
+                break;
+            }
+        }
+        if (!extent) return false;
+
+        QFile file(extent->path);
+        if (!file.open(QIODevice::ReadOnly)) return false;
+        if (!file.seek(extent->fileOffset + (offset - extent->start))) return false;
+        qint64 left = qMin(length, extent->end - offset);
+        if (buffer.isEmpty()) buffer.resize(1024 * 1024);
+        while (left > 0) {
+            const qint64 got = file.read(buffer.data(), qMin<qint64>(left, buffer.size()));
+            if (got <= 0) return false;
+            sink(buffer.constData(), got);
+            offset += got;
+            left -= got;
+            length -= got;
+        }
+    }
+    return true;
+}
+
+// Merge [start, end) into a map of disjoint ranges.
+void mergeRange(QMap<qint64, qint64>& ranges, qint64 start, qint64 end)
+{
+    auto it = ranges.lowerBound(start);
+    if (it != ranges.begin()) {
+        auto prev = std::prev(it);
+        if (prev.value() >= start) {
+            start = prev.key();
+            end = qMax(end, prev.value());
+            it = ranges.erase(prev);
+        }
+    }
+    while (it != ranges.end() && it.key() <= end) {
+        end = qMax(end, it.value());
+        it = ranges.erase(it);
+    }
+    ranges.insert(start, end);
+}
+
+// Remove [start, end) from a map of disjoint ranges.
+void eraseRange(QMap<qint64, qint64>& ranges, qint64 start, qint64 end)
+{
+    auto it = ranges.lowerBound(start);
+    if (it != ranges.begin() && std::prev(it).value() > start) --it;
+    while (it != ranges.end() && it.key() < end) {
+        const qint64 rangeStart = it.key();
+        const qint64 rangeEnd = it.value();
+        it = ranges.erase(it);
+        if (rangeStart < start) ranges.insert(rangeStart, start);
+        if (rangeEnd > end) {
+            ranges.insert(end, rangeEnd);
+            break;
+        }
+    }
+}
+
+} // namespace
+
+quint32 crc32c(quint32 crc, const char* data, qint64 size)
+{
+    const Crc32cTables& tab = crcTables();
+    const auto* p = reinterpret_cast<const uchar*>(data);
+    crc = ~crc;
+    // Slicing-by-8: one table lookup per byte, eight bytes per step.
+    while (size >= 8) {
+        const quint32 lo = crc ^ (quint32(p[0]) | quint32(p[1]) << 8 | quint32(p[2]) << 16 | quint32(p[3]) << 24);
+        crc = tab.t[7][lo & 0xFF] ^ tab.t[6][(lo >> 8) & 0xFF] ^ tab.t[5][(lo >> 16) & 0xFF] ^ tab.t[4][lo >> 24]
+              ^ tab.t[3][p[4]] ^ tab.t[2][p[5]] ^ tab.t[1][p[6]] ^ tab.t[0][p[7]];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ tab.t[0][(crc ^ *p++) & 0xFF];
+    }
+    return ~crc;
+}
+
+StreamHasher::StreamHasher(QCryptographicHash::Algorithm algorithm)
+    : m_algorithm(algorithm),
+    m_hash(algorithm)
+{
+}
+
+quint64 StreamHasher::generation() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_generation;
+}
+
+void StreamHasher::restart()
+{
+    QMutexLocker lock(&m_mutex);
+    ++m_generation;
+    m_hash.reset();
+    m_cursor = 0;
+    m_ahead.clear();
+    m_valid = true;
+}
+
+void StreamHasher::invalidate()
+{
+    QMutexLocker lock(&m_mutex);
+    ++m_generation;
+    m_ahead.clear();
+    m_valid = false;
+}
+
+bool StreamHasher::isValid() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_valid;
+}
+
+void StreamHasher::setLayout(QVector<Extent> layout)
+{
+    QMutexLocker lock(&m_mutex);
+    m_layout = std::move(layout);
+}
+
+qint64 StreamHasher::hashedBytes() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_cursor;
+}
+
+void StreamHasher::written(quint64 generation, qint64 offset, const QVector<BufferSlice>& data)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_valid || generation != m_generation) return;
+
+    qint64 length = 0;
+    for (const BufferSlice& slice : data) length += slice.length;
+    const qint64 end = offset + length;
+    if (end <= m_cursor) return;
+
+    if (offset <= m_cursor) {
+        // Continues the prefix: hash from memory, skipping bytes already covered.
+        qint64 skip = m_cursor - offset;
+        for (const BufferSlice& slice : data) {
+            if (skip >= slice.length) {
+                skip -= slice.length;
+                continue;
+            }
+            m_hash.addData(QByteArrayView(slice.data() + skip, static_cast<qsizetype>(slice.length - skip)));
+            skip = 0;
+        }
+        m_cursor = end;
+    } else {
+        recordLocked(offset, end);
+    }
+    catchUpLocked(kCatchUpStep);
+}
+
+void StreamHasher::committed(quint64 generation, qint64 offset, qint64 length)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_valid || generation != m_generation) return;
+    const qint64 end = offset + length;
+    if (length <= 0 || end <= m_cursor) return;
+    recordLocked(offset, end);
+    catchUpLocked(kCatchUpStep);
+}
+
+void StreamHasher::recordLocked(qint64 start, qint64 end)
+{
+    mergeRange(m_ahead, start, end);
+}
+
+void StreamHasher::catchUpLocked(qint64 budget)
+{
+    while (budget > 0 && !m_ahead.isEmpty() && m_ahead.firstKey() <= m_cursor) {
+        const qint64 end = m_ahead.first();
+        if (end <= m_cursor) {
+            m_ahead.erase(m_ahead.begin());
+            continue;
+        }
+        const qint64 step = qMin(end - m_cursor, budget);
+        if (!readBackLocked(step)) {
+            ++m_generation;
+            m_ahead.clear();
+            m_valid = false;
+            return;
+        }
+        budget -= step;
+    }
+}
+
+bool StreamHasher::readBackLocked(qint64 length)
+{
+    return readLayout(m_layout, m_cursor, length, [this](const char* data, qint64 size) {
+        m_hash.addData(QByteArrayView(data, static_cast<qsizetype>(size)));
+        m_cursor += size;
+    });
+}
+
+QByteArray StreamHasher::completedDigest(qint64 totalSize)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_valid || m_cursor != totalSize) return QByteArray();
+    // The context is final after result(); later checks must read the file again.
+    m_valid = false;
+    return m_hash.result();
+}
+
+QByteArray StreamHasher::finish(const QString& path, qint64 totalSize)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_valid || m_cursor > totalSize) return QByteArray();
+    // The finished file holds every byte, so only the unhashed tail has to be read.
+    m_layout = { Extent { 0, totalSize, path, 0 } };
+    m_ahead.clear();
+    const bool ok = readBackLocked(totalSize - m_cursor);
+    m_valid = false;
+    return ok ? m_hash.result() : QByteArray();
+}
+
+BlockManifest::BlockManifest(qint64 totalSize)
+    : m_totalSize(qMax<qint64>(0, totalSize))
+{
+    m_blocks.resize(static_cast<qsizetype>((m_totalSize + kBlockSize - 1) / kBlockSize));
+}
+
+std::shared_ptr<BlockManifest> BlockManifest::load(const QString& path, qint64 totalSize)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return nullptr;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+    if (!doc.isObject()) return nullptr;
+
+    const QJsonObject root = doc.object();
+    if (root.value("version").toInt() != 1) return nullptr;
+    if (static_cast<qint64>(root.value("blockSize").toDouble(0)) != kBlockSize) return nullptr;
+    if (static_cast<qint64>(root.value("totalSize").toDouble(-1)) != totalSize) return nullptr;
+
+    auto manifest = std::make_shared<BlockManifest>(totalSize);
+    const qsizetype count = manifest->m_blocks.size();
+    const QByteArray packed = QByteArray::fromBase64(root.value("blocks").toString().toLatin1());
+    if (packed.size() != count * 8) return nullptr;
+
+    for (qsizetype i = 0; i < count; ++i) {
+        const auto [blockStart, blockEnd] = manifest->blockSpan(static_cast<int>(i));
+        Block& block = manifest->m_blocks[i];
+        block.crc = qFromLittleEndian<quint32>(packed.constData() + i * 8);
+        block.next = qMin<qint64>(qFromLittleEndian<quint32>(packed.constData() + i * 8 + 4), blockEnd - blockStart);
+        block.done = block.next == blockEnd - blockStart;
+    }
+    return manifest;
+}
+
+bool BlockManifest::save(const QString& path)
+{
+    // Per block: checksum and length of the in-order prefix it covers (full length = finished).
+    QByteArray packed;
+    {
+        QMutexLocker lock(&m_mutex);
+        packed.resize(m_blocks.size() * 8);
+        for (qsizetype i = 0; i < m_blocks.size(); ++i) {
+            qToLittleEndian<quint32>(m_blocks.at(i).crc, packed.data() + i * 8);
+            qToLittleEndian<quint32>(static_cast<quint32>(m_blocks.at(i).next), packed.data() + i * 8 + 4);
+        }
+        m_dirty = false;
+    }
+
+    QJsonObject root;
+    root.insert("version", 1);
+    root.insert("blockSize", static_cast<double>(kBlockSize));
+    root.insert("totalSize", static_cast<double>(m_totalSize));
+    root.insert("blocks", QString::fromLatin1(packed.toBase64()));
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+bool BlockManifest::isDirty() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_dirty;
+}
+
+int BlockManifest::blockCount() const
+{
+    QMutexLocker lock(&m_mutex);
+    return static_cast<int>(m_blocks.size());
+}
+
+quint64 BlockManifest::generation() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_generation;
+}
+
+void BlockManifest::restart()
+{
+    QMutexLocker lock(&m_mutex);
+    ++m_generation;
+    for (Block& block : m_blocks) block = Block {};
+    m_committed.clear();
+    m_dirty = true;
+}
+
+void BlockManifest::setLayout(QVector<DiskExtent> layout)
+{
+    QMutexLocker lock(&m_mutex);
+    m_layout = std::move(layout);
+}
+
+std::pair<qint64, qint64> BlockManifest::blockSpan(int index) const
+{
+    const qint64 start = static_cast<qint64>(index) * kBlockSize;
+    return { start, qMin(m_totalSize, start + kBlockSize) };
+}
+
+void BlockManifest::recordLocked(qint64 start, qint64 end)
+{
+    mergeRange(m_committed, start, end);
+}
+
+bool BlockManifest::coveredLocked(qint64 start, qint64 end) const
+{
+    auto it = m_committed.upperBound(start);
+    if (it == m_committed.begin()) return false;
+    --it;
+    return it.key() <= start && it.value() >= end;
+}
+
+void BlockManifest::markCommitted(qint64 start, qint64 end)
+{
+    if (end <= start) return;
+    QMutexLocker lock(&m_mutex);
+    recordLocked(start, end);
+}
+
+void BlockManifest::written(quint64 generation, qint64 offset, const QVector<BufferSlice>& data)
+{
+    QMutexLocker lock(&m_mutex);
+    if (generation != m_generation || m_blocks.isEmpty()) return;
+
+    qint64 length = 0;
+    for (const BufferSlice& slice : data) length += slice.length;
+    const qint64 end = qMin(offset + length, m_totalSize);
+    if (offset < 0 || end <= offset) return;
+    recordLocked(offset, end);
+
+    const int first = static_cast<int>(offset / kBlockSize);
+    const int last = static_cast<int>((end - 1) / kBlockSize);
+    for (int index = first; index <= last; ++index) {
+        Block& block = m_blocks[index];
+        if (block.done) continue;
+        const auto [blockStart, blockEnd] = blockSpan(index);
+
+        // Extend the in-order checksum with the part of this write that continues it.
+        const qint64 from = blockStart + block.next;
+        const qint64 to = qMin(end, blockEnd);
+        if (offset <= from && to > from) {
+            qint64 skip = from - offset;
+            qint64 want = to - from;
+            for (const BufferSlice& slice : data) {
+                if (want <= 0) break;
+                if (skip >= slice.length) {
+                    skip -= slice.length;
+                    continue;
+                }
+                const qint64 n = qMin(slice.length - skip, want);
+                block.crc = crc32c(block.crc, slice.data() + skip, n);
+                want -= n;
+                skip = 0;
+            }
+            block.next = to - blockStart;
+            m_dirty = true;
+        }
+
+        if (block.next == blockEnd - blockStart) {
+            block.done = true;
+        } else {
+            settleBlockLocked(index);
+        }
+    }
+}
+
+void BlockManifest::committed(quint64 generation, qint64 offset, qint64 length)
+{
+    QMutexLocker lock(&m_mutex);
+    if (generation != m_generation || m_blocks.isEmpty()) return;
+    const qint64 end = qMin(offset + length, m_totalSize);
+    if (offset < 0 || end <= offset) return;
+    recordLocked(offset, end);
+
+    const int first = static_cast<int>(offset / kBlockSize);
+    const int last = static_cast<int>((end - 1) / kBlockSize);
+    for (int index = first; index <= last; ++index) {
+        settleBlockLocked(index);
+    }
+}
+
+void BlockManifest::settleBlockLocked(int index)
+{
+    Block& block = m_blocks[index];
+    const auto [blockStart, blockEnd] = blockSpan(index);
+    if (block.done || !coveredLocked(blockStart, blockEnd)) return;
+    // Filled out of order or straight to disk; every byte is there now, so read it back once.
+    quint32 crc = 0;
+    if (readBlockLocked(index, blockEnd - blockStart, &crc)) {
+        block.crc = crc;
+        block.next = blockEnd - blockStart;
+        block.done = true;
+        m_dirty = true;
+    }
+}
+
+bool BlockManifest::isBlockDone(int index) const
+{
+    QMutexLocker lock(&m_mutex);
+    return index >= 0 && index < m_blocks.size() && m_blocks.at(index).done;
+}
+
+void BlockManifest::forgetBlock(int index)
+{
+    QMutexLocker lock(&m_mutex);
+    if (index < 0 || index >= m_blocks.size()) return;
+    m_blocks[index] = Block {};
+    // Its bytes must arrive again before the block can be read back.
+    const auto [blockStart, blockEnd] = blockSpan(index);
+    eraseRange(m_committed, blockStart, blockEnd);
+    m_dirty = true;
+}
+
+bool BlockManifest::readBlockLocked(int index, qint64 length, quint32* crc) const
+{
+    quint32 value = 0;
+    const bool ok = readLayout(m_layout, blockSpan(index).first, length, [&value](const char* data, qint64 size) {
+        value = crc32c(value, data, size);
+    });
+    if (ok) *crc = value;
+    return ok;
+}
+
+qint64 BlockManifest::verifiedEnd(qint64 start, qint64 claimedEnd)
+{
+    QMutexLocker lock(&m_mutex);
+    claimedEnd = qMin(claimedEnd, m_totalSize);
+    if (claimedEnd <= start || m_blocks.isEmpty()) return start;
+
+    // Walk finished blocks from the range start; the first unfinished one ends the trusted part.
+    const int first = static_cast<int>(start / kBlockSize);
+    const int last = static_cast<int>((claimedEnd - 1) / kBlockSize);
+    int index = first;
+    while (index <= last && m_blocks.at(index).done) ++index;
+
+    // Re-read the tail of the finished run, where a crash leaves torn writes.
+    const int checkFrom = qMax(first, index - kResumeCheckBlocks);
+    for (int i = checkFrom; i < index; ++i) {
+        quint32 crc = 0;
+        const auto [blockStart, blockEnd] = blockSpan(i);
+        if (!readBlockLocked(i, blockEnd - blockStart, &crc) || crc != m_blocks.at(i).crc) {
+            m_blocks[i] = Block {};
+            m_dirty = true;
+            return qBound(start, blockStart, claimedEnd);
+        }
+    }
+    if (index > last) return claimedEnd;
+
+    // The unfinished block is trusted up to its checked in-order prefix.
+    Block& block = m_blocks[index];
+    const qint64 blockStart = blockSpan(index).first;
+    if (block.next <= 0) return qBound(start, blockStart, claimedEnd);
+    quint32 crc = 0;
+    if (!readBlockLocked(index, block.next, &crc) || crc != block.crc) {
+        block = Block {};
+        m_dirty = true;
+        return qBound(start, blockStart, claimedEnd);
+    }
+    return qBound(start, blockStart + block.next, claimedEnd);
+}
+
+bool BlockManifest::verifyFile(const QString& path, QList<int>* badBlocks) const
+{
+    QMutexLocker lock(&m_mutex);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() != m_totalSize) return false;
+
+    QByteArray buffer(static_cast<qsizetype>(kBlockSize), Qt::Uninitialized);
+    for (int index = 0; index < m_blocks.size(); ++index) {
+        const auto [blockStart, blockEnd] = blockSpan(index);
+        const qint64 length = blockEnd - blockStart;
+        if (file.read(buffer.data(), length) != length) return false;
+        const Block& block = m_blocks.at(index);
+        if (!block.done || crc32c(0, buffer.constData(), length) != block.crc) {
+            if (badBlocks) badBlocks->append(index);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,300 @@
+/*!
+ * @file        streamhash.cppm
+ * @brief       Integrity data derived from committed download writes.
+ * @details     The disk writer reports every successful write to the hasher
+ *              of its task. Bytes that continue the hashed prefix are hashed
+ *              straight from the write buffers; ranges that land further
+ *              ahead (other segments) are only recorded and read back from
+ *              disk, in bounded steps and while still hot in the page cache,
+ *              once the prefix reaches them. When the download finishes the
+ *              digest is usually complete and no full re-read is needed.
+ *
+ *              The same writes maintain a block manifest: a CRC-32C per
+ *              4 MiB block, kept in a sidecar file. Resume checks the tail of
+ *              every claimed range against it instead of trusting file
+ *              sizes, and repair re-verifies a finished file to refetch only
+ *              the blocks that no longer match.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include <utility>
+
+#ifndef Q_MOC_RUN
+export module raad.core.streamhash;
+import raad.core.chunkring;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+/**
+ * @brief Where a stretch of the download lives on disk.
+ */
+RAAD_MODULE_EXPORT struct DiskExtent {
+    qint64 start = 0;                       //!< First download offset covered.
+    qint64 end = 0;                         //!< One past the last offset covered.
+    QString path;                           //!< File holding the stretch.
+    qint64 fileOffset = 0;                  //!< Position of @c start within the file.
+};
+
+/**
+ * @brief Extend a CRC-32C (Castagnoli) checksum.
+ * @param crc Checksum of the preceding bytes (0 to start).
+ * @param data Bytes to add.
+ * @param size Byte count.
+ * @return Updated checksum.
+ */
+RAAD_MODULE_EXPORT quint32 crc32c(quint32 crc, const char* data, qint64 size);
+
+/**
+ * @brief Thread-safe hash context that follows the contiguous committed prefix.
+ *
+ * Written to from a disk writer thread and read from the task's thread.
+ * Every feed carries the generation it was issued for, so writes from a
+ * run whose data was discarded are ignored after restart().
+ */
+RAAD_MODULE_EXPORT class StreamHasher {
+public:
+    static constexpr qint64 kCatchUpStep = 8 * 1024 * 1024;     //!< Disk read-back per write.
+
+    using Extent = DiskExtent;
+
+    /**
+     * @brief Create an empty hasher.
+     * @param algorithm Hash algorithm.
+     */
+    explicit StreamHasher(QCryptographicHash::Algorithm algorithm);
+
+    //!< @brief Return the hash algorithm.
+    QCryptographicHash::Algorithm algorithm() const { return m_algorithm; }
+
+    //!< @brief Return the current generation (changes on restart()).
+    quint64 generation() const;
+
+    //!< @brief Forget all hashed and recorded data, e.g. after the file was truncated.
+    void restart();
+
+    //!< @brief Mark the streaming state as lost; the checksum then needs a full read.
+    void invalidate();
+
+    //!< @brief Return whether the hasher can still produce a digest.
+    bool isValid() const;
+
+    /**
+     * @brief Replace the map used to read recorded ranges back from disk.
+     * @param layout Extents covering the download.
+     */
+    void setLayout(QVector<Extent> layout);
+
+    /**
+     * @brief Report bytes that were written successfully (writer thread).
+     * @param generation Generation the write was issued under.
+     * @param offset Download offset of the first byte.
+     * @param data Written payload.
+     */
+    void written(quint64 generation, qint64 offset, const QVector<BufferSlice>& data);
+
+    /**
+     * @brief Report bytes that reached the file without passing through memory (any thread).
+     *
+     * They are read back from disk once the prefix reaches them.
+     *
+     * @param generation Generation the write was issued under.
+     * @param offset Download offset of the first byte.
+     * @param length Byte count.
+     */
+    void committed(quint64 generation, qint64 offset, qint64 length);
+
+    //!< @brief Return the length of the hashed prefix.
+    qint64 hashedBytes() const;
+
+    /**
+     * @brief Return the digest if exactly @p totalSize bytes were hashed, without any I/O.
+     * @param totalSize Final download size.
+     * @return Digest, or empty when reading is still needed.
+     */
+    QByteArray completedDigest(qint64 totalSize);
+
+    /**
+     * @brief Hash whatever is missing from the finished file and return the digest.
+     * @param path Completed file.
+     * @param totalSize Final download size.
+     * @return Digest, or empty on failure.
+     */
+    QByteArray finish(const QString& path, qint64 totalSize);
+
+private:
+    //!< @brief Hash [m_cursor, m_cursor + length) read from the layout.
+    bool readBackLocked(qint64 length);
+
+    //!< @brief Advance through recorded ranges that reach the prefix, reading at most @p budget bytes.
+    void catchUpLocked(qint64 budget);
+
+    //!< @brief Record [start, end) as written ahead of the prefix.
+    void recordLocked(qint64 start, qint64 end);
+
+    mutable QMutex m_mutex;                 //!< Guards every member below.
+    QCryptographicHash::Algorithm m_algorithm;  //!< Hash algorithm.
+    QCryptographicHash m_hash;              //!< Running context over [0, m_cursor).
+    qint64 m_cursor = 0;                    //!< Length of the hashed prefix.
+    QMap<qint64, qint64> m_ahead;           //!< Written ranges past the prefix (start -> end).
+    QVector<Extent> m_layout;               //!< On-disk map for read-back.
+    quint64 m_generation = 0;               //!< Bumped on restart().
+    bool m_valid = true;                    //!< False once state was lost or the digest taken.
+};
+
+/**
+ * @brief Per-block CRC-32C manifest of a download.
+ *
+ * Blocks are fixed 4 MiB stretches of the final file. A block's checksum is
+ * accumulated from the write buffers while its bytes arrive in order; a
+ * block filled out of order (e.g. across a segment boundary) is read back
+ * once every byte of it has been committed. Thread-safe like StreamHasher.
+ */
+RAAD_MODULE_EXPORT class BlockManifest {
+public:
+    static constexpr qint64 kBlockSize = 4 * 1024 * 1024;       //!< Block length in bytes.
+    static constexpr int kResumeCheckBlocks = 2;                //!< Tail blocks re-read per range on resume.
+
+    /**
+     * @brief Create an empty manifest.
+     * @param totalSize Download size in bytes.
+     */
+    explicit BlockManifest(qint64 totalSize);
+
+    /**
+     * @brief Load a manifest saved by save().
+     * @param path Sidecar path.
+     * @param totalSize Expected download size.
+     * @return Manifest, or null if missing, unreadable or for another size.
+     */
+    static std::shared_ptr<BlockManifest> load(const QString& path, qint64 totalSize);
+
+    /**
+     * @brief Atomically write the block checksums to a sidecar file.
+     * @param path Sidecar path.
+     * @return false on I/O failure.
+     */
+    bool save(const QString& path);
+
+    //!< @brief Return whether checksums advanced since the last save().
+    bool isDirty() const;
+
+    //!< @brief Return the download size.
+    qint64 totalSize() const { return m_totalSize; }
+
+    //!< @brief Return the number of blocks.
+    int blockCount() const;
+
+    //!< @brief Return the current generation (changes on restart()).
+    quint64 generation() const;
+
+    //!< @brief Forget every block, e.g. after the data was truncated.
+    void restart();
+
+    /**
+     * @brief Replace the map used to read blocks back from disk.
+     * @param layout Extents covering the download.
+     */
+    void setLayout(QVector<DiskExtent> layout);
+
+    /**
+     * @brief Declare [start, end) as already on disk (bytes kept from an earlier run).
+     * @param start First offset.
+     * @param end One past the last offset.
+     */
+    void markCommitted(qint64 start, qint64 end);
+
+    /**
+     * @brief Report bytes that were written successfully (writer thread).
+     * @param generation Generation the write was issued under.
+     * @param offset Download offset of the first byte.
+     * @param data Written payload.
+     */
+    void written(quint64 generation, qint64 offset, const QVector<BufferSlice>& data);
+
+    /**
+     * @brief Report bytes that reached the file without passing through memory (any thread).
+     *
+     * Blocks they complete are read back once.
+     *
+     * @param generation Generation the write was issued under.
+     * @param offset Download offset of the first byte.
+     * @param length Byte count.
+     */
+    void committed(quint64 generation, qint64 offset, qint64 length);
+
+    //!< @brief Return whether a block has a recorded checksum.
+    bool isBlockDone(int index) const;
+
+    //!< @brief Drop the checksum and committed bytes of a block so it is treated as missing.
+    void forgetBlock(int index);
+
+    /**
+     * @brief Check the claimed bytes of a range against the manifest.
+     *
+     * Only the last kResumeCheckBlocks finished blocks and the in-order
+     * prefix of the first unfinished one are read back, since torn writes
+     * sit at the end of what was committed before a crash. Bytes that have
+     * no checksum yet cannot be trusted and are dropped.
+     *
+     * @param start First offset of the range.
+     * @param claimedEnd One past the last byte believed to be on disk.
+     * @return One past the last byte that passed the check (>= @p start).
+     */
+    qint64 verifiedEnd(qint64 start, qint64 claimedEnd);
+
+    /**
+     * @brief Re-read a complete file and list blocks that do not match.
+     * @param path File to check.
+     * @param badBlocks Receives failing or unrecorded block indexes.
+     * @return false if the file could not be read.
+     */
+    bool verifyFile(const QString& path, QList<int>* badBlocks) const;
+
+private:
+    struct Block {
+        quint32 crc = 0;                    //!< Checksum of the in-order prefix (final when done).
+        qint64 next = 0;                    //!< In-order bytes accumulated from the block start.
+        bool done = false;                  //!< Checksum covers the whole block.
+    };
+
+    //!< @brief Return [start, end) of a block.
+    std::pair<qint64, qint64> blockSpan(int index) const;
+
+    //!< @brief Record [start, end) as committed.
+    void recordLocked(qint64 start, qint64 end);
+
+    //!< @brief Return whether [start, end) is fully committed.
+    bool coveredLocked(qint64 start, qint64 end) const;
+
+    //!< @brief Read a block back if all of it is committed but its checksum is not final.
+    void settleBlockLocked(int index);
+
+    //!< @brief Compute the checksum of the first @p length bytes of a block from disk.
+    bool readBlockLocked(int index, qint64 length, quint32* crc) const;
+
+    mutable QMutex m_mutex;                 //!< Guards every member below.
+    qint64 m_totalSize = 0;                 //!< Download size.
+    QVector<Block> m_blocks;                //!< Per-block state.
+    QMap<qint64, qint64> m_committed;       //!< Committed ranges (start -> end).
+    QVector<DiskExtent> m_layout;           //!< On-disk map for read-back.
+    quint64 m_generation = 0;               //!< Bumped on restart().
+    bool m_dirty = false;                   //!< Checksums changed since the last save.
+};
@@ -0,0 +1,177 @@
+module;
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+module raad.core.taskregistry;
+
+TaskRegistry::Id TaskRegistry::add(QObject* task)
+{
+    if (!task) return kNoTask;
+    const auto found = m_ids.constFind(task);
+    if (found != m_ids.cend()) return *found;
+
+    Id id = kNoTask;
+    if (!m_free.isEmpty()) {
+        id = m_free.takeLast();
+        m_tasks[id] = task;
+        m_speed[id] = 0;
+        m_received[id] = 0;
+        m_total[id] = 0;
+        m_lastReceived[id] = 0;
+        m_maxSpeed[id] = 0;
+        m_priority[id] = 0;
+        m_createdOrder[id] = ++m_orderCounter;
+        m_paused[id] = 0;
+        m_queueSlot[id] = -1;
+        m_hostSlot[id] = -1;
+        m_cold[id] = Cold();
+    } else {
+        id = static_cast<Id>(m_tasks.size());
+        m_tasks.append(task);
+        m_speed.append(0);
+        m_received.append(0);
+        m_total.append(0);
+        m_lastReceived.append(0);
+        m_maxSpeed.append(0);
+        m_priority.append(0);
+        m_createdOrder.append(++m_orderCounter);
+        m_paused.append(0);
+        m_queueSlot.append(-1);
+        m_hostSlot.append(-1);
+        m_cold.append(Cold());
+    }
+    m_ids.insert(task, id);
+    return id;
+}
+
+void TaskRegistry::remove(const QObject* task)
+{
+    const auto found = m_ids.find(task);
+    if (found == m_ids.end()) return;
+    const Id id = *found;
+    m_ids.erase(found);
+    account(id, -1);
+    m_tasks[id] = nullptr;
+    // Drop the strings now; the numeric columns are reset when the row is reused.
+    m_cold[id] = Cold();
+    m_free.append(id);
+}
+
+void TaskRegistry::clear()
+{
+    m_ids.clear();
+    m_tasks.clear();
+    m_free.clear();
+    m_orderCounter = 0;
+    m_speed.clear();
+    m_received.clear();
+    m_total.clear();
+    m_lastReceived.clear();
+    m_maxSpeed.clear();
+    m_priority.clear();
+    m_createdOrder.clear();
+    m_paused.clear();
+    m_queueSlot.clear();
+    m_hostSlot.clear();
+    m_cold.clear();
+    m_totals = Totals();
+    m_queueSlots.clear();
+    m_hostSlots.clear();
+    m_queueTotals.clear();
+    m_hostTotals.clear();
+}
+
+void TaskRegistry::setPausedBy(Id id, PauseCause cause, bool paused)
+{
+    if (paused) {
+        m_paused[id] |= cause;
+    } else {
+        m_paused[id] &= static_cast<quint8>(~cause);
+    }
+}
+
+void TaskRegistry::setSpeed(Id id, qint64 speed)
+{
+    const qint64 delta = speed - m_speed.at(id);
+    if (delta == 0) return;
+    m_speed[id] = speed;
+    m_totals.speed += delta;
+    if (m_queueSlot.at(id) >= 0) m_queueTotals[m_queueSlot.at(id)].speed += delta;
+    if (m_hostSlot.at(id) >= 0) m_hostTotals[m_hostSlot.at(id)].speed += delta;
+}
+
+void TaskRegistry::setProgress(Id id, qint64 received, qint64 total)
+{
+    const qint64 receivedDelta = received - m_received.at(id);
+    const qint64 totalDelta = total - m_total.at(id);
+    if (receivedDelta == 0 && totalDelta == 0) return;
+    m_received[id] = received;
+    m_total[id] = total;
+    m_totals.received += receivedDelta;
+    m_totals.total += totalDelta;
+    if (m_queueSlot.at(id) >= 0) {
+        Totals& sums = m_queueTotals[m_queueSlot.at(id)];
+        sums.received += receivedDelta;
+        sums.total += totalDelta;
+    }
+    if (m_hostSlot.at(id) >= 0) {
+        Totals& sums = m_hostTotals[m_hostSlot.at(id)];
+        sums.received += receivedDelta;
+        sums.total += totalDelta;
+    }
+}
+
+void TaskRegistry::setQueue(Id id, const QString& queue)
+{
+    if (m_queueSlot.at(id) >= 0 && m_cold.at(id).queue == queue) return;
+    account(id, -1);
+    m_cold[id].queue = queue;
+    m_queueSlot[id] = slotFor(m_queueSlots, m_queueTotals, queue);
+    account(id, 1);
+}
+
+void TaskRegistry::setHost(Id id, const QString& host)
+{
+    if (m_hostSlot.at(id) >= 0 && m_cold.at(id).host == host) return;
+    account(id, -1);
+    m_cold[id].host = host;
+    m_hostSlot[id] = slotFor(m_hostSlots, m_hostTotals, host);
+    account(id, 1);
+}
+
+TaskRegistry::Totals TaskRegistry::queueTotals(const QString& queue) const
+{
+    const int slot = m_queueSlots.value(queue, -1);
+    return slot >= 0 ? m_queueTotals.at(slot) : Totals();
+}
+
+TaskRegistry::Totals TaskRegistry::hostTotals(const QString& host) const
+{
+    const int slot = m_hostSlots.value(host, -1);
+    return slot >= 0 ? m_hostTotals.at(slot) : Totals();
+}
+
+void TaskRegistry::account(Id id, int sign)
+{
+    const auto add = [&](Totals& sums) {
+        sums.speed += sign * m_speed.at(id);
+        sums.received += sign * m_received.at(id);
+        sums.total += sign * m_total.at(id);
+    };
+    add(m_totals);
+    if (m_queueSlot.at(id) >= 0) add(m_queueTotals[m_queueSlot.at(id)]);
+    if (m_hostSlot.at(id) >= 0) add(m_hostTotals[m_hostSlot.at(id)]);
+}
+
+int TaskRegistry::slotFor(QHash<QString, int>& slots, QVector<Totals>& totals, const QString& name)
+{
+    // Slots are never freed: names come from a handful of queues and the hosts seen this session.
+    const auto found = slots.constFind(name);
+    if (found != slots.cend()) return *found;
+    const int slot = static_cast<int>(totals.size());
+    totals.append(Totals());
+    slots.insert(name, slot);
+    return slot;
+}
@@ -0,0 +1,206 @@
+/*!
+ * @file        taskregistry.cppm
+ * @brief       Dense per-task bookkeeping for the download manager.
+ * @details     The manager used to keep one QHash per per-task field, so a
+ *              progress event paid a hash lookup per field and removing a task
+ *              touched every table. The registry gives each task a stable
+ *              integer id (its row) on registration and keeps the fields in
+ *              columns indexed by that id: the ones the progress and scheduling
+ *              paths touch on every event sit in flat vectors, rarely touched
+ *              strings and counters live in a separate cold row. Finding a
+ *              task's row costs one hash lookup; every field after that is an
+ *              array index. Rows of removed tasks are reused.
+ *
+ *              Speed, received and total bytes are only written through
+ *              setSpeed() and setProgress(), which apply the change as a delta
+ *              to running sums: overall, per queue and per host. Reading a sum
+ *              costs O(1) no matter how many finished tasks sit in history.
+ *
+ * @author      <a href='https://github.com/thecompez'>Kambiz Asadzadeh</a>
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap. All rights reserved.
+ * @license     https://github.com/genyleap/raad/blob/main/LICENSE.md
+ */
+
+module;
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#ifndef Q_MOC_RUN
+export module raad.core.taskregistry;
+#endif
+
+#ifdef Q_MOC_RUN
+#define RAAD_MODULE_EXPORT
+#else
+#define RAAD_MODULE_EXPORT export
+#endif
+
+/**
+ * @brief Struct-of-arrays table of per-task state, keyed by a stable row id.
+ *
+ * Ids stay valid until the task is removed and may be handed to a later task
+ * afterwards. Not thread-safe: use it from the thread that runs the download
+ * engine.
+ */
+RAAD_MODULE_EXPORT class TaskRegistry {
+public:
+    using Id = int;
+    static constexpr Id kNoTask = -1;       //!< Id of an unregistered task.
+
+    /**
+     * @brief Reasons the manager paused a task on its own.
+     */
+    enum PauseCause : quint8 {
+        PausedBySchedule = 1 << 0,          //!< Outside the queue's schedule window.
+        PausedByQuota = 1 << 1,             //!< Queue quota reached.
+        PausedByBattery = 1 << 2,           //!< Running on battery.
+        PausedByNetwork = 1 << 3            //!< Connectivity lost.
+    };
+
+    /**
+     * @brief Fields only read on rare paths (UI queries, session save, retries).
+     */
+    struct Cold {
+        QString queue;                      //!< Queue name (written by setQueue()).
+        QString host;                       //!< Normalized host (written by setHost()).
+        QString category;                   //!< Category name.
+        qint64 completedAt = 0;             //!< Completion time (ms since epoch, 0 = not finished).
+        int retryCount = 0;                 //!< Automatic retries used.
+    };
+
+    /**
+     * @brief Sums over a set of tasks.
+     */
+    struct Totals {
+        qint64 speed = 0;                   //!< Speed in bytes/sec.
+        qint64 received = 0;                //!< Received bytes.
+        qint64 total = 0;                   //!< Total bytes.
+    };
+
+    /**
+     * @brief Register a task, or return its id if it already has one.
+     * @param task Task object.
+     * @return Row id.
+     */
+    Id add(QObject* task);
+
+    //!< @brief Unregister a task; its row is reused later.
+    void remove(const QObject* task);
+
+    //!< @brief Unregister every task and restart the creation order.
+    void clear();
+
+    //!< @brief Return the row of a task (kNoTask if unregistered).
+    Id id(const QObject* task) const { return m_ids.value(task, kNoTask); }
+
+    //!< @brief Return the task in a row (nullptr for a free row).
+    QObject* task(Id id) const { return m_tasks.at(id); }
+
+    //!< @brief Return the number of registered tasks.
+    int size() const { return static_cast<int>(m_ids.size()); }
+
+    //!< @brief Return the number of rows, free ones included (ids are below it).
+    int rows() const { return static_cast<int>(m_tasks.size()); }
+
+    //!< @brief Return the current download speed in bytes/sec.
+    qint64 speed(Id id) const { return m_speed.at(id); }
+
+    //!< @brief Return the bytes received so far.
+    qint64 received(Id id) const { return m_received.at(id); }
+
+    //!< @brief Return the expected total bytes (0 = unknown).
+    qint64 total(Id id) const { return m_total.at(id); }
+
+    //!< @brief Set a task's speed and update the sums.
+    void setSpeed(Id id, qint64 speed);
+
+    //!< @brief Set a task's received and total bytes and update the sums.
+    void setProgress(Id id, qint64 received, qint64 total);
+
+    //!< @brief Move a task to a queue (and its share of the sums with it).
+    void setQueue(Id id, const QString& queue);
+
+    //!< @brief Move a task to a host (and its share of the sums with it).
+    void setHost(Id id, const QString& host);
+
+    //!< @brief Return the sums over every registered task.
+    const Totals& totals() const { return m_totals; }
+
+    //!< @brief Return the sums over the tasks of a queue.
+    Totals queueTotals(const QString& queue) const;
+
+    //!< @brief Return the sums over the tasks of a host.
+    Totals hostTotals(const QString& host) const;
+
+    //!< @brief Received bytes at the previous progress event.
+    qint64& lastReceived(Id id) { return m_lastReceived[id]; }
+    qint64 lastReceived(Id id) const { return m_lastReceived.at(id); }
+
+    //!< @brief Per-task speed limit in bytes/sec (0 = unlimited).
+    qint64& maxSpeed(Id id) { return m_maxSpeed[id]; }
+    qint64 maxSpeed(Id id) const { return m_maxSpeed.at(id); }
+
+    //!< @brief Scheduling priority.
+    int& priority(Id id) { return m_priority[id]; }
+    int priority(Id id) const { return m_priority.at(id); }
+
+    //!< @brief Return the registration order (earlier tasks compare lower).
+    qint64 createdOrder(Id id) const { return m_createdOrder.at(id); }
+
+    //!< @brief Return whether the manager paused the task for @p cause.
+    bool pausedBy(Id id, PauseCause cause) const { return (m_paused.at(id) & cause) != 0; }
+
+    //!< @brief Set or clear a pause cause.
+    void setPausedBy(Id id, PauseCause cause, bool paused);
+
+    //!< @brief Rarely used fields of a row.
+    Cold& cold(Id id) { return m_cold[id]; }
+    const Cold& cold(Id id) const { return m_cold.at(id); }
+
+    /**
+     * @brief Call @p fn(id, task) for every registered task in row order.
+     * @param fn Callback; must not add or remove tasks.
+     */
+    template <typename Fn>
+    void forEach(Fn&& fn) const
+    {
+        for (Id i = 0; i < rows(); ++i) {
+            if (QObject* t = m_tasks.at(i)) fn(i, t);
+        }
+    }
+
+private:
+    //!< @brief Add a row's values, scaled by @p sign, to the sums it belongs to.
+    void account(Id id, int sign);
+
+    //!< @brief Return the breakdown slot of a name, creating it on first use.
+    static int slotFor(QHash<QString, int>& slots, QVector<Totals>& totals, const QString& name);
+
+    QHash<const QObject*, Id> m_ids;        //!< Row of each registered task.
+    QVector<QObject*> m_tasks;              //!< Task of each row (nullptr = free).
+    QVector<Id> m_free;                     //!< Free rows, reused last-in first-out.
+    qint64 m_orderCounter = 0;              //!< Last creation order handed out.
+
+    // Hot columns, one entry per row.
+    QVector<qint64> m_speed;                //!< Current speed.
+    QVector<qint64> m_received;             //!< Received bytes.
+    QVector<qint64> m_total;                //!< Total bytes.
+    QVector<qint64> m_lastReceived;         //!< Received bytes at the last progress event.
+    QVector<qint64> m_maxSpeed;             //!< Speed limits.
+    QVector<int> m_priority;                //!< Priorities.
+    QVector<qint64> m_createdOrder;         //!< Creation order.
+    QVector<quint8> m_paused;               //!< PauseCause bits.
+    QVector<int> m_queueSlot;               //!< Queue breakdown slot (-1 = none).
+    QVector<int> m_hostSlot;                //!< Host breakdown slot (-1 = none).
+
+    QVector<Cold> m_cold;                   //!< Cold rows.
+
+    Totals m_totals;                        //!< Sums over every row.
+    QHash<QString, int> m_queueSlots;       //!< Breakdown slot of each queue name.
+    QHash<QString, int> m_hostSlots;        //!< Breakdown slot of each host.
+    QVector<Totals> m_queueTotals;          //!< Sums per queue slot.
+    QVector<Totals> m_hostTotals;           //!< Sums per host slot.
+};
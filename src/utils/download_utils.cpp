@@ -3,7 +3,11 @@ module;
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QRegularExpression>
+#include <QSaveFile>
 #include <QStringList>
 #include <QUrlQuery>
 #include <QtGlobal>
@@ -53,15 +57,207 @@ QString normalizeFilePath(const QString& path)
     return path;
 }
 
+QString placementDataPath(const QString& filePath)
+{
+    return filePath + ".raad";
+}
+
+QString placementMapPath(const QString& filePath)
+{
+    return filePath + ".raad.map";
+}
+
+QString blockManifestPath(const QString& filePath)
+{
+    return filePath + ".raad.blocks";
+}
+
+QString segmentJournalPath(const QString& filePath)
+{
+    return filePath + ".raad.journal";
+}
+
+static bool appendJournalRecord(const QString& filePath, const QJsonObject& record)
+{
+    QFile file(segmentJournalPath(filePath));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) return false;
+    // One record per line, so a crash can only tear the last one.
+    const QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n';
+    return file.write(line) == line.size() && file.flush();
+}
+
+bool readSegmentJournal(const QString& filePath, qint64* totalSize, QList<PlacementRange>* ranges)
+{
+    QFile file(segmentJournalPath(filePath));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    qint64 total = 0;
+    QList<PlacementRange> parsed;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (!line.endsWith('\n')) break;
+        const QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (!doc.isObject()) break;
+        const QJsonObject record = doc.object();
+        const QString op = record.value("op").toString();
+
+        if (op == QStringLiteral("layout")) {
+            if (record.value("version").toInt() != 1) break;
+            total = static_cast<qint64>(record.value("totalSize").toDouble(0));
+            if (total <= 0) break;
+            QList<PlacementRange> layout;
+            bool valid = true;
+            for (const QJsonValue& v : record.value("ranges").toArray()) {
+                const QJsonArray item = v.toArray();
+                PlacementRange r;
+                r.start = static_cast<qint64>(item.at(0).toDouble(-1));
+                r.end = static_cast<qint64>(item.at(1).toDouble(-1));
+                r.done = static_cast<qint64>(item.at(2).toDouble(0));
+                valid = valid && item.size() == 3 && r.start >= 0 && r.end >= r.start && r.end < total;
+                r.done = qBound<qint64>(0, r.done, r.end - r.start + 1);
+                layout.append(r);
+            }
+            if (!valid || layout.isEmpty()) break;
+            parsed = layout;
+        } else if (op == QStringLiteral("split") && !parsed.isEmpty()) {
+            const int donor = record.value("donor").toInt(-1);
+            const qint64 donorEnd = static_cast<qint64>(record.value("end").toDouble(-1));
+            const qint64 tailEnd = static_cast<qint64>(record.value("tailEnd").toDouble(-1));
+            if (donor < 0 || donor >= parsed.size()) break;
+            PlacementRange& d = parsed[donor];
+            if (donorEnd < d.start || donorEnd >= tailEnd || tailEnd > d.end) break;
+            d.end = donorEnd;
+            d.done = qMin(d.done, d.end - d.start + 1);
+            parsed.append(PlacementRange{ donorEnd + 1, tailEnd, 0 });
+        } else if (op == QStringLiteral("commit") && !parsed.isEmpty()) {
+            const QJsonArray done = record.value("done").toArray();
+            if (done.size() != parsed.size()) break;
+            for (qsizetype i = 0; i < parsed.size(); ++i) {
+                PlacementRange& r = parsed[i];
+                r.done = qBound<qint64>(0, static_cast<qint64>(done.at(i).toDouble(0)), r.end - r.start + 1);
+            }
+        } else {
+            break;
+        }
+    }
+    if (parsed.isEmpty()) return false;
+
+    if (totalSize) *totalSize = total;
+    if (ranges) *ranges = parsed;
+    return true;
+}
+
+bool resetSegmentJournal(const QString& filePath, qint64 totalSize, const QList<PlacementRange>& ranges)
+{
+    QJsonArray items;
+    for (const PlacementRange& r : ranges) {
+        items.append(QJsonArray{ static_cast<double>(r.start),
+                                 static_cast<double>(r.end),
+                                 static_cast<double>(r.done) });
+    }
+    QJsonObject record;
+    record.insert("op", QStringLiteral("layout"));
+    record.insert("version", 1);
+    record.insert("totalSize", static_cast<double>(totalSize));
+    record.insert("ranges", items);
+
+    QSaveFile file(segmentJournalPath(filePath));
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+    return file.commit();
+}
+
+bool appendSegmentSplit(const QString& filePath, int donor, qint64 donorEnd, qint64 tailEnd)
+{
+    QJsonObject record;
+    record.insert("op", QStringLiteral("split"));
+    record.insert("donor", donor);
+    record.insert("end", static_cast<double>(donorEnd));
+    record.insert("tailEnd", static_cast<double>(tailEnd));
+    return appendJournalRecord(filePath, record);
+}
+
+bool appendSegmentCommit(const QString& filePath, const QList<qint64>& done)
+{
+    QJsonArray items;
+    for (qint64 value : done) items.append(static_cast<double>(value));
+    QJsonObject record;
+    record.insert("op", QStringLiteral("commit"));
+    record.insert("done", items);
+    return appendJournalRecord(filePath, record);
+}
+
+bool readPlacementMap(const QString& filePath, qint64* totalSize, QList<PlacementRange>* ranges)
+{
+    QFile file(placementMapPath(filePath));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+    if (!doc.isObject()) return false;
+
+    const QJsonObject root = doc.object();
+    if (root.value("version").toInt() != 1) return false;
+    const qint64 total = static_cast<qint64>(root.value("totalSize").toDouble(0));
+    if (total <= 0) return false;
+
+    QList<PlacementRange> parsed;
+    const QJsonArray items = root.value("ranges").toArray();
+    for (const QJsonValue& v : items) {
+        const QJsonArray item = v.toArray();
+        if (item.size() != 3) return false;
+        PlacementRange r;
+        r.start = static_cast<qint64>(item.at(0).toDouble(-1));
+        r.end = static_cast<qint64>(item.at(1).toDouble(-1));
+        r.done = static_cast<qint64>(item.at(2).toDouble(0));
+        if (r.start < 0 || r.end < r.start || r.end >= total) return false;
+        r.done = qBound<qint64>(0, r.done, r.end - r.start + 1);
+        parsed.append(r);
+    }
+    if (parsed.isEmpty()) return false;
+
+    if (totalSize) *totalSize = total;
+    if (ranges) *ranges = parsed;
+    return true;
+}
+
+bool writePlacementMap(const QString& filePath, qint64 totalSize, const QList<PlacementRange>& ranges)
+{
+    QJsonArray items;
+    for (const PlacementRange& r : ranges) {
+        items.append(QJsonArray{ static_cast<double>(r.start),
+                                 static_cast<double>(r.end),
+                                 static_cast<double>(r.done) });
+    }
+    QJsonObject root;
+    root.insert("version", 1);
+    root.insert("totalSize", static_cast<double>(totalSize));
+    root.insert("ranges", items);
+
+    QSaveFile file(placementMapPath(filePath));
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
 qint64 bytesReceivedOnDisk(const QString& filePath, int segments)
 {
     const QString localPath = normalizeFilePath(filePath);
     if (localPath.isEmpty()) return 0;
 
+    QList<PlacementRange> placed;
+    if (QFileInfo::exists(placementDataPath(localPath)) && readPlacementMap(localPath, nullptr, &placed)) {
+        qint64 placedTotal = 0;
+        for (const PlacementRange& r : placed) placedTotal += r.done;
+        return placedTotal;
+    }
+
     qint64 partsTotal = 0;
     bool anyParts = false;
 
-    const int maxParts = qMax(1, segments);
+    // Dynamic splits add parts beyond the configured segment count.
+    QList<PlacementRange> journal;
+    readSegmentJournal(localPath, nullptr, &journal);
+    const int maxParts = qMax(1, qMax(segments, static_cast<int>(journal.size())));
     for (int i = 0; i < maxParts; ++i) {
         const QString partPath = QString("%1.part%2").arg(localPath).arg(i);
         QFileInfo info(partPath);
@@ -204,6 +400,31 @@ QString detectChecksumAlgo(const QString& expected)
     return QString();
 }
 
+QString resolveChecksumAlgo(const QString& algo, const QString& expected)
+{
+    QString resolved = algo.trimmed();
+    if (resolved.isEmpty() && !expected.trimmed().isEmpty()) {
+        resolved = detectChecksumAlgo(expected.trimmed());
+    }
+    if (resolved.isEmpty()) {
+        resolved = QStringLiteral("SHA256");
+    }
+    return resolved;
+}
+
+bool checksumHashAlgorithm(const QString& algo, QCryptographicHash::Algorithm* out)
+{
+    const QString upper = algo.trimmed().toUpper();
+    QCryptographicHash::Algorithm hashAlgo = QCryptographicHash::Sha256;
+    if (upper == QStringLiteral("MD5")) hashAlgo = QCryptographicHash::Md5;
+    else if (upper == QStringLiteral("SHA1")) hashAlgo = QCryptographicHash::Sha1;
+    else if (upper == QStringLiteral("SHA256")) hashAlgo = QCryptographicHash::Sha256;
+    else if (upper == QStringLiteral("SHA512")) hashAlgo = QCryptographicHash::Sha512;
+    else return false;
+    if (out) *out = hashAlgo;
+    return true;
+}
+
 QString extractChecksumFromText(const QString& text, const QString& fileName, const QString& preferredAlgo)
 {
     const QString normalizedFileName = QFileInfo(fileName.trimmed()).fileName().toLower();
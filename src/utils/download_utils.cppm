@@ -16,6 +16,8 @@
  */
 
 module;
+#include <QCryptographicHash>
+#include <QList>
 #include <QUrl>
 #include <QString>
 #include <QtGlobal>
@@ -43,11 +45,123 @@ RAAD_MODULE_EXPORT namespace raad::utils {
  */
 QString normalizeFilePath(const QString& path);
 
+/**
+ * @brief Byte range tracked by a direct-placement progress map or segment journal.
+ *
+ * Offsets are absolute positions inside the final output file.
+ */
+struct PlacementRange {
+    qint64 start = 0;       //!< First byte offset of the range.
+    qint64 end = 0;         //!< Last byte offset of the range (inclusive).
+    qint64 done = 0;        //!< Bytes committed from @ref start onwards.
+};
+
+/**
+ * @brief Returns the preallocated data file used by direct-placement downloads.
+ *
+ * @param filePath Final target file path.
+ * @return Path of the in-progress data file.
+ */
+QString placementDataPath(const QString& filePath);
+
+/**
+ * @brief Returns the sidecar progress map for a direct-placement download.
+ *
+ * @param filePath Final target file path.
+ * @return Path of the progress map file.
+ */
+QString placementMapPath(const QString& filePath);
+
+/**
+ * @brief Returns the sidecar block checksum manifest for a download.
+ *
+ * @param filePath Final target file path.
+ * @return Path of the block manifest file.
+ */
+QString blockManifestPath(const QString& filePath);
+
+/**
+ * @brief Returns the segment journal used by downloads written to `.partN` files.
+ *
+ * @param filePath Final target file path.
+ * @return Path of the journal file.
+ */
+QString segmentJournalPath(const QString& filePath);
+
+/**
+ * @brief Replays the segment journal of a target file.
+ *
+ * Records are applied in order up to the first one that is torn or invalid,
+ * which is where a crash interrupted the last append.
+ *
+ * @param filePath Final target file path.
+ * @param totalSize Receives the total size recorded in the journal.
+ * @param ranges Receives the segment ranges (index i lives in `.part<i>`) and their last committed counts.
+ * @return true if at least a layout record was recovered, false otherwise.
+ */
+bool readSegmentJournal(const QString& filePath, qint64* totalSize, QList<PlacementRange>* ranges);
+
+/**
+ * @brief Atomically replaces the segment journal with a single layout record.
+ *
+ * @param filePath Final target file path.
+ * @param totalSize Total size of the download.
+ * @param ranges Segment ranges with their committed byte counts.
+ * @return true if the journal was written, false otherwise.
+ */
+bool resetSegmentJournal(const QString& filePath, qint64 totalSize, const QList<PlacementRange>& ranges);
+
+/**
+ * @brief Appends a dynamic split to the segment journal.
+ *
+ * The donor segment now ends at @p donorEnd and a new segment covering
+ * (@p donorEnd, @p tailEnd] is appended after the existing ones.
+ *
+ * @param filePath Final target file path.
+ * @param donor Index of the segment that was shortened.
+ * @param donorEnd New last byte offset of the donor (inclusive).
+ * @param tailEnd Last byte offset of the new segment (inclusive).
+ * @return true if the record was flushed, false otherwise.
+ */
+bool appendSegmentSplit(const QString& filePath, int donor, qint64 donorEnd, qint64 tailEnd);
+
+/**
+ * @brief Appends the committed byte count of every segment to the segment journal.
+ *
+ * @param filePath Final target file path.
+ * @param done Committed bytes per segment, in segment order.
+ * @return true if the record was flushed, false otherwise.
+ */
+bool appendSegmentCommit(const QString& filePath, const QList<qint64>& done);
+
+/**
+ * @brief Reads the direct-placement progress map for a target file.
+ *
+ * @param filePath Final target file path.
+ * @param totalSize Receives the total size recorded in the map.
+ * @param ranges Receives the recorded segment ranges.
+ * @return true if a well-formed map was found, false otherwise.
+ */
+bool readPlacementMap(const QString& filePath, qint64* totalSize, QList<PlacementRange>* ranges);
+
+/**
+ * @brief Atomically writes the direct-placement progress map for a target file.
+ *
+ * @param filePath Final target file path.
+ * @param totalSize Total size of the download.
+ * @param ranges Segment ranges with their committed byte counts.
+ * @return true if the map was written, false otherwise.
+ */
+bool writePlacementMap(const QString& filePath, qint64 totalSize, const QList<PlacementRange>& ranges);
+
 /**
  * @brief Calculates the total number of bytes received on disk.
  *
- * Sums the sizes of the main file and any associated partial segment files
- * (e.g. `.part` files) to determine total downloaded progress.
+ * Uses the direct-placement progress map when present, since its data file
+ * is preallocated and its size says nothing about progress. Otherwise sums
+ * the sizes of the main file and any associated partial segment files
+ * (e.g. `.part` files, including split segments listed in the journal) to
+ * determine total downloaded progress.
  *
  * @param filePath Target file path.
  * @param segments Number of download segments.
@@ -129,6 +243,26 @@ QString normalizeChecksum(const QString& value);
  */
 QString detectChecksumAlgo(const QString& expected);
 
+/**
+ * @brief Resolves the checksum algorithm to use for a task.
+ *
+ * Falls back to detection from @p expected, then to SHA256.
+ *
+ * @param algo Configured algorithm name (may be empty).
+ * @param expected Expected checksum value (may be empty).
+ * @return Algorithm name.
+ */
+QString resolveChecksumAlgo(const QString& algo, const QString& expected);
+
+/**
+ * @brief Maps a checksum algorithm name to a QCryptographicHash algorithm.
+ *
+ * @param algo Algorithm name (MD5, SHA1, SHA256, SHA512; case-insensitive).
+ * @param out Receives the hash algorithm.
+ * @return False if the name is not supported.
+ */
+bool checksumHashAlgorithm(const QString& algo, QCryptographicHash::Algorithm* out);
+
 /**
  * @brief Extracts a checksum from checksum file text.
  *
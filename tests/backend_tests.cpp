@@ -1,5 +1,23 @@
 #include <QtTest/QtTest>
+#include <QHttp1Configuration>
+#include <QNetworkAccessManager>
+#include <QNetworkProxy>
+#include <QNetworkRequest>
+#include <QTcpServer>
+#include <QTcpSocket>
 
+import raad.core.chunkring;
+import raad.core.connectionarbiter;
+import raad.core.diskwriter;
+import raad.core.hostprofile;
+import raad.core.networksession;
+import raad.core.partmerger;
+import raad.core.rangeengine;
+import raad.core.ratelimiter;
+import raad.core.readyqueue;
+import raad.core.segmentcontroller;
+import raad.core.streamhash;
+import raad.core.taskregistry;
 import raad.utils.version_utils;
 import raad.utils.download_utils;
 import raad.utils.category_utils;
@@ -18,6 +36,22 @@ private slots:
     void extractChecksumFromText();
     void normalizeHost();
     void detectCategory();
+    void placementMapResume();
+    void segmentJournalReplay();
+    void chunkRingSlices();
+    void streamHashOutOfOrder();
+    void blockManifestResume();
+    void networkSessionSharing();
+    void segmentControllerAimd();
+    void hostProfileLearning();
+    void connectionArbiterBudget();
+    void rateLimiterHierarchy();
+    void rangeEngineLoopback();
+    void diskWriterReserve();
+    void partMergerLadder();
+    void taskRegistryRows();
+    void taskRegistryTotals();
+    void readyQueueOrdering();
 };
 
 void BackendTests::compareVersions_data()
@@ -97,5 +131,685 @@ void BackendTests::detectCategory()
     QCOMPARE(utils::toString(utils::detectCategory(QStringLiteral("unknown.customext"))), QStringLiteral("Other"));
 }
 
+void BackendTests::placementMapResume()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString target = dir.filePath(QStringLiteral("image.iso"));
+
+    QFile data(utils::placementDataPath(target));
+    QVERIFY(data.open(QIODevice::WriteOnly));
+    QVERIFY(data.resize(1000));
+    data.close();
+
+    const QList<utils::PlacementRange> ranges{
+        { 0, 499, 120 },
+        { 500, 999, 600 } // clamped to the range length on read
+    };
+    QVERIFY(utils::writePlacementMap(target, 1000, ranges));
+
+    qint64 total = 0;
+    QList<utils::PlacementRange> restored;
+    QVERIFY(utils::readPlacementMap(target, &total, &restored));
+    QCOMPARE(total, qint64(1000));
+    QCOMPARE(restored.size(), 2);
+    QCOMPARE(restored.at(1).start, qint64(500));
+    QCOMPARE(restored.at(1).done, qint64(500));
+
+    // Preallocated size must not be mistaken for progress.
+    QCOMPARE(utils::bytesReceivedOnDisk(target, 2), qint64(620));
+}
+
+void BackendTests::segmentJournalReplay()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString target = dir.filePath(QStringLiteral("video.mkv"));
+
+    QVERIFY(utils::resetSegmentJournal(target, 1000, { { 0, 499, 0 }, { 500, 999, 0 } }));
+    QVERIFY(utils::appendSegmentCommit(target, { 100, 50 }));
+    // Segment 1 gives its tail [800, 999] to a new segment 2.
+    QVERIFY(utils::appendSegmentSplit(target, 1, 799, 999));
+    QVERIFY(utils::appendSegmentCommit(target, { 200, 120, 30 }));
+    {
+        // A crash in the middle of an append leaves a torn last line.
+        QFile journal(utils::segmentJournalPath(target));
+        QVERIFY(journal.open(QIODevice::Append));
+        journal.write("{\"op\":\"commit\",\"done\":[300,");
+    }
+
+    qint64 total = 0;
+    QList<utils::PlacementRange> ranges;
+    QVERIFY(utils::readSegmentJournal(target, &total, &ranges));
+    QCOMPARE(total, qint64(1000));
+    QCOMPARE(ranges.size(), 3);
+    QCOMPARE(ranges.at(1).end, qint64(799));
+    QCOMPARE(ranges.at(2).start, qint64(800));
+    QCOMPARE(ranges.at(2).end, qint64(999));
+    QCOMPARE(ranges.at(0).done, qint64(200));
+    QCOMPARE(ranges.at(2).done, qint64(30));
+
+    // Parts created by the split count towards progress.
+    for (int i = 0; i < 3; ++i) {
+        QFile part(QStringLiteral("%1.part%2").arg(target).arg(i));
+        QVERIFY(part.open(QIODevice::WriteOnly));
+        QVERIFY(part.resize(ranges.at(i).done));
+    }
+    QCOMPARE(utils::bytesReceivedOnDisk(target, 2), qint64(350));
+}
+
+void BackendTests::chunkRingSlices()
+{
+    // Span three blocks so peek/consume cross block boundaries.
+    QByteArray payload(static_cast<qsizetype>(BlockPool::kBlockSize * 2 + 100), Qt::Uninitialized);
+    for (qsizetype i = 0; i < payload.size(); ++i) payload[i] = static_cast<char>(i % 251);
+
+    ChunkRing ring;
+    ring.append(payload.constData(), payload.size());
+    QCOMPARE(ring.size(), qint64(payload.size()));
+    QCOMPARE(ring.memoryBytes(), BlockPool::kBlockSize * 3);
+
+    const qint64 first = BlockPool::kBlockSize + 10;
+    const QVector<BufferSlice> head = ring.peek(first);
+    QCOMPARE(head.size(), 2);
+    QByteArray gathered;
+    for (const BufferSlice& slice : head) gathered.append(slice.data(), slice.length);
+    QCOMPARE(gathered, payload.left(first));
+
+    ring.consume(first);
+    QCOMPARE(ring.size(), qint64(payload.size()) - first);
+    QCOMPARE(ring.memoryBytes(), BlockPool::kBlockSize * 2);
+
+    gathered.clear();
+    for (const BufferSlice& slice : ring.takeAll()) gathered.append(slice.data(), slice.length);
+    QCOMPARE(gathered, payload.mid(first));
+    QVERIFY(ring.isEmpty());
+    QCOMPARE(ring.memoryBytes(), qint64(0));
+}
+
+void BackendTests::streamHashOutOfOrder()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QByteArray payload(300000, Qt::Uninitialized);
+    for (qsizetype i = 0; i < payload.size(); ++i) payload[i] = static_cast<char>(i % 241);
+    const QByteArray expected = QCryptographicHash::hash(payload, QCryptographicHash::Sha256);
+
+    // Two ranges in separate part files; the second one is committed first.
+    const qint64 split = 120000;
+    const QString part0 = dir.filePath(QStringLiteral("f.part0"));
+    const QString part1 = dir.filePath(QStringLiteral("f.part1"));
+    StreamHasher hasher(QCryptographicHash::Sha256);
+    hasher.setLayout({ { 0, split, part0, 0 }, { split, payload.size(), part1, 0 } });
+    const quint64 generation = hasher.generation();
+
+    auto commit = [&](const QString& path, qint64 fileOffset, qint64 offset, qint64 length) {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.seek(fileOffset));
+        QCOMPARE(file.write(payload.constData() + offset, length), length);
+        file.close();
+        hasher.written(generation, offset, { BufferSlice::fromBytes(payload.mid(offset, length)) });
+    };
+
+    commit(part1, 0, split, 50000);
+    QCOMPARE(hasher.hashedBytes(), qint64(0));
+    commit(part0, 0, 0, split);
+    // Reaching the recorded range reads it back from part1.
+    QCOMPARE(hasher.hashedBytes(), split + 50000);
+    commit(part1, 50000, split + 50000, payload.size() - split - 50000);
+    QCOMPARE(hasher.completedDigest(payload.size()), expected);
+    QVERIFY(!hasher.isValid());
+
+    // A write from before restart() must not leak into the new run.
+    hasher.restart();
+    hasher.written(generation, 0, { BufferSlice::fromBytes(payload.left(10)) });
+    QCOMPARE(hasher.hashedBytes(), qint64(0));
+}
+
+void BackendTests::blockManifestResume()
+{
+    QCOMPARE(crc32c(0, "123456789", 9), quint32(0xE3069283));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const qint64 block = BlockManifest::kBlockSize;
+    QByteArray payload(2 * block + 12345, Qt::Uninitialized);
+    for (qsizetype i = 0; i < payload.size(); ++i) payload[i] = static_cast<char>((i * 7) % 253);
+    const QString dataPath = dir.filePath(QStringLiteral("f.raad"));
+    const QString sidecar = dir.filePath(QStringLiteral("f.raad.blocks"));
+    {
+        QFile file(dataPath);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QCOMPARE(file.write(payload), qint64(payload.size()));
+    }
+
+    // Only the first block and a bit more were committed before the "crash".
+    {
+        BlockManifest manifest(payload.size());
+        manifest.setLayout({ { 0, payload.size(), dataPath, 0 } });
+        manifest.written(manifest.generation(), 0, { BufferSlice::fromBytes(payload.left(block + 1000)) });
+        QVERIFY(manifest.isBlockDone(0));
+        QVERIFY(!manifest.isBlockDone(1));
+        QVERIFY(manifest.save(sidecar));
+    }
+    auto loaded = BlockManifest::load(sidecar, payload.size());
+    QVERIFY(loaded);
+    QVERIFY(!BlockManifest::load(sidecar, payload.size() + 1));
+    loaded->setLayout({ { 0, payload.size(), dataPath, 0 } });
+    // A larger claim (e.g. file size) is cut back to the checksummed prefix.
+    QCOMPARE(loaded->verifiedEnd(0, payload.size()), block + 1000);
+
+    // Finish the rest, then damage the last block on disk.
+    loaded->written(loaded->generation(), block + 1000, { BufferSlice::fromBytes(payload.mid(block + 1000)) });
+    QVERIFY(loaded->isBlockDone(2));
+    QVERIFY(loaded->save(sidecar));
+    {
+        QFile file(dataPath);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.seek(2 * block + 10));
+        QCOMPARE(file.write("x", 1), qint64(1));
+    }
+    QList<int> bad;
+    QVERIFY(loaded->verifyFile(dataPath, &bad));
+    QCOMPARE(bad, QList<int>{ 2 });
+
+    auto reloaded = BlockManifest::load(sidecar, payload.size());
+    QVERIFY(reloaded);
+    reloaded->setLayout({ { 0, payload.size(), dataPath, 0 } });
+    QCOMPARE(reloaded->verifiedEnd(0, payload.size()), 2 * block);
+    QVERIFY(!reloaded->isBlockDone(2));
+}
+
+void BackendTests::networkSessionSharing()
+{
+    NetworkSessionPool& pool = NetworkSessionPool::instance();
+    const QNetworkProxy direct(QNetworkProxy::DefaultProxy);
+    const QNetworkProxy proxied(QNetworkProxy::HttpProxy, QStringLiteral("127.0.0.1"), 3128);
+
+    // Tasks with the same proxy settings share one manager; other settings get their own.
+    QNetworkAccessManager* a = pool.acquire(direct);
+    QNetworkAccessManager* b = pool.acquire(QNetworkProxy(QNetworkProxy::NoProxy));
+    QNetworkAccessManager* c = pool.acquire(proxied);
+    QVERIFY(a);
+    QCOMPARE(a, b);
+    QVERIFY(c != a);
+    QCOMPARE(pool.borrowers(a), 2);
+    QCOMPARE(c->proxy().hostName(), QStringLiteral("127.0.0.1"));
+
+    // An unborrowed session lingers so the next task reuses its connections.
+    pool.release(a);
+    pool.release(b);
+    QCOMPARE(pool.borrowers(a), 0);
+    QCOMPARE(pool.acquire(direct), a);
+    pool.release(a);
+    pool.release(c);
+
+    const int previous = pool.connectionsPerHost();
+    pool.setConnectionsPerHost(1000);
+    QCOMPARE(pool.connectionsPerHost(), NetworkSessionPool::kMaxConnectionsPerHost);
+    QNetworkRequest req(QUrl(QStringLiteral("https://example.com/file.bin")));
+    pool.prepare(req);
+    QCOMPARE(req.http1Configuration().numberOfConnectionsPerHost(), qsizetype(NetworkSessionPool::kMaxConnectionsPerHost));
+    pool.setConnectionsPerHost(previous);
+}
+
+void BackendTests::segmentControllerAimd()
+{
+    SegmentController controller;
+    controller.reset(4);
+    auto window = [&controller](int connections, qint64 mibPerSec) {
+        SegmentController::Sample sample;
+        sample.connections = connections;
+        sample.bytesPerSec = mibPerSec * 1024 * 1024;
+        return controller.update(sample, 0);
+    };
+
+    // Saturated target: probe one more connection; it paid off, so grow again.
+    QCOMPARE(window(4, 40), 5);
+    QCOMPARE(window(5, 50), 6);
+    QCOMPARE(controller.trace().constLast().action, SegmentController::Action::Grow);
+
+    // The sixth connection added almost nothing: go back and hold before probing again.
+    QCOMPARE(window(6, 51), 5);
+    QCOMPARE(controller.trace().constLast().action, SegmentController::Action::Revert);
+    for (int i = 0; i < SegmentController::kHoldWindows; ++i) {
+        QCOMPARE(window(5, 50), 5);
+    }
+    QCOMPARE(window(5, 50), 6);
+    QCOMPARE(controller.trace().constLast().action, SegmentController::Action::Probe);
+
+    // Server throttling cuts the target multiplicatively.
+    SegmentController::Sample throttled;
+    throttled.connections = 6;
+    throttled.bytesPerSec = 50ll * 1024 * 1024;
+    throttled.serverThrottle = 1;
+    QCOMPARE(controller.update(throttled, 0), 4);
+    QCOMPARE(controller.trace().constLast().action, SegmentController::Action::Backoff);
+    QVERIFY(controller.traceLines().constLast().startsWith(QStringLiteral("backoff 6 -> 4")));
+
+    // No probing while the controller holds after a backoff.
+    QCOMPARE(window(2, 20), 4);
+}
+
+void BackendTests::hostProfileLearning()
+{
+    HostProfileStore store;
+    QCOMPARE(store.profile(QStringLiteral("cdn.example.com")).segments, 0);
+
+    HostObservation run;
+    run.segments = 12;
+    run.bytesPerSec = 40ll * 1024 * 1024;
+    run.rttMs = 80;
+    run.rangeSupport = 1;
+    store.learn(QStringLiteral("cdn.example.com"), run, 1000);
+    HostProfile p = store.profile(QStringLiteral("cdn.example.com"));
+    QCOMPARE(p.segments, 12);
+    QCOMPARE(p.rangeSupport, 1);
+
+    // Later runs blend in; a throttled run pulls the start point below its own best.
+    run.segments = 20;
+    run.throttleEvents = 3;
+    run.rangeSupport = 0;
+    store.learn(QStringLiteral("cdn.example.com"), run, 2000);
+    p = store.profile(QStringLiteral("cdn.example.com"));
+    QCOMPARE(p.segments, 14);
+    QCOMPARE(p.throttleScore, 3);
+    QCOMPARE(p.rangeSupport, 1);
+    QCOMPARE(p.samples, 2);
+
+    // A range verdict expires so the host gets re-checked eventually.
+    HostObservation plain;
+    plain.rangeSupport = -1;
+    store.learn(QStringLiteral("files.example.org"), plain, 5000);
+    const HostProfile rangeless = store.profile(QStringLiteral("files.example.org"));
+    QVERIFY(rangeless.knownRangeless(6000));
+    QVERIFY(!rangeless.knownRangeless(5000 + HostProfile::kRangeVerdictMs));
+
+    HostProfileStore reloaded;
+    reloaded.fromJson(store.toJson());
+    QCOMPARE(reloaded.size(), 2);
+    QCOMPARE(reloaded.profile(QStringLiteral("cdn.example.com")).segments, 14);
+    QCOMPARE(reloaded.profile(QStringLiteral("cdn.example.com")).rttMs, 80);
+    QVERIFY(reloaded.profile(QStringLiteral("files.example.org")).knownRangeless(6000));
+}
+
+void BackendTests::connectionArbiterBudget()
+{
+    ConnectionArbiter& arbiter = ConnectionArbiter::instance();
+    const int previous = arbiter.budget();
+    arbiter.setBudget(12);
+    const QString host = QStringLiteral("arbiter.example.com");
+    int low = 0;
+    int high = 0;
+    int other = 0;
+
+    // The first task may use the whole budget while nobody else wants it.
+    QCOMPARE(arbiter.request(&low, host, 100, 0, 16), 12);
+    QCOMPARE(arbiter.hostConnections(host), 12);
+
+    // A second task on the same host waits; a different host has its own budget.
+    QCOMPARE(arbiter.request(&high, host, 300, 0, 8), 0);
+    QCOMPARE(arbiter.request(&other, QStringLiteral("elsewhere.example.com"), 100, 0, 4), 4);
+    QCOMPARE(arbiter.fairShare(&high), 8);
+    QCOMPARE(arbiter.fairShare(&low), 3);
+
+    // Freed slots go to the waiting task below its share, not back to the one above it.
+    arbiter.report(&low, host, 100, 8);
+    QCOMPARE(arbiter.request(&low, host, 100, 8, 4), 0);
+    QCOMPARE(arbiter.request(&high, host, 300, 0, 8), 4);
+    QCOMPARE(arbiter.hostConnections(host), 12);
+
+    arbiter.leave(&low);
+    arbiter.leave(&high);
+    arbiter.leave(&other);
+    QCOMPARE(arbiter.hostConnections(host), 0);
+    arbiter.setBudget(previous);
+}
+
+void BackendTests::rateLimiterHierarchy()
+{
+    RateLimiter& limiter = RateLimiter::instance();
+    constexpr qint64 kGrant = RateLimiter::kMinGrant;
+    const int parent = limiter.createNode();
+    const int left = limiter.createNode(parent);
+    const int right = limiter.createNode(parent);
+
+    // Without a rate anywhere on the path everything is granted at once.
+    QVERIFY(!limiter.limited(left));
+    QCOMPARE(limiter.acquire(left, 4 * kGrant), 4 * kGrant);
+
+    // A parent limit applies to its children and starts empty.
+    limiter.setRate(parent, 256 * 1024);
+    QVERIFY(limiter.limited(left));
+    QVERIFY(limiter.limited(right));
+    QCOMPARE(limiter.rate(left), qint64(0));
+    QCOMPARE(limiter.acquire(left, kGrant), qint64(0));
+
+    // A parked caller is woken once the refill covers it; tokens the idle sibling left are its own.
+    QObject context;
+    bool woke = false;
+    limiter.waitFor(right, kGrant, &context, 0, [&woke] { woke = true; });
+    QVERIFY(!woke);
+    QTRY_VERIFY_WITH_TIMEOUT(woke, 2000);
+    QCOMPARE(limiter.acquire(right, kGrant), kGrant);
+
+    // The parent caps the sum of its children: what one drains, the other cannot take.
+    QTest::qWait(300);
+    qint64 drained = 0;
+    for (qint64 grant = limiter.acquire(left, 1 << 20); grant > 0; grant = limiter.acquire(left, 1 << 20)) {
+        QVERIFY(grant <= kGrant);
+        drained += grant;
+    }
+    QVERIFY(drained >= RateLimiter::kMinBurst - kGrant);
+    QVERIFY(drained <= RateLimiter::kMinBurst + kGrant);
+    QCOMPARE(limiter.acquire(right, kGrant), qint64(0));
+
+    // A child's own lower limit holds it back while its sibling uses the parent's tokens.
+    limiter.setRate(left, 32 * 1024);
+    QTest::qWait(300);
+    QCOMPARE(limiter.acquire(left, kGrant), qint64(0));
+    QCOMPARE(limiter.acquire(right, kGrant), kGrant);
+
+    limiter.cancelWaits(&context);
+    limiter.removeNode(left);
+    limiter.removeNode(right);
+    limiter.removeNode(parent);
+    QVERIFY(!limiter.limited(left));
+}
+
+void BackendTests::rangeEngineLoopback()
+{
+    RangeEngine::Request request;
+    request.target = "/file.bin?x=1";
+    request.host = "127.0.0.1:8080";
+    request.headers = { { "User-Agent", "raad-test" }, { "Range", "bytes=0-" }, { "Connection", "keep-alive" } };
+    request.ifRange = "\"v1\"";
+    request.from = 100;
+    request.to = 199;
+    const QByteArray head = RangeEngine::requestHead(request);
+    QVERIFY(head.startsWith("GET /file.bin?x=1 HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nRange: bytes=100-199\r\n"));
+    QVERIFY(head.contains("If-Range: \"v1\"\r\nUser-Agent: raad-test\r\n"));
+    QVERIFY(!head.contains("bytes=0-"));
+    QVERIFY(!head.contains("keep-alive"));
+    QVERIFY(head.endsWith("Connection: close\r\n\r\n"));
+
+    if (!RangeEngine::isSupported()) QSKIP("native range transport is Linux only");
+
+    QByteArray source(4096, '\0');
+    for (int i = 0; i < source.size(); ++i) source[i] = static_cast<char>(i * 7 + 3);
+    bool refuseRange = false;
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    connect(&server, &QTcpServer::newConnection, this, [&] {
+        QTcpSocket* socket = server.nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, socket, [&, socket] {
+            if (!socket->peek(socket->bytesAvailable()).contains("\r\n\r\n")) return;
+            socket->readAll();
+            if (refuseRange) {
+                socket->write("HTTP/1.1 200 OK\r\nContent-Length: 4096\r\n\r\n" + source);
+            } else {
+                socket->write("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 1000-2999/4096\r\n"
+                              "Content-Length: 2000\r\nETag: \"abc\"\r\n\r\n" + source.mid(1000, 2000));
+            }
+            socket->disconnectFromHost();
+        });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    });
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("segment.part"));
+    RangeEngine::Request ranged;
+    ranged.address = QHostAddress(QHostAddress::LocalHost);
+    ranged.port = server.serverPort();
+    ranged.target = "/file.bin";
+    ranged.host = "127.0.0.1";
+    ranged.from = 1000;
+    ranged.to = 2999;
+    ranged.totalSize = source.size();
+    ranged.path = path;
+    ranged.fileOffset = 0;
+    qint64 committed = 0;
+    ranged.onCommitted = [&committed](qint64, qint64 length) { committed += length; };
+
+    QList<RangeEngine::Event> events;
+    auto collect = [&events](const RangeEngine::Event& event) { events.append(event); };
+    QVERIFY(RangeEngine::instance().start(ranged, this, collect) > 0);
+    QTRY_VERIFY(!events.isEmpty() && events.constLast().kind == RangeEngine::EventKind::Finished);
+    QCOMPARE(events.constFirst().kind, RangeEngine::EventKind::Headers);
+    QCOMPARE(events.constFirst().status, 206);
+    QCOMPARE(events.constFirst().etag, QByteArray("\"abc\""));
+    QVERIFY(events.constLast().ok);
+    QCOMPARE(events.constLast().bytes, 2000);
+    QCOMPARE(committed, 2000);
+    QFile written(path);
+    QVERIFY(written.open(QIODevice::ReadOnly));
+    QCOMPARE(written.readAll(), source.mid(1000, 2000));
+    written.close();
+
+    // A server that ignores the range fails the transfer instead of writing the wrong bytes.
+    refuseRange = true;
+    events.clear();
+    QVERIFY(RangeEngine::instance().start(ranged, this, collect) > 0);
+    QTRY_VERIFY(!events.isEmpty() && events.constLast().kind == RangeEngine::EventKind::Finished);
+    QVERIFY(!events.constLast().ok);
+    QCOMPARE(events.constLast().errorCode, QStringLiteral("range_refused"));
+    QCOMPARE(events.constLast().bytes, 0);
+    QTRY_COMPARE(RangeEngine::instance().activeTransfers(), 0);
+}
+
+void BackendTests::diskWriterReserve()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString kept = dir.filePath(QStringLiteral("kept.part0"));
+    const QString sized = dir.filePath(QStringLiteral("sized.bin"));
+    const qint64 length = 8 * 1024 * 1024;
+
+    QList<DiskWriterPool::Result> results;
+    DiskWriterPool& pool = DiskWriterPool::instance();
+    const int channel = pool.openChannel(dir.path(), this, [&results](const DiskWriterPool::Result& result) {
+        results.append(result);
+    });
+    int fileId = 0;
+    for (const QString& path : { kept, sized }) {
+        DiskWriterPool::Job reserve;
+        reserve.op = DiskWriterPool::Op::Allocate;
+        reserve.fileId = ++fileId;
+        reserve.path = path;
+        reserve.length = length;
+        reserve.keepSize = path == kept;
+        QVERIFY(pool.submit(channel, std::move(reserve), true));
+        DiskWriterPool::Job close;
+        close.op = DiskWriterPool::Op::Close;
+        close.fileId = fileId;
+        QVERIFY(pool.submit(channel, std::move(close), true));
+    }
+    QTRY_COMPARE(results.size(), 4);
+    pool.closeChannel(channel, true);
+
+    for (const DiskWriterPool::Result& result : std::as_const(results)) {
+        QVERIFY2(result.ok, qPrintable(result.errorMessage));
+        // Either the blocks were reserved in full or the filesystem cannot reserve at all.
+        if (result.op == DiskWriterPool::Op::Allocate) QVERIFY(result.bytes == 0 || result.bytes == length);
+    }
+    // A reservation that keeps the size leaves resume-by-size part files intact.
+    QCOMPARE(QFileInfo(kept).size(), 0);
+    QCOMPARE(QFileInfo(sized).size(), length);
+}
+
+void BackendTests::partMergerLadder()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QByteArray expected;
+    QStringList parts;
+    // Odd sizes leave every part but the first unaligned, so the ladder has to fall through.
+    for (const int size : { 8192, 70001, 12288 }) {
+        QByteArray data(size, '\0');
+        for (int i = 0; i < size; ++i) data[i] = static_cast<char>((i * 31 + parts.size()) & 0xff);
+        parts << dir.filePath(QStringLiteral("merge.part%1").arg(parts.size()));
+        QFile part(parts.constLast());
+        QVERIFY(part.open(QIODevice::WriteOnly));
+        QCOMPARE(part.write(data), data.size());
+        expected += data;
+    }
+
+    for (const bool buffered : { false, true }) {
+        const QString target = dir.filePath(buffered ? QStringLiteral("buffered.bin") : QStringLiteral("ladder.bin"));
+        QFile out(target);
+        QVERIFY(out.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered));
+        PartMerger merger(&out);
+        if (buffered) merger.setFirstStrategy(PartMerger::Strategy::Buffered);
+        for (const QString& part : std::as_const(parts)) {
+            QVERIFY2(merger.append(part), qPrintable(merger.errorMessage()));
+        }
+        out.close();
+        QCOMPARE(merger.size(), expected.size());
+
+        qint64 counted = 0;
+        for (int i = 0; i < PartMerger::kStrategyCount; ++i) {
+            counted += merger.usage(static_cast<PartMerger::Strategy>(i)).bytes;
+        }
+        QCOMPARE(counted, expected.size());
+        if (buffered) QCOMPARE(merger.usage(PartMerger::Strategy::Buffered).parts, 3);
+        QVERIFY(!merger.summary().isEmpty());
+
+        QFile merged(target);
+        QVERIFY(merged.open(QIODevice::ReadOnly));
+        QCOMPARE(merged.readAll(), expected);
+    }
+}
+
+void BackendTests::taskRegistryRows()
+{
+    QObject a;
+    QObject b;
+    QObject c;
+    TaskRegistry registry;
+    const TaskRegistry::Id ida = registry.add(&a);
+    const TaskRegistry::Id idb = registry.add(&b);
+    QCOMPARE(registry.add(&a), ida);
+    QCOMPARE(registry.size(), 2);
+    QVERIFY(registry.createdOrder(ida) < registry.createdOrder(idb));
+
+    registry.setProgress(idb, 4096, 8192);
+    registry.cold(idb).queue = QStringLiteral("Night");
+    registry.setPausedBy(idb, TaskRegistry::PausedByQuota, true);
+    registry.setPausedBy(idb, TaskRegistry::PausedByNetwork, true);
+    registry.setPausedBy(idb, TaskRegistry::PausedByQuota, false);
+    QVERIFY(!registry.pausedBy(idb, TaskRegistry::PausedByQuota));
+    QVERIFY(registry.pausedBy(idb, TaskRegistry::PausedByNetwork));
+
+    // A removed task's row goes to the next task, with every field reset.
+    const qint64 orderB = registry.createdOrder(idb);
+    registry.remove(&b);
+    QCOMPARE(registry.id(&b), TaskRegistry::kNoTask);
+    const TaskRegistry::Id idc = registry.add(&c);
+    QCOMPARE(idc, idb);
+    QCOMPARE(registry.task(idc), &c);
+    QCOMPARE(registry.received(idc), qint64(0));
+    QVERIFY(registry.cold(idc).queue.isEmpty());
+    QVERIFY(!registry.pausedBy(idc, TaskRegistry::PausedByNetwork));
+    QVERIFY(registry.createdOrder(idc) > orderB);
+
+    int visited = 0;
+    registry.forEach([&](TaskRegistry::Id, QObject*) { ++visited; });
+    QCOMPARE(visited, 2);
+    registry.clear();
+    QCOMPARE(registry.size(), 0);
+    QCOMPARE(registry.id(&a), TaskRegistry::kNoTask);
+}
+
+void BackendTests::taskRegistryTotals()
+{
+    QObject a;
+    QObject b;
+    TaskRegistry registry;
+    const TaskRegistry::Id ida = registry.add(&a);
+    const TaskRegistry::Id idb = registry.add(&b);
+    const QString main = QStringLiteral("Main");
+    const QString night = QStringLiteral("Night");
+    const QString host = QStringLiteral("mirror.example");
+    registry.setQueue(ida, main);
+    registry.setQueue(idb, main);
+    registry.setHost(ida, host);
+    registry.setHost(idb, host);
+
+    registry.setProgress(ida, 100, 1000);
+    registry.setProgress(idb, 50, 500);
+    registry.setSpeed(ida, 30);
+    registry.setSpeed(idb, 20);
+    registry.setProgress(ida, 400, 1000);
+    QCOMPARE(registry.totals().received, qint64(450));
+    QCOMPARE(registry.totals().total, qint64(1500));
+    QCOMPARE(registry.totals().speed, qint64(50));
+    QCOMPARE(registry.hostTotals(host).received, qint64(450));
+
+    // Moving a task between queues moves its share of the sums.
+    registry.setQueue(idb, night);
+    QCOMPARE(registry.queueTotals(main).received, qint64(400));
+    QCOMPARE(registry.queueTotals(night).speed, qint64(20));
+    QCOMPARE(registry.queueTotals(QStringLiteral("Unknown")).total, qint64(0));
+
+    registry.remove(&a);
+    QCOMPARE(registry.totals().received, qint64(50));
+    QCOMPARE(registry.totals().speed, qint64(20));
+    QCOMPARE(registry.queueTotals(main).total, qint64(0));
+    QCOMPARE(registry.hostTotals(host).total, qint64(500));
+
+    // A reused row starts from zero.
+    QObject c;
+    const TaskRegistry::Id idc = registry.add(&c);
+    QCOMPARE(idc, ida);
+    QCOMPARE(registry.received(idc), qint64(0));
+    QCOMPARE(registry.totals().total, qint64(500));
+}
+
+void BackendTests::readyQueueOrdering()
+{
+    const QString q = QStringLiteral("Main");
+    const QString a = QStringLiteral("a.example");
+    const QString b = QStringLiteral("b.example");
+    const auto any = [](const QString&) { return true; };
+    ReadyQueue ready;
+    ready.update(0, ReadyQueue::Status::Ready, q, a, 100, 1);
+    ready.update(1, ReadyQueue::Status::Ready, q, a, 100, 2);
+    ready.update(2, ReadyQueue::Status::Ready, q, b, 100, 3);
+    ready.update(3, ReadyQueue::Status::Ready, q, b, 200, 4);
+    QCOMPARE(ready.readyCount(), 4);
+    QCOMPARE(ready.best(q, any), 3);
+
+    // Priority changes reorder; a blocked host yields to the next host's best task.
+    ready.update(3, ReadyQueue::Status::Ready, q, b, 50, 4);
+    QCOMPARE(ready.best(q, any), 0);
+    QCOMPARE(ready.best(q, [&](const QString& host) { return host != a; }), 2);
+    QCOMPARE(ready.best(QStringLiteral("Other"), any), ReadyQueue::kNone);
+
+    ready.update(0, ReadyQueue::Status::Running, q, a, 100, 1);
+    ready.update(2, ReadyQueue::Status::Running, q, b, 100, 3);
+    QCOMPARE(ready.readyCount(), 2);
+    QCOMPARE(ready.running(), 2);
+    QCOMPARE(ready.runningInQueue(q), 2);
+    QCOMPARE(ready.runningOnHost(a), 1);
+    QCOMPARE(ready.best(q, any), 1);
+
+    // Moving a running task to another queue moves its slot with it.
+    ready.update(2, ReadyQueue::Status::Running, QStringLiteral("Night"), b, 100, 3);
+    QCOMPARE(ready.runningInQueue(q), 1);
+    QCOMPARE(ready.runningInQueue(QStringLiteral("Night")), 1);
+
+    ready.remove(0);
+    ready.update(1, ReadyQueue::Status::None, q, a, 100, 2);
+    QCOMPARE(ready.running(), 1);
+    QCOMPARE(ready.runningOnHost(a), 0);
+    QCOMPARE(ready.best(q, any), 3);
+    QCOMPARE(ready.readyQueues(), QStringList {q});
+    ready.clear();
+    QCOMPARE(ready.readyCount(), 0);
+    QVERIFY(ready.readyQueues().isEmpty());
+}
+
 QTEST_MAIN(BackendTests)
 #include "backend_tests.moc"
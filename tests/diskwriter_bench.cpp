@@ -0,0 +1,166 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QTextStream>
+#include <ctime>
+#include <utility>
+
+import raad.core.chunkring;
+import raad.core.diskwriter;
+
+// Compares the disk writer backends on each directory given on the command line,
+// e.g. a tmpfs mount and a real disk:
+//   raad_diskwriter_bench --size 2048 --files 64 /dev/shm /var/tmp
+// Segments are simulated by interleaving chunk writes across several files the way
+// concurrent ranged downloads do.
+
+namespace {
+
+struct BenchResult {
+    bool ok = true;
+    double seconds = 0.0;
+    double cpuSeconds = 0.0;
+    qint64 bytes = 0;
+    qint64 submissions = 0;
+};
+
+BenchResult runBackend(DiskWriterPool::Backend backend, const QString& dir, qint64 totalBytes, qint64 chunkBytes, int files)
+{
+    DiskWriterPool& pool = DiskWriterPool::instance();
+    pool.setBackend(backend);
+
+    QObject receiver;
+    QEventLoop loop;
+    BenchResult out;
+
+    const BufferSlice chunk = BufferSlice::fromBytes(QByteArray(static_cast<qsizetype>(chunkBytes), 'r'));
+    const qint64 chunkCount = totalBytes / chunkBytes;
+    qint64 nextChunk = 0;
+    qint64 doneChunks = 0;
+    int closed = 0;
+    bool closing = false;
+
+    QStringList paths;
+    for (int i = 0; i < files; ++i) {
+        paths << QDir(dir).filePath(QStringLiteral("raad-bench-%1.bin").arg(i));
+        QFile::remove(paths.last());
+    }
+
+    int channel = 0;
+    auto pump = [&] {
+        while (nextChunk < chunkCount) {
+            DiskWriterPool::Job job;
+            job.op = DiskWriterPool::Op::Write;
+            job.fileId = static_cast<int>(nextChunk % files) + 1;
+            job.path = paths.at(job.fileId - 1);
+            job.offset = (nextChunk / files) * chunkBytes;
+            job.data = { chunk };
+            if (!pool.submit(channel, std::move(job))) return;
+            ++nextChunk;
+        }
+        if (closing || doneChunks < chunkCount) return;
+        closing = true;
+        for (int i = 0; i < files; ++i) {
+            DiskWriterPool::Job sync;
+            sync.op = DiskWriterPool::Op::Sync;
+            sync.fileId = i + 1;
+            sync.path = paths.at(i);
+            pool.submit(channel, std::move(sync), true);
+            DiskWriterPool::Job close;
+            close.op = DiskWriterPool::Op::Close;
+            close.fileId = i + 1;
+            pool.submit(channel, std::move(close), true);
+        }
+    };
+
+    channel = pool.openChannel(dir, &receiver, [&](const DiskWriterPool::Result& result) {
+        if (!result.ok) {
+            QTextStream(stderr) << "  " << result.errorCode << ": " << result.errorMessage << Qt::endl;
+            out.ok = false;
+            loop.quit();
+            return;
+        }
+        if (result.op == DiskWriterPool::Op::Write) {
+            ++doneChunks;
+            out.bytes += result.bytes;
+        } else if (result.op == DiskWriterPool::Op::Close && ++closed == files) {
+            loop.quit();
+            return;
+        }
+        pump();
+    });
+
+    const qint64 submissionsBefore = pool.submissionCount();
+    const std::clock_t cpuBefore = std::clock();
+    QElapsedTimer wall;
+    wall.start();
+
+    pump();
+    loop.exec();
+
+    out.seconds = wall.nsecsElapsed() / 1e9;
+    out.cpuSeconds = static_cast<double>(std::clock() - cpuBefore) / CLOCKS_PER_SEC;
+    out.submissions = pool.submissionCount() - submissionsBefore;
+
+    pool.closeChannel(channel, true);
+    for (const QString& path : std::as_const(paths)) {
+        QFile::remove(path);
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Disk writer backend benchmark"));
+    parser.addHelpOption();
+    QCommandLineOption sizeOption(QStringLiteral("size"), QStringLiteral("MiB written per run."), QStringLiteral("mib"), QStringLiteral("1024"));
+    QCommandLineOption chunkOption(QStringLiteral("chunk"), QStringLiteral("Write size in KiB."), QStringLiteral("kib"), QStringLiteral("64"));
+    QCommandLineOption filesOption(QStringLiteral("files"), QStringLiteral("Concurrent segment files."), QStringLiteral("count"), QStringLiteral("32"));
+    parser.addOption(sizeOption);
+    parser.addOption(chunkOption);
+    parser.addOption(filesOption);
+    parser.addPositionalArgument(QStringLiteral("dirs"), QStringLiteral("Directories to write into (e.g. a tmpfs and a disk)."));
+    parser.process(app);
+
+    const qint64 totalBytes = qMax<qint64>(1, parser.value(sizeOption).toLongLong()) * 1024 * 1024;
+    const qint64 chunkBytes = qMax<qint64>(4, parser.value(chunkOption).toLongLong()) * 1024;
+    const int files = qBound(1, parser.value(filesOption).toInt(), 1024);
+    QStringList dirs = parser.positionalArguments();
+    if (dirs.isEmpty()) dirs << QDir::tempPath();
+
+    QList<DiskWriterPool::Backend> backends { DiskWriterPool::Backend::Portable };
+    if (DiskWriterPool::ioUringAvailable()) {
+        backends << DiskWriterPool::Backend::IoUring;
+    } else {
+        QTextStream(stdout) << "io_uring backend unavailable in this build or kernel; measuring qfile only" << Qt::endl;
+    }
+
+    QTextStream out(stdout);
+    out << "dir\tbackend\tMiB/s\tcpu_s/GiB\tsubmits/GiB" << Qt::endl;
+    int status = 0;
+    for (const QString& dir : std::as_const(dirs)) {
+        for (DiskWriterPool::Backend backend : std::as_const(backends)) {
+            const BenchResult r = runBackend(backend, dir, totalBytes, chunkBytes, files);
+            if (!r.ok || r.bytes <= 0) {
+                out << dir << '\t' << DiskWriterPool::backendName(backend) << "\tfailed" << Qt::endl;
+                status = 1;
+                continue;
+            }
+            const double gib = static_cast<double>(r.bytes) / (1024.0 * 1024.0 * 1024.0);
+            out << dir << '\t'
+                << DiskWriterPool::backendName(backend) << '\t'
+                << QString::number(r.bytes / (1024.0 * 1024.0) / r.seconds, 'f', 1) << '\t'
+                << QString::number(r.cpuSeconds / gib, 'f', 3) << '\t'
+                << QString::number(r.submissions / gib, 'f', 0) << Qt::endl;
+        }
+    }
+    return status;
+}
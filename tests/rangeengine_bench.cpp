@@ -0,0 +1,316 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QHostAddress>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTextStream>
+#include <QUrl>
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#if defined(Q_OS_LINUX)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+import raad.core.rangeengine;
+
+// Compares the Qt network path with the native range transport on loopback:
+//   raad_rangeengine_bench --size 2048 --ranges 8 /dev/shm /var/tmp
+// A small in-process server answers ranged GETs with sendfile(), so both clients
+// face the same server cost and differ only in how bytes reach the target file.
+
+namespace {
+
+struct BenchResult {
+    bool ok = true;
+    double seconds = 0.0;
+    double cpuSeconds = 0.0;
+    qint64 bytes = 0;
+};
+
+#if defined(Q_OS_LINUX)
+
+//!< Minimal HTTP/1.1 server: one thread per connection, one ranged GET per connection.
+class LoopbackServer {
+public:
+    explicit LoopbackServer(QString sourcePath) : m_sourcePath(std::move(sourcePath)) {}
+
+    ~LoopbackServer()
+    {
+        m_stopping = true;
+        if (m_listenFd >= 0) ::shutdown(m_listenFd, SHUT_RDWR);
+        if (m_acceptor.joinable()) m_acceptor.join();
+        if (m_listenFd >= 0) ::close(m_listenFd);
+    }
+
+    bool listen()
+    {
+        m_listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (m_listenFd < 0) return false;
+        const int one = 1;
+        ::setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (::bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), len) != 0 || ::listen(m_listenFd, 64) != 0
+            || ::getsockname(m_listenFd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            return false;
+        }
+        m_port = ntohs(addr.sin_port);
+        m_acceptor = std::thread([this] { acceptLoop(); });
+        return true;
+    }
+
+    quint16 port() const { return m_port; }
+
+private:
+    void acceptLoop()
+    {
+        while (!m_stopping) {
+            const int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (m_stopping) return;
+                continue;
+            }
+            std::thread([this, fd] { serve(fd); }).detach();
+        }
+    }
+
+    void serve(int fd)
+    {
+        QByteArray head;
+        char buffer[4096];
+        while (!head.contains("\r\n\r\n") && head.size() < 65536) {
+            const ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                ::close(fd);
+                return;
+            }
+            head.append(buffer, n);
+        }
+
+        const int file = ::open(QFile::encodeName(m_sourcePath).constData(), O_RDONLY | O_CLOEXEC);
+        const qint64 size = file >= 0 ? ::lseek(file, 0, SEEK_END) : 0;
+        qint64 from = 0;
+        qint64 to = size - 1;
+        const int range = head.indexOf("Range: bytes=");
+        if (range >= 0) {
+            const int lineEnd = head.indexOf("\r\n", range);
+            const QList<QByteArray> bounds = head.mid(range + 13, lineEnd - range - 13).split('-');
+            from = bounds.value(0).toLongLong();
+            if (bounds.size() > 1 && !bounds.at(1).isEmpty()) to = qMin(size - 1, bounds.at(1).toLongLong());
+        }
+
+        QByteArray reply = "HTTP/1.1 206 Partial Content\r\nContent-Type: application/octet-stream\r\n";
+        reply += "Content-Range: bytes " + QByteArray::number(from) + '-' + QByteArray::number(to) + '/'
+                 + QByteArray::number(size) + "\r\n";
+        reply += "Content-Length: " + QByteArray::number(to - from + 1) + "\r\nConnection: close\r\n\r\n";
+        ::send(fd, reply.constData(), reply.size(), MSG_NOSIGNAL);
+
+        off_t offset = static_cast<off_t>(from);
+        qint64 left = to - from + 1;
+        while (file >= 0 && left > 0) {
+            const ssize_t n = ::sendfile(fd, file, &offset, static_cast<size_t>(qMin<qint64>(left, 1 << 20)));
+            if (n <= 0) break;
+            left -= n;
+        }
+        if (file >= 0) ::close(file);
+        ::shutdown(fd, SHUT_WR);
+        while (::recv(fd, buffer, sizeof(buffer), 0) > 0) {}
+        ::close(fd);
+    }
+
+    QString m_sourcePath;
+    int m_listenFd = -1;
+    quint16 m_port = 0;
+    std::atomic<bool> m_stopping { false };
+    std::thread m_acceptor;
+};
+
+#endif
+
+BenchResult runQt(quint16 port, const QString& target, qint64 totalBytes, int ranges)
+{
+    BenchResult out;
+    QFile file(target);
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        out.ok = false;
+        return out;
+    }
+
+    QNetworkAccessManager manager;
+    QEventLoop loop;
+    int finished = 0;
+    const qint64 rangeBytes = totalBytes / ranges;
+
+    const std::clock_t cpuBefore = std::clock();
+    QElapsedTimer wall;
+    wall.start();
+
+    for (int i = 0; i < ranges; ++i) {
+        const qint64 from = i * rangeBytes;
+        const qint64 to = i + 1 == ranges ? totalBytes - 1 : from + rangeBytes - 1;
+        QNetworkRequest req(QUrl(QStringLiteral("http://127.0.0.1:%1/source.bin").arg(port)));
+        req.setRawHeader("Range", QByteArray("bytes=") + QByteArray::number(from) + '-' + QByteArray::number(to));
+        QNetworkReply* reply = manager.get(req);
+        reply->setReadBufferSize(256 * 1024);
+        auto offset = std::make_shared<qint64>(from);
+        QObject::connect(reply, &QNetworkReply::readyRead, reply, [&, reply, offset] {
+            const QByteArray data = reply->readAll();
+            file.seek(*offset);
+            file.write(data);
+            *offset += data.size();
+            out.bytes += data.size();
+        });
+        QObject::connect(reply, &QNetworkReply::finished, reply, [&, reply] {
+            if (reply->error() != QNetworkReply::NoError) out.ok = false;
+            reply->deleteLater();
+            if (++finished == ranges) loop.quit();
+        });
+    }
+    loop.exec();
+
+    out.seconds = wall.nsecsElapsed() / 1e9;
+    out.cpuSeconds = static_cast<double>(std::clock() - cpuBefore) / CLOCKS_PER_SEC;
+    file.close();
+    return out;
+}
+
+BenchResult runNative(quint16 port, const QString& target, qint64 totalBytes, int ranges)
+{
+    BenchResult out;
+    QFile::remove(target);
+
+    QObject receiver;
+    QEventLoop loop;
+    int finished = 0;
+    const qint64 rangeBytes = totalBytes / ranges;
+
+    const std::clock_t cpuBefore = std::clock();
+    QElapsedTimer wall;
+    wall.start();
+
+    for (int i = 0; i < ranges; ++i) {
+        RangeEngine::Request request;
+        request.address = QHostAddress(QHostAddress::LocalHost);
+        request.port = port;
+        request.target = "/source.bin";
+        request.host = "127.0.0.1:" + QByteArray::number(port);
+        request.from = i * rangeBytes;
+        request.to = i + 1 == ranges ? totalBytes - 1 : request.from + rangeBytes - 1;
+        request.totalSize = totalBytes;
+        request.path = target;
+        request.fileOffset = request.from;
+        const int id = RangeEngine::instance().start(std::move(request), &receiver, [&](const RangeEngine::Event& event) {
+            if (event.kind != RangeEngine::EventKind::Finished) return;
+            if (!event.ok) {
+                QTextStream(stderr) << "  " << event.errorCode << ": " << event.errorMessage << Qt::endl;
+                out.ok = false;
+            }
+            out.bytes += event.bytes;
+            if (++finished == ranges) loop.quit();
+        });
+        if (id <= 0) {
+            out.ok = false;
+            return out;
+        }
+    }
+    loop.exec();
+
+    out.seconds = wall.nsecsElapsed() / 1e9;
+    out.cpuSeconds = static_cast<double>(std::clock() - cpuBefore) / CLOCKS_PER_SEC;
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Qt versus native range transport benchmark"));
+    parser.addHelpOption();
+    QCommandLineOption sizeOption(QStringLiteral("size"), QStringLiteral("MiB fetched per run."), QStringLiteral("mib"), QStringLiteral("1024"));
+    QCommandLineOption rangesOption(QStringLiteral("ranges"), QStringLiteral("Concurrent ranged requests."), QStringLiteral("count"), QStringLiteral("8"));
+    parser.addOption(sizeOption);
+    parser.addOption(rangesOption);
+    parser.addPositionalArgument(QStringLiteral("dirs"), QStringLiteral("Directories to download into (e.g. a tmpfs and a disk)."));
+    parser.process(app);
+
+    QTextStream out(stdout);
+#if defined(Q_OS_LINUX)
+    const qint64 totalBytes = qMax<qint64>(1, parser.value(sizeOption).toLongLong()) * 1024 * 1024;
+    const int ranges = qBound(1, parser.value(rangesOption).toInt(), 64);
+    QStringList dirs = parser.positionalArguments();
+    if (dirs.isEmpty()) dirs << QDir::tempPath();
+
+    const QString source = QDir(QDir::tempPath()).filePath(QStringLiteral("raad-bench-source.bin"));
+    {
+        QFile file(source);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            out << "cannot create " << source << Qt::endl;
+            return 1;
+        }
+        QByteArray block(1024 * 1024, '\0');
+        for (qsizetype i = 0; i < block.size(); ++i) block[i] = static_cast<char>(i * 131 + 7);
+        for (qint64 written = 0; written < totalBytes; written += block.size()) {
+            file.write(block.constData(), qMin<qint64>(block.size(), totalBytes - written));
+        }
+    }
+
+    LoopbackServer server(source);
+    if (!server.listen()) {
+        out << "cannot listen on loopback" << Qt::endl;
+        return 1;
+    }
+
+    out << "dir\ttransport\tMiB/s\tcpu_s/GiB" << Qt::endl;
+    int status = 0;
+    for (const QString& dir : std::as_const(dirs)) {
+        const QString target = QDir(dir).filePath(QStringLiteral("raad-bench-target.bin"));
+        const qint64 splicedBefore = RangeEngine::instance().splicedBytes();
+        const QList<std::pair<QString, BenchResult>> results {
+            { QStringLiteral("qt"), runQt(server.port(), target, totalBytes, ranges) },
+            { QStringLiteral("native"), runNative(server.port(), target, totalBytes, ranges) },
+        };
+        for (const auto& [name, r] : results) {
+            if (!r.ok || r.bytes != totalBytes) {
+                out << dir << '\t' << name << "\tfailed" << Qt::endl;
+                status = 1;
+                continue;
+            }
+            const double gib = static_cast<double>(r.bytes) / (1024.0 * 1024.0 * 1024.0);
+            out << dir << '\t' << name << '\t'
+                << QString::number(r.bytes / (1024.0 * 1024.0) / r.seconds, 'f', 1) << '\t'
+                << QString::number(r.cpuSeconds / gib, 'f', 3) << Qt::endl;
+        }
+        const qint64 spliced = RangeEngine::instance().splicedBytes() - splicedBefore;
+        if (spliced < totalBytes) {
+            out << dir << "\tnative\t" << (totalBytes - spliced) / (1024 * 1024) << " MiB copied (no splice to this filesystem)" << Qt::endl;
+        }
+        QFile::remove(target);
+    }
+    QFile::remove(source);
+    return status;
+#else
+    Q_UNUSED(sizeOption);
+    Q_UNUSED(rangesOption);
+    out << "the native range transport is only available on Linux" << Qt::endl;
+    return 0;
+#endif
+}